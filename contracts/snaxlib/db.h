@@ -223,6 +223,53 @@ int32_t db_upperbound_i64(account_name code, account_name scope, table_name tabl
   */
 int32_t db_end_i64(account_name code, account_name scope, table_name table);
 
+/**
+  *
+  *  Find and get several records of a primary 64-bit integer index table with a single call, as if `db_find_i64` and then `db_get_i64` had been called for each of them
+  *
+  *  @brief Find and get several records of a primary 64-bit integer index table
+  *  @param code - The name of the owner of the table
+  *  @param scope - The scope where the table resides
+  *  @param table - The table name
+  *  @param ids - The primary keys of the records
+  *  @param count - Number of primary keys
+  *  @param iterators - Pointer to the buffer which will be filled with the iterator of each record, as `db_find_i64` would return it
+  *  @param iterators_count - Number of iterators, must be equal to `count`
+  *  @param data - Pointer to the buffer which will be filled with the records found, in order, each as its `uint32_t` size followed by the record
+  *  @param len - Size of the buffer
+  *  @return size the records found take in the buffer; when it is larger than `len` the buffer is left unchanged
+  *  @pre `ids` and `iterators` are valid pointers to ranges of memory at least `count` elements long
+  *  @pre `data` is a valid pointer to a range of memory at least `len` bytes long
+  *
+  *  Example:
+  *
+  *  @code
+  *  uint64_t ids[2] = { N(alice), N(bob) };
+  *  int32_t itrs[2];
+  *  char buffer[128];
+  *  auto len = db_get_many_i64(receiver, receiver, table1, ids, 2, itrs, 2, buffer, sizeof(buffer));
+  *  snax_assert(len <= sizeof(buffer), "buffer to small to store retrieved records");
+  *  @endcode
+  */
+int32_t db_get_many_i64(account_name code, account_name scope, table_name table, const uint64_t* ids, uint32_t count, int32_t* iterators, uint32_t iterators_count, void* data, uint32_t len);
+
+/**
+  *
+  *  Update several records of a primary 64-bit integer index table with a single call, as if `db_update_i64` had been called for each of them in order
+  *
+  *  @brief Update several records of a primary 64-bit integer index table
+  *  @param iterators - Iterators to the table rows containing the records to update
+  *  @param count - Number of iterators
+  *  @param payer - The account that pays for the storage costs (use 0 to continue using the current payer of each record)
+  *  @param data - The new updated records, in the order of the iterators, each as its `uint32_t` size followed by the record
+  *  @param len - Size of data
+  *  @pre `iterators` is a valid pointer to a range of memory at least `count` elements long
+  *  @pre `data` holds exactly `count` records
+  *  @pre each iterator points to an existing table row in the table
+  *  @post the records contained in the table rows pointed to by `iterators` are replaced with the new updated records
+  */
+void db_update_many_i64(const int32_t* iterators, uint32_t count, account_name payer, const void* data, uint32_t len);
+
 /**
   *
   *  Store an association of a 64-bit integer secondary key to a primary key in a secondary 64-bit integer index table
@@ -548,14 +548,16 @@ class multi_index
 
       indices_type _indices;
 
-      const item& load_object_by_primary_iterator( int32_t itr )const {
-         using namespace _multi_index_detail;
-
+      const item* find_object_by_primary_iterator( int32_t itr )const {
          auto itr2 = std::find_if(_items_vector.rbegin(), _items_vector.rend(), [&](const item_ptr& ptr) {
             return ptr._primary_itr == itr;
          });
-         if( itr2 != _items_vector.rend() )
-            return *itr2->_item;
+         return itr2 != _items_vector.rend() ? itr2->_item.get() : nullptr;
+      }
+
+      const item& load_object_by_primary_iterator( int32_t itr )const {
+         if( const item* cached = find_object_by_primary_iterator( itr ) )
+            return *cached;
 
          auto size = db_get_i64( itr, nullptr, 0 );
          snax_assert( size >= 0, "error reading iterator" );
@@ -565,12 +567,21 @@ class multi_index
 
          db_get_i64( itr, buffer, uint32_t(size) );
 
-         datastream<const char*> ds( (char*)buffer, uint32_t(size) );
+         const item& obj = load_object( itr, (const char*)buffer, uint32_t(size) );
 
          if ( max_stack_buffer_size < size_t(size) ) {
             free(buffer);
          }
 
+         return obj;
+      } /// load_object_by_primary_iterator
+
+      /// unpacks the object read from the table row at the primary iterator into the cache of loaded objects
+      const item& load_object( int32_t itr, const char* data, uint32_t size )const {
+         using namespace _multi_index_detail;
+
+         datastream<const char*> ds( data, size );
+
          auto itm = std::make_unique<item>( this, [&]( auto& i ) {
             T& val = static_cast<T&>(i);
             ds >> val;
@@ -590,7 +601,42 @@ class multi_index
          _items_vector.emplace_back( std::move(itm), pk, pitr );
 
          return *ptr;
-      } /// load_object_by_primary_iterator
+      } /// load_object
+
+      auto extract_secondary_keys( const T& obj )const {
+         return hana::transform( _indices, [&]( auto&& idx ) {
+            typedef typename decltype(+hana::at_c<0>(idx))::type index_type;
+
+            return index_type::extract_secondary_key( obj );
+         });
+      }
+
+      /// updates the secondary indices whose key differs from the one the object had before it was modified
+      template<typename SecondaryKeys>
+      void update_secondary_indices( const item& objitem, uint64_t payer, const SecondaryKeys& secondary_keys ) {
+         using namespace _multi_index_detail;
+
+         auto& mutableitem = const_cast<item&>(objitem);
+         const T& obj = objitem;
+         auto pk = obj.primary_key();
+
+         hana::for_each( _indices, [&]( auto& idx ) {
+            typedef typename decltype(+hana::at_c<0>(idx))::type index_type;
+
+            auto secondary = index_type::extract_secondary_key( obj );
+            if( memcmp( &hana::at_c<index_type::index_number>(secondary_keys), &secondary, sizeof(secondary) ) != 0 ) {
+               auto indexitr = mutableitem.__iters[index_type::number()];
+
+               if( indexitr < 0 ) {
+                  typename index_type::secondary_key_type temp_secondary_key;
+                  indexitr = mutableitem.__iters[index_type::number()]
+                           = secondary_index_db_functions<typename index_type::secondary_key_type>::db_idx_find_primary( _code, _scope, index_type::name(), pk,  temp_secondary_key );
+               }
+
+               secondary_index_db_functions<typename index_type::secondary_key_type>::db_idx_update( indexitr, payer, secondary );
+            }
+         });
+      }
 
    public:
       /**
@@ -1836,14 +1882,9 @@ class multi_index
 
          const auto& objitem = static_cast<const item&>(obj);
          snax_assert( objitem.__idx == this, "object passed to modify is not in multi_index" );
-         auto& mutableitem = const_cast<item&>(objitem);
          snax_assert( _code == current_receiver(), "cannot modify objects in table of another contract" ); // Quick fix for mutating db using multi_index that shouldn't allow mutation. Real fix can come in RC2.
 
-         auto secondary_keys = hana::transform( _indices, [&]( auto&& idx ) {
-            typedef typename decltype(+hana::at_c<0>(idx))::type index_type;
-
-            return index_type::extract_secondary_key( obj );
-         });
+         auto secondary_keys = extract_secondary_keys( obj );
 
          auto pk = obj.primary_key();
 
@@ -1868,22 +1909,81 @@ class multi_index
          if( pk >= _next_primary_key )
             _next_primary_key = (pk >= no_available_primary_key) ? no_available_primary_key : (pk + 1);
 
-         hana::for_each( _indices, [&]( auto& idx ) {
-            typedef typename decltype(+hana::at_c<0>(idx))::type index_type;
+         update_secondary_indices( objitem, payer, secondary_keys );
+      }
 
-            auto secondary = index_type::extract_secondary_key( obj );
-            if( memcmp( &hana::at_c<index_type::index_number>(secondary_keys), &secondary, sizeof(secondary) ) != 0 ) {
-               auto indexitr = mutableitem.__iters[index_type::number()];
+      /**
+       *  Modifies several existing objects of a table, storing all of them with a single call to the chain.
+       *  @brief Modifies several existing objects of a table.
+       *
+       *  @param objects - the objects to be updated, for instance as returned by find_many
+       *  @param payer - account name of the payer for the Storage usage of the updated rows
+       *  @param updater - lambda function that updates each of the target objects
+       *
+       *  @pre each object is an existing object in the table, listed once
+       *  @pre payer is a valid account that is authorized to execute the action and be billed for storage usage.
+       *
+       *  @post Same as calling modify() on each of the objects in order, except that the secondary indices of the objects are updated once all of them are stored.
+       *
+       *  Exceptions:
+       *  If called with an invalid precondition, execution is aborted.
+       *
+       *  Example:
+       *
+       *  @code
+       *  auto users = addresses.find_many( { N(dan), N(brendan) } );
+       *  snax_assert( users[0] && users[1], "Address for account not found" );
+       *  addresses.modify_many( users, payer, [&]( auto& address ) {
+       *    address.state = "CA";
+       *  });
+       *  @endcode
+       */
+      template<typename Lambda>
+      void modify_many( const std::vector<const T*>& objects, uint64_t payer, Lambda&& updater ) {
+         using namespace _multi_index_detail;
 
-               if( indexitr < 0 ) {
-                  typename index_type::secondary_key_type temp_secondary_key;
-                  indexitr = mutableitem.__iters[index_type::number()]
-                           = secondary_index_db_functions<typename index_type::secondary_key_type>::db_idx_find_primary( _code, _scope, index_type::name(), pk,  temp_secondary_key );
-               }
+         snax_assert( _code == current_receiver(), "cannot modify objects in table of another contract" );
 
-               secondary_index_db_functions<typename index_type::secondary_key_type>::db_idx_update( indexitr, payer, secondary );
-            }
-         });
+         std::vector<decltype( extract_secondary_keys( std::declval<const T&>() ) )> secondary_keys;
+         secondary_keys.reserve( objects.size() );
+         std::vector<int32_t> iterators;
+         iterators.reserve( objects.size() );
+         std::vector<char> buffer;
+
+         for( const T* obj : objects ) {
+            snax_assert( obj != nullptr, "cannot pass a missing object to modify_many" );
+            const auto& objitem = static_cast<const item&>(*obj);
+            snax_assert( objitem.__idx == this, "object passed to modify is not in multi_index" );
+
+            secondary_keys.push_back( extract_secondary_keys( *obj ) );
+
+            auto pk = obj->primary_key();
+
+            updater( const_cast<T&>(*obj) );
+
+            snax_assert( pk == obj->primary_key(), "updater cannot change primary key when modifying an object" );
+
+            // each object is stored as its size followed by the object
+            uint32_t size = pack_size( *obj );
+            auto offset = buffer.size();
+            buffer.resize( offset + sizeof(size) + size );
+            datastream<char*> ds( buffer.data() + offset, sizeof(size) + size );
+            ds.write( (const char*)&size, sizeof(size) );
+            ds << *obj;
+
+            iterators.push_back( objitem.__primary_itr );
+
+            if( pk >= _next_primary_key )
+               _next_primary_key = (pk >= no_available_primary_key) ? no_available_primary_key : (pk + 1);
+         }
+
+         if( iterators.empty() ) return;
+
+         db_update_many_i64( iterators.data(), iterators.size(), payer, buffer.data(), buffer.size() );
+
+         for( size_t i = 0; i < objects.size(); ++i ) {
+            update_secondary_indices( static_cast<const item&>(*objects[i]), payer, secondary_keys[i] );
+         }
       }
 
       /**
@@ -1998,6 +2098,63 @@ class multi_index
          return iterator_to(static_cast<const T&>(i));
       }
 
+      /**
+       *  Search for several existing objects in a table using their primary keys, reading all of those not loaded yet with a single call to the chain.
+       *  @brief Search for several existing objects in a table using their primary keys.
+       *
+       *  @param primary_keys - Primary key values of the objects
+       *  @return For each primary key, a pointer to the object which has that primary key OR nullptr if the table has no such object.
+       *
+       *  Example:
+       *
+       *  @code
+       *  auto found = addresses.find_many( { N(dan), N(brendan) } );
+       *  snax_assert( found[0] != nullptr, "Couldn't get him." );
+       *  @endcode
+       */
+      std::vector<const T*> find_many( const std::vector<uint64_t>& primary_keys )const {
+         std::vector<const T*> objects( primary_keys.size(), nullptr );
+
+         std::vector<uint64_t> ids;
+         std::vector<size_t>   positions;
+         for( size_t i = 0; i < primary_keys.size(); ++i ) {
+            auto itr2 = std::find_if(_items_vector.rbegin(), _items_vector.rend(), [&](const item_ptr& ptr) {
+               return ptr._item->primary_key() == primary_keys[i];
+            });
+            if( itr2 != _items_vector.rend() ) {
+               objects[i] = itr2->_item.get();
+            } else {
+               ids.push_back( primary_keys[i] );
+               positions.push_back( i );
+            }
+         }
+         if( ids.empty() ) return objects;
+
+         // rows usually pack to about the size of the object, so most calls are answered the first time
+         std::vector<int32_t> iterators( ids.size() );
+         std::vector<char> buffer( ids.size() * (sizeof(uint32_t) + sizeof(T)) );
+         auto size = db_get_many_i64( _code, _scope, TableName, ids.data(), ids.size(), iterators.data(), iterators.size(), buffer.data(), buffer.size() );
+         snax_assert( size >= 0, "error reading iterators" );
+         if( size_t(size) > buffer.size() ) {
+            buffer.resize( size_t(size) );
+            db_get_many_i64( _code, _scope, TableName, ids.data(), ids.size(), iterators.data(), iterators.size(), buffer.data(), buffer.size() );
+         }
+
+         datastream<const char*> ds( buffer.data(), size_t(size) );
+         for( size_t j = 0; j < ids.size(); ++j ) {
+            if( iterators[j] < 0 ) continue;
+
+            uint32_t row_size = 0;
+            ds.read( (char*)&row_size, sizeof(row_size) );
+            // the same key may be listed more than once
+            const item* cached = find_object_by_primary_iterator( iterators[j] );
+            objects[positions[j]] = cached ? cached : &load_object( iterators[j], ds.pos(), row_size );
+            ds.skip( row_size );
+         }
+
+         return objects;
+      }
+
       /**
        *  Search for an existing object in a table using its primary key.
        *  @brief Search for an existing object in a table using its primary key.
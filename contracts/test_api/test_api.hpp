@@ -80,6 +80,12 @@ struct test_db {
    static void primary_i64_general(uint64_t receiver, uint64_t code, uint64_t action);
    static void primary_i64_lowerbound(uint64_t receiver, uint64_t code, uint64_t action);
    static void primary_i64_upperbound(uint64_t receiver, uint64_t code, uint64_t action);
+   static void primary_i64_many(uint64_t receiver, uint64_t code, uint64_t action);
+   static void primary_i64_many_invalid(uint64_t receiver, uint64_t code, uint64_t action);
+   static void primary_i64_many_count_mismatch(uint64_t receiver, uint64_t code, uint64_t action);
+   static void primary_i64_bench_setup(uint64_t receiver, uint64_t code, uint64_t action);
+   static void primary_i64_bench_per_row(uint64_t receiver, uint64_t code, uint64_t action);
+   static void primary_i64_bench_many(uint64_t receiver, uint64_t code, uint64_t action);
 
    static void idx64_general(uint64_t receiver, uint64_t code, uint64_t action);
    static void idx64_lowerbound(uint64_t receiver, uint64_t code, uint64_t action);
@@ -13,6 +13,12 @@ extern "C" {
       WASM_TEST_HANDLER_EX(test_db, primary_i64_general);
       WASM_TEST_HANDLER_EX(test_db, primary_i64_lowerbound);
       WASM_TEST_HANDLER_EX(test_db, primary_i64_upperbound);
+      WASM_TEST_HANDLER_EX(test_db, primary_i64_many);
+      WASM_TEST_HANDLER_EX(test_db, primary_i64_many_invalid);
+      WASM_TEST_HANDLER_EX(test_db, primary_i64_many_count_mismatch);
+      WASM_TEST_HANDLER_EX(test_db, primary_i64_bench_setup);
+      WASM_TEST_HANDLER_EX(test_db, primary_i64_bench_per_row);
+      WASM_TEST_HANDLER_EX(test_db, primary_i64_bench_many);
       WASM_TEST_HANDLER_EX(test_db, idx64_general);
       WASM_TEST_HANDLER_EX(test_db, idx64_lowerbound);
       WASM_TEST_HANDLER_EX(test_db, idx64_upperbound);
@@ -180,6 +180,122 @@ void test_db::primary_i64_general(uint64_t receiver, uint64_t code, uint64_t act
    }
 }
 
+void test_db::primary_i64_many(uint64_t receiver, uint64_t code, uint64_t action)
+{
+   (void)code; (void)action;
+   auto table1 = N(table1);
+
+   db_store_i64(receiver, table1, receiver, N(alice), "alice's info", strlen("alice's info"));
+   db_store_i64(receiver, table1, receiver, N(bob), "bob's info", strlen("bob's info"));
+
+   uint64_t ids[3] = { N(bob), N(carol), N(alice) };
+   int32_t itrs[3];
+   char buffer[64];
+   const uint32_t expected_size = 2 * sizeof(uint32_t) + strlen("bob's info") + strlen("alice's info");
+
+   // get
+   {
+      my_memset(buffer, 0, sizeof(buffer));
+      int size = db_get_many_i64(receiver, receiver, table1, ids, 3, itrs, 3, buffer, sizeof(uint32_t));
+      snax_assert(size == expected_size, "primary_i64_many - db_get_many_i64 size");
+      snax_assert(buffer[0] == 0, "primary_i64_many - db_get_many_i64 buffer too small");
+
+      snax_assert(itrs[0] == db_find_i64(receiver, receiver, table1, N(bob)), "primary_i64_many - db_get_many_i64 bob");
+      snax_assert(itrs[1] == db_end_i64(receiver, receiver, table1), "primary_i64_many - db_get_many_i64 carol");
+      snax_assert(itrs[2] == db_find_i64(receiver, receiver, table1, N(alice)), "primary_i64_many - db_get_many_i64 alice");
+
+      size = db_get_many_i64(receiver, receiver, table1, ids, 3, itrs, 3, buffer, sizeof(buffer));
+      snax_assert(size == expected_size, "primary_i64_many - db_get_many_i64 size");
+
+      uint32_t len = 0;
+      memcpy(&len, buffer, sizeof(len));
+      snax_assert(len == strlen("bob's info") && my_memcmp(buffer + sizeof(len), (void*)"bob's info", len),
+                   "primary_i64_many - db_get_many_i64 bob");
+      char* alice = buffer + sizeof(len) + len;
+      memcpy(&len, alice, sizeof(len));
+      snax_assert(len == strlen("alice's info") && my_memcmp(alice + sizeof(len), (void*)"alice's info", len),
+                   "primary_i64_many - db_get_many_i64 alice");
+   }
+
+   // update
+   {
+      // the records db_get_many_i64 returns are laid out the way db_update_many_i64 takes them
+      buffer[sizeof(uint32_t)] = 'B';
+      int32_t found[2] = { itrs[0], itrs[2] };
+      db_update_many_i64(found, 2, 0, buffer, expected_size);
+
+      char value[32];
+      int len = db_get_i64(itrs[0], value, sizeof(value));
+      snax_assert(len == strlen("Bob's info") && my_memcmp(value, (void*)"Bob's info", len), "primary_i64_many - db_update_many_i64");
+      len = db_get_i64(itrs[2], value, sizeof(value));
+      snax_assert(len == strlen("alice's info") && my_memcmp(value, (void*)"alice's info", len), "primary_i64_many - db_update_many_i64");
+   }
+}
+
+void test_db::primary_i64_many_invalid(uint64_t receiver, uint64_t code, uint64_t action)
+{
+   (void)code; (void)action;
+   auto table1 = N(table2);
+
+   char buffer[16];
+   uint32_t len = 4;
+   memcpy(buffer, &len, sizeof(len));
+   int32_t itr = db_store_i64(receiver, table1, receiver, N(alice), "info", len);
+   memcpy(buffer + sizeof(len), "info", len);
+   // one value more than rows
+   memcpy(buffer + sizeof(len) + len, buffer, sizeof(len) + len);
+   db_update_many_i64(&itr, 1, 0, buffer, sizeof(buffer));
+}
+
+void test_db::primary_i64_many_count_mismatch(uint64_t receiver, uint64_t code, uint64_t action)
+{
+   (void)code; (void)action;
+   uint64_t ids[2] = { N(alice), N(bob) };
+   int32_t itrs[1];
+   char buffer[64];
+   db_get_many_i64(receiver, receiver, N(table1), ids, 2, itrs, 1, buffer, sizeof(buffer));
+}
+
+const uint32_t bench_rows = 500;
+const uint32_t bench_row_size = 32;
+uint64_t bench_ids[bench_rows];
+int32_t bench_itrs[bench_rows];
+char bench_buffer[bench_rows * (sizeof(uint32_t) + bench_row_size)];
+
+void test_db::primary_i64_bench_setup(uint64_t receiver, uint64_t code, uint64_t action)
+{
+   (void)code; (void)action;
+   char value[bench_row_size];
+   my_memset(value, 0, sizeof(value));
+   for( uint32_t i = 0; i < bench_rows; ++i ) {
+      db_store_i64(receiver, N(bench), receiver, i, value, sizeof(value));
+   }
+}
+
+void test_db::primary_i64_bench_per_row(uint64_t receiver, uint64_t code, uint64_t action)
+{
+   (void)code; (void)action;
+   char value[bench_row_size];
+   for( uint32_t i = 0; i < bench_rows; ++i ) {
+      int32_t itr = db_find_i64(receiver, receiver, N(bench), i);
+      db_get_i64(itr, value, sizeof(value));
+      ++value[0];
+      db_update_i64(itr, 0, value, sizeof(value));
+   }
+}
+
+void test_db::primary_i64_bench_many(uint64_t receiver, uint64_t code, uint64_t action)
+{
+   (void)code; (void)action;
+   for( uint32_t i = 0; i < bench_rows; ++i ) bench_ids[i] = i;
+   int size = db_get_many_i64(receiver, receiver, N(bench), bench_ids, bench_rows, bench_itrs, bench_rows, bench_buffer, sizeof(bench_buffer));
+   snax_assert(size == sizeof(bench_buffer), "primary_i64_bench_many - db_get_many_i64");
+   for( uint32_t i = 0; i < bench_rows; ++i ) {
+      ++bench_buffer[i * (sizeof(uint32_t) + bench_row_size) + sizeof(uint32_t)];
+   }
+   db_update_many_i64(bench_itrs, bench_rows, 0, bench_buffer, sizeof(bench_buffer));
+}
+
 void test_db::primary_i64_lowerbound(uint64_t receiver, uint64_t code, uint64_t action)
 {
    (void)code;(void)action;
@@ -5,6 +5,7 @@
 #include <snax/chain/exceptions.hpp>
 #include <snax/chain/wasm_interface.hpp>
 #include <snax/chain/generated_transaction_object.hpp>
+#include <snax/chain/key_value_hash_index.hpp>
 #include <snax/chain/authorization_manager.hpp>
 #include <snax/chain/resource_limits.hpp>
 #include <snax/chain/account_object.hpp>
@@ -419,27 +420,39 @@ bool apply_context::cancel_deferred_transaction( const uint128_t& sender_id, acc
 }
 
 const table_id_object* apply_context::find_table( name code, name scope, name table ) {
-   return db.find<table_id_object, by_code_scope_table>(boost::make_tuple(code, scope, table));
+   const auto* tab = trx_context.table_reads.find_table( code, scope, table );
+   if( tab ) return tab;
+
+   tab = db.find<table_id_object, by_code_scope_table>(boost::make_tuple(code, scope, table));
+   if( tab ) trx_context.table_reads.add_table( *tab );
+   return tab;
 }
 
 const table_id_object& apply_context::find_or_create_table( name code, name scope, name table, const account_name &payer ) {
-   const auto* existing_tid =  db.find<table_id_object, by_code_scope_table>(boost::make_tuple(code, scope, table));
+   const auto* existing_tid = trx_context.table_reads.find_table( code, scope, table );
+   if( existing_tid == nullptr ) {
+      existing_tid = db.find<table_id_object, by_code_scope_table>(boost::make_tuple(code, scope, table));
+   }
    if (existing_tid != nullptr) {
+      trx_context.table_reads.add_table( *existing_tid );
       return *existing_tid;
    }
 
    update_db_usage(payer, config::billable_size_v<table_id_object>);
 
-   return db.create<table_id_object>([&](table_id_object &t_id){
+   const auto& tab = db.create<table_id_object>([&](table_id_object &t_id){
       t_id.code = code;
       t_id.scope = scope;
       t_id.table = table;
       t_id.payer = payer;
    });
+   trx_context.table_reads.add_table( tab );
+   return tab;
 }
 
 void apply_context::remove_table( const table_id_object& tid ) {
    update_db_usage(tid.payer, - config::billable_size_v<table_id_object>);
+   trx_context.table_reads.remove_table( tid );
    db.remove(tid);
 }
 
@@ -542,6 +555,8 @@ int apply_context::db_store_i64( uint64_t code, uint64_t scope, uint64_t table,
    int64_t billable_size = (int64_t)(buffer_size + config::billable_size_v<key_value_object>);
    update_db_usage( payer, billable_size);
 
+   trx_context.table_reads.add_row( obj );
+   if( auto* rows = control.row_hash_index() ) rows->add( obj );
    keyval_cache.cache_table( tab );
    return keyval_cache.add( obj );
 }
@@ -590,6 +605,8 @@ void apply_context::db_remove_i64( int iterator ) {
    db.modify( table_obj, [&]( auto& t ) {
       --t.count;
    });
+   trx_context.table_reads.remove_row( obj );
+   if( auto* rows = control.row_hash_index() ) rows->remove( obj );
    db.remove( obj );
 
    if (table_obj.count == 0) {
@@ -666,8 +683,13 @@ int apply_context::db_find_i64( uint64_t code, uint64_t scope, uint64_t table, u
 
    auto table_end_itr = keyval_cache.cache_table( *tab );
 
-   const key_value_object* obj = db.find<key_value_object, by_scope_primary>( boost::make_tuple( tab->id, id ) );
-   if( !obj ) return table_end_itr;
+   const key_value_object* obj = trx_context.table_reads.find_row( tab->id, id );
+   if( !obj ) {
+      auto* rows = control.row_hash_index();
+      obj = rows ? rows->find( tab->id, id ) : db.find<key_value_object, by_scope_primary>( boost::make_tuple( tab->id, id ) );
+      if( !obj ) return table_end_itr;
+      trx_context.table_reads.add_row( *obj );
+   }
 
    return keyval_cache.add( *obj );
 }
@@ -713,6 +735,53 @@ int apply_context::db_end_i64( uint64_t code, uint64_t scope, uint64_t table ) {
    return keyval_cache.cache_table( *tab );
 }
 
+/**
+ *  Finds the rows with the given primary keys like db_find_i64, storing their iterators, then copies the rows found
+ *  to the buffer like db_get_i64, each as its uint32_t size followed by its value. Nothing is copied if the rows
+ *  do not all fit in the buffer.
+ *
+ *  @return the size the rows found take in the buffer
+ */
+int apply_context::db_get_many_i64( uint64_t code, uint64_t scope, uint64_t table, const uint64_t* ids, int* iterators, size_t count, char* buffer, size_t buffer_size ) {
+   uint64_t size = 0;
+   for( size_t i = 0; i < count; ++i ) {
+      trx_context.checktime();
+      iterators[i] = db_find_i64( code, scope, table, ids[i] );
+      if( iterators[i] >= 0 )
+         size += sizeof(uint32_t) + keyval_cache.get( iterators[i] ).value.size();
+   }
+   SNAX_ASSERT( size <= uint64_t(std::numeric_limits<int>::max()), table_operation_not_permitted, "rows are too large to be read in one batch" );
+   if( size > buffer_size ) return size;
+
+   fc::datastream<char*> ds( buffer, buffer_size );
+   for( size_t i = 0; i < count; ++i ) {
+      if( iterators[i] < 0 ) continue;
+      const key_value_object& obj = keyval_cache.get( iterators[i] );
+      const uint32_t value_size = obj.value.size();
+      ds.write( (const char*)&value_size, sizeof(value_size) );
+      ds.write( obj.value.data(), value_size );
+   }
+   return size;
+}
+
+/**
+ *  Updates the rows the iterators point to like db_update_i64, in order, with the values in the buffer, each given
+ *  as its uint32_t size followed by the value. The buffer must hold exactly one value per iterator.
+ */
+void apply_context::db_update_many_i64( const int* iterators, size_t count, account_name payer, const char* buffer, size_t buffer_size ) {
+   fc::datastream<const char*> ds( buffer, buffer_size );
+   for( size_t i = 0; i < count; ++i ) {
+      trx_context.checktime();
+      uint32_t value_size = 0;
+      SNAX_ASSERT( ds.remaining() >= sizeof(value_size), invalid_table_batch, "missing the value of row ${i} of the batch", ("i", i) );
+      ds.read( (char*)&value_size, sizeof(value_size) );
+      SNAX_ASSERT( ds.remaining() >= value_size, invalid_table_batch, "missing the value of row ${i} of the batch", ("i", i) );
+      db_update_i64( iterators[i], payer, ds.pos(), value_size );
+      ds.skip( value_size );
+   }
+   SNAX_ASSERT( ds.remaining() == 0, invalid_table_batch, "more values than rows in the batch" );
+}
+
 uint64_t apply_context::next_global_sequence() {
    const auto& p = control.get_dynamic_global_properties();
    db.modify( p, [&]( auto& dgp ) {
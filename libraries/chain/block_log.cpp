@@ -5,13 +5,36 @@
 #include <snax/chain/block_log.hpp>
 #include <snax/chain/exceptions.hpp>
 #include <fstream>
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <future>
+#include <functional>
 #include <fc/io/raw.hpp>
 
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+
+#include <fcntl.h>
+#include <unistd.h>
+
 #define LOG_READ  (std::ios::in | std::ios::binary)
 #define LOG_WRITE (std::ios::out | std::ios::binary | std::ios::app)
 
 namespace snax { namespace chain {
 
+   namespace bip = boost::interprocess;
+   namespace bfs = boost::filesystem;
+   namespace bio = boost::iostreams;
+
    const uint32_t block_log::min_supported_version = 1;
 
    /**
@@ -19,66 +42,516 @@ namespace snax { namespace chain {
     * Version 1: complete block log from genesis
     * Version 2: adds optional partial block log, cannot be used for replay without snapshot
     *            this is in the form of an first_block_num that is written immediately after the version
+    * Version 3: blocks may be compressed, each block is preceded by its compression and the size of its data
     */
-   const uint32_t block_log::max_supported_version = 2;
+   const uint32_t block_log::max_supported_version = 3;
 
    namespace detail {
+      /// a block appended to the log that the writer thread has not written yet
+      struct queued_block {
+         signed_block_ptr                     block;
+         std::shared_ptr<const vector<char>>  data;  ///< the packed block
+         std::shared_ptr<const vector<char>>  entry; ///< what is written to the log for it, the same as data before version 3
+         uint64_t                             pos = 0;
+      };
+
+      /// a version 3 block entry starts with the compression of the block and the size of the data that follows
+      const uint64_t entry_header_size = sizeof(uint8_t) + sizeof(uint32_t);
+
+      static vector<char> zlib_decompress( const char* data, size_t size ) {
+         try {
+            vector<char> out;
+            bio::filtering_ostream decomp;
+            decomp.push( bio::zlib_decompressor() );
+            decomp.push( bio::back_inserter( out ) );
+            bio::write( decomp, data, size );
+            bio::close( decomp );
+            return out;
+         } catch( fc::exception& er ) {
+            throw;
+         } catch( ... ) {
+            SNAX_THROW( block_log_exception, "Unable to decompress block from the block log" );
+         }
+      }
+
+      static std::shared_ptr<const vector<char>> encode_entry( const std::shared_ptr<const vector<char>>& packed, uint32_t version,
+                                                               block_log_compression compression ) {
+         if( version < 3 ) return packed;
+
+         auto entry = std::make_shared<vector<char>>( entry_header_size );
+         (*entry)[0] = static_cast<char>( compression );
+         if( compression == block_log_compression::zlib ) {
+            bio::filtering_ostream comp;
+            comp.push( bio::zlib_compressor( bio::zlib::best_speed ) );
+            comp.push( bio::back_inserter( *entry ) );
+            bio::write( comp, packed->data(), packed->size() );
+            bio::close( comp );
+         } else {
+            entry->insert( entry->end(), packed->begin(), packed->end() );
+         }
+         const uint32_t size = entry->size() - entry_header_size;
+         memcpy( entry->data() + sizeof(uint8_t), &size, sizeof(size) );
+         return entry;
+      }
+
+      /// @return the size of the entry starting at data, of which available bytes can be read
+      static uint64_t entry_size( const char* data, uint64_t available ) {
+         SNAX_ASSERT( available >= entry_header_size, block_log_exception, "Block log entry is truncated" );
+         uint32_t size;
+         memcpy( &size, data + sizeof(uint8_t), sizeof(size) );
+         SNAX_ASSERT( entry_header_size + size <= available, block_log_exception, "Block log entry is truncated" );
+         return entry_header_size + size;
+      }
+
+      /// @return the packed block of an entry, decompressed when needed
+      static packed_block_view decode_entry( const char* data, uint64_t size, uint32_t version, std::shared_ptr<const void> owner ) {
+         packed_block_view view;
+         if( version < 3 ) {
+            view.data = data;
+            view.size = size;
+            view.owner = std::move(owner);
+            return view;
+         }
+
+         SNAX_ASSERT( entry_size( data, size ) == size, block_log_exception, "Block log entry has trailing data" );
+         switch( static_cast<block_log_compression>( data[0] ) ) {
+            case block_log_compression::none:
+               view.data = data + entry_header_size;
+               view.size = size - entry_header_size;
+               view.owner = std::move(owner);
+               break;
+            case block_log_compression::zlib: {
+               auto out = std::make_shared<const vector<char>>( zlib_decompress( data + entry_header_size, size - entry_header_size ) );
+               view.data = out->data();
+               view.size = out->size();
+               view.owner = std::move(out);
+               break;
+            }
+            default:
+               SNAX_THROW( block_log_exception, "Unknown compression ${c} of block log entry", ("c", (uint32_t)(uint8_t)data[0]) );
+         }
+         return view;
+      }
+
+      static void fsync_file( const fc::path& p ) {
+         int fd = ::open( p.generic_string().c_str(), O_RDONLY );
+         SNAX_ASSERT( fd != -1, block_log_exception, "Unable to open ${f} to sync it to disk", ("f", p.generic_string()) );
+         int r = ::fsync( fd );
+         ::close( fd );
+         SNAX_ASSERT( r == 0, block_log_exception, "Unable to sync ${f} to disk", ("f", p.generic_string()) );
+      }
+
+      /// copies a file to another file system, only giving it its name once it is complete
+      static void copy_file( const fc::path& from, const fc::path& to ) {
+         const fc::path temp = to.generic_string() + ".tmp";
+         bfs::remove( temp.generic_string() );
+         bfs::copy_file( from.generic_string(), temp.generic_string() );
+         bfs::rename( temp.generic_string(), to.generic_string() );
+      }
+
+      static fc::path segment_path( const fc::path& dir, uint32_t first_block_num, uint32_t last_block_num, const char* extension ) {
+         return dir / ("blocks-" + std::to_string( first_block_num ) + "-" + std::to_string( last_block_num ) + extension);
+      }
+
+      /// parses the block range out of the name of a segment, blocks-<first>-<last>.log
+      static bool parse_segment_path( const fc::path& p, uint32_t& first_block_num, uint32_t& last_block_num ) {
+         if( p.extension().generic_string() != ".log" ) return false;
+         const auto stem = p.stem().generic_string();
+         unsigned first = 0, last = 0;
+         char rest = 0;
+         if( sscanf( stem.c_str(), "blocks-%u-%u%c", &first, &last, &rest ) != 2 || first == 0 || last < first ) return false;
+         first_block_num = first;
+         last_block_num = last;
+         return true;
+      }
+
+      /**
+       *  Read only mapping of a file that is being appended to. Only the part of the file already written is read,
+       *  and the file is mapped again once a read reaches past the end of the mapping. A mapping lives for as long
+       *  as views of it are held, so mapping the file again never invalidates bytes handed out before.
+       */
+      class mapped_log_file {
+         public:
+            void open( const fc::path& p ) {
+               path = p;
+               region.reset();
+            }
+
+            void close() {
+               region.reset();
+            }
+
+            /// @return a mapping of at least the first end bytes of the file
+            std::shared_ptr<const bip::mapped_region> map( uint64_t end ) {
+               if( !region || region->get_size() < end ) {
+                  const uint64_t size = fc::file_size( path );
+                  SNAX_ASSERT( end > 0 && size >= end, block_log_exception,
+                              "Block log file ${f} is ${size} bytes long, expected at least ${end}",
+                              ("f", path.generic_string())("size", size)("end", end) );
+                  bip::file_mapping mapping( path.generic_string().c_str(), bip::read_only );
+                  region = std::make_shared<bip::mapped_region>( mapping, bip::read_only, 0, size );
+               }
+               return region;
+            }
+
+            static const char* data( const std::shared_ptr<const bip::mapped_region>& r ) {
+               return static_cast<const char*>( r->get_address() );
+            }
+
+         private:
+            fc::path                                  path;
+            std::shared_ptr<const bip::mapped_region> region;
+      };
+
+      /// a complete block log rolled out of blocks.log, which is never written again
+      struct log_segment {
+         uint32_t         first_block_num = 0;
+         uint32_t         last_block_num = 0;
+         uint32_t         version = 0; ///< read from the header on first use
+         bool             archived = false;
+         fc::path         block_file;
+         fc::path         index_file;
+         mapped_log_file  block_map;
+         mapped_log_file  index_map;
+
+         void open( const fc::path& dir ) {
+            block_file = segment_path( dir, first_block_num, last_block_num, ".log" );
+            index_file = segment_path( dir, first_block_num, last_block_num, ".index" );
+            block_map.open( block_file );
+            index_map.open( index_file );
+         }
+
+         packed_block_view read_packed( uint32_t block_num ) {
+            const uint64_t offset = sizeof(uint64_t) * (block_num - first_block_num);
+            auto index = index_map.map( offset + sizeof(uint64_t) );
+            uint64_t pos, end_pos;
+            memcpy( &pos, mapped_log_file::data( index ) + offset, sizeof(pos) );
+            if( block_num < last_block_num ) {
+               index = index_map.map( offset + 2 * sizeof(uint64_t) );
+               memcpy( &end_pos, mapped_log_file::data( index ) + offset + sizeof(uint64_t), sizeof(end_pos) );
+            } else {
+               end_pos = fc::file_size( block_file );
+            }
+            end_pos -= sizeof(uint64_t);
+            SNAX_ASSERT( end_pos > pos, block_log_exception, "Block log segment ${f} is malformed, block ${n} has no data",
+                         ("f", block_file.generic_string())("n", block_num) );
+
+            auto region = block_map.map( end_pos );
+            if( !version )
+               memcpy( &version, mapped_log_file::data( region ), sizeof(version) );
+            return decode_entry( mapped_log_file::data( region ) + pos, end_pos - pos, version, region );
+         }
+      };
+
       class block_log_impl {
          public:
             signed_block_ptr         head;
             block_id_type            head_id;
-            std::fstream             block_stream;
-            std::fstream             index_stream;
+            std::fstream             block_stream; ///< append only, used by the writer
+            std::fstream             index_stream; ///< append only, used by the writer
+            fc::path                 data_dir;
             fc::path                 block_file;
             fc::path                 index_file;
-            bool                     block_write;
-            bool                     index_write;
             bool                     genesis_written_to_block_log = false;
-            uint32_t                 version = 0;
-            uint32_t                 first_block_num = 0;
-
-            inline void check_block_read() {
-               if (block_write) {
-                  block_stream.close();
-                  block_stream.open(block_file.generic_string().c_str(), LOG_READ);
-                  block_write = false;
+            uint32_t                 version = 0;          ///< guarded by mtx, only changed by the appending thread
+            vector<char>             packed_genesis; ///< the genesis state in the header of blocks.log, for the segments after it
+
+            /// sizes the files will have once all appended blocks are written
+            uint64_t                 block_end_pos = 0;
+            uint64_t                 index_end_pos = 0;
+
+            block_log_config         config;
+            uint32_t                 blocks_since_fsync = 0;
+            std::thread              writer;
+
+            // guards the members below, shared by the writer thread and the threads appending and reading blocks
+            mutable std::mutex       mtx;
+            std::condition_variable  queue_cv;
+            std::deque<queued_block> write_queue;
+            uint32_t                 first_block_num = 0;  ///< first block of blocks.log
+            uint64_t                 written_end_pos = 0;  ///< end of the last block written and flushed
+            uint32_t                 written_head_num = 0; ///< last block written and flushed, 0 if none
+            mapped_log_file          block_map;
+            mapped_log_file          index_map;
+            std::map<uint32_t, log_segment> segments;      ///< by first block number
+            std::exception_ptr       write_error;
+            bool                     stopping = false;
+
+            std::future<void>        retiring;              ///< only touched by the appending thread
+            uint32_t                 retire_head_num = 0;   ///< segments this far behind are retired, guarded by mtx
+            bool                     retiring_active = false; ///< guarded by mtx
+
+            /// @pre mtx is locked
+            const queued_block* find_queued( uint32_t block_num )const {
+               if( write_queue.empty() ) return nullptr;
+               const uint32_t front_num = write_queue.front().block->block_num();
+               if( block_num < front_num || block_num - front_num >= write_queue.size() ) return nullptr;
+               return &write_queue[block_num - front_num];
+            }
+
+            /// @pre mtx is locked
+            log_segment* find_segment( uint32_t block_num ) {
+               auto itr = segments.upper_bound( block_num );
+               if( itr == segments.begin() ) return nullptr;
+               --itr;
+               return block_num <= itr->second.last_block_num ? &itr->second : nullptr;
+            }
+
+            /// @pre mtx is locked and block_num was written to the files
+            uint64_t read_index( uint32_t block_num ) {
+               const uint64_t offset = sizeof(uint64_t) * (block_num - first_block_num);
+               auto region = index_map.map( offset + sizeof(uint64_t) );
+               uint64_t pos;
+               memcpy( &pos, mapped_log_file::data( region ) + offset, sizeof(pos) );
+               return pos;
+            }
+
+            /// @pre mtx is locked
+            packed_block_view read_packed( uint32_t block_num ) {
+               packed_block_view view;
+               if( const auto* q = find_queued( block_num ) ) {
+                  view.data = q->data->data();
+                  view.size = q->data->size();
+                  view.owner = q->data;
+                  return view;
+               }
+               if( block_num < first_block_num ) {
+                  if( auto* segment = find_segment( block_num ) )
+                     return segment->read_packed( block_num );
+                  return view;
+               }
+               if( block_num > written_head_num )
+                  return view;
+
+               // a block ends where the position marker that trails it begins; the marker of the last block written
+               // ends the written part of the file
+               const uint64_t pos = read_index( block_num );
+               const uint64_t end_pos = (block_num < written_head_num ? read_index( block_num + 1 ) : written_end_pos) - sizeof(uint64_t);
+               SNAX_ASSERT( end_pos > pos, block_log_exception, "Block log is malformed, block ${n} has no data", ("n", block_num) );
+
+               auto region = block_map.map( end_pos );
+               return decode_entry( mapped_log_file::data( region ) + pos, end_pos - pos, version, region );
+            }
+
+            /// registers the segments found in dir
+            void add_segments( const fc::path& dir, bool archived ) {
+               if( !fc::is_directory( dir ) ) return;
+               for( bfs::directory_iterator itr( dir.generic_string() ), end; itr != end; ++itr ) {
+                  log_segment segment;
+                  if( !bfs::is_regular_file( itr->path() ) ||
+                      !parse_segment_path( itr->path().generic_string(), segment.first_block_num, segment.last_block_num ) )
+                     continue;
+                  segment.archived = archived;
+                  segment.open( dir );
+                  if( !fc::exists( segment.index_file ) ) {
+                     wlog( "Ignoring block log segment ${f} which has no index", ("f", segment.block_file.generic_string()) );
+                     continue;
+                  }
+                  if( find_segment( segment.first_block_num ) || find_segment( segment.last_block_num ) ) {
+                     wlog( "Ignoring block log segment ${f} which overlaps another one", ("f", segment.block_file.generic_string()) );
+                     continue;
+                  }
+                  segments.emplace( segment.first_block_num, std::move(segment) );
+               }
+            }
+
+            /**
+             *  Writes blocks to the log and then their positions to the index, so that the index never refers to
+             *  blocks missing from the log after a crash. The blocks are flushed to the OS as a group, and synced
+             *  to disk every fsync_interval blocks.
+             */
+            void write( const vector<const queued_block*>& batch ) {
+               for( const auto* q : batch ) {
+                  block_stream.write( q->entry->data(), q->entry->size() );
+                  block_stream.write( (const char*)&q->pos, sizeof(q->pos) );
+               }
+               block_stream.flush();
+
+               blocks_since_fsync += batch.size();
+               const bool sync = config.fsync_interval && blocks_since_fsync >= config.fsync_interval;
+               if( sync ) fsync_file( block_file );
+
+               for( const auto* q : batch )
+                  index_stream.write( (const char*)&q->pos, sizeof(q->pos) );
+               index_stream.flush();
+
+               if( sync ) {
+                  fsync_file( index_file );
+                  blocks_since_fsync = 0;
                }
             }
 
-            inline void check_block_write() {
-               if (!block_write) {
-                  block_stream.close();
-                  block_stream.open(block_file.generic_string().c_str(), LOG_WRITE);
-                  block_write = true;
+            /// @pre mtx is locked
+            void set_written( const queued_block& last ) {
+               written_end_pos = last.pos + last.entry->size() + sizeof(uint64_t);
+               written_head_num = last.block->block_num();
+            }
+
+            /// writes the queued blocks in groups until stopped, and the queue is drained
+            void write_loop() {
+               std::unique_lock<std::mutex> lock( mtx );
+               while( true ) {
+                  queue_cv.wait( lock, [&]() { return stopping || !write_queue.empty(); } );
+                  if( write_queue.empty() ) return;
+
+                  // the appending thread only pushes to the back of the queue, which leaves these in place
+                  vector<const queued_block*> batch;
+                  batch.reserve( write_queue.size() );
+                  for( const auto& q : write_queue )
+                     batch.push_back( &q );
+                  lock.unlock();
+
+                  std::exception_ptr error;
+                  try {
+                     write( batch );
+                  } catch( ... ) {
+                     error = std::current_exception();
+                  }
+
+                  lock.lock();
+                  if( error ) {
+                     write_error = error;
+                     queue_cv.notify_all();
+                     return;
+                  }
+                  set_written( *batch.back() );
+                  write_queue.erase( write_queue.begin(), write_queue.begin() + batch.size() );
+                  queue_cv.notify_all();
                }
             }
 
-            inline void check_index_read() {
+            /// @pre mtx is locked
+            void check_write_error()const {
+               if( write_error )
+                  std::rethrow_exception( write_error );
+            }
+
+            /// retires the segments past the retained blocks on a thread of its own, which a running one picks up instead
+            void start_retiring_segments( uint32_t head_block_num ) {
+               if( !config.retained_blocks ) return;
+               {
+                  std::lock_guard<std::mutex> g( mtx );
+                  retire_head_num = std::max( retire_head_num, head_block_num );
+                  if( retiring_active ) return;
+                  retiring_active = true;
+               }
+               wait_retiring_segments();
+               retiring = std::async( std::launch::async, [this]() {
+                  try {
+                     retire_segments();
+                  } catch( ... ) {
+                     std::lock_guard<std::mutex> g( mtx );
+                     retiring_active = false;
+                     throw;
+                  }
+               });
+            }
+
+            void wait_retiring_segments() {
+               if( !retiring.valid() ) return;
                try {
-                  if (index_write) {
-                     index_stream.close();
-                     index_stream.open(index_file.generic_string().c_str(), LOG_READ);
-                     index_write = false;
+                  retiring.get();
+               } catch( const fc::exception& e ) {
+                  elog( "Unable to retire block log segments: ${e}", ("e", e.to_detail_string()) );
+               } catch( const std::exception& e ) {
+                  elog( "Unable to retire block log segments: ${e}", ("e", e.what()) );
+               }
+            }
+
+            /**
+             * Moves the segments older than the retained blocks to the archive directory, or deletes them. A segment
+             * stays readable from where it was until its archived copy is complete.
+             */
+            void retire_segments() {
+               while( true ) {
+                  log_segment segment;
+                  fc::path block_from, index_from;
+                  {
+                     std::lock_guard<std::mutex> g( mtx );
+                     auto itr = std::find_if( segments.begin(), segments.end(), [&]( const auto& s ) {
+                        return !s.second.archived && s.second.last_block_num + config.retained_blocks < retire_head_num;
+                     });
+                     if( itr == segments.end() ) {
+                        retiring_active = false;
+                        return;
+                     }
+
+                     if( config.archive_dir.empty() ) {
+                        // views handed out keep the deleted files mapped
+                        segment = std::move( itr->second );
+                        segments.erase( itr );
+                     } else {
+                        segment.first_block_num = itr->second.first_block_num;
+                        segment.last_block_num = itr->second.last_block_num;
+                        block_from = itr->second.block_file;
+                        index_from = itr->second.index_file;
+                        if( !fc::is_directory( config.archive_dir ) )
+                           fc::create_directories( config.archive_dir );
+                        segment.open( config.archive_dir );
+                        segment.archived = true;
+
+                        // renaming within a file system is quick enough to do while reads wait
+                        boost::system::error_code ec;
+                        bfs::rename( index_from.generic_string(), segment.index_file.generic_string(), ec );
+                        if( !ec ) {
+                           bfs::rename( block_from.generic_string(), segment.block_file.generic_string(), ec );
+                           if( ec )
+                              bfs::rename( segment.index_file.generic_string(), index_from.generic_string() );
+                        }
+                        if( !ec ) {
+                           ilog( "Archived block log segment ${f} to ${d}", ("f", block_from.generic_string())("d", config.archive_dir.generic_string()) );
+                           itr->second = std::move( segment );
+                           continue;
+                        }
+                     }
                   }
+
+                  if( config.archive_dir.empty() ) {
+                     ilog( "Deleting block log segment ${f}", ("f", segment.block_file.generic_string()) );
+                     fc::remove_all( segment.block_file );
+                     fc::remove_all( segment.index_file );
+                     continue;
+                  }
+
+                  // the archive is on another file system, the segment is copied there while it is read from here
+                  ilog( "Copying block log segment ${f} to ${d}", ("f", block_from.generic_string())("d", config.archive_dir.generic_string()) );
+                  copy_file( block_from, segment.block_file );
+                  copy_file( index_from, segment.index_file );
+                  {
+                     std::lock_guard<std::mutex> g( mtx );
+                     auto itr = segments.find( segment.first_block_num );
+                     if( itr == segments.end() || itr->second.block_file != block_from ) continue;
+                     // views handed out keep the removed files mapped
+                     itr->second = std::move( segment );
+                  }
+                  fc::remove_all( index_from );
+                  fc::remove_all( block_from );
                }
-               FC_LOG_AND_RETHROW()
             }
 
-            inline void check_index_write() {
-               if (!index_write) {
-                  index_stream.close();
-                  index_stream.open(index_file.generic_string().c_str(), LOG_WRITE);
-                  index_write = true;
+            void stop_writer() {
+               if( !writer.joinable() ) return;
+               {
+                  std::lock_guard<std::mutex> g( mtx );
+                  stopping = true;
                }
+               queue_cv.notify_all();
+               writer.join();
             }
       };
    }
 
-   block_log::block_log(const fc::path& data_dir)
+   block_log::block_log(const fc::path& data_dir, const block_log_config& config)
    :my(new detail::block_log_impl()) {
       my->block_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
       my->index_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
+      my->config = config;
       open(data_dir);
+
+      if( config.write_queue_size ) {
+         auto* impl = my.get();
+         my->writer = std::thread( [impl]() { impl->write_loop(); } );
+      }
    }
 
    block_log::block_log(block_log&& other) {
@@ -87,12 +560,25 @@ namespace snax { namespace chain {
 
    block_log::~block_log() {
       if (my) {
-         flush();
+         my->wait_retiring_segments();
+         my->stop_writer();
+         if( my->write_error ) {
+            try {
+               std::rethrow_exception( my->write_error );
+            } catch( const fc::exception& e ) {
+               elog( "Blocks were not written to the block log: ${e}", ("e", e.to_detail_string()) );
+            } catch( const std::exception& e ) {
+               elog( "Blocks were not written to the block log: ${e}", ("e", e.what()) );
+            }
+         } else {
+            flush();
+         }
          my.reset();
       }
    }
 
    void block_log::open(const fc::path& data_dir) {
+      my->wait_retiring_segments();
       if (my->block_stream.is_open())
          my->block_stream.close();
       if (my->index_stream.is_open())
@@ -100,14 +586,20 @@ namespace snax { namespace chain {
 
       if (!fc::is_directory(data_dir))
          fc::create_directories(data_dir);
+      my->data_dir = data_dir;
       my->block_file = data_dir / "blocks.log";
       my->index_file = data_dir / "blocks.index";
 
+      my->segments.clear();
+      my->add_segments( data_dir, false );
+      if( !my->config.archive_dir.empty() )
+         my->add_segments( my->config.archive_dir, true );
+
       //ilog("Opening block log at ${path}", ("path", my->block_file.generic_string()));
       my->block_stream.open(my->block_file.generic_string().c_str(), LOG_WRITE);
       my->index_stream.open(my->index_file.generic_string().c_str(), LOG_WRITE);
-      my->block_write = true;
-      my->index_write = true;
+      my->block_map.open(my->block_file);
+      my->index_map.open(my->index_file);
 
       /* On startup of the block log, there are several states the log file and the index file can be
        * in relation to each other.
@@ -129,43 +621,83 @@ namespace snax { namespace chain {
        */
       auto log_size = fc::file_size(my->block_file);
       auto index_size = fc::file_size(my->index_file);
+      my->written_end_pos = log_size;
+
+      if (!log_size && !my->segments.empty()) {
+         // interrupted while rolling the log, start blocks.log over after the last segment
+         auto& last = my->segments.rbegin()->second;
+         ilog("Log is empty, starting it after segment ${f}", ("f", last.block_file.generic_string()));
+         my->block_stream.close();
+         my->index_stream.close();
+         fc::remove_all(my->index_file);
+         index_size = 0;
+
+         // segments are written with a version 2 or later header, the genesis state follows the first block number
+         const auto segment_size = fc::file_size( last.block_file );
+         auto segment_region = last.block_map.map( segment_size );
+         fc::datastream<const char*> ds( detail::mapped_log_file::data( segment_region ) + sizeof(uint32_t) * 2,
+                                         segment_size - sizeof(uint32_t) * 2 );
+         genesis_state gs;
+         fc::raw::unpack( ds, gs );
+         my->packed_genesis = fc::raw::pack( gs );
+         write_header( last.last_block_num + 1 );
+         commit_header();
+         log_size = fc::file_size(my->block_file);
+         my->written_end_pos = log_size;
+      }
 
       if (log_size) {
          ilog("Log is nonempty");
-         my->check_block_read();
-         my->block_stream.seekg( 0 );
+         SNAX_ASSERT( log_size >= sizeof(my->version) + sizeof(my->first_block_num), block_log_exception,
+                      "Block log was not setup properly" );
+         auto log_region = my->block_map.map( log_size );
+         const char* log_data = detail::mapped_log_file::data( log_region );
+
          my->version = 0;
-         my->block_stream.read( (char*)&my->version, sizeof(my->version) );
+         memcpy( &my->version, log_data, sizeof(my->version) );
          SNAX_ASSERT( my->version > 0, block_log_exception, "Block log was not setup properly" );
          SNAX_ASSERT( my->version >= min_supported_version && my->version <= max_supported_version, block_log_unsupported_version,
                  "Unsupported version of block log. Block log version is ${version} while code supports version(s) [${min},${max}]",
                  ("version", my->version)("min", block_log::min_supported_version)("max", block_log::max_supported_version) );
 
 
+         if( my->version < 3 && my->config.compression != block_log_compression::none )
+            wlog( "Block log version ${v} does not support compression, blocks are appended uncompressed until it is rolled or reset",
+                  ("v", my->version) );
+
          my->genesis_written_to_block_log = true; // Assume it was constructed properly.
+         uint64_t genesis_pos = sizeof(my->version);
          if (my->version > 1){
             my->first_block_num = 0;
-            my->block_stream.read( (char*)&my->first_block_num, sizeof(my->first_block_num) );
+            memcpy( &my->first_block_num, log_data + sizeof(my->version), sizeof(my->first_block_num) );
             SNAX_ASSERT(my->first_block_num > 0, block_log_exception, "Block log is malformed, first recorded block number is 0 but must be greater than or equal to 1");
+            genesis_pos += sizeof(my->first_block_num);
          } else {
             my->first_block_num = 1;
          }
 
-         my->head = read_head();
-         my->head_id = my->head->id();
+         fc::datastream<const char*> ds( log_data + genesis_pos, log_size - genesis_pos );
+         genesis_state gs;
+         fc::raw::unpack( ds, gs );
+         my->packed_genesis.assign( log_data + genesis_pos, log_data + genesis_pos + ds.tellp() );
 
-         if (index_size) {
-            my->check_block_read();
-            my->check_index_read();
+         my->head = read_head();
+         if (my->head) {
+            my->head_id = my->head->id();
+            if (my->head->block_num() >= my->first_block_num)
+               my->written_head_num = my->head->block_num();
+         }
 
+         if (my->written_head_num && index_size) {
             ilog("Index is nonempty");
             uint64_t block_pos;
-            my->block_stream.seekg(-sizeof(uint64_t), std::ios::end);
-            my->block_stream.read((char*)&block_pos, sizeof(block_pos));
+            memcpy( &block_pos, log_data + log_size - sizeof(uint64_t), sizeof(block_pos) );
 
-            uint64_t index_pos;
-            my->index_stream.seekg(-sizeof(uint64_t), std::ios::end);
-            my->index_stream.read((char*)&index_pos, sizeof(index_pos));
+            uint64_t index_pos = 0;
+            if (index_size >= sizeof(uint64_t)) {
+               auto index_region = my->index_map.map( index_size );
+               memcpy( &index_pos, detail::mapped_log_file::data( index_region ) + index_size - sizeof(uint64_t), sizeof(index_pos) );
+            }
 
             if (block_pos < index_pos) {
                ilog("block_pos < index_pos, close and reopen index_stream");
@@ -174,114 +706,251 @@ namespace snax { namespace chain {
                ilog("Index is incomplete");
                construct_index();
             }
-         } else {
+         } else if (my->written_head_num || index_size) {
             ilog("Index is empty");
             construct_index();
          }
       } else if (index_size) {
          ilog("Index is nonempty, remove and recreate it");
          my->index_stream.close();
+         my->index_map.close();
          fc::remove_all(my->index_file);
          my->index_stream.open(my->index_file.generic_string().c_str(), LOG_WRITE);
-         my->index_write = true;
       }
+
+      my->block_end_pos = log_size;
+      my->index_end_pos = fc::file_size(my->index_file);
    }
 
    uint64_t block_log::append(const signed_block_ptr& b) {
+      return append(b, false);
+   }
+
+   uint64_t block_log::append(const signed_block_ptr& b, bool synchronous) {
       try {
          SNAX_ASSERT( my->genesis_written_to_block_log, block_log_append_fail, "Cannot append to block log until the genesis is first written" );
 
-         my->check_block_write();
-         my->check_index_write();
+         if( my->config.stride && my->index_end_pos > 0 && (b->block_num() - 1) % my->config.stride == 0 )
+            roll();
 
-         uint64_t pos = my->block_stream.tellp();
-         SNAX_ASSERT(my->index_stream.tellp() == sizeof(uint64_t) * (b->block_num() - my->first_block_num),
+         SNAX_ASSERT(my->index_end_pos == sizeof(uint64_t) * (b->block_num() - my->first_block_num),
                    block_log_append_fail,
                    "Append to index file occuring at wrong position.",
-                   ("position", (uint64_t) my->index_stream.tellp())
+                   ("position", my->index_end_pos)
                    ("expected", (b->block_num() - my->first_block_num) * sizeof(uint64_t)));
-         auto data = fc::raw::pack(*b);
-         my->block_stream.write(data.data(), data.size());
-         my->block_stream.write((char*)&pos, sizeof(pos));
-         my->index_stream.write((char*)&pos, sizeof(pos));
+
+         detail::queued_block q;
+         q.block = b;
+         q.data = std::make_shared<const vector<char>>( fc::raw::pack(*b) );
+         q.entry = detail::encode_entry( q.data, my->version, my->config.compression );
+         q.pos = my->block_end_pos;
+         const uint64_t pos = q.pos;
+         const uint64_t end_pos = pos + q.entry->size() + sizeof(uint64_t);
+
+         if( !my->writer.joinable() || synchronous ) {
+            my->write( { &q } );
+            std::lock_guard<std::mutex> g( my->mtx );
+            my->set_written( q );
+         } else {
+            std::unique_lock<std::mutex> lock( my->mtx );
+            // applying blocks stalls only once the writer falls this far behind
+            my->queue_cv.wait( lock, [&]() { return my->write_error || my->write_queue.size() < my->config.write_queue_size; } );
+            my->check_write_error();
+            my->write_queue.emplace_back( std::move(q) );
+            my->queue_cv.notify_all();
+         }
+
+         my->block_end_pos = end_pos;
+         my->index_end_pos += sizeof(uint64_t);
          my->head = b;
          my->head_id = b->id();
 
-         flush();
-
          return pos;
       }
       FC_LOG_AND_RETHROW()
    }
 
    void block_log::flush() {
-      my->block_stream.flush();
-      my->index_stream.flush();
+      if( my->writer.joinable() ) {
+         std::unique_lock<std::mutex> lock( my->mtx );
+         my->queue_cv.wait( lock, [&]() { return my->write_error || my->write_queue.empty(); } );
+         my->check_write_error();
+      } else {
+         my->block_stream.flush();
+         my->index_stream.flush();
+      }
    }
 
-   void block_log::reset( const genesis_state& gs, const signed_block_ptr& first_block, uint32_t first_block_num ) {
-      if (my->block_stream.is_open())
-         my->block_stream.close();
-      if (my->index_stream.is_open())
-         my->index_stream.close();
-
-      fc::remove_all(my->block_file);
-      fc::remove_all(my->index_file);
+   uint32_t block_log::last_written_block_num()const {
+      std::lock_guard<std::mutex> g( my->mtx );
+      if( !my->write_queue.empty() )
+         return my->write_queue.front().block->block_num() - 1;
+      return my->head ? my->head->block_num() : 0;
+   }
 
+   /**
+    * Starts new, empty blocks.log and blocks.index files, with a header that is only valid once committed
+    */
+   void block_log::write_header( uint32_t first_block_num ) {
       my->block_stream.open(my->block_file.generic_string().c_str(), LOG_WRITE);
       my->index_stream.open(my->index_file.generic_string().c_str(), LOG_WRITE);
-      my->block_write = true;
-      my->index_write = true;
 
-      auto data = fc::raw::pack(gs);
-      my->version = 0; // version of 0 is invalid; it indicates that the genesis was not properly written to the block log
-      my->first_block_num = first_block_num;
-      my->block_stream.write((char*)&my->version, sizeof(my->version));
-      my->block_stream.write((char*)&my->first_block_num, sizeof(my->first_block_num));
-      my->block_stream.write(data.data(), data.size());
+      uint32_t version = 0; // version of 0 is invalid; it indicates that the genesis was not properly written to the block log
+      my->block_stream.write((char*)&version, sizeof(version));
+      my->block_stream.write((char*)&first_block_num, sizeof(first_block_num));
+      my->block_stream.write(my->packed_genesis.data(), my->packed_genesis.size());
       my->genesis_written_to_block_log = true;
 
       // append a totem to indicate the division between blocks and header
       auto totem = npos;
       my->block_stream.write((char*)&totem, sizeof(totem));
 
-      if (first_block) {
-         append(first_block);
-      }
+      my->block_end_pos = my->block_stream.tellp();
+      my->index_end_pos = 0;
+      std::lock_guard<std::mutex> g( my->mtx );
+      // uncompressed logs keep the version older tools can read
+      my->version = my->config.compression == block_log_compression::none ? 2 : block_log::max_supported_version;
+      my->first_block_num = first_block_num;
+      my->written_end_pos = my->block_end_pos;
+      my->written_head_num = 0;
+   }
 
+   void block_log::commit_header() {
       auto pos = my->block_stream.tellp();
 
       my->block_stream.close();
       my->block_stream.open(my->block_file.generic_string().c_str(), std::ios::in | std::ios::out | std::ios::binary ); // Bypass append-only writing just once
 
-      static_assert( block_log::max_supported_version > 0, "a version number of zero is not supported" );
-      my->version = block_log::max_supported_version;
       my->block_stream.seekp( 0 );
       my->block_stream.write( (char*)&my->version, sizeof(my->version) );
       my->block_stream.seekp( pos );
+      my->block_stream.flush();
+      my->index_stream.flush();
+
+      // Reset to append-only writing.
+      my->block_stream.close();
+      my->block_stream.open(my->block_file.generic_string().c_str(), LOG_WRITE);
+   }
+
+   void block_log::reset( const genesis_state& gs, const signed_block_ptr& first_block, uint32_t first_block_num ) {
+      my->wait_retiring_segments();
       flush();
 
-      my->block_write = false;
-      my->check_block_write(); // Reset to append-only writing.
+      if (my->block_stream.is_open())
+         my->block_stream.close();
+      if (my->index_stream.is_open())
+         my->index_stream.close();
+      {
+         std::lock_guard<std::mutex> g( my->mtx );
+         // views handed out keep the replaced files mapped
+         my->block_map.close();
+         my->index_map.close();
+         // the segments of the replaced log go with it, archived ones are left in place but not read anymore
+         for( const auto& s : my->segments ) {
+            if( s.second.archived ) continue;
+            fc::remove_all( s.second.block_file );
+            fc::remove_all( s.second.index_file );
+         }
+         my->segments.clear();
+         my->retire_head_num = 0;
+      }
+
+      fc::remove_all(my->block_file);
+      fc::remove_all(my->index_file);
+
+      my->packed_genesis = fc::raw::pack(gs);
+      write_header( first_block_num );
+      my->head.reset();
+      my->head_id = block_id_type();
+
+      if (first_block) {
+         append(first_block, true);
+      }
+
+      commit_header();
+   }
+
+   /**
+    * Renames blocks.log and blocks.index after the blocks they hold, and starts them over with the next block
+    */
+   void block_log::roll() {
+      flush();
+
+      const uint32_t first_block_num = my->first_block_num;
+      const uint32_t last_block_num = block_header::num_from_id(my->head_id);
+      ilog( "Rolling block log segment of blocks ${first} through ${last}", ("first", first_block_num)("last", last_block_num) );
+
+      my->block_stream.close();
+      my->index_stream.close();
+
+      detail::log_segment segment;
+      segment.first_block_num = first_block_num;
+      segment.last_block_num = last_block_num;
+      segment.open( my->data_dir );
+      {
+         std::lock_guard<std::mutex> g( my->mtx );
+         my->block_map.close();
+         my->index_map.close();
+         // the index goes first, so that an interruption leaves blocks.log to be indexed again on restart
+         fc::rename( my->index_file, segment.index_file );
+         fc::rename( my->block_file, segment.block_file );
+         my->segments.emplace( first_block_num, std::move(segment) );
+      }
+
+      write_header( last_block_num + 1 );
+      commit_header();
+
+      my->start_retiring_segments( last_block_num );
    }
 
    std::pair<signed_block_ptr, uint64_t> block_log::read_block(uint64_t pos)const {
-      my->check_block_read();
+      std::shared_ptr<const bip::mapped_region> region;
+      uint64_t end_pos = 0;
+      uint32_t version = 0;
+      {
+         std::lock_guard<std::mutex> g( my->mtx );
+         for( const auto& q : my->write_queue ) {
+            if( q.pos == pos )
+               return { q.block, pos + q.entry->size() + sizeof(uint64_t) };
+         }
+         end_pos = my->written_end_pos;
+         version = my->version;
+         SNAX_ASSERT( pos < end_pos, block_log_exception, "Position ${pos} is past the end of the block log", ("pos", pos) );
+         region = my->block_map.map( end_pos );
+      }
 
-      my->block_stream.seekg(pos);
+      const char* data = detail::mapped_log_file::data( region ) + pos;
       std::pair<signed_block_ptr,uint64_t> result;
       result.first = std::make_shared<signed_block>();
-      fc::raw::unpack(my->block_stream, *result.first);
-      result.second = uint64_t(my->block_stream.tellg()) + 8;
+      if( version < 3 ) {
+         fc::datastream<const char*> ds( data, end_pos - pos );
+         fc::raw::unpack(ds, *result.first);
+         result.second = pos + ds.tellp() + 8;
+      } else {
+         const uint64_t size = detail::entry_size( data, end_pos - pos );
+         auto view = detail::decode_entry( data, size, version, region );
+         fc::datastream<const char*> ds( view.data, view.size );
+         fc::raw::unpack(ds, *result.first);
+         result.second = pos + size + 8;
+      }
       return result;
    }
 
    signed_block_ptr block_log::read_block_by_num(uint32_t block_num)const {
       try {
+         packed_block_view view;
+         {
+            std::lock_guard<std::mutex> g( my->mtx );
+            if( const auto* q = my->find_queued( block_num ) )
+               return q->block;
+            view = my->read_packed( block_num );
+         }
+
          signed_block_ptr b;
-         uint64_t pos = get_block_pos(block_num);
-         if (pos != npos) {
-            b = read_block(pos).first;
+         if (view) {
+            b = std::make_shared<signed_block>();
+            fc::datastream<const char*> ds( view.data, view.size );
+            fc::raw::unpack(ds, *b);
             SNAX_ASSERT(b->block_num() == block_num, reversible_blocks_exception,
                       "Wrong block was read from block log.", ("returned", b->block_num())("expected", block_num));
          }
@@ -289,33 +958,57 @@ namespace snax { namespace chain {
       } FC_LOG_AND_RETHROW()
    }
 
+   packed_block_view block_log::read_packed_block_by_num(uint32_t block_num)const {
+      try {
+         std::lock_guard<std::mutex> g( my->mtx );
+         return my->read_packed( block_num );
+      } FC_LOG_AND_RETHROW()
+   }
+
+   vector<char> block_log::read_serialized_block_by_num(uint32_t block_num)const {
+      auto view = read_packed_block_by_num( block_num );
+      return vector<char>( view.data, view.data + view.size );
+   }
+
    uint64_t block_log::get_block_pos(uint32_t block_num) const {
-      my->check_index_read();
-      if (!(my->head && block_num <= block_header::num_from_id(my->head_id) && block_num >= my->first_block_num))
+      std::lock_guard<std::mutex> g( my->mtx );
+      if( const auto* q = my->find_queued( block_num ) )
+         return q->pos;
+      if( block_num < my->first_block_num || block_num > my->written_head_num )
          return npos;
-      my->index_stream.seekg(sizeof(uint64_t) * (block_num - my->first_block_num));
-      uint64_t pos;
-      my->index_stream.read((char*)&pos, sizeof(pos));
-      return pos;
+      return my->read_index( block_num );
    }
 
    signed_block_ptr block_log::read_head()const {
-      my->check_block_read();
-
       uint64_t pos;
+      {
+         std::lock_guard<std::mutex> g( my->mtx );
+         if( !my->write_queue.empty() )
+            return my->write_queue.back().block;
+
+         // Check that the file is not empty
+         if( my->written_end_pos <= sizeof(pos) )
+            pos = npos;
+         else {
+            auto region = my->block_map.map( my->written_end_pos );
+            memcpy( &pos, detail::mapped_log_file::data( region ) + my->written_end_pos - sizeof(pos), sizeof(pos) );
+         }
+      }
 
-      // Check that the file is not empty
-      my->block_stream.seekg(0, std::ios::end);
-      if (my->block_stream.tellg() <= sizeof(pos))
-         return {};
-
-      my->block_stream.seekg(-sizeof(pos), std::ios::end);
-      my->block_stream.read((char*)&pos, sizeof(pos));
       if (pos != npos) {
          return read_block(pos).first;
-      } else {
-         return {};
       }
+
+      // blocks.log has no blocks yet when it was just rolled
+      std::lock_guard<std::mutex> g( my->mtx );
+      if( my->segments.empty() || my->segments.rbegin()->second.last_block_num + 1 != my->first_block_num )
+         return {};
+      auto& last = my->segments.rbegin()->second;
+      auto view = last.read_packed( last.last_block_num );
+      auto b = std::make_shared<signed_block>();
+      fc::datastream<const char*> ds( view.data, view.size );
+      fc::raw::unpack( ds, *b );
+      return b;
    }
 
    const signed_block_ptr& block_log::head()const {
@@ -323,46 +1016,250 @@ namespace snax { namespace chain {
    }
 
    uint32_t block_log::first_block_num() const {
-      return my->first_block_num;
+      std::lock_guard<std::mutex> g( my->mtx );
+      // only the segments leading up to blocks.log without a gap count
+      uint32_t first = my->first_block_num;
+      for( auto itr = my->segments.rbegin(); itr != my->segments.rend() && itr->second.last_block_num + 1 == first; ++itr )
+         first = itr->first;
+      return first;
    }
 
    void block_log::construct_index() {
-      ilog("Reconstructing Block Log Index...");
       my->index_stream.close();
-      fc::remove_all(my->index_file);
+      my->index_map.close();
+      construct_index( my->block_file, my->index_file );
       my->index_stream.open(my->index_file.generic_string().c_str(), LOG_WRITE);
-      my->index_write = true;
+   } // construct_index
+
+   namespace detail {
+      /**
+       *  Finds where the blocks of a mapped block log start by following the position markers that trail them,
+       *  from the end of the log backwards. The log is split into ranges that are walked by a thread each. Only
+       *  the walk from the end of the log starts from a known marker, the other threads start from the first
+       *  marker of their range that looks like one. A walk from a known marker that lands on a block start found
+       *  by the walk of a lower range carries on with that walk, which is then known to be right too, and else
+       *  keeps walking on its own. A guess that is wrong therefore only costs time.
+       */
+      class index_scanner {
+         public:
+            index_scanner( const char* data, uint64_t blocks_begin, uint64_t log_end )
+            :data(data), blocks_begin(blocks_begin), log_end(log_end) {}
+
+            /**
+             * @param lower  a block start known to be right; only the blocks after it are returned, or all of them
+             *               when it is npos
+             * @return the starts of the blocks in descending order, or nothing when the walk from the end of the
+             *         log did not land on lower
+             */
+            optional<vector<uint64_t>> scan( uint64_t lower, uint32_t threads, std::atomic<uint64_t>& scanned )const {
+               const uint64_t lo = lower == block_log::npos ? blocks_begin : lower + 1;
+               if( log_end - lo < threads )
+                  threads = 1;
+
+               // range i is [bounds[i], bounds[i+1]), the last one is walked from the end of the log
+               vector<uint64_t> bounds( threads + 1 );
+               for( uint32_t i = 0; i < threads; ++i )
+                  bounds[i] = lo + (log_end - lo) / threads * i;
+               bounds[threads] = log_end;
+
+               // each range is walked from the first marker in it that looks right, the last one from the end of the log
+               vector<vector<uint64_t>> found( threads );
+               vector<std::thread> workers;
+               for( uint32_t i = 0; i < threads; ++i ) {
+                  workers.emplace_back( [&, i]() {
+                     const uint64_t start = i + 1 == threads ? log_end : find_marker( bounds[i], bounds[i+1] );
+                     if( start ) walk( start, bounds[i], found[i], scanned );
+                  });
+               }
+               for( auto& w : workers )
+                  w.join();
+
+               // follow the markers from the end of the log, and skip over the starts of a range once landing on one
+               vector<uint64_t> starts;
+               uint64_t o = log_end;
+               while( true ) {
+                  const uint64_t v = marker_before( o );
+                  if( v == block_log::npos || v < lo ) break;
+                  const auto& other = found[std::upper_bound( bounds.begin(), bounds.end() - 1, v ) - bounds.begin() - 1];
+                  auto itr = std::lower_bound( other.begin(), other.end(), v, std::greater<uint64_t>() );
+                  if( itr != other.end() && *itr == v )
+                     starts.insert( starts.end(), itr, other.end() );
+                  else
+                     starts.push_back( v );
+                  o = starts.back();
+                  if( o == blocks_begin ) break;
+               }
+
+               if( lower == block_log::npos ) {
+                  SNAX_ASSERT( !starts.empty() && starts.back() == blocks_begin, block_log_exception,
+                               "Block log is malformed, the position markers do not lead back to its first block" );
+                  return starts;
+               }
+               if( marker_before( starts.empty() ? log_end : starts.back() ) != lower )
+                  return {};
+               return starts;
+            }
+
+            /// @return the position that the marker ending at o holds, or npos if it does not look like a block start
+            uint64_t marker_before( uint64_t o )const {
+               if( o < blocks_begin + sizeof(uint64_t) || o > log_end ) return block_log::npos;
+               uint64_t v;
+               memcpy( &v, data + o - sizeof(uint64_t), sizeof(v) );
+               if( v < blocks_begin || v >= o - sizeof(uint64_t) || o - sizeof(uint64_t) - v > max_entry_size ) return block_log::npos;
+               return v;
+            }
+
+         private:
+            static const uint64_t max_entry_size = 64 * 1024 * 1024; ///< far larger than any block, only used to rule out guesses
+            static const uint32_t guess_depth = 4;                    ///< markers a guess has to lead through
+
+            /// @return the highest position in (lo, hi] that looks like the end of a marker, or 0 if there is none
+            uint64_t find_marker( uint64_t lo, uint64_t hi )const {
+               for( uint64_t o = hi; o > lo; --o ) {
+                  uint64_t p = o;
+                  uint32_t depth = 0;
+                  for( ; depth < guess_depth; ++depth ) {
+                     const uint64_t v = marker_before( p );
+                     if( v == block_log::npos ) break;
+                     if( v == blocks_begin ) { depth = guess_depth; break; }
+                     p = v;
+                  }
+                  if( depth == guess_depth ) return o;
+               }
+               return 0;
+            }
+
+            /// follows the markers from the one ending at o while the blocks start at or above lo
+            void walk( uint64_t o, uint64_t lo, vector<uint64_t>& starts, std::atomic<uint64_t>& scanned )const {
+               while( true ) {
+                  const uint64_t v = marker_before( o );
+                  if( v == block_log::npos || v < lo ) return;
+                  starts.push_back( v );
+                  scanned += o - v;
+                  if( v == blocks_begin ) return;
+                  o = v;
+               }
+            }
+
+            const char*     data;
+            const uint64_t  blocks_begin;
+            const uint64_t  log_end;
+      };
+   }
 
-      uint64_t end_pos;
-      my->check_block_read();
+   void block_log::construct_index( const fc::path& block_file, const fc::path& index_file, uint32_t threads,
+                                    const std::function<void(uint64_t, uint64_t)>& progress ) {
+      ilog("Reconstructing Block Log Index...");
+      const uint64_t log_size = fc::file_size(block_file);
+      SNAX_ASSERT( log_size > sizeof(uint32_t), block_log_exception, "Block log ${f} was not setup properly", ("f", block_file.generic_string()) );
+      bip::file_mapping mapping( block_file.generic_string().c_str(), bip::read_only );
+      bip::mapped_region region( mapping, bip::read_only, 0, log_size );
+      const char* log_data = static_cast<const char*>( region.get_address() );
 
-      my->block_stream.seekg(-sizeof( uint64_t), std::ios::end);
-      my->block_stream.read((char*)&end_pos, sizeof(end_pos));
-      signed_block tmp;
+      uint32_t version = 0;
+      memcpy( &version, log_data, sizeof(version) );
+      SNAX_ASSERT( version >= min_supported_version && version <= max_supported_version, block_log_unsupported_version,
+                   "Unsupported version of block log. Block log version is ${version} while code supports version(s) [${min},${max}]",
+                   ("version", version)("min", block_log::min_supported_version)("max", block_log::max_supported_version) );
 
       uint64_t pos = 0;
-      if (my->version == 1) {
+      uint32_t first_block_num = 1;
+      if (version == 1) {
          pos = 4; // Skip version which should have already been checked.
       } else {
+         memcpy( &first_block_num, log_data + sizeof(version), sizeof(first_block_num) );
          pos = 8; // Skip version and first block offset which should have already been checked
       }
-      my->block_stream.seekg(pos);
+      fc::datastream<const char*> ds(log_data + pos, log_size - pos);
 
       genesis_state gs;
-      fc::raw::unpack(my->block_stream, gs);
+      fc::raw::unpack(ds, gs);
 
       // skip the totem
-      if (my->version > 1) {
+      if (version > 1) {
          uint64_t totem;
-         my->block_stream.read((char*) &totem, sizeof(totem));
+         ds.read((char*) &totem, sizeof(totem));
+      }
+      const uint64_t blocks_begin = pos + ds.tellp();
+
+      uint64_t last_block_pos;
+      memcpy(&last_block_pos, log_data + log_size - sizeof(last_block_pos), sizeof(last_block_pos));
+      if( log_size < blocks_begin + sizeof(uint64_t) || last_block_pos == npos ) {
+         // no blocks yet
+         fc::remove_all(index_file);
+         std::fstream index_stream( index_file.generic_string().c_str(), LOG_WRITE );
+         return;
       }
 
-      while( pos < end_pos ) {
-         fc::raw::unpack(my->block_stream, tmp);
-         my->block_stream.read((char*)&pos, sizeof(pos));
-         my->index_stream.write((char*)&pos, sizeof(pos));
+      // keep the entries of the index up to the last block of the log, and resume after them
+      uint64_t lower = npos;
+      uint64_t index_count = fc::exists(index_file) ? fc::file_size(index_file) / sizeof(uint64_t) : 0;
+      if( index_count ) {
+         bip::file_mapping index_mapping( index_file.generic_string().c_str(), bip::read_only );
+         bip::mapped_region index_region( index_mapping, bip::read_only, 0, index_count * sizeof(uint64_t) );
+         const char* index_data = static_cast<const char*>( index_region.get_address() );
+         for( ; index_count; --index_count ) {
+            memcpy( &lower, index_data + (index_count - 1) * sizeof(uint64_t), sizeof(lower) );
+            if( lower >= blocks_begin && lower <= last_block_pos ) break;
+         }
+         if( !index_count ) lower = npos;
+      }
+      if( lower != npos ) {
+         // the last entry kept has to be the block that its place in the index stands for
+         uint32_t block_num = 0;
+         try {
+            const auto view = version < 3 ? packed_block_view{ log_data + lower, log_size - lower, nullptr }
+                                          : detail::decode_entry( log_data + lower, detail::entry_size( log_data + lower, log_size - lower ),
+                                                                  version, nullptr );
+            fc::datastream<const char*> header_ds( view.data, view.size );
+            block_header header;
+            fc::raw::unpack( header_ds, header );
+            block_num = header.block_num();
+         } catch( ... ) {
+         }
+         if( block_num != first_block_num + index_count - 1 )
+            lower = npos;
+      }
+
+      if( !threads ) {
+         // a thread per 64MiB at most, a smaller range is not worth a thread
+         const uint64_t max_threads = std::max<uint64_t>( 1, log_size / (64 * 1024 * 1024) );
+         threads = static_cast<uint32_t>( std::min<uint64_t>( std::max( 1u, std::thread::hardware_concurrency() ), max_threads ) );
+      }
+      detail::index_scanner scanner( log_data, blocks_begin, log_size );
+      std::atomic<uint64_t> scanned( 0 );
+      auto scan = [&]( uint64_t lower ) {
+         auto result = std::async( std::launch::async, [&]() { return scanner.scan( lower, threads, scanned ); } );
+         while( result.wait_for( std::chrono::seconds(1) ) != std::future_status::ready ) {
+            // walks from wrong guesses may scan the same blocks again
+            const uint64_t total = log_size - (lower == npos ? blocks_begin : lower);
+            if( progress ) progress( std::min( scanned.load(), total ), total );
+         }
+         return result.get();
+      };
+
+      auto starts = lower == npos ? optional<vector<uint64_t>>() : scan( lower );
+      if( starts ) {
+         ilog( "Resuming from the ${n} entries of the existing index", ("n", index_count) );
+         bfs::resize_file( index_file.generic_string(), index_count * sizeof(uint64_t) );
+      } else {
+         if( lower != npos )
+            wlog( "Index does not match the block log, reconstructing it from the first block" );
+         index_count = 0;
+         fc::remove_all(index_file);
+         scanned = 0;
+         starts = scan( npos );
       }
-   } // construct_index
+
+      std::fstream index_stream;
+      index_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
+      index_stream.open(index_file.generic_string().c_str(), LOG_WRITE);
+      for( auto itr = starts->rbegin(); itr != starts->rend(); ++itr )
+         index_stream.write( (const char*)&*itr, sizeof(*itr) );
+      index_stream.flush();
+      if( progress ) progress( log_size, log_size );
+      ilog( "Block log index has ${n} entries", ("n", index_count + starts->size()) );
+   }
 
    fc::path block_log::repair_log( const fc::path& data_dir, uint32_t truncate_at_block ) {
       ilog("Recovering Block Log...");
@@ -390,6 +1287,23 @@ namespace snax { namespace chain {
       fc::create_directories(blocks_dir);
       auto block_log_path = blocks_dir / "blocks.log";
 
+      // the segments rolled out of blocks.log are complete block logs of their own, which are restored as they are
+      vector<std::pair<uint32_t, uint32_t>> segments;
+      for( bfs::directory_iterator itr( backup_dir.generic_string() ), end; itr != end; ++itr ) {
+         uint32_t first_block_num = 0, last_block_num = 0;
+         if( detail::parse_segment_path( itr->path().generic_string(), first_block_num, last_block_num ) )
+            segments.emplace_back( first_block_num, last_block_num );
+      }
+      for( const auto& s : segments ) {
+         for( const char* extension : { ".log", ".index" } ) {
+            auto segment_file = detail::segment_path( backup_dir, s.first, s.second, extension );
+            if( fc::exists( segment_file ) )
+               fc::copy( segment_file, detail::segment_path( blocks_dir, s.first, s.second, extension ) );
+         }
+      }
+      if( !segments.empty() )
+         ilog( "Restored ${n} block log segments from the backed up blocks directory", ("n", segments.size()) );
+
       ilog( "Reconstructing '${new_block_log}' from backed up block log", ("new_block_log", block_log_path) );
 
       std::fstream  old_block_stream;
@@ -445,9 +1359,24 @@ namespace snax { namespace chain {
       uint64_t pos = old_block_stream.tellg();
       while( pos < end_pos ) {
          signed_block tmp;
+         vector<char> entry; // the bytes of a version 3 entry, which are kept as they are
 
          try {
-            fc::raw::unpack(old_block_stream, tmp);
+            if( version < 3 ) {
+               fc::raw::unpack(old_block_stream, tmp);
+            } else {
+               entry.resize( detail::entry_header_size );
+               old_block_stream.read( entry.data(), entry.size() );
+               SNAX_ASSERT( old_block_stream.gcount() == (std::streamsize)entry.size(), block_log_exception, "Block log entry is truncated" );
+               uint32_t size;
+               memcpy( &size, entry.data() + sizeof(uint8_t), sizeof(size) );
+               entry.resize( detail::entry_header_size + size );
+               old_block_stream.read( entry.data() + detail::entry_header_size, size );
+               SNAX_ASSERT( old_block_stream.gcount() == (std::streamsize)size, block_log_exception, "Block log entry is truncated" );
+               auto view = detail::decode_entry( entry.data(), entry.size(), version, nullptr );
+               fc::datastream<const char*> ds( view.data, view.size );
+               fc::raw::unpack(ds, tmp);
+            }
          } catch( ... ) {
             except_ptr = std::current_exception();
             incomplete_block_data.resize( end_pos - pos );
@@ -477,7 +1406,7 @@ namespace snax { namespace chain {
             break;
          }
 
-         auto data = fc::raw::pack(tmp);
+         auto data = version < 3 ? fc::raw::pack(tmp) : entry;
          new_block_stream.write( data.data(), data.size() );
          new_block_stream.write( reinterpret_cast<char*>(&pos), sizeof(pos) );
          block_num = tmp.block_num();
@@ -10,6 +10,7 @@
 #include <snax/chain/snax_contract.hpp>
 #include <snax/chain/global_property_object.hpp>
 #include <snax/chain/contract_table_objects.hpp>
+#include <snax/chain/key_value_hash_index.hpp>
 #include <snax/chain/generated_transaction_object.hpp>
 #include <snax/chain/transaction_object.hpp>
 #include <snax/chain/reversible_block_object.hpp>
@@ -26,6 +27,9 @@
 #include <boost/asio/thread_pool.hpp>
 #include <boost/asio/post.hpp>
 
+#include <atomic>
+#include <deque>
+
 
 namespace snax { namespace chain {
 
@@ -115,6 +119,17 @@ struct pending_state {
    }
 };
 
+static block_log_config make_block_log_config( const controller::config& cfg ) {
+   block_log_config c;
+   c.write_queue_size = cfg.blocks_log_write_queue_size;
+   c.fsync_interval   = cfg.blocks_log_fsync_interval;
+   c.stride           = cfg.blocks_log_stride;
+   c.retained_blocks  = cfg.blocks_log_retained_blocks;
+   c.archive_dir      = cfg.blocks_archive_dir;
+   c.compression      = cfg.blocks_log_compression;
+   return c;
+}
+
 struct controller_impl {
    controller&                    self;
    chainbase::database            db;
@@ -124,11 +139,13 @@ struct controller_impl {
    block_state_ptr                head;
    fork_database                  fork_db;
    wasm_interface                 wasmif;
+   recovered_keys_cache           recovered_keys;
    resource_limits_manager        resource_limits;
    authorization_manager          authorization;
    controller::config             conf;
    chain_id_type                  chain_id;
    bool                           replaying= false;
+   bool                           fork_db_recovered = false; ///< recovered from the journal, it may lag the reversible blocks
    optional<fc::time_point>       replay_head_time;
    db_read_mode                   read_mode = db_read_mode::SPECULATIVE;
    bool                           in_trx_requiring_checks = false; ///< if true, checks that are normally skipped on replay (e.g. auth checks) cannot be skipped
@@ -136,6 +153,13 @@ struct controller_impl {
    bool                           trusted_producer_light_validation = false;
    uint32_t                       snapshot_head_block = 0;
    optional<boost::asio::thread_pool>  thread_pool;
+   optional<key_value_hash_index> row_index;
+   /// a block_state built ahead by prepare_block, whose producer signature is verified on the thread pool
+   struct prepared_block {
+      block_state_ptr           state;
+      std::shared_future<void>  signee_verified;
+   };
+   map<block_id_type, prepared_block>  prepared_blocks;
 
    typedef pair<scope_name,action_name>                   handler_key;
    map< account_name, map<handler_key, apply_handler> >   apply_handlers;
@@ -187,9 +211,10 @@ struct controller_impl {
     reversible_blocks( cfg.blocks_dir/config::reversible_blocks_dir_name,
         cfg.read_only ? database::read_only : database::read_write,
         cfg.reversible_cache_size ),
-    blog( cfg.blocks_dir ),
-    fork_db( cfg.state_dir ),
-    wasmif( cfg.wasm_runtime ),
+    blog( cfg.blocks_dir, make_block_log_config( cfg ) ),
+    fork_db( cfg.state_dir, cfg.fork_db_journal ),
+    wasmif( cfg.wasm_runtime, cfg.code_cache_dir, cfg.code_cache_size, cfg.wasm_compile_threads, cfg.wasm_cache_size ),
+    recovered_keys( cfg.recovered_keys_cache_size ),
     resource_limits( db ),
     authorization( s, db ),
     conf( cfg ),
@@ -215,6 +240,8 @@ struct controller_impl {
 
    SET_APP_HANDLER( snax, snax, canceldelay );
 
+   if( conf.contract_row_hash_index ) row_index.emplace( db );
+
    fork_db.irreversible.connect( [&]( auto b ) {
                                  on_irreversible(b);
                                  });
@@ -272,14 +299,19 @@ struct controller_impl {
 
 
       db.commit( s->block_num );
+      if( row_index ) row_index->commit( s->block_num );
+      drop_prepared_blocks( s->block_num );
 
       if( append_to_blog ) {
          blog.append(s->block);
       }
 
+      // blocks still queued for the block log writer stay in the reversible database until they are written, so
+      // that a crash cannot lose them; they are removed by a later call once the writer has caught up
+      const uint32_t written_num = std::min( s->block_num, blog.last_written_block_num() );
       const auto& ubi = reversible_blocks.get_index<reversible_block_index,by_num>();
       auto objitr = ubi.begin();
-      while( objitr != ubi.end() && objitr->blocknum <= s->block_num ) {
+      while( objitr != ubi.end() && objitr->blocknum <= written_num ) {
          reversible_blocks.remove( *objitr );
          objitr = ubi.begin();
       }
@@ -307,6 +339,134 @@ struct controller_impl {
       }
    }
 
+   /**
+    *  A block from the block log that has been deserialized and prepared on the thread pool ahead of
+    *  application: its transactions are unpacked (and their keys recovered if they are going to be checked).
+    */
+   struct prefetched_block {
+      signed_block_ptr                  block;
+      vector<transaction_metadata_ptr>  trxs;
+   };
+
+   struct replay_stage {
+      std::shared_future<prefetched_block>  prefetched;
+      std::shared_future<block_state_ptr>   state;
+   };
+
+   struct replay_stats {
+      fc::microseconds                      read;
+      fc::microseconds                      stall;
+      fc::microseconds                      apply;
+      std::atomic<int64_t>                  unpack_us{0};
+      std::atomic<int64_t>                  header_us{0};
+   };
+
+   /**
+    *  Replays the irreversible blocks of the block log as a pipeline: the main thread reads packed blocks
+    *  sequentially up to conf.replay_prefetch_blocks ahead, the thread pool deserializes them, unpacks their
+    *  transactions and builds their block_state (chained in block order), and only apply_block runs on the
+    *  main thread. Blocks are still applied strictly in order so the resulting state is unchanged.
+    */
+   void replay_irreversible_blocks( uint32_t last_block_num, std::function<bool()> shutdown ) {
+      const bool skip_validate_signee = !conf.force_all_checks;
+      const bool recover_keys = conf.force_all_checks;
+      const auto start_block_num = head->block_num + 1;
+
+      replay_stats stats;
+      std::deque<replay_stage> window;
+
+      std::promise<block_state_ptr> head_promise;
+      head_promise.set_value( head );
+      std::shared_future<block_state_ptr> prev_state = head_promise.get_future().share();
+
+      uint32_t next_block_num = start_block_num;
+      auto fill_window = [&]() {
+         while( window.size() < conf.replay_prefetch_blocks && next_block_num <= last_block_num ) {
+            auto read_start = fc::time_point::now();
+            auto data = blog.read_serialized_block_by_num( next_block_num );
+            stats.read += fc::time_point::now() - read_start;
+            if( data.empty() ) {
+               next_block_num = last_block_num + 1;
+               break;
+            }
+
+            auto prefetched = async_thread_pool( [data = std::move(data), block_num = next_block_num, recover_keys,
+                                                  chain_id = this->chain_id, &stats, this]() {
+               auto unpack_start = fc::time_point::now();
+               prefetched_block result;
+               result.block = std::make_shared<signed_block>();
+               fc::datastream<const char*> ds( data.data(), data.size() );
+               fc::raw::unpack( ds, *result.block );
+               SNAX_ASSERT( result.block->block_num() == block_num, block_log_exception,
+                           "Wrong block was read from block log.", ("returned", result.block->block_num())("expected", block_num) );
+               result.trxs = unpack_block_transactions( *result.block );
+               if( recover_keys ) {
+                  for( const auto& mtrx : result.trxs )
+                     mtrx->recover_keys( chain_id, &recovered_keys );
+               }
+               stats.unpack_us += (fc::time_point::now() - unpack_start).count();
+               return result;
+            } ).share();
+
+            // each block_state is built from the one before it, so these tasks form a chain in block order;
+            // they only ever wait on tasks posted before them which keeps the pool free of deadlocks
+            prev_state = async_thread_pool( [prefetched, prev_state, skip_validate_signee, &stats]() {
+               const auto& prev = prev_state.get();
+               const auto& b = prefetched.get().block;
+               auto header_start = fc::time_point::now();
+               auto bsp = std::make_shared<block_state>( *prev, b, skip_validate_signee );
+               stats.header_us += (fc::time_point::now() - header_start).count();
+               return bsp;
+            } ).share();
+
+            window.push_back( replay_stage{ std::move(prefetched), prev_state } );
+            ++next_block_num;
+         }
+      };
+
+      auto report = [&]( const char* prefix ) {
+         auto n = head->block_num + 1 - start_block_num;
+         auto per_sec = [n]( const fc::microseconds& t ) { return t.count() > 0 ? n * 1000000.0 / t.count() : 0.0; };
+         ilog( "${p} ${n} blocks; read: ${r} blocks/s, unpack: ${u} blocks/s, header: ${h} blocks/s, apply: ${a} blocks/s, "
+               "main thread stalled on pipeline for ${s} ms",
+               ("p", prefix)("n", n)
+               ("r", per_sec(stats.read))("u", per_sec(fc::microseconds(stats.unpack_us.load())))
+               ("h", per_sec(fc::microseconds(stats.header_us.load())))("a", per_sec(stats.apply))
+               ("s", stats.stall.count() / 1000) );
+      };
+
+      // tasks in flight hold a reference to stats, make sure they are done before leaving
+      auto drain_window = fc::make_scoped_exit([&window]() {
+         for( auto& stage : window ) {
+            stage.prefetched.wait();
+            stage.state.wait();
+         }
+      });
+
+      for( fill_window(); !window.empty(); fill_window() ) {
+         auto stage = std::move( window.front() );
+         window.pop_front();
+
+         auto stall_start = fc::time_point::now();
+         const auto& bsp = stage.state.get();
+         auto trxs = stage.prefetched.get().trxs;
+         auto apply_start = fc::time_point::now();
+         stats.stall += apply_start - stall_start;
+
+         replay_push_block( bsp, trxs, controller::block_status::irreversible );
+         stats.apply += fc::time_point::now() - apply_start;
+
+         if( bsp->block_num % 100 == 0 ) {
+            std::cerr << std::setw(10) << bsp->block_num << " of " << last_block_num <<"\r";
+            if( bsp->block_num % 100000 == 0 )
+               report( "replay progress:" );
+            if( shutdown() ) break;
+         }
+      }
+      std::cerr<< "\n";
+      report( "replay pipeline processed" );
+   }
+
    void replay(std::function<bool()> shutdown) {
       auto blog_head = blog.read_head();
       auto blog_head_time = blog_head->timestamp.to_time_point();
@@ -317,14 +477,7 @@ struct controller_impl {
             ("s", start_block_num)("n", blog_head->block_num()) );
 
       auto start = fc::time_point::now();
-      while( auto next = blog.read_block_by_num( head->block_num + 1 ) ) {
-         replay_push_block( next, controller::block_status::irreversible );
-         if( next->block_num() % 100 == 0 ) {
-            std::cerr << std::setw(10) << next->block_num() << " of " << blog_head->block_num() <<"\r";
-            if( shutdown() ) break;
-         }
-      }
-      std::cerr<< "\n";
+      replay_irreversible_blocks( blog_head->block_num(), shutdown );
       ilog( "${n} blocks replayed", ("n", head->block_num - start_block_num) );
 
       // if the irreverible log is played without undo sessions enabled, we need to sync the
@@ -357,6 +510,7 @@ struct controller_impl {
          snapshot->validate();
 
          read_from_snapshot( snapshot );
+         if( row_index ) row_index->build();
 
          auto end = blog.read_head();
          if( !end ) {
@@ -371,6 +525,7 @@ struct controller_impl {
          if( !head ) {
             initialize_fork_db(); // set head to genesis state
          }
+         if( row_index ) row_index->build();
 
          auto end = blog.read_head();
          if( !end ) {
@@ -385,8 +540,10 @@ struct controller_impl {
 
       const auto& ubi = reversible_blocks.get_index<reversible_block_index,by_num>();
       auto objitr = ubi.rbegin();
+      // a received block is journaled once applied, so a fork database recovered from the journal can lag the reversible blocks
+      const bool reapply_reversible = fork_db_recovered && objitr != ubi.rend() && objitr->blocknum > head->block_num;
       if( objitr != ubi.rend() ) {
-         SNAX_ASSERT( objitr->blocknum == head->block_num, fork_database_exception,
+         SNAX_ASSERT( objitr->blocknum == head->block_num || reapply_reversible, fork_database_exception,
                     "reversible block database is inconsistent with fork database, replay blockchain",
                     ("head",head->block_num)("unconfimed", objitr->blocknum)         );
       } else {
@@ -403,9 +560,25 @@ struct controller_impl {
          wlog( "warning: database revision (${db}) is greater than head block number (${head}), "
                "attempting to undo pending changes",
                ("db",db.revision())("head",head->block_num) );
+         while( db.revision() > head->block_num ) {
+            db.undo();
+         }
+         // the index was built with the pending changes, which were not journaled
+         if( row_index ) row_index->build();
       }
-      while( db.revision() > head->block_num ) {
-         db.undo();
+
+      if( reapply_reversible ) {
+         const auto reversible_head = objitr->blocknum;
+         wlog( "fork database recovered at block ${head}, re-applying reversible blocks up to ${n}",
+               ("head",head->block_num)("n",reversible_head) );
+         replaying = true;
+         auto reset_replaying = fc::make_scoped_exit( [&]() { replaying = false; } );
+         while( auto obj = reversible_blocks.find<reversible_block_object,by_num>(head->block_num+1) ) {
+            replay_push_block( obj->get_block(), controller::block_status::validated );
+         }
+         SNAX_ASSERT( head->block_num == reversible_head, fork_database_exception,
+                      "reversible block database is inconsistent with fork database, replay blockchain",
+                      ("head",head->block_num)("unconfimed", reversible_head) );
       }
 
       if( report_integrity_hash ) {
@@ -449,9 +622,11 @@ struct controller_impl {
       });
    }
 
-   void add_contract_tables_to_snapshot( const snapshot_writer_ptr& snapshot ) const {
-      snapshot->write_section("contract_tables", [this]( auto& section ) {
-         index_utils<table_id_multi_index>::walk(db, [this, &section]( const table_id_object& table_row ){
+   /// writes the contract tables with ids in [begin_id, end_id) and their rows
+   void add_contract_tables_to_snapshot( snapshot_writer& snapshot, int64_t begin_id, int64_t end_id ) const {
+      snapshot.write_section("contract_tables", [this, begin_id, end_id]( auto& section ) {
+         index_utils<table_id_multi_index>::walk_range<by_id>(db, table_id_object::id_type(begin_id), table_id_object::id_type(end_id),
+                                                              [this, &section]( const table_id_object& table_row ){
             // add a row for the table
             section.add_row(table_row, db);
 
@@ -517,7 +692,11 @@ struct controller_impl {
          section.template add_row<block_header_state>(*fork_db.head(), db);
       });
 
-      controller_index_set::walk_indices([this, &snapshot]( auto utils ){
+      // the sections below only read the database so writers that can, write them on several threads at once
+      std::vector<std::function<void(snapshot_writer&)>> writes;
+
+      controller_index_set::walk_indices([this, &writes]( auto utils ){
+         using utils_t = decltype(utils);
          using value_t = typename decltype(utils)::index_t::value_type;
 
          // skip the table_id_object as its inlined with contract tables section
@@ -525,14 +704,29 @@ struct controller_impl {
             return;
          }
 
-         snapshot->write_section<value_t>([this]( auto& section ){
-            decltype(utils)::walk(db, [this, &section]( const auto &row ) {
-               section.add_row(row, db);
+         writes.emplace_back([this]( snapshot_writer& snapshot ){
+            snapshot.write_section<value_t>([this]( auto& section ){
+               utils_t::walk(db, [this, &section]( const auto &row ) {
+                  section.add_row(row, db);
+               });
             });
          });
       });
 
-      add_contract_tables_to_snapshot(snapshot);
+      // split the contract tables by table id so that the largest section is spread over the threads too, the parts are
+      // read back as a single section
+      const auto& tables = db.get_index<table_id_multi_index, by_id>();
+      const int64_t end_id = tables.empty() ? 0 : tables.rbegin()->id._id + 1;
+      const int64_t parts = std::max<int64_t>( 1, std::min<int64_t>( end_id, snapshot->concurrency() > 1 ? snapshot->concurrency() * 4 : 1 ) );
+      for( int64_t part = 0; part < parts; ++part ) {
+         const int64_t begin = part == 0 ? 0 : end_id * part / parts;
+         const int64_t end = part == parts - 1 ? std::numeric_limits<int64_t>::max() : end_id * (part + 1) / parts;
+         writes.emplace_back([this, begin, end]( snapshot_writer& snapshot ){
+            add_contract_tables_to_snapshot(snapshot, begin, end);
+         });
+      }
+
+      snapshot->write_concurrently(writes);
 
       authorization.add_to_snapshot(snapshot);
       resource_limits.add_to_snapshot(snapshot);
@@ -706,6 +900,8 @@ struct controller_impl {
             emit(self.accepted_block_header, pending->_pending_block_state);
             head = fork_db.head();
             SNAX_ASSERT(new_bsp == head, fork_database_exception, "committed block did not become the new head in fork database");
+            // journaled before the reversible block database holds the block, recover_blocks drops it if the write is lost
+            fork_db.flush_journal();
          }
 
          if( !replaying ) {
@@ -834,8 +1030,10 @@ struct controller_impl {
    transaction_trace_ptr push_scheduled_transaction( const generated_transaction_object& gto, fc::time_point deadline, uint32_t billed_cpu_time_us, bool explicit_billed_cpu_time = false )
    { try {
       maybe_session undo_session;
-      if ( !self.skip_db_sessions() )
+      if ( !self.skip_db_sessions() ) {
+         if( row_index ) row_index->sync();
          undo_session = maybe_session(db);
+      }
 
       auto gtrx = generated_transaction(gto);
 
@@ -1039,7 +1237,7 @@ struct controller_impl {
             if( !self.skip_auth_check() && !trx->implicit ) {
                authorization.check_authorization(
                        trx->trx.actions,
-                       trx->recover_keys( chain_id ),
+                       trx->recover_keys( chain_id, &recovered_keys ),
                        {},
                        trx_context.delay,
                        [&trx_context](){ trx_context.checktime(); },
@@ -1118,6 +1316,7 @@ struct controller_impl {
          SNAX_ASSERT( db.revision() == head->block_num, database_exception, "db revision is not on par with head block",
                      ("db.revision()", db.revision())("controller_head_block", head->block_num)("fork_db_head_block", fork_db.head()->block_num) );
 
+         if( row_index ) row_index->sync();
          pending.emplace(maybe_session(db));
       } else {
          pending.emplace(maybe_session());
@@ -1190,28 +1389,53 @@ struct controller_impl {
       static_cast<signed_block_header&>(*p->block) = p->header;
    } /// sign_block
 
-   void apply_block( const signed_block_ptr& b, controller::block_status s ) { try {
+   /**
+    *  Unpacks the packed transactions of a block, in block order. Does not touch controller state and
+    *  so may be called from the thread pool.
+    */
+   static vector<transaction_metadata_ptr> unpack_block_transactions( const signed_block& b ) {
+      vector<transaction_metadata_ptr> packed_transactions;
+      packed_transactions.reserve( b.transactions.size() );
+      for( const auto& receipt : b.transactions ) {
+         if( receipt.trx.contains<packed_transaction>()) {
+            auto& pt = receipt.trx.get<packed_transaction>();
+            packed_transactions.emplace_back( std::make_shared<transaction_metadata>( pt ) );
+         }
+      }
+      return packed_transactions;
+   }
+
+   /**
+    *  @param prepared_trxs - the packed transactions of b already unpacked by unpack_block_transactions, if empty
+    *                         they are unpacked here
+    */
+   void apply_block( const signed_block_ptr& b, controller::block_status s,
+                     const vector<transaction_metadata_ptr>& prepared_trxs = vector<transaction_metadata_ptr>() ) { try {
       try {
          SNAX_ASSERT( b->block_extensions.size() == 0, block_validate_exception, "no supported extensions" );
          auto producer_block_id = b->id();
          start_block( b->timestamp, b->confirmed, s , producer_block_id);
 
-         std::vector<transaction_metadata_ptr> packed_transactions;
-         packed_transactions.reserve( b->transactions.size() );
-         for( const auto& receipt : b->transactions ) {
-            if( receipt.trx.contains<packed_transaction>()) {
-               auto& pt = receipt.trx.get<packed_transaction>();
-               auto mtrx = std::make_shared<transaction_metadata>( pt );
-               if( !self.skip_auth_check() ) {
-                  std::weak_ptr<transaction_metadata> mtrx_wp = mtrx;
-                  mtrx->signing_keys_future = async_thread_pool( [chain_id = this->chain_id, mtrx_wp]() {
-                     auto mtrx = mtrx_wp.lock();
-                     return mtrx ?
-                            std::make_pair( chain_id, mtrx->trx.get_signature_keys( chain_id ) ) :
-                            std::make_pair( chain_id, decltype( mtrx->trx.get_signature_keys( chain_id ) ){} );
-                  } );
+         std::vector<transaction_metadata_ptr> packed_transactions = prepared_trxs.empty() ? unpack_block_transactions( *b )
+                                                                                           : prepared_trxs;
+         if( !self.skip_auth_check() ) {
+            for( const auto& mtrx : packed_transactions ) {
+               if( mtrx->signing_keys && mtrx->signing_keys->first == chain_id )
+                  continue;
+               // transactions this node already saw pushed to it, or applied in a block of another fork
+               if( auto keys = recovered_keys.find( mtrx->signed_id, chain_id ) ) {
+                  mtrx->signing_keys = std::make_pair( chain_id, std::move( *keys ) );
+                  continue;
                }
-               packed_transactions.emplace_back( std::move( mtrx ) );
+               std::weak_ptr<transaction_metadata> mtrx_wp = mtrx;
+               mtrx->signing_keys_future = async_thread_pool( [chain_id = this->chain_id, mtrx_wp, this]() {
+                  auto mtrx = mtrx_wp.lock();
+                  if( !mtrx )
+                     return std::make_pair( chain_id, flat_set<public_key_type>() );
+                  auto keys = mtrx->trx.get_signature_keys( chain_id );
+                  recovered_keys.add( mtrx->signed_id, chain_id, keys );
+                  return std::make_pair( chain_id, std::move( keys ) );
+               } );
             }
          }
 
@@ -1287,12 +1511,76 @@ struct controller_impl {
       auto prev = fork_db.get_block( b->previous );
       SNAX_ASSERT( prev, unlinkable_block_exception, "unlinkable block ${id}", ("id", id)("previous", b->previous) );
 
+      auto prepared = prepared_blocks.find( id );
+      if( prepared != prepared_blocks.end() ) {
+         auto p = std::move( prepared->second );
+         prepared_blocks.erase( prepared );
+         return std::async( std::launch::deferred, [p]() {
+            p.signee_verified.get();
+            return p.state;
+         } );
+      }
+
       return async_thread_pool( [b, prev]() {
          const bool skip_validate_signee = false;
          return std::make_shared<block_state>( *prev, move( b ), skip_validate_signee );
       } );
    }
 
+   /**
+    *  Builds the block_state of b from the (possibly also prepared) block_state of the block before it, and
+    *  starts recovering its producer key and the signatures of its transactions on the thread pool. Only the
+    *  cheap header chaining happens here, in order; the signatures of blocks prepared in order are therefore
+    *  recovered in parallel while the main thread applies earlier ones.
+    */
+   void prepare_block( const signed_block_ptr& b ) {
+      SNAX_ASSERT( b, block_validate_exception, "null block" );
+
+      auto id = b->id();
+      if( prepared_blocks.count( id ) || fork_db.get_block( id ) ) return;
+
+      block_state_ptr prev;
+      auto prepared_prev = prepared_blocks.find( b->previous );
+      if( prepared_prev != prepared_blocks.end() ) {
+         prev = prepared_prev->second.state;
+      } else {
+         prev = fork_db.get_block( b->previous );
+      }
+      if( !prev ) return; // unlinkable, reported when the block is pushed
+
+      block_state_ptr state;
+      try {
+         const bool skip_validate_signee = true;
+         state = std::make_shared<block_state>( *prev, b, skip_validate_signee );
+      } catch( ... ) {
+         return; // invalid, reported when the block is pushed
+      }
+
+      // transaction signatures do not depend on the previous block, apply_block finds them in recovered_keys
+      if( !self.skip_auth_check() && b->transactions.size() ) {
+         async_thread_pool( [b, chain_id = this->chain_id, this]() {
+            for( const auto& mtrx : unpack_block_transactions( *b ) )
+               mtrx->recover_keys( chain_id, &recovered_keys );
+         } );
+      }
+
+      auto& prepared = prepared_blocks[id];
+      prepared.state = state;
+      prepared.signee_verified = async_thread_pool( [state]() {
+         state->verify_signee( state->signee() );
+      } ).share();
+   }
+
+   /// drops the blocks prepared at or below block_num, which can no longer be pushed
+   void drop_prepared_blocks( uint32_t block_num ) {
+      for( auto itr = prepared_blocks.begin(); itr != prepared_blocks.end(); ) {
+         if( block_header::num_from_id( itr->first ) <= block_num )
+            itr = prepared_blocks.erase( itr );
+         else
+            ++itr;
+      }
+   }
+
    void push_block( std::future<block_state_ptr>& block_state_future ) {
       controller::block_status s = controller::block_status::complete;
       SNAX_ASSERT(!pending, block_validate_exception, "it is not valid to push a block when there is a pending block");
@@ -1320,23 +1608,41 @@ struct controller_impl {
    }
 
    void replay_push_block( const signed_block_ptr& b, controller::block_status s ) {
+      SNAX_ASSERT( b, block_validate_exception, "trying to push empty block" );
+      replay_push_block( b, s, [&]() {
+         const bool skip_validate_signee = !conf.force_all_checks;
+         return fork_db.add( b, skip_validate_signee );
+      });
+   }
+
+   /**
+    *  Replays a block whose block_state was already built (and transactions unpacked) ahead of time
+    */
+   void replay_push_block( const block_state_ptr& bsp, const vector<transaction_metadata_ptr>& trxs, controller::block_status s ) {
+      SNAX_ASSERT( bsp && bsp->block, block_validate_exception, "trying to push empty block" );
+      replay_push_block( bsp->block, s, [&]() {
+         return fork_db.add( bsp, false );
+      }, trxs );
+   }
+
+   template<typename AddToForkDb>
+   void replay_push_block( const signed_block_ptr& b, controller::block_status s, AddToForkDb&& add_to_fork_db,
+                           const vector<transaction_metadata_ptr>& trxs = vector<transaction_metadata_ptr>() ) {
       self.validate_db_available_size();
       self.validate_reversible_available_size();
 
       SNAX_ASSERT(!pending, block_validate_exception, "it is not valid to push a block when there is a pending block");
 
       try {
-         SNAX_ASSERT( b, block_validate_exception, "trying to push empty block" );
          SNAX_ASSERT( (s == controller::block_status::irreversible || s == controller::block_status::validated),
                      block_validate_exception, "invalid block status for replay" );
          emit( self.pre_accepted_block, b );
-         const bool skip_validate_signee = !conf.force_all_checks;
-         auto new_header_state = fork_db.add( b, skip_validate_signee );
+         auto new_header_state = add_to_fork_db();
 
          emit( self.accepted_block_header, new_header_state );
 
          if ( read_mode != db_read_mode::IRREVERSIBLE ) {
-            maybe_switch_forks( s );
+            maybe_switch_forks( s, trxs );
          }
 
          // on replay irreversible is not emitted by fork database, so emit it explicitly here
@@ -1346,12 +1652,18 @@ struct controller_impl {
       } FC_LOG_AND_RETHROW( )
    }
 
-   void maybe_switch_forks( controller::block_status s ) {
+   /**
+    *  @param trxs - unpacked transactions of the new head, only used when it builds directly off the current head
+    */
+   void maybe_switch_forks( controller::block_status s,
+                            const vector<transaction_metadata_ptr>& trxs = vector<transaction_metadata_ptr>() ) {
+      // the fork database changes made for the block are journaled together
+      auto flush_journal = fc::make_scoped_exit( [&]() { fork_db.flush_journal(); } );
       auto new_head = fork_db.head();
 
       if( new_head->header.previous == head->id ) {
          try {
-            apply_block( new_head->block, s );
+            apply_block( new_head->block, s, trxs );
             fork_db.mark_in_current_chain( new_head, true );
             fork_db.set_validity( new_head, true );
             head = new_head;
@@ -1377,7 +1689,7 @@ struct controller_impl {
                apply_block( (*ritr)->block, (*ritr)->validated ? controller::block_status::validated : controller::block_status::complete );
                head = *ritr;
                fork_db.mark_in_current_chain( *ritr, true );
-               (*ritr)->validated = true;
+               fork_db.set_validity( *ritr, true );
             }
             catch (const fc::exception& e) { except = e; }
             if (except) {
@@ -1743,6 +2055,15 @@ void controller::add_indices() {
 }
 
 void controller::startup( std::function<bool()> shutdown, const snapshot_reader_ptr& snapshot ) {
+   my->fork_db_recovered = my->fork_db.recover_blocks( [&]( const block_state& s ) -> signed_block_ptr {
+      // reversible blocks are applied ones, blocks of other forks have to be received again
+      signed_block_ptr b;
+      if( const auto* obj = my->reversible_blocks.find<reversible_block_object,by_num>( s.block_num ) )
+         b = obj->get_block();
+      else
+         b = my->blog.read_block_by_num( s.block_num );
+      return b && b->id() == s.id ? b : signed_block_ptr();
+   });
    my->head = my->fork_db.head();
    if( !my->head ) {
       elog( "No head block in fork db, perhaps we need to replay" );
@@ -1754,6 +2075,8 @@ const chainbase::database& controller::db()const { return my->db; }
 
 chainbase::database& controller::mutable_db()const { return my->db; }
 
+key_value_hash_index* controller::row_hash_index()const { return my->row_index ? &*my->row_index : nullptr; }
+
 const fork_database& controller::fork_db()const { return my->fork_db; }
 
 
@@ -1785,6 +2108,14 @@ std::future<block_state_ptr> controller::create_block_state_future( const signed
    return my->create_block_state_future( b );
 }
 
+void controller::prepare_block( const signed_block_ptr& b ) {
+   my->prepare_block( b );
+}
+
+void controller::clear_prepared_blocks() {
+   my->prepared_blocks.clear();
+}
+
 void controller::push_block( std::future<block_state_ptr>& block_state_future ) {
    validate_db_available_size();
    validate_reversible_available_size();
@@ -1934,6 +2265,10 @@ signed_block_ptr controller::fetch_block_by_number( uint32_t block_num )const  {
    return my->blog.read_block_by_num(block_num);
 } FC_CAPTURE_AND_RETHROW( (block_num) ) }
 
+packed_block_view controller::fetch_packed_block_by_number( uint32_t block_num )const { try {
+   return my->blog.read_packed_block_by_num(block_num);
+} FC_CAPTURE_AND_RETHROW( (block_num) ) }
+
 block_state_ptr controller::fetch_block_state_by_id( block_id_type id )const {
    auto state = my->fork_db.get_block(id);
    return state;
@@ -2106,6 +2441,14 @@ wasm_interface& controller::get_wasm_interface() {
    return my->wasmif;
 }
 
+const wasm_interface& controller::get_wasm_interface()const {
+   return my->wasmif;
+}
+
+recovered_keys_cache::stats controller::get_recovered_keys_stats()const {
+   return my->recovered_keys.get_stats();
+}
+
 const account_object& controller::get_account( account_name name )const
 { try {
    return my->db.get<account_object, by_name>(name);
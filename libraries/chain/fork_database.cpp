@@ -1,55 +1,383 @@
 #include <snax/chain/fork_database.hpp>
 #include <snax/chain/exceptions.hpp>
-#include <boost/multi_index_container.hpp>
-#include <boost/multi_index/member.hpp>
-#include <boost/multi_index/ordered_index.hpp>
-#include <boost/multi_index/hashed_index.hpp>
-#include <boost/multi_index/mem_fun.hpp>
-#include <boost/multi_index/composite_key.hpp>
 #include <fc/io/fstream.hpp>
+#include <fc/crypto/city.hpp>
+#include <fc/scoped_exit.hpp>
+#include <algorithm>
+#include <deque>
 #include <fstream>
+#include <limits>
+#include <tuple>
+#include <unordered_map>
+
+namespace snax { namespace chain { namespace detail {
+
+   /// what the journal keeps of a block state, its block is kept by the reversible block database
+   struct journaled_block_state {
+      block_header_state header_state;
+      bool               validated = false;
+      bool               in_current_chain = false;
+   };
+
+} } } /// snax::chain::detail
+
+FC_REFLECT( snax::chain::detail::journaled_block_state, (header_state)(validated)(in_current_chain) )
 
 namespace snax { namespace chain {
-   using boost::multi_index_container;
-   using namespace boost::multi_index;
-
-
-   struct by_block_id;
-   struct by_block_num;
-   struct by_lib_block_num;
-   struct by_prev;
-   typedef multi_index_container<
-      block_state_ptr,
-      indexed_by<
-         hashed_unique< tag<by_block_id>, member<block_header_state, block_id_type, &block_header_state::id>, std::hash<block_id_type>>,
-         ordered_non_unique< tag<by_prev>, const_mem_fun<block_header_state, const block_id_type&, &block_header_state::prev> >,
-         ordered_non_unique< tag<by_block_num>,
-            composite_key< block_state,
-               member<block_header_state,uint32_t,&block_header_state::block_num>,
-               member<block_state,bool,&block_state::in_current_chain>
-            >,
-            composite_key_compare< std::less<uint32_t>, std::greater<bool> >
-         >,
-         ordered_non_unique< tag<by_lib_block_num>,
-            composite_key< block_header_state,
-                member<block_header_state,uint32_t,&block_header_state::dpos_irreversible_blocknum>,
-                member<block_header_state,uint32_t,&block_header_state::bft_irreversible_blocknum>,
-                member<block_header_state,uint32_t,&block_header_state::block_num>
-            >,
-            composite_key_compare< std::greater<uint32_t>, std::greater<uint32_t>, std::greater<uint32_t> >
-         >
-      >
-   > fork_multi_index_type;
 
+   /**
+    *  Flat index of the block states in the fork database.
+    *
+    *  Block states live in a contiguous arena of nodes that link to their parent by slot, with a
+    *  hash map from id to slot and a small vector of slots per block height. Nodes keep a copy of
+    *  the keys the fork database orders by so that branch walks, head selection and pruning touch
+    *  the arena rather than block states scattered across the heap. Erased slots are reused.
+    */
+   class fork_index {
+      public:
+         static constexpr uint32_t npos = std::numeric_limits<uint32_t>::max();
+
+         size_t size()const { return ids.size(); }
+
+         void clear() {
+            nodes.clear();
+            free_slots.clear();
+            ids.clear();
+            heights.clear();
+            first_height = 0;
+            best_slot    = npos;
+            best_dirty   = false;
+         }
+
+         block_state_ptr find( const block_id_type& id )const {
+            auto itr = ids.find( id );
+            return itr != ids.end() ? nodes[itr->second].state : block_state_ptr();
+         }
+
+         bool contains( const block_id_type& id )const { return ids.count( id ) != 0; }
+
+         /// @return false if a block state with the same id is already indexed
+         bool insert( const block_state_ptr& s ) {
+            auto result = ids.emplace( s->id, 0 );
+            if( !result.second ) return false;
+
+            uint32_t slot;
+            if( free_slots.size() ) {
+               slot = free_slots.back();
+               free_slots.pop_back();
+            } else {
+               slot = nodes.size();
+               nodes.emplace_back();
+            }
+            result.first->second = slot;
+
+            auto& n = nodes[slot];
+            n.id               = s->id;
+            n.previous         = s->header.previous;
+            n.state            = s;
+            n.seq              = next_seq++;
+            n.block_num        = s->block_num;
+            n.dpos_lib         = s->dpos_irreversible_blocknum;
+            n.bft_lib          = s->bft_irreversible_blocknum;
+            n.in_current_chain = s->in_current_chain;
+
+            auto parent = ids.find( n.previous );
+            n.parent = parent != ids.end() ? parent->second : npos;
+            for( auto child : children_slots( n.id, n.block_num ) )
+               nodes[child].parent = slot;
+
+            auto& at = height( n.block_num );
+            at.push_back( slot );
+            sort_height( at );
+
+            if( !best_dirty && ( best_slot == npos || better_lib( slot, best_slot ) ) )
+               best_slot = slot;
+            return true;
+         }
+
+         /// @return the erased block state or null if it was not indexed
+         block_state_ptr erase( const block_id_type& id ) {
+            auto itr = ids.find( id );
+            if( itr == ids.end() ) return block_state_ptr();
+            const auto slot = itr->second;
+            ids.erase( itr );
+
+            auto& n = nodes[slot];
+            for( auto child : children_slots( n.id, n.block_num ) )
+               nodes[child].parent = npos;
+
+            auto& at = heights[n.block_num - first_height];
+            at.erase( std::find( at.begin(), at.end(), slot ) );
+            while( heights.size() && heights.front().empty() ) {
+               heights.pop_front();
+               ++first_height;
+            }
+            while( heights.size() && heights.back().empty() )
+               heights.pop_back();
+
+            if( slot == best_slot ) best_dirty = true;
+
+            block_state_ptr erased;
+            erased.swap( n.state );
+            n.parent = npos;
+            free_slots.push_back( slot );
+            return erased;
+         }
+
+         /// the block with the highest (dpos lib, bft lib, block num), the earliest inserted on ties
+         block_state_ptr best()const {
+            if( best_dirty ) {
+               best_slot  = npos;
+               best_dirty = false;
+               for( const auto& at : heights )
+                  for( auto slot : at )
+                     if( best_slot == npos || better_lib( slot, best_slot ) )
+                        best_slot = slot;
+            }
+            return best_slot != npos ? nodes[best_slot].state : block_state_ptr();
+         }
+
+         /// the lowest block, preferring the one in the current chain and then the earliest inserted
+         block_state_ptr oldest()const {
+            return heights.size() ? nodes[heights.front().front()].state : block_state_ptr();
+         }
+
+         /// blocks at height @p num ordered as for oldest()
+         vector<block_state_ptr> at_height( uint32_t num )const {
+            vector<block_state_ptr> result;
+            if( num < first_height || num - first_height >= heights.size() ) return result;
+            for( auto slot : heights[num - first_height] )
+               result.push_back( nodes[slot].state );
+            return result;
+         }
+
+         block_state_ptr in_current_chain_at( uint32_t num )const {
+            if( num < first_height || num - first_height >= heights.size() ) return block_state_ptr();
+            const auto& at = heights[num - first_height];
+            if( at.empty() || !nodes[at.front()].in_current_chain ) return block_state_ptr();
+            return nodes[at.front()].state;
+         }
+
+         /// ids of the blocks built directly on @p id, which does not need to be indexed itself
+         vector<block_id_type> children( const block_id_type& id )const {
+            vector<block_id_type> result;
+            for( auto slot : children_slots( id, block_header::num_from_id( id ) ) )
+               result.push_back( nodes[slot].id );
+            return result;
+         }
+
+         /**
+          *  Walks both branches back by parent slot until they share the same previous block.
+          *  @return the branches from the given blocks down to (and including) the first blocks past the fork
+          */
+         pair<branch_type, branch_type> branches( const block_id_type& first, const block_id_type& second )const {
+            pair<branch_type, branch_type> result;
+            auto slot = [&]( const block_id_type& id ) {
+               auto itr = ids.find( id );
+               SNAX_ASSERT( itr != ids.end(), fork_db_block_not_found, "block ${id} does not exist", ("id", string(id)) );
+               return itr->second;
+            };
+            auto parent = [&]( uint32_t s ) {
+               SNAX_ASSERT( nodes[s].parent != npos, fork_db_block_not_found, "block ${id} does not exist",
+                            ("id", string(nodes[s].previous)) );
+               return nodes[s].parent;
+            };
+
+            auto a = slot( first );
+            auto b = slot( second );
+            while( nodes[a].block_num > nodes[b].block_num ) {
+               result.first.push_back( nodes[a].state );
+               a = parent( a );
+            }
+            while( nodes[b].block_num > nodes[a].block_num ) {
+               result.second.push_back( nodes[b].state );
+               b = parent( b );
+            }
+            while( nodes[a].previous != nodes[b].previous ) {
+               result.first.push_back( nodes[a].state );
+               result.second.push_back( nodes[b].state );
+               a = parent( a );
+               b = parent( b );
+            }
+            result.first.push_back( nodes[a].state );
+            result.second.push_back( nodes[b].state );
+            return result;
+         }
+
+         void set_in_current_chain( const block_id_type& id, bool in_current_chain ) {
+            auto& n = nodes[ids.at( id )];
+            n.state->in_current_chain = in_current_chain;
+            n.in_current_chain        = in_current_chain;
+            sort_height( heights[n.block_num - first_height] );
+         }
+
+         void set_bft_irreversible( const block_id_type& id, uint32_t bft_lib ) {
+            const auto slot = ids.at( id );
+            auto& n = nodes[slot];
+            n.state->bft_irreversible_blocknum = bft_lib;
+            n.bft_lib                          = bft_lib;
+            if( !best_dirty && ( best_slot == npos || better_lib( slot, best_slot ) ) )
+               best_slot = slot;
+         }
+
+         /// visits every block in increasing block number
+         template<typename F>
+         void for_each( F&& f )const {
+            for( const auto& at : heights )
+               for( auto slot : at )
+                  f( nodes[slot].state );
+         }
+
+      private:
+         struct node {
+            block_id_type    id;
+            block_id_type    previous;
+            block_state_ptr  state;
+            uint64_t         seq              = 0;    ///< insertion order, breaks ties like an ordered index would
+            uint32_t         parent           = npos;
+            uint32_t         block_num        = 0;
+            uint32_t         dpos_lib         = 0;
+            uint32_t         bft_lib          = 0;
+            bool             in_current_chain = false;
+         };
+
+         bool better_lib( uint32_t a, uint32_t b )const {
+            const auto& x = nodes[a];
+            const auto& y = nodes[b];
+            return std::tie( x.dpos_lib, x.bft_lib, x.block_num, y.seq ) > std::tie( y.dpos_lib, y.bft_lib, y.block_num, x.seq );
+         }
+
+         void sort_height( vector<uint32_t>& at )const {
+            std::sort( at.begin(), at.end(), [&]( uint32_t a, uint32_t b ) {
+               return std::tie( nodes[b].in_current_chain, nodes[a].seq ) < std::tie( nodes[a].in_current_chain, nodes[b].seq );
+            });
+         }
+
+         vector<uint32_t>& height( uint32_t num ) {
+            if( heights.empty() ) {
+               first_height = num;
+            } else if( num < first_height ) {
+               heights.insert( heights.begin(), first_height - num, vector<uint32_t>() );
+               first_height = num;
+            }
+            if( num - first_height >= heights.size() )
+               heights.resize( num - first_height + 1 );
+            return heights[num - first_height];
+         }
+
+         vector<uint32_t> children_slots( const block_id_type& id, uint32_t num )const {
+            vector<uint32_t> result;
+            if( num + 1 < first_height || num + 1 - first_height >= heights.size() ) return result;
+            for( auto slot : heights[num + 1 - first_height] )
+               if( nodes[slot].previous == id )
+                  result.push_back( slot );
+            return result;
+         }
+
+         vector<node>                                                 nodes;
+         vector<uint32_t>                                             free_slots;
+         std::unordered_map<block_id_type, uint32_t, std::hash<block_id_type>> ids;
+         std::deque<vector<uint32_t>>                                 heights;
+         uint32_t                                                     first_height = 0;
+         uint64_t                                                     next_seq     = 0;
+         mutable uint32_t                                             best_slot    = npos;
+         mutable bool                                                 best_dirty   = false;
+   };
+
+
+   namespace {
+      const uint32_t forkdb_journal_magic   = 0x4a424446; ///< "FDBJ"
+      const uint32_t forkdb_journal_version = 2;
+
+      /**
+       *  Every mutation of the fork database is journaled as one of these records so that the
+       *  exact fork tree can be rebuilt after an unclean exit. Records are replayed through the
+       *  same public methods that produced them, so nested mutations (e.g. the prune performed
+       *  by add) are never journaled on their own. Block states are journaled without their block.
+       */
+      enum class journal_op : uint8_t {
+         set                     = 1, ///< journaled_block_state
+         add                     = 2, ///< journaled_block_state
+         remove                  = 3, ///< block_id_type
+         set_validity            = 4, ///< block_id_type
+         mark_in_current_chain   = 5, ///< block_id_type
+         unmark_in_current_chain = 6, ///< block_id_type
+         prune                   = 7, ///< block_id_type
+         add_confirmation        = 8, ///< header_confirmation
+         set_head                = 9  ///< block_id_type
+      };
+
+      /**
+       *  record layout: uint32_t size, uint64_t city_hash64 of the body, body = op + packed payload
+       *  a record with a bad size or checksum marks the torn tail of a journal written during a crash,
+       *  records are buffered until the stream is flushed
+       */
+      template<typename T>
+      bool write_journal_record( std::ostream& out, journal_op op, const T& payload ) {
+         vector<char> body( 1 + fc::raw::pack_size( payload ) );
+         body[0] = static_cast<char>( op );
+         fc::datastream<char*> ds( body.data() + 1, body.size() - 1 );
+         fc::raw::pack( ds, payload );
+
+         const uint32_t size     = body.size();
+         const uint64_t checksum = fc::city_hash64( body.data(), body.size() );
+         out.write( reinterpret_cast<const char*>(&size), sizeof(size) );
+         out.write( reinterpret_cast<const char*>(&checksum), sizeof(checksum) );
+         out.write( body.data(), body.size() );
+         return out.good();
+      }
+
+      bool write_journal_record( std::ostream& out, journal_op op, const block_state& s ) {
+         return write_journal_record( out, op, detail::journaled_block_state{ s, s.validated, s.in_current_chain } );
+      }
+   }
 
    struct fork_database_impl {
-      fork_multi_index_type index;
+      fork_index            index;
       block_state_ptr       head;
       fc::path              datadir;
+
+      std::ofstream         journal;
+      uint64_t              journal_records = 0;
+      uint32_t              journal_depth   = 0;
+      bool                  replaying       = false;
+      bool                  recovered       = false; ///< the tree was replayed from the journal and lacks its blocks
+
+      fc::path journal_path()const { return datadir / config::forkdb_journal_filename; }
+
+      template<typename T>
+      void append( journal_op op, const T& payload ) {
+         if( !journal.is_open() ) return;
+         if( write_journal_record( journal, op, payload ) ) {
+            ++journal_records;
+            return;
+         }
+         disable_journal();
+      }
+
+      void disable_journal() {
+         // a journal missing a mutation must never be recovered, fall back to replaying reversible blocks
+         elog( "unable to write fork database journal ${path}, journaling disabled", ("path", journal_path()) );
+         journal.close();
+         fc::remove( journal_path() );
+      }
+   };
+
+   /**
+    *  Tracks the nesting of fork database mutations, only the outermost call made from outside
+    *  the fork database is journaled.
+    */
+   struct journal_scope {
+      explicit journal_scope( fork_database_impl& my )
+      :my(my), outermost( my.journal_depth++ == 0 && !my.replaying ) {}
+      ~journal_scope() { --my.journal_depth; }
+
+      fork_database_impl& my;
+      const bool          outermost;
    };
 
 
-   fork_database::fork_database( const fc::path& data_dir ):my( new fork_database_impl() ) {
+   fork_database::fork_database( const fc::path& data_dir, bool journal ):my( new fork_database_impl() ) {
       my->datadir = data_dir;
 
       if (!fc::is_directory(my->datadir))
@@ -73,19 +401,243 @@ namespace snax { namespace chain {
          my->head = get_block( head_id );
 
          fc::remove( fork_db_dat );
+      } else if( journal && fc::exists( my->journal_path() ) ) {
+         replay_journal();
+      }
+
+      if( journal ) {
+         // start a fresh journal holding the tree loaded above
+         compact_journal();
+      } else if( fc::exists( my->journal_path() ) ) {
+         // left behind by a run that journaled, it would no longer match the tree
+         fc::remove( my->journal_path() );
+      }
+   }
+
+   void fork_database::replay_journal() {
+      const auto start = fc::time_point::now();
+      const auto path = my->journal_path();
+
+      string content;
+      fc::read_file_contents( path, content );
+
+      fc::datastream<const char*> ds( content.data(), content.size() );
+      uint32_t magic = 0, version = 0;
+      if( content.size() < sizeof(magic) + sizeof(version) ) {
+         wlog( "fork database journal ${path} is truncated, ignoring it", ("path", path) );
+         return;
+      }
+      fc::raw::unpack( ds, magic );
+      fc::raw::unpack( ds, version );
+      if( magic != forkdb_journal_magic || version != forkdb_journal_version ) {
+         wlog( "fork database journal ${path} has an unsupported format, ignoring it", ("path", path) );
+         return;
+      }
+
+      my->replaying = true;
+      auto reset_replaying = fc::make_scoped_exit( [&]() { my->replaying = false; } );
+
+      uint64_t records = 0;
+      try {
+         uint32_t size     = 0;
+         uint64_t checksum = 0;
+         while( ds.remaining() >= sizeof(size) + sizeof(checksum) ) {
+            auto record_start = ds.tellp();
+            ds.read( reinterpret_cast<char*>(&size), sizeof(size) );
+            ds.read( reinterpret_cast<char*>(&checksum), sizeof(checksum) );
+            const char* body = content.data() + ds.tellp();
+            if( size == 0 || size > ds.remaining() || fc::city_hash64( body, size ) != checksum ) {
+               ds.seekp( record_start );
+               break;
+            }
+            fc::datastream<const char*> payload( body + 1, size - 1 );
+            replay_journal_record( static_cast<uint8_t>(body[0]), payload );
+            ds.skip( size );
+            ++records;
+         }
+      } catch( const fc::exception& e ) {
+         elog( "unable to recover fork database from journal ${path} after ${n} records: ${e}",
+               ("path", path)("n", records)("e", e.to_detail_string()) );
+         my->index.clear();
+         my->head.reset();
+         return;
+      }
+
+      if( ds.remaining() ) {
+         wlog( "discarding ${b} bytes of incomplete records at the end of fork database journal",
+               ("b", ds.remaining()) );
+      }
+      my->recovered = my->index.size() != 0;
+      ilog( "recovered ${n} fork database blocks from ${r} journal records in ${t} ms",
+            ("n", my->index.size())("r", records)("t", (fc::time_point::now() - start).count() / 1000) );
+   }
+
+   void fork_database::replay_journal_record( uint8_t op, fc::datastream<const char*>& ds ) {
+      auto unpack_id = [&]() {
+         block_id_type id;
+         fc::raw::unpack( ds, id );
+         return id;
+      };
+      auto find_block = [&]( const block_id_type& id ) {
+         auto b = get_block( id );
+         SNAX_ASSERT( b, fork_db_block_not_found, "journal refers to unknown block ${id}", ("id", id) );
+         return b;
+      };
+
+      switch( static_cast<journal_op>(op) ) {
+         case journal_op::set:
+         case journal_op::add: {
+            detail::journaled_block_state s;
+            fc::raw::unpack( ds, s );
+            auto bsp = std::make_shared<block_state>( s.header_state );
+            bsp->validated        = s.validated;
+            bsp->in_current_chain = s.in_current_chain;
+            if( static_cast<journal_op>(op) == journal_op::set )
+               set( bsp );
+            else
+               add( bsp, true );
+            break;
+         }
+         case journal_op::remove:
+            remove( unpack_id() );
+            break;
+         case journal_op::set_validity:
+            set_validity( find_block( unpack_id() ), true );
+            break;
+         case journal_op::mark_in_current_chain:
+            mark_in_current_chain( find_block( unpack_id() ), true );
+            break;
+         case journal_op::unmark_in_current_chain:
+            mark_in_current_chain( find_block( unpack_id() ), false );
+            break;
+         case journal_op::prune: {
+            auto id = unpack_id();
+            auto h = get_block( id );
+            if( !h ) {
+               // prune only needs the id and number of a block which may already have been removed
+               h = std::make_shared<block_state>();
+               h->id        = id;
+               h->block_num = block_header::num_from_id( id );
+            }
+            prune( h );
+            break;
+         }
+         case journal_op::add_confirmation: {
+            header_confirmation c;
+            fc::raw::unpack( ds, c );
+            add( c );
+            break;
+         }
+         case journal_op::set_head:
+            my->head = find_block( unpack_id() );
+            break;
+         default:
+            SNAX_THROW( fork_database_exception, "unknown fork database journal record ${op}", ("op", op) );
+      }
+   }
+
+   /**
+    *  Rewrites the journal as one record per block in the fork database followed by the head, so its
+    *  size stays proportional to the number of reversible blocks as LIB advances.
+    */
+   void fork_database::compact_journal() {
+      const auto path = my->journal_path();
+      const auto tmp  = fc::path( path.generic_string() + ".tmp" );
+
+      my->journal.close();
+      my->journal_records = 0;
+
+      bool ok = false;
+      {
+         std::ofstream out( tmp.generic_string().c_str(), std::ios::out | std::ios::binary | std::ofstream::trunc );
+         fc::raw::pack( out, forkdb_journal_magic );
+         fc::raw::pack( out, forkdb_journal_version );
+         ok = out.good();
+
+         my->index.for_each( [&]( const block_state_ptr& s ) {
+            ok = ok && write_journal_record( out, journal_op::set, *s );
+         });
+         if( ok && my->head ) {
+            ok = write_journal_record( out, journal_op::set_head, my->head->id );
+         }
+         out.flush();
+         ok = ok && out.good();
+      }
+
+      if( !ok ) {
+         elog( "unable to write fork database journal ${path}, journaling disabled", ("path", tmp) );
+         fc::remove( tmp );
+         if( fc::exists( path ) ) fc::remove( path );
+         return;
+      }
+
+      fc::rename( tmp, path );
+      my->journal.open( path.generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::app );
+      my->journal_records = my->index.size() + 1;
+   }
+
+   void fork_database::flush_journal() {
+      if( !my->journal.is_open() ) return;
+      my->journal.flush();
+      if( !my->journal.good() ) my->disable_journal();
+   }
+
+   bool fork_database::recover_blocks( const std::function<signed_block_ptr(const block_state&)>& fetch_block ) {
+      if( !my->recovered ) return false;
+      my->recovered = false;
+
+      vector<block_state_ptr> states;
+      my->index.for_each( [&]( const block_state_ptr& s ) { states.push_back( s ); } );
+      std::sort( states.begin(), states.end(), []( const auto& a, const auto& b ) { return a->block_num < b->block_num; } );
+
+      const auto oldest = my->index.oldest();
+      uint32_t missing = 0;
+      for( const auto& s : states ) {
+         if( !my->index.contains( s->id ) ) continue; // removed with a block it builds on
+         s->block = fetch_block( *s );
+         if( s->block || s == oldest ) continue; // the root may lack its block, as one loaded from a snapshot does
+         ++missing;
+         remove( s->id );
+      }
+
+      // only applied blocks were found, the journal may not have caught up with a fork switch that applied them
+      states.clear();
+      my->index.for_each( [&]( const block_state_ptr& s ) { states.push_back( s ); } );
+      for( const auto& s : states ) {
+         mark_in_current_chain( s, true );
+         set_validity( s, true );
+      }
+      flush_journal();
+
+      if( missing ) {
+         wlog( "removed ${n} fork database blocks recovered from the journal whose blocks were not found", ("n", missing) );
+      }
+      return true;
+   }
+
+   void fork_database::compact_journal_if_needed() {
+      if( my->journal.is_open() && my->journal_records > 2 * my->index.size() + 64 ) {
+         compact_journal();
       }
    }
 
    void fork_database::close() {
+      auto remove_journal = fc::make_scoped_exit( [&]() {
+         // forkdb.dat (if any) is complete, a journal is only needed to recover from an unclean exit
+         my->journal.close();
+         if( fc::exists( my->journal_path() ) )
+            fc::remove( my->journal_path() );
+      });
+
       if( my->index.size() == 0 ) return;
 
       auto fork_db_dat = my->datadir / config::forkdb_filename;
       std::ofstream out( fork_db_dat.generic_string().c_str(), std::ios::out | std::ios::binary | std::ofstream::trunc );
       uint32_t num_blocks_in_fork_db = my->index.size();
       fc::raw::pack( out, unsigned_int{num_blocks_in_fork_db} );
-      for( const auto& s : my->index ) {
+      my->index.for_each( [&]( const block_state_ptr& s ) {
          fc::raw::pack( out, *s );
-      }
+      });
       if( my->head )
          fc::raw::pack( out, my->head->id );
       else
@@ -96,7 +648,7 @@ namespace snax { namespace chain {
       /// the next block needs to build off of the head block. We are exiting
       /// now so we can prune this block as irreversible before exiting.
       auto lib    = my->head->dpos_irreversible_blocknum;
-      auto oldest = *my->index.get<by_block_num>().begin();
+      auto oldest = my->index.oldest();
       if( oldest->block_num <= lib ) {
          prune( oldest );
       }
@@ -109,42 +661,49 @@ namespace snax { namespace chain {
    }
 
    void fork_database::set( block_state_ptr s ) {
-      auto result = my->index.insert( s );
+      journal_scope scope( *my );
       SNAX_ASSERT( s->id == s->header.id(), fork_database_exception,
                   "block state id (${id}) is different from block state header id (${hid})", ("id", string(s->id))("hid", string(s->header.id())) );
 
          //FC_ASSERT( s->block_num == s->header.block_num() );
 
-      SNAX_ASSERT( result.second, fork_database_exception, "unable to insert block state, duplicate state detected" );
+      SNAX_ASSERT( my->index.insert( s ), fork_database_exception, "unable to insert block state, duplicate state detected" );
       if( !my->head ) {
          my->head =  s;
       } else if( my->head->block_num < s->block_num ) {
          my->head =  s;
       }
+
+      if( scope.outermost ) my->append( journal_op::set, *s );
    }
 
    block_state_ptr fork_database::add( const block_state_ptr& n, bool skip_validate_previous ) {
       SNAX_ASSERT( n, fork_database_exception, "attempt to add null block state" );
       SNAX_ASSERT( my->head, fork_db_block_not_found, "no head block set" );
+      journal_scope scope( *my );
 
       if( !skip_validate_previous ) {
-         auto prior = my->index.find( n->block->previous );
-         SNAX_ASSERT( prior != my->index.end(), unlinkable_block_exception,
+         SNAX_ASSERT( my->index.contains( n->block->previous ), unlinkable_block_exception,
                      "unlinkable block", ("id", n->block->id())("previous", n->block->previous) );
       }
 
-      auto inserted = my->index.insert(n);
-      SNAX_ASSERT( inserted.second, fork_database_exception, "duplicate block added?" );
+      SNAX_ASSERT( my->index.insert(n), fork_database_exception, "duplicate block added?" );
 
-      my->head = *my->index.get<by_lib_block_num>().begin();
+      my->head = my->index.best();
 
       auto lib    = my->head->dpos_irreversible_blocknum;
-      auto oldest = *my->index.get<by_block_num>().begin();
+      auto oldest = my->index.oldest();
 
       if( oldest->block_num < lib ) {
          prune( oldest );
       }
 
+      if( scope.outermost ) {
+         // journaled with skip_validate_previous, the previous block may have been pruned since
+         my->append( journal_op::add, *n );
+         compact_journal_if_needed();
+      }
+
       return n;
    }
 
@@ -152,14 +711,12 @@ namespace snax { namespace chain {
       SNAX_ASSERT( b, fork_database_exception, "attempt to add null block" );
       SNAX_ASSERT( my->head, fork_db_block_not_found, "no head block set" );
 
-      const auto& by_id_idx = my->index.get<by_block_id>();
-      auto existing = by_id_idx.find( b->id() );
-      SNAX_ASSERT( existing == by_id_idx.end(), fork_database_exception, "we already know about this block" );
+      SNAX_ASSERT( !my->index.contains( b->id() ), fork_database_exception, "we already know about this block" );
 
-      auto prior = by_id_idx.find( b->previous );
-      SNAX_ASSERT( prior != by_id_idx.end(), unlinkable_block_exception, "unlinkable block", ("id", string(b->id()))("previous", string(b->previous)) );
+      auto prior = my->index.find( b->previous );
+      SNAX_ASSERT( prior, unlinkable_block_exception, "unlinkable block", ("id", string(b->id()))("previous", string(b->previous)) );
 
-      auto result = std::make_shared<block_state>( **prior, move(b), skip_validate_signee );
+      auto result = std::make_shared<block_state>( *prior, move(b), skip_validate_signee );
       SNAX_ASSERT( result, fork_database_exception , "fail to add new block state" );
       return add(result, true);
    }
@@ -172,61 +729,24 @@ namespace snax { namespace chain {
     */
    pair< branch_type, branch_type >  fork_database::fetch_branch_from( const block_id_type& first,
                                                                        const block_id_type& second )const {
-      pair<branch_type,branch_type> result;
-      auto first_branch = get_block(first);
-      auto second_branch = get_block(second);
-
-      while( first_branch->block_num > second_branch->block_num )
-      {
-         result.first.push_back(first_branch);
-         first_branch = get_block( first_branch->header.previous );
-         SNAX_ASSERT( first_branch, fork_db_block_not_found, "block ${id} does not exist", ("id", string(first_branch->header.previous)) );
-      }
-
-      while( second_branch->block_num > first_branch->block_num )
-      {
-         result.second.push_back( second_branch );
-         second_branch = get_block( second_branch->header.previous );
-         SNAX_ASSERT( second_branch, fork_db_block_not_found, "block ${id} does not exist", ("id", string(second_branch->header.previous)) );
-      }
-
-      while( first_branch->header.previous != second_branch->header.previous )
-      {
-         result.first.push_back(first_branch);
-         result.second.push_back(second_branch);
-         first_branch = get_block( first_branch->header.previous );
-         second_branch = get_block( second_branch->header.previous );
-         SNAX_ASSERT( first_branch && second_branch, fork_db_block_not_found,
-                     "either block ${fid} or ${sid} does not exist",
-                     ("fid", string(first_branch->header.previous))("sid", string(second_branch->header.previous)) );
-      }
-
-      if( first_branch && second_branch )
-      {
-         result.first.push_back(first_branch);
-         result.second.push_back(second_branch);
-      }
-      return result;
+      return my->index.branches( first, second );
    } /// fetch_branch_from
 
    /// remove all of the invalid forks built of this id including this id
    void fork_database::remove( const block_id_type& id ) {
+      journal_scope scope( *my );
       vector<block_id_type> remove_queue{id};
 
       for( uint32_t i = 0; i < remove_queue.size(); ++i ) {
-         auto itr = my->index.find( remove_queue[i] );
-         if( itr != my->index.end() )
-            my->index.erase(itr);
-
-         auto& previdx = my->index.get<by_prev>();
-         auto  previtr = previdx.lower_bound(remove_queue[i]);
-         while( previtr != previdx.end() && (*previtr)->header.previous == remove_queue[i] ) {
-            remove_queue.push_back( (*previtr)->id );
-            ++previtr;
-         }
+         my->index.erase( remove_queue[i] );
+
+         for( auto& child : my->index.children( remove_queue[i] ) )
+            remove_queue.push_back( child );
       }
       //wdump((my->index.size()));
-      my->head = *my->index.get<by_lib_block_num>().begin();
+      my->head = my->index.best();
+
+      if( scope.outermost ) my->append( journal_op::remove, id );
    }
 
    void fork_database::set_validity( const block_state_ptr& h, bool valid ) {
@@ -234,7 +754,9 @@ namespace snax { namespace chain {
          remove( h->id );
       } else {
          /// remove older than irreversible and mark block as valid
+         journal_scope scope( *my );
          h->validated = true;
+         if( scope.outermost ) my->append( journal_op::set_validity, h->id );
       }
    }
 
@@ -242,66 +764,63 @@ namespace snax { namespace chain {
       if( h->in_current_chain == in_current_chain )
          return;
 
-      auto& by_id_idx = my->index.get<by_block_id>();
-      auto itr = by_id_idx.find( h->id );
-      SNAX_ASSERT( itr != by_id_idx.end(), fork_db_block_not_found, "could not find block in fork database" );
+      SNAX_ASSERT( my->index.contains( h->id ), fork_db_block_not_found, "could not find block in fork database" );
 
-      by_id_idx.modify( itr, [&]( auto& bsp ) { // Need to modify this way rather than directly so that Boost MultiIndex can re-sort
-         bsp->in_current_chain = in_current_chain;
-      });
+      // Need to modify through the index rather than directly so that blocks at this height are re-sorted
+      my->index.set_in_current_chain( h->id, in_current_chain );
+
+      journal_scope scope( *my );
+      if( scope.outermost )
+         my->append( in_current_chain ? journal_op::mark_in_current_chain : journal_op::unmark_in_current_chain, h->id );
    }
 
    void fork_database::prune( const block_state_ptr& h ) {
+      journal_scope scope( *my );
       try {
           auto num = h->block_num;
 
-          auto& by_bn = my->index.get<by_block_num>();
-          auto bni = by_bn.begin();
-          while( bni != by_bn.end() && (*bni)->block_num < num ) {
-             prune( *bni );
-             bni = by_bn.begin();
+          auto oldest = my->index.oldest();
+          while( oldest && oldest->block_num < num ) {
+             prune( oldest );
+             oldest = my->index.oldest();
           }
 
-          auto itr = my->index.find( h->id );
-          if( itr != my->index.end() ) {
-             irreversible(*itr);
-             my->index.erase(itr);
+          auto pruned = my->index.find( h->id );
+          if( pruned ) {
+             if( !my->replaying ) {
+                // mutations made by irreversible handlers are journaled on their own
+                auto depth = my->journal_depth;
+                my->journal_depth = 0;
+                auto restore_depth = fc::make_scoped_exit( [&]() { my->journal_depth = depth; } );
+                irreversible(pruned);
+             }
+             my->index.erase( h->id );
           }
 
-          auto& numidx = my->index.get<by_block_num>();
-          auto nitr = numidx.lower_bound( num );
-          while( nitr != numidx.end() && (*nitr)->block_num == num ) {
-             auto itr_to_remove = nitr;
-             ++nitr;
-             auto id = (*itr_to_remove)->id;
-             remove( id );
+          for( const auto& b : my->index.at_height( num ) ) {
+             remove( b->id );
           }
       } catch (...) {
           wlog("Failed to prune object: ${object}", ("object", h));
       }
+
+      if( scope.outermost ) {
+         my->append( journal_op::prune, h->id );
+         compact_journal_if_needed();
+      }
    }
 
    block_state_ptr   fork_database::get_block(const block_id_type& id)const {
-      auto itr = my->index.find( id );
-      if( itr != my->index.end() )
-         return *itr;
-      return block_state_ptr();
+      return my->index.find( id );
    }
 
    block_state_ptr   fork_database::get_block_in_current_chain_by_num( uint32_t n )const {
-      const auto& numidx = my->index.get<by_block_num>();
-      auto nitr = numidx.lower_bound( n );
-      // following asserts removed so null can be returned
-      //FC_ASSERT( nitr != numidx.end() && (*nitr)->block_num == n,
-      //           "could not find block in fork database with block number ${block_num}", ("block_num", n) );
-      //FC_ASSERT( (*nitr)->in_current_chain == true,
-      //           "block (with block number ${block_num}) found in fork database is not in the current chain", ("block_num", n) );
-      if( nitr == numidx.end() || (*nitr)->block_num != n || (*nitr)->in_current_chain != true )
-         return block_state_ptr();
-      return *nitr;
+      // null is returned if there is no block with this number in the current chain
+      return my->index.in_current_chain_at( n );
    }
 
    void fork_database::add( const header_confirmation& c ) {
+      journal_scope scope( *my );
       auto b = get_block( c.block_id );
       SNAX_ASSERT( b, fork_db_block_not_found, "unable to find block id ${id}", ("id",c.block_id));
       b->add_confirmation( c );
@@ -310,6 +829,8 @@ namespace snax { namespace chain {
          b->confirmations.size() >= ((b->active_schedule.producers.size() * 2) / 3 + 1) ) {
          set_bft_irreversible( c.block_id );
       }
+
+      if( scope.outermost ) my->append( journal_op::add_confirmation, c );
    }
 
    /**
@@ -320,12 +841,9 @@ namespace snax { namespace chain {
     *  This will require a search over all forks
     */
    void fork_database::set_bft_irreversible( block_id_type id ) {
-      auto& idx = my->index.get<by_block_id>();
-      auto itr = idx.find(id);
-      uint32_t block_num = (*itr)->block_num;
-      idx.modify( itr, [&]( auto& bsp ) {
-           bsp->bft_irreversible_blocknum = bsp->block_num;
-      });
+      auto b = my->index.find( id );
+      uint32_t block_num = b->block_num;
+      my->index.set_bft_irreversible( id, block_num );
 
       /** to prevent stack-overflow, we perform a bredth-first traversal of the
        * fork database. At each stage we iterate over the leafs from the prior stage
@@ -337,17 +855,11 @@ namespace snax { namespace chain {
          vector<block_id_type> updated;
 
          for( const auto& i : in ) {
-            auto& pidx = my->index.get<by_prev>();
-            auto pitr  = pidx.lower_bound( i );
-            auto epitr = pidx.upper_bound( i );
-            while( pitr != epitr ) {
-               pidx.modify( pitr, [&]( auto& bsp ) {
-                 if( bsp->bft_irreversible_blocknum < block_num ) {
-                    bsp->bft_irreversible_blocknum = block_num;
-                    updated.push_back( bsp->id );
-                 }
-               });
-               ++pitr;
+            for( const auto& child : my->index.children( i ) ) {
+               if( my->index.find( child )->bft_irreversible_blocknum < block_num ) {
+                  my->index.set_bft_irreversible( child, block_num );
+                  updated.push_back( child );
+               }
             }
          }
          return updated;
@@ -10,6 +10,7 @@
 #include <sstream>
 #include <algorithm>
 #include <set>
+#include <unordered_map>
 
 namespace chainbase { class database; }
 
@@ -93,7 +94,7 @@ class apply_context {
             map<table_id_object::id_type, pair<const table_id_object*, int>> _table_cache;
             vector<const table_id_object*>                  _end_iterator_to_table;
             vector<const T*>                                _iterator_to_object;
-            map<const T*,int>                               _object_to_iterator;
+            std::unordered_map<const T*,int>                _object_to_iterator;
 
             /// Precondition: std::numeric_limits<int>::min() < ei < -1
             /// Iterator of -1 is reserved for invalid iterators (i.e. when the appropriate table has not yet been created).
@@ -553,6 +554,10 @@ class apply_context {
       int  db_upperbound_i64( uint64_t code, uint64_t scope, uint64_t table, uint64_t id );
       int  db_end_i64( uint64_t code, uint64_t scope, uint64_t table );
 
+      /// batches of rows, each the same as the corresponding calls of the single row methods above
+      int  db_get_many_i64( uint64_t code, uint64_t scope, uint64_t table, const uint64_t* ids, int* iterators, size_t count, char* buffer, size_t buffer_size );
+      void db_update_many_i64( const int* iterators, size_t count, account_name payer, const char* buffer, size_t buffer_size );
+
    private:
 
       const table_id_object* find_table( name code, name scope, name table );
@@ -7,10 +7,38 @@
 #include <snax/chain/block.hpp>
 #include <snax/chain/genesis_state.hpp>
 
+#include <functional>
+
 namespace snax { namespace chain {
 
    namespace detail { class block_log_impl; }
 
+   /**
+    * The packed bytes of a block in the block log, read without copying them. The bytes stay valid for as long as
+    * the view is held, also once the block log maps its files again or is reset.
+    */
+   struct packed_block_view {
+      const char*                  data = nullptr;
+      size_t                       size = 0;
+      std::shared_ptr<const void>  owner; ///< keeps data alive
+
+      explicit operator bool()const { return data != nullptr; }
+   };
+
+   enum class block_log_compression : uint8_t {
+      none = 0,
+      zlib = 1
+   };
+
+   struct block_log_config {
+      uint32_t  write_queue_size = 0; ///< appended blocks waiting to be written before append blocks, 0 writes them on the appending thread
+      uint32_t  fsync_interval = 0;   ///< blocks written between two syncs of the files to disk, 0 leaves it to the OS
+      uint32_t  stride = 0;           ///< blocks per segment the log is split into, 0 keeps a single file
+      uint32_t  retained_blocks = 0;  ///< segments older than this many blocks are moved to archive_dir or deleted, 0 keeps them all
+      fc::path  archive_dir;          ///< where segments past retained_blocks are moved to, deleted when empty
+      block_log_compression compression = block_log_compression::none; ///< of the blocks appended to a version 3 log
+   };
+
    /* The block log is an external append only log of the blocks with a header. Blocks should only
     * be written to the log after they irreverisble as the log is append only. The log is a doubly
     * linked list of blocks. There is a secondary index file of only block positions that enables
@@ -32,20 +60,37 @@ namespace snax { namespace chain {
     * Blocks can be accessed at random via block number through the index file. Seek to 8 * (block_num - 1)
     * to find the position of the block in the main file.
     *
-    * The main file is the only file that needs to persist. The index file can be reconstructed during a
-    * linear scan of the main file.
+    * The main file is the only file that needs to persist. The index file can be reconstructed by following
+    * the position markers of the main file, which parts of the file are scanned for in parallel.
+    *
+    * Appended blocks can be written by a dedicated thread, in groups, so that irreversible blocks do not stall
+    * block application while they are written. Blocks are readable as soon as they are appended. Both files are
+    * read through memory mappings of their written part.
+    *
+    * With a stride, the log is rolled every stride blocks: blocks.log and blocks.index are renamed to
+    * blocks-<first>-<last>.log and blocks-<first>-<last>.index, and a new blocks.log starts with the next block.
+    * Each segment is a complete block log of its own. Blocks are read from whichever segment holds them, in the
+    * blocks directory or in the archive directory, while blocks.log only ever holds the most recent blocks.
+    *
+    * From version 3, each block is stored as an entry of its compression, the size of its data and the data, so
+    * that blocks can be compressed one by one and still be read at random through the index. A new log is
+    * version 3 only when it is compressed, uncompressed logs stay at version 2.
     */
 
    class block_log {
       public:
-         block_log(const fc::path& data_dir);
+         block_log(const fc::path& data_dir, const block_log_config& config = block_log_config());
          block_log(block_log&& other);
          ~block_log();
 
          uint64_t append(const signed_block_ptr& b);
+         /// waits for the appended blocks to be written
          void flush();
+         /// the last appended block written to the files, blocks after it are still queued for the writer
+         uint32_t last_written_block_num()const;
          void reset( const genesis_state& gs, const signed_block_ptr& genesis_block, uint32_t first_block_num = 1 );
 
+         /// reads the block at file_pos in blocks.log, the file holding the most recent blocks
          std::pair<signed_block_ptr, uint64_t> read_block(uint64_t file_pos)const;
          signed_block_ptr read_block_by_num(uint32_t block_num)const;
          signed_block_ptr read_block_by_id(const block_id_type& id)const {
@@ -53,11 +98,24 @@ namespace snax { namespace chain {
          }
 
          /**
-          * Return offset of block in file, or block_log::npos if it does not exist.
+          * Return the packed bytes of a block without unpacking them, or an empty vector if it does not exist.
+          * Allows the caller to move deserialization off the reading thread.
+          */
+         vector<char> read_serialized_block_by_num(uint32_t block_num)const;
+
+         /**
+          * Return the packed bytes of a block straight from the mapped block log, or an empty view if it does not exist.
+          * Safe to call from any thread, also while blocks are appended.
+          */
+         packed_block_view read_packed_block_by_num(uint32_t block_num)const;
+
+         /**
+          * Return offset of block in blocks.log, or block_log::npos if it is not there.
           */
          uint64_t get_block_pos(uint32_t block_num) const;
          signed_block_ptr        read_head()const;
          const signed_block_ptr& head()const;
+         /// the first block readable from the log, through its segments
          uint32_t                first_block_num() const;
 
          static const uint64_t npos = std::numeric_limits<uint64_t>::max();
@@ -69,9 +127,22 @@ namespace snax { namespace chain {
 
          static genesis_state extract_genesis_state( const fc::path& data_dir );
 
+         /**
+          * Rebuilds index_file from the position markers of block_file, scanning parts of the log on up to threads
+          * threads, all cores when 0. The entries of an existing index that match the log are kept, so that an
+          * interrupted rebuild resumes where it stopped. progress is called with the bytes scanned so far and the
+          * bytes to scan, from the calling thread.
+          */
+         static void construct_index( const fc::path& block_file, const fc::path& index_file, uint32_t threads = 0,
+                                      const std::function<void(uint64_t, uint64_t)>& progress = {} );
+
       private:
          void open(const fc::path& data_dir);
+         uint64_t append(const signed_block_ptr& b, bool synchronous);
          void construct_index();
+         void write_header( uint32_t first_block_num );
+         void commit_header();
+         void roll();
 
          std::unique_ptr<detail::block_log_impl> my;
    };
@@ -15,14 +15,25 @@ typedef __uint128_t uint128_t;
 
 const static auto default_blocks_dir_name    = "blocks";
 const static auto reversible_blocks_dir_name = "reversible";
+const static uint32_t default_blocks_log_write_queue_size = 1024; ///< irreversible blocks waiting to be written to the block log
+const static uint32_t default_blocks_log_fsync_interval   = 0;    ///< blocks written between syncs of the block log to disk
+const static uint32_t default_blocks_log_stride          = 0;    ///< blocks per block log segment, 0 keeps a single block log
+const static uint32_t default_blocks_log_retained_blocks  = 0;    ///< blocks kept in segments before they are archived, 0 keeps all
+const static auto default_blocks_archive_dir_name    = "archive";
 const static auto default_reversible_cache_size = 340*1024*1024ll;/// 1MB * 340 blocks based on 21 producer BFT delay
 const static auto default_reversible_guard_size = 2*1024*1024ll;/// 1MB * 340 blocks based on 21 producer BFT delay
 
 const static auto default_state_dir_name     = "state";
 const static auto forkdb_filename            = "forkdb.dat";
+const static auto forkdb_journal_filename    = "forkdb.journal";
 const static auto default_state_size            = 1*1024*1024*1024ll;
 const static auto default_state_guard_size      =    128*1024*1024ll;
 
+const static auto default_code_cache_dir_name   = "code_cache";
+const static auto default_code_cache_size       = 1*1024*1024*1024ll; ///< on-disk cache of compiled contracts
+const static uint16_t default_wasm_compile_threads = 1;
+const static auto default_wasm_instantiation_cache_size = 1*1024*1024*1024ll;
+
 
 const static uint64_t system_account_name    = N(snax);
 const static uint64_t null_account_name      = N(snax.null);
@@ -86,6 +97,8 @@ const static uint32_t   default_max_inline_action_size         = 4 * 1024;   //
 const static uint16_t   default_max_inline_action_depth        = 4;
 const static uint16_t   default_max_auth_depth                 = 6;
 const static uint16_t   default_controller_thread_pool_size    = 2;
+const static uint32_t   default_replay_prefetch_blocks         = 256; ///< blocks read and prepared ahead of application during replay
+const static uint32_t   default_recovered_keys_cache_size      = 100000; ///< transactions whose recovered signing keys are kept
 
 const static uint32_t   min_net_usage_delta_between_base_and_max_for_trx  = 10*1024;
 // Should be large enough to allow recovery from badly set blockchain parameters without a hard fork
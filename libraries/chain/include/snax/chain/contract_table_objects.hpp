@@ -47,6 +47,10 @@ namespace snax { namespace chain {
 
    using table_id = table_id_object::id_type;
 
+   struct table_id_hash {
+      size_t operator()( const table_id& t )const { return std::hash<int64_t>()( t._id ); }
+   };
+
    struct by_scope_primary;
    struct by_scope_secondary;
    struct by_scope_tertiary;
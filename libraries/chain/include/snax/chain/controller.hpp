@@ -7,6 +7,7 @@
 #include <snax/chain/abi_serializer.hpp>
 #include <snax/chain/account_object.hpp>
 #include <snax/chain/snapshot.hpp>
+#include <snax/chain/block_log.hpp>
 
 namespace chainbase {
    class database;
@@ -34,6 +35,7 @@ namespace snax { namespace chain {
    using unapplied_transactions_type = map<transaction_id_type, transaction_metadata_ptr>;
 
    class fork_database;
+   class key_value_hash_index;
 
    enum class db_read_mode {
       SPECULATIVE,
@@ -59,17 +61,31 @@ namespace snax { namespace chain {
             flat_set< pair<account_name, action_name> > action_blacklist;
             flat_set<public_key_type> key_blacklist;
             path                     blocks_dir             =  chain::config::default_blocks_dir_name;
+            uint32_t                 blocks_log_write_queue_size = chain::config::default_blocks_log_write_queue_size;
+            uint32_t                 blocks_log_fsync_interval   = chain::config::default_blocks_log_fsync_interval;
+            uint32_t                 blocks_log_stride           = chain::config::default_blocks_log_stride;
+            uint32_t                 blocks_log_retained_blocks  = chain::config::default_blocks_log_retained_blocks;
+            path                     blocks_archive_dir;         ///< empty deletes the segments past blocks_log_retained_blocks
+            block_log_compression    blocks_log_compression      = block_log_compression::none;
             path                     state_dir              =  chain::config::default_state_dir_name;
             uint64_t                 state_size             =  chain::config::default_state_size;
             uint64_t                 state_guard_size       =  chain::config::default_state_guard_size;
             uint64_t                 reversible_cache_size  =  chain::config::default_reversible_cache_size;
             uint64_t                 reversible_guard_size  =  chain::config::default_reversible_guard_size;
+            path                     code_cache_dir         =  chain::config::default_code_cache_dir_name;
+            uint64_t                 code_cache_size        =  chain::config::default_code_cache_size; ///< on-disk cache of compiled contracts, 0 disables it
+            uint16_t                 wasm_compile_threads   =  chain::config::default_wasm_compile_threads; ///< compile contracts in the background with wavm, 0 compiles them on first use
+            uint64_t                 wasm_cache_size        =  chain::config::default_wasm_instantiation_cache_size;
             uint16_t                 thread_pool_size       =  chain::config::default_controller_thread_pool_size;
+            uint32_t                 replay_prefetch_blocks =  chain::config::default_replay_prefetch_blocks;
+            uint32_t                 recovered_keys_cache_size = chain::config::default_recovered_keys_cache_size;
             bool                     read_only              =  false;
             bool                     force_all_checks       =  false;
             bool                     disable_replay_opts    =  false;
             bool                     contracts_console      =  false;
             bool                     allow_ram_billing_in_notify = false;
+            bool                     contract_row_hash_index = false; ///< keep an in-memory hash index of the contract table rows
+            bool                     fork_db_journal        =  false; ///< journal the fork database to recover it after an unclean exit
 
             genesis_state            genesis;
             wasm_interface::vm_type  wasm_runtime = chain::config::default_wasm_runtime;
@@ -132,6 +148,16 @@ namespace snax { namespace chain {
          std::future<block_state_ptr> create_block_state_future( const signed_block_ptr& b );
          void push_block( std::future<block_state_ptr>& block_state_future );
 
+         /**
+          *  Starts verifying the producer and transaction signatures of b on the thread pool ahead of
+          *  create_block_state_future( b ), which then picks up the result. b may build on a block that
+          *  was itself only prepared, so a window of blocks verifies in parallel; they are still pushed
+          *  and applied in order. Blocks that do not link are ignored here and rejected when pushed.
+          */
+         void prepare_block( const signed_block_ptr& b );
+         /// drops the blocks prepared but not pushed, e.g. when sync from a peer is abandoned
+         void clear_prepared_blocks();
+
          const chainbase::database& db()const;
 
          const fork_database& fork_db()const;
@@ -183,6 +209,8 @@ namespace snax { namespace chain {
 
          signed_block_ptr fetch_block_by_number( uint32_t block_num )const;
          signed_block_ptr fetch_block_by_id( block_id_type id )const;
+         /// the packed bytes of an irreversible block read from the block log, empty when it is not in the block log
+         packed_block_view fetch_packed_block_by_number( uint32_t block_num )const;
 
          block_state_ptr fetch_block_state_by_number( uint32_t block_num )const;
          block_state_ptr fetch_block_state_by_id( block_id_type id )const;
@@ -251,6 +279,8 @@ namespace snax { namespace chain {
 
          const apply_handler* find_apply_handler( account_name contract, scope_name scope, action_name act )const;
          wasm_interface& get_wasm_interface();
+         const wasm_interface& get_wasm_interface()const;
+         recovered_keys_cache::stats get_recovered_keys_stats()const;
 
 
          optional<abi_serializer> get_abi_serializer( account_name n, const fc::microseconds& max_serialization_time )const {
@@ -279,6 +309,8 @@ namespace snax { namespace chain {
          friend class transaction_context;
 
          chainbase::database& mutable_db()const;
+         /// nullptr unless config::contract_row_hash_index is set
+         key_value_hash_index* row_hash_index()const;
 
          std::unique_ptr<controller_impl> my;
 
@@ -18,15 +18,30 @@ namespace snax { namespace chain {
     * database tracks the longest chain and the last irreversible block number. All
     * blocks older than the last irreversible block are freed after emitting the
     * irreversible signal.
+    *
+    * When journaling is enabled, every mutation is appended to a journal in the data directory
+    * so that the fork tree can be recovered after an unclean exit without re-validating reversible
+    * blocks. The journal keeps block states without their blocks, which are fetched again
+    * by recover_blocks(). It is compacted as LIB advances and removed by a clean close().
     */
    class fork_database {
       public:
 
-         fork_database( const fc::path& data_dir );
+         fork_database( const fc::path& data_dir, bool journal = false );
          ~fork_database();
 
          void close();
 
+         /**
+          *  Gives the block states recovered from the journal their blocks. A block state whose block
+          *  cannot be fetched is removed together with the blocks built on it, the others are marked
+          *  as the applied chain. Returns whether the fork database was recovered from the journal.
+          */
+         bool recover_blocks( const std::function<signed_block_ptr(const block_state&)>& fetch_block );
+
+         /// writes the journal records buffered since the last flush
+         void flush_journal();
+
          block_state_ptr  get_block(const block_id_type& id)const;
          block_state_ptr  get_block_in_current_chain_by_num( uint32_t n )const;
 //         vector<block_state_ptr>    get_blocks_by_number(uint32_t n)const;
@@ -72,6 +87,12 @@ namespace snax { namespace chain {
 
       private:
          void set_bft_irreversible( block_id_type id );
+
+         void replay_journal();
+         void replay_journal_record( uint8_t op, fc::datastream<const char*>& ds );
+         void compact_journal();
+         void compact_journal_if_needed();
+
          unique_ptr<fork_database_impl> my;
    };
 
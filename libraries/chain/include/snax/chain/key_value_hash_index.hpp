@@ -0,0 +1,69 @@
+/**
+ *  @file
+ *  @copyright defined in snax/LICENSE.txt
+ */
+#pragma once
+#include <snax/chain/contract_table_objects.hpp>
+#include <boost/functional/hash.hpp>
+
+#include <deque>
+#include <unordered_map>
+
+namespace snax { namespace chain {
+
+   /**
+    *  An in-memory hash index of the contract table rows by table and primary key, so that point lookups find a
+    *  row in constant time instead of walking the ordered by_scope_primary index of all the rows of all tables.
+    *
+    *  The index lives outside chainbase, so the state database layout is unchanged; it is built from the state
+    *  database at startup. apply_context adds and removes the rows it creates and removes. chainbase does not
+    *  report undo and squash, so every change is journaled with the database revision it was made at: whenever
+    *  the revision is found lower than that of journaled changes, their rows are looked up again in the ordered
+    *  index. sync() must be called before an undo session is started, so that a revision reached again after an
+    *  undo is not taken for the one the changes were made at. commit() drops the changes that can no longer be
+    *  undone.
+    */
+   class key_value_hash_index {
+      public:
+         explicit key_value_hash_index( const chainbase::database& db );
+
+         /// indexes every row of the state database, dropping the journal
+         void build();
+
+         const key_value_object* find( table_id t_id, uint64_t primary_key );
+         void add( const key_value_object& obj );
+         void remove( const key_value_object& obj );
+
+         /// catches up with the undo sessions undone or squashed since the last call
+         void sync();
+         void commit( int64_t revision );
+
+         size_t size()const { return _rows.size(); }
+
+      private:
+         struct row_key {
+            table_id t_id;
+            uint64_t primary_key;
+
+            friend bool operator == ( const row_key& a, const row_key& b ) {
+               return a.t_id == b.t_id && a.primary_key == b.primary_key;
+            }
+         };
+
+         struct row_key_hash {
+            size_t operator()( const row_key& k )const {
+               size_t seed = table_id_hash()( k.t_id );
+               boost::hash_combine( seed, k.primary_key );
+               return seed;
+            }
+         };
+
+         void journal( const row_key& k );
+
+         const chainbase::database&                                          _db;
+         std::unordered_map<row_key, const key_value_object*, row_key_hash>  _rows;
+         /// rows added or removed, with the revision of the change, in revision order
+         std::deque<std::pair<int64_t, row_key>>                             _journal;
+   };
+
+} } /// snax::chain
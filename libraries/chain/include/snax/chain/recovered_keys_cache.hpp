@@ -0,0 +1,78 @@
+/**
+ *  @file
+ *  @copyright defined in snax/LICENSE.txt
+ */
+#pragma once
+#include <snax/chain/types.hpp>
+#include <snax/chain/chain_id_type.hpp>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/composite_key.hpp>
+
+#include <mutex>
+
+namespace snax { namespace chain {
+
+   /**
+    *  The public keys recovered from the signatures of the transactions this node has seen, so that a transaction
+    *  pushed to the node and later applied in a block, possibly more than once across forks, has its signatures
+    *  recovered only once.
+    *
+    *  Entries are keyed by the signed id of the transaction, which covers its signatures and context free data,
+    *  and by the chain id the signatures were recovered for. The least recently used entries are evicted once
+    *  the cache holds max_entries of them. Safe to use from several threads.
+    */
+   class recovered_keys_cache {
+      public:
+         struct stats {
+            uint64_t  hits = 0;
+            uint64_t  misses = 0;
+            uint64_t  evictions = 0;
+            uint64_t  entries = 0;
+            uint64_t  max_entries = 0;
+         };
+
+         explicit recovered_keys_cache( uint32_t max_entries );
+
+         optional<flat_set<public_key_type>> find( const transaction_id_type& signed_id, const chain_id_type& chain_id );
+         void add( const transaction_id_type& signed_id, const chain_id_type& chain_id, const flat_set<public_key_type>& keys );
+
+         stats get_stats()const;
+
+      private:
+         struct entry {
+            transaction_id_type        signed_id;
+            chain_id_type              chain_id;
+            flat_set<public_key_type>  keys;
+         };
+         struct by_signed_id;
+
+         typedef boost::multi_index_container<
+            entry,
+            boost::multi_index::indexed_by<
+               boost::multi_index::sequenced<>,
+               boost::multi_index::hashed_unique<
+                  boost::multi_index::tag<by_signed_id>,
+                  boost::multi_index::composite_key< entry,
+                     boost::multi_index::member<entry, transaction_id_type, &entry::signed_id>,
+                     boost::multi_index::member<entry, chain_id_type, &entry::chain_id>
+                  >,
+                  boost::multi_index::composite_key_hash< std::hash<transaction_id_type>, std::hash<fc::sha256> >
+               >
+            >
+         > entry_index_type;
+
+         mutable std::mutex  _mutex;
+         entry_index_type    _entries; ///< least recently used first
+         const uint32_t      _max_entries;
+         uint64_t            _hits = 0;
+         uint64_t            _misses = 0;
+         uint64_t            _evictions = 0;
+   };
+
+} } /// snax::chain
+
+FC_REFLECT( snax::chain::recovered_keys_cache::stats, (hits)(misses)(evictions)(entries)(max_entries) )
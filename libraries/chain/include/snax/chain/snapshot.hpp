@@ -9,6 +9,12 @@
 #include <fc/variant_object.hpp>
 #include <boost/core/demangle.hpp>
 #include <ostream>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <tuple>
+#include <boost/asio/thread_pool.hpp>
 
 namespace snax { namespace chain {
    /**
@@ -75,6 +81,7 @@ namespace snax { namespace chain {
       struct abstract_snapshot_row_writer {
          virtual void write(ostream_wrapper& out) const = 0;
          virtual void write(fc::sha256::encoder& out) const = 0;
+         virtual void write(std::vector<char>& out) const = 0;
          virtual variant to_variant() const = 0;
          virtual std::string row_type_name() const = 0;
       };
@@ -97,6 +104,13 @@ namespace snax { namespace chain {
             write_stream(out);
          }
 
+         void write(std::vector<char>& out) const override {
+            const auto pos = out.size();
+            out.resize( pos + fc::raw::pack_size(data) );
+            fc::datastream<char*> ds( out.data() + pos, out.size() - pos );
+            write_stream(ds);
+         }
+
          fc::variant to_variant() const override {
             variant var;
             fc::to_variant(data, var);
@@ -114,8 +128,38 @@ namespace snax { namespace chain {
       snapshot_row_writer<T> make_row_writer( const T& data) {
          return snapshot_row_writer<T>(data);
       }
+
+      /// writes a row that is already packed, as read from a packed_snapshot_reader
+      struct packed_row_writer : abstract_snapshot_row_writer {
+         explicit packed_row_writer( const std::vector<char>& data )
+         :data(data) {}
+
+         void write(ostream_wrapper& out) const override {
+            out.write(data.data(), data.size());
+         }
+
+         void write(fc::sha256::encoder& out) const override {
+            out.write(data.data(), data.size());
+         }
+
+         void write(std::vector<char>& out) const override {
+            out.insert(out.end(), data.begin(), data.end());
+         }
+
+         fc::variant to_variant() const override {
+            SNAX_THROW(snapshot_exception, "Packed snapshot rows cannot be converted to variants");
+         }
+
+         std::string row_type_name() const override {
+            return "packed row";
+         }
+
+         const std::vector<char>& data;
+      };
    }
 
+   class packed_snapshot_reader;
+
    class snapshot_writer {
       public:
          class section_writer {
@@ -148,9 +192,24 @@ namespace snax { namespace chain {
             write_section(detail::snapshot_section_traits<T>::section_name(), f);
          }
 
+         /**
+          * Calls each of writes with a writer to write sections to. Writers that support it call them on several
+          * threads at once, each with a writer of its own, and read sections of the same name back as a single
+          * section in the order of writes. Others call them in order with this writer.
+          */
+         virtual void write_concurrently( const std::vector<std::function<void(snapshot_writer&)>>& writes ) {
+            for( const auto& write : writes )
+               write( *this );
+         }
+
+         /// the number of threads that write_concurrently calls writes on
+         virtual uint32_t concurrency() const { return 1; }
+
       virtual ~snapshot_writer(){};
 
       protected:
+         friend void copy_snapshot( packed_snapshot_reader& from, snapshot_writer& to );
+
          virtual void write_start_section( const std::string& section_name ) = 0;
          virtual void write_row( const detail::abstract_snapshot_row_writer& row_writer ) = 0;
          virtual void write_end_section() = 0;
@@ -161,6 +220,7 @@ namespace snax { namespace chain {
    namespace detail {
       struct abstract_snapshot_row_reader {
          virtual void provide(std::istream& in) const = 0;
+         virtual void provide(fc::datastream<const char*>& in) const = 0;
          virtual void provide(const fc::variant&) const = 0;
          virtual std::string row_type_name() const = 0;
       };
@@ -206,6 +266,12 @@ namespace snax { namespace chain {
             });
          }
 
+         void provide(fc::datastream<const char*>& in) const override {
+            row_validation_helper::apply(data, [&in,this](){
+               fc::raw::unpack(in, data);
+            });
+         }
+
          void provide(const fc::variant& var) const override {
             row_validation_helper::apply(data, [&var,this]() {
                fc::from_variant(var, data);
@@ -366,6 +432,239 @@ namespace snax { namespace chain {
          uint64_t       cur_row;
    };
 
+   namespace detail {
+      struct parallel_snapshot_output;
+
+      /// a run of rows of a section, compressed and checksummed on its own
+      struct snapshot_chunk_info {
+         uint64_t     offset = 0;      ///< from the start of the snapshot
+         uint32_t     stored_size = 0;
+         uint32_t     size = 0;        ///< of the row sizes and rows once decompressed
+         uint32_t     index_size = 0;  ///< of the row sizes, packed as unsigned_int ahead of the rows
+         uint32_t     rows = 0;
+         uint8_t      compression = 0; ///< 0 for none, 1 for zlib
+         fc::sha256   checksum;        ///< of the rows once decompressed
+      };
+
+      struct snapshot_section_info {
+         std::string                  name;
+         std::vector<snapshot_chunk_info> chunks;
+      };
+   }
+
+   /**
+    * Writes a binary snapshot whose sections are split into chunks that are compressed and checksummed on threads
+    * of their own. Sections given to write_concurrently are also written on several threads at once. A directory
+    * of the sections and their chunks at the end of the snapshot lets parallel_snapshot_reader read them in any
+    * order.
+    */
+   class parallel_snapshot_writer : public snapshot_writer {
+      public:
+         /// @param threads  compressing chunks and writing sections, all cores when 0
+         explicit parallel_snapshot_writer(std::ostream& snapshot, uint32_t threads = 0, bool compress = true);
+
+         void write_start_section( const std::string& section_name ) override;
+         void write_row( const detail::abstract_snapshot_row_writer& row_writer ) override;
+         void write_end_section( ) override;
+         void write_concurrently( const std::vector<std::function<void(snapshot_writer&)>>& writes ) override;
+         uint32_t concurrency() const override;
+         void finalize();
+
+         /**
+          * Lets up to max_chunks chunks wait to be compressed and written before write_row blocks, twice the threads
+          * by default. Raising it lets the rows be captured quickly and written out later, by finalize on another
+          * thread, at the cost of holding them in memory.
+          */
+         void set_max_buffered_chunks( uint32_t max_chunks );
+
+         struct progress_info {
+            uint64_t chunks_written = 0;
+            uint64_t chunks_total = 0;
+            uint64_t bytes_written = 0;
+         };
+
+         /// safe to call from any thread while the snapshot is written
+         progress_info progress() const;
+
+         static const uint32_t magic_number = 0x30510551;
+         static const uint32_t chunk_size = 4 * 1024 * 1024; ///< bytes of rows a chunk is cut at
+
+      private:
+         parallel_snapshot_writer(const std::shared_ptr<detail::parallel_snapshot_output>& output, uint32_t batch, uint32_t part);
+         void write_chunk();
+
+         using section_key = std::tuple<uint32_t, uint32_t, uint32_t>; ///< orders the sections in the directory
+
+         std::shared_ptr<detail::parallel_snapshot_output> output;
+         optional<std::pair<uint32_t, uint32_t>> part;  ///< call of write_concurrently and index of the write a part writer is given to
+         section_key              cur_section;
+         uint32_t                 next_section = 0;
+         bool                     in_section = false;
+         std::vector<char>        chunk;
+         std::vector<char>        chunk_row_sizes;
+         uint32_t                 chunk_rows = 0;
+
+         friend struct detail::parallel_snapshot_output;
+   };
+
+   /**
+    * A reader whose rows can also be read as they were packed, without knowing their types. Deltas are applied onto
+    * readers of this kind.
+    */
+   class packed_snapshot_reader : public snapshot_reader {
+      public:
+         using snapshot_reader::has_section;
+         using snapshot_reader::set_section;
+         using snapshot_reader::empty;
+         using snapshot_reader::clear_section;
+
+         /// reads the next row of the current section as it was packed, returning whether more rows follow
+         virtual bool read_packed_row( std::vector<char>& row ) = 0;
+
+         /// @return the names of the sections in the order they were written
+         virtual std::vector<std::string> section_names() = 0;
+
+         /// @return a digest identifying the snapshot files read, which deltas written against them record
+         virtual fc::sha256 digest() = 0;
+   };
+
+   /**
+    * Reads a snapshot written by parallel_snapshot_writer. The chunks of the current section are read, decompressed
+    * and checked on threads of their own, ahead of the rows read from them.
+    */
+   class parallel_snapshot_reader : public packed_snapshot_reader {
+      public:
+         /// @param threads  reading chunks ahead, all cores when 0
+         explicit parallel_snapshot_reader(std::istream& snapshot, uint32_t threads = 0);
+         ~parallel_snapshot_reader();
+
+         void validate() const override;
+         bool has_section( const string& section_name ) override;
+         void set_section( const string& section_name ) override;
+         bool read_row( detail::abstract_snapshot_row_reader& row_reader ) override;
+         bool empty ( ) override;
+         void clear_section() override;
+         bool read_packed_row( std::vector<char>& row ) override;
+         std::vector<std::string> section_names() override;
+         fc::sha256 digest() override;
+
+         /// @return whether the stream holds a snapshot of this format, leaving its position as it was
+         static bool is_parallel_snapshot( std::istream& snapshot );
+
+      private:
+         const std::vector<detail::snapshot_section_info>& directory() const;
+         void read_ahead();
+         uint32_t next_row_size();
+         bool finish_row();
+         std::vector<char> read_chunk( const detail::snapshot_chunk_info& chunk ) const;
+
+         std::istream&                                 snapshot;
+         std::streampos                                header_pos;
+         uint32_t                                      threads;
+         boost::asio::thread_pool                      pool;
+         mutable std::mutex                            snapshot_mtx; ///< guards the stream, shared by the threads reading chunks
+         mutable optional<std::vector<detail::snapshot_section_info>> sections;
+
+         std::vector<const detail::snapshot_chunk_info*> chunks;      ///< of the current section
+         size_t                                        next_chunk = 0; ///< to read ahead
+         size_t                                        cur_chunk = 0;
+         std::deque<std::future<std::vector<char>>>    read_chunks;
+         std::vector<char>                             cur_data;
+         size_t                                        cur_index_pos = 0; ///< of the size of the next row
+         size_t                                        cur_pos = 0;
+         uint32_t                                      chunk_rows_left = 0;
+         uint64_t                                      rows_left = 0;
+   };
+
+   /// @return a reader of the binary snapshot in the stream, for whichever binary format it was written in
+   snapshot_reader_ptr make_binary_snapshot_reader( std::istream& snapshot );
+
+   namespace detail {
+      /// the first section of a delta snapshot
+      struct snapshot_delta_header {
+         uint32_t    version = 1;
+         fc::sha256  base_digest; ///< of the snapshot the delta was written against
+      };
+
+      /**
+       * Rebuilds rows of a section of the new state: skips rows of the base section, copies the rows that follow and
+       * then takes the rows after the run, which were packed into the delta.
+       */
+      struct snapshot_delta_run {
+         fc::unsigned_int skip;
+         fc::unsigned_int copy;
+         fc::unsigned_int literals;
+      };
+   }
+
+   /**
+    * Writes the rows that differ from a base snapshot, in the parallel format. Rows are matched by their packed
+    * bytes, so a row that is unchanged, or moved by the rows inserted or removed before it, is copied from the base
+    * instead of being written again. Deltas written against a delta_snapshot_reader extend a chain of deltas.
+    */
+   class delta_snapshot_writer : public snapshot_writer {
+      public:
+         delta_snapshot_writer(const std::shared_ptr<packed_snapshot_reader>& base, std::ostream& delta, uint32_t threads = 0);
+
+         void write_start_section( const std::string& section_name ) override;
+         void write_row( const detail::abstract_snapshot_row_writer& row_writer ) override;
+         void write_end_section( ) override;
+         void finalize();
+
+         static const std::string header_section_name;
+
+      private:
+         void flush_run();
+         /// @return whether the base row at pos, at or after base_pos, has the bytes of row
+         bool base_row_equals( uint32_t pos );
+
+         std::shared_ptr<packed_snapshot_reader>        base;
+         parallel_snapshot_writer                       delta;
+         std::vector<uint64_t>                          base_rows;  ///< hashes of the rows of the base section
+         std::vector<std::pair<uint64_t, uint32_t>>     base_index; ///< base_rows sorted, with their positions
+         uint32_t                                       base_pos = 0;
+         std::deque<std::vector<char>>                  base_ahead; ///< base rows from base_pos on, read to compare
+         detail::snapshot_delta_run                     run;
+         std::vector<std::vector<char>>                 literals;
+         std::vector<char>                              row;
+   };
+
+   /**
+    * Reads the state a delta was written for by applying it onto the reader of its base, which may itself be a
+    * delta_snapshot_reader.
+    */
+   class delta_snapshot_reader : public packed_snapshot_reader {
+      public:
+         delta_snapshot_reader(const std::shared_ptr<packed_snapshot_reader>& base, const std::shared_ptr<parallel_snapshot_reader>& delta);
+
+         void validate() const override;
+         bool has_section( const string& section_name ) override;
+         void set_section( const string& section_name ) override;
+         bool read_row( detail::abstract_snapshot_row_reader& row_reader ) override;
+         bool empty ( ) override;
+         void clear_section() override;
+         bool read_packed_row( std::vector<char>& row ) override;
+         std::vector<std::string> section_names() override;
+         fc::sha256 digest() override;
+
+         /// @return whether the reader holds a delta rather than a full snapshot
+         static bool is_delta_snapshot( parallel_snapshot_reader& snapshot );
+
+      private:
+         std::shared_ptr<packed_snapshot_reader>   base;
+         std::shared_ptr<parallel_snapshot_reader> delta;
+         bool                                      base_more = false; ///< whether the base section has rows left
+         bool                                      delta_more = false;
+         detail::snapshot_delta_run                run;
+         std::vector<char>                         row;
+   };
+
+   /// writes every row of a snapshot to another writer, e.g. to collapse a chain of deltas into a full snapshot
+   void copy_snapshot( packed_snapshot_reader& from, snapshot_writer& to );
+
+   /// @return the hash integrity_hash_snapshot_writer computes for the state in the snapshot, to verify one rebuilt from deltas
+   fc::sha256 calculate_integrity_hash( packed_snapshot_reader& snapshot );
+
    class integrity_hash_snapshot_writer : public snapshot_writer {
       public:
          explicit integrity_hash_snapshot_writer(fc::sha256::encoder&  enc);
@@ -381,3 +680,8 @@ namespace snax { namespace chain {
    };
 
 }}
+
+FC_REFLECT( snax::chain::detail::snapshot_chunk_info, (offset)(stored_size)(size)(index_size)(rows)(compression)(checksum) )
+FC_REFLECT( snax::chain::detail::snapshot_section_info, (name)(chunks) )
+FC_REFLECT( snax::chain::detail::snapshot_delta_header, (version)(base_digest) )
+FC_REFLECT( snax::chain::detail::snapshot_delta_run, (skip)(copy)(literals) )
@@ -0,0 +1,94 @@
+/**
+ *  @file
+ *  @copyright defined in snax/LICENSE.txt
+ */
+#pragma once
+#include <snax/chain/contract_table_objects.hpp>
+#include <boost/functional/hash.hpp>
+#include <unordered_map>
+
+namespace snax { namespace chain {
+
+   /**
+    *  The contract tables and rows a transaction already looked up, so that the point lookups its actions repeat
+    *  on the same hot rows (balances, users, ...) do not search the state database again.
+    *
+    *  Only tables and rows that exist are cached, by pointer to the object in the state database. apply_context
+    *  drops the entries of the tables and rows it removes and the transaction drops the whole cache when it
+    *  undoes its changes, so a cached object is always the one the state database would return.
+    */
+   class table_read_cache {
+      public:
+         const table_id_object* find_table( name code, name scope, name table )const {
+            auto itr = _tables.find( table_key{code, scope, table} );
+            return itr != _tables.end() ? itr->second : nullptr;
+         }
+
+         void add_table( const table_id_object& t ) {
+            _tables[table_key{t.code, t.scope, t.table}] = &t;
+         }
+
+         void remove_table( const table_id_object& t ) {
+            _tables.erase( table_key{t.code, t.scope, t.table} );
+         }
+
+         const key_value_object* find_row( table_id t_id, uint64_t primary_key )const {
+            auto itr = _rows.find( row_key{t_id, primary_key} );
+            return itr != _rows.end() ? itr->second : nullptr;
+         }
+
+         void add_row( const key_value_object& obj ) {
+            _rows[row_key{obj.t_id, obj.primary_key}] = &obj;
+         }
+
+         void remove_row( const key_value_object& obj ) {
+            _rows.erase( row_key{obj.t_id, obj.primary_key} );
+         }
+
+         void clear() {
+            _tables.clear();
+            _rows.clear();
+         }
+
+      private:
+         struct table_key {
+            uint64_t code;
+            uint64_t scope;
+            uint64_t table;
+
+            friend bool operator == ( const table_key& a, const table_key& b ) {
+               return a.code == b.code && a.scope == b.scope && a.table == b.table;
+            }
+         };
+
+         struct table_key_hash {
+            size_t operator()( const table_key& k )const {
+               size_t seed = std::hash<uint64_t>()( k.code );
+               boost::hash_combine( seed, k.scope );
+               boost::hash_combine( seed, k.table );
+               return seed;
+            }
+         };
+
+         struct row_key {
+            table_id t_id;
+            uint64_t primary_key;
+
+            friend bool operator == ( const row_key& a, const row_key& b ) {
+               return a.t_id == b.t_id && a.primary_key == b.primary_key;
+            }
+         };
+
+         struct row_key_hash {
+            size_t operator()( const row_key& k )const {
+               size_t seed = table_id_hash()( k.t_id );
+               boost::hash_combine( seed, k.primary_key );
+               return seed;
+            }
+         };
+
+         std::unordered_map<table_key, const table_id_object*, table_key_hash>  _tables;
+         std::unordered_map<row_key, const key_value_object*, row_key_hash>     _rows;
+   };
+
+} } /// snax::chain
@@ -1,6 +1,7 @@
 #pragma once
 #include <snax/chain/controller.hpp>
 #include <snax/chain/trace.hpp>
+#include <snax/chain/table_read_cache.hpp>
 #include <signal.h>
 
 namespace snax { namespace chain {
@@ -104,6 +105,9 @@ namespace snax { namespace chain {
          int64_t                       billed_cpu_time_us = 0;
          bool                          explicit_billed_cpu_time = false;
 
+         /// contract tables and rows already looked up by the actions of the transaction
+         table_read_cache              table_reads;
+
       private:
          bool                          is_initialized = false;
 
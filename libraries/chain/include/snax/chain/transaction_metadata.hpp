@@ -4,6 +4,7 @@
  */
 #pragma once
 #include <snax/chain/transaction.hpp>
+#include <snax/chain/recovered_keys_cache.hpp>
 #include <snax/chain/types.hpp>
 #include <future>
 
@@ -39,7 +40,8 @@ class transaction_metadata {
          signed_id = digest_type::hash(packed_trx);
       }
 
-      const flat_set<public_key_type>& recover_keys( const chain_id_type& chain_id ) {
+      /// @param cache - the node-wide cache of recovered keys to consult and fill, may be null
+      const flat_set<public_key_type>& recover_keys( const chain_id_type& chain_id, recovered_keys_cache* cache = nullptr ) {
          // Unlikely for more than one chain_id to be used in one snaxnode instance
          if( !signing_keys || signing_keys->first != chain_id ) {
             if( signing_keys_future.valid() ) {
@@ -48,11 +50,25 @@ class transaction_metadata {
                   return signing_keys->second;
                }
             }
-            signing_keys = std::make_pair( chain_id, trx.get_signature_keys( chain_id ));
+            signing_keys = std::make_pair( chain_id, get_signature_keys( chain_id, cache ));
          }
          return signing_keys->second;
       }
 
+      /**
+       *  Recovers the keys of the signatures of trx, unless cache already has them. Does not touch signing_keys
+       *  and so may be called from the thread pool.
+       */
+      flat_set<public_key_type> get_signature_keys( const chain_id_type& chain_id, recovered_keys_cache* cache )const {
+         if( cache ) {
+            if( auto keys = cache->find( signed_id, chain_id ) )
+               return std::move( *keys );
+         }
+         auto keys = trx.get_signature_keys( chain_id );
+         if( cache ) cache->add( signed_id, chain_id, keys );
+         return keys;
+      }
+
       uint32_t total_actions()const { return trx.context_free_actions.size() + trx.actions.size(); }
 };
 
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <snax/chain/wasm_interface.hpp>
+#include <snax/chain/webassembly/runtime_interface.hpp>
+#include <snax/chain/exceptions.hpp>
+
+#include <list>
+#include <map>
+
+namespace snax { namespace chain {
+
+/**
+ * Instantiated contracts, bounded by the memory they keep resident: the least recently applied contracts are
+ * evicted first. Pinned contracts are never evicted, but count against the budget.
+ */
+class wasm_instantiation_cache {
+   public:
+      explicit wasm_instantiation_cache(uint64_t max_size) { _stats.max_bytes = max_size; }
+
+      /// @return the module instantiated for the code, which becomes the most recently used one, or nullptr
+      wasm_instantiated_module_interface* get(const digest_type& code_id) {
+         auto it = _entries.find(code_id);
+         if(it == _entries.end()) {
+            ++_stats.misses;
+            return nullptr;
+         }
+         ++_stats.hits;
+         if(!it->second.pinned)
+            _lru.splice(_lru.end(), _lru, it->second.lru_position);
+         return it->second.module.get();
+      }
+
+      bool contains(const digest_type& code_id)const { return _entries.count(code_id); }
+
+      wasm_instantiated_module_interface& insert(const digest_type& code_id, std::unique_ptr<wasm_instantiated_module_interface> module, bool pinned) {
+         auto& e = _entries[code_id];
+         SNAX_ASSERT(!e.module, wasm_exception, "code ${id} is already instantiated", ("id", code_id));
+         e.size = module->resident_size();
+         e.module = std::move(module);
+         e.pinned = pinned;
+         if(pinned)
+            ++_stats.pinned_entries;
+         else
+            e.lru_position = _lru.insert(_lru.end(), code_id);
+         ++_stats.entries;
+         _stats.resident_bytes += e.size;
+
+         // the new entry is the most recently used one, so it is only evicted if everything else was; pinned
+         // entries are not in _lru, so inserting one can leave the cache over budget once _lru is exhausted
+         for(auto it = _lru.begin(); it != _lru.end() && _stats.resident_bytes > _stats.max_bytes && *it != code_id; it = _lru.erase(it)) {
+            auto evicted = _entries.find(*it);
+            _stats.resident_bytes -= evicted->second.size;
+            --_stats.entries;
+            ++_stats.evictions;
+            _entries.erase(evicted);
+         }
+         return *e.module;
+      }
+
+      const wasm_interface::cache_stats& stats()const { return _stats; }
+
+   private:
+      struct entry {
+         std::unique_ptr<wasm_instantiated_module_interface>  module;
+         size_t                                               size = 0;
+         bool                                                 pinned = false;
+         std::list<digest_type>::iterator                     lru_position;
+      };
+
+      std::map<digest_type, entry>  _entries;
+      std::list<digest_type>        _lru;  ///< unpinned entries, least recently used first
+      wasm_interface::cache_stats   _stats;
+};
+
+} } // snax::chain
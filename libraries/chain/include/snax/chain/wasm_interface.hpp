@@ -4,6 +4,8 @@
 #include "Runtime/Linker.h"
 #include "Runtime/Runtime.h"
 
+#include <limits>
+
 namespace snax { namespace chain {
 
    class apply_context;
@@ -56,12 +58,43 @@ namespace snax { namespace chain {
             wabt
          };
 
-         wasm_interface(vm_type vm);
+         struct compile_stats {
+            uint32_t          queue_depth = 0;          ///< contracts queued or being compiled in the background
+            uint64_t          compiled = 0;
+            uint64_t          failed = 0;
+            uint64_t          interpreted_applies = 0;  ///< actions interpreted while their contract was being compiled
+            fc::microseconds  total_compile_time;
+            fc::microseconds  max_compile_time;
+         };
+
+         struct cache_stats {
+            uint64_t  hits = 0;
+            uint64_t  misses = 0;
+            uint64_t  evictions = 0;
+            uint64_t  entries = 0;
+            uint64_t  pinned_entries = 0;
+            uint64_t  resident_bytes = 0;
+            uint64_t  max_bytes = 0;
+         };
+
+         /// @param code_cache_size maximum size of the on-disk cache of compiled contracts in code_cache_dir, 0 disables it
+         /// @param compile_threads number of threads compiling contracts in the background for the wavm runtime, 0 compiles
+         ///                        them on first use
+         /// @param instantiation_cache_size memory budget of the contracts kept instantiated, in bytes
+         wasm_interface(vm_type vm, const fc::path& code_cache_dir = fc::path(), uint64_t code_cache_size = 0,
+                        uint16_t compile_threads = 0, uint64_t instantiation_cache_size = std::numeric_limits<uint64_t>::max());
          ~wasm_interface();
 
          //validates code -- does a WASM validation pass and checks the wasm against SNAX specific constraints
          static void validate(const controller& control, const bytes& code);
 
+         //Starts compiling code in the background, if enabled, so that it is ready by the time it is first applied;
+         //a pinned contract is never evicted from the instantiation cache once compiled
+         void compile_async(const digest_type& code_id, const bytes& code, bool pinned);
+
+         compile_stats get_compile_stats()const;
+         cache_stats   get_cache_stats()const;
+
          //Calls apply or error on a given code
          void apply(const digest_type& code_id, const shared_string& code, apply_context& context);
 
@@ -80,3 +113,7 @@ namespace snax{ namespace chain {
 }}
 
 FC_REFLECT_ENUM( snax::chain::wasm_interface::vm_type, (wavm)(wabt) )
+FC_REFLECT( snax::chain::wasm_interface::compile_stats,
+            (queue_depth)(compiled)(failed)(interpreted_applies)(total_compile_time)(max_compile_time) )
+FC_REFLECT( snax::chain::wasm_interface::cache_stats,
+            (hits)(misses)(evictions)(entries)(pinned_entries)(resident_bytes)(max_bytes) )
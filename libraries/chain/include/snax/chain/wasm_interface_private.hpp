@@ -1,14 +1,21 @@
 #pragma once
 
 #include <snax/chain/wasm_interface.hpp>
+#include <snax/chain/wasm_instantiation_cache.hpp>
 #include <snax/chain/webassembly/wavm.hpp>
 #include <snax/chain/webassembly/wabt.hpp>
 #include <snax/chain/webassembly/runtime_interface.hpp>
 #include <snax/chain/wasm_snax_injection.hpp>
 #include <snax/chain/transaction_context.hpp>
+#include <snax/chain/apply_context.hpp>
+#include <snax/chain/account_object.hpp>
 #include <snax/chain/exceptions.hpp>
 #include <fc/scoped_exit.hpp>
 
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <mutex>
+
 #include "IR/Module.h"
 #include "Runtime/Intrinsics.h"
 #include "Platform/Platform.h"
@@ -23,16 +30,44 @@ using namespace Runtime;
 namespace snax { namespace chain {
 
    struct wasm_interface_impl {
-      wasm_interface_impl(wasm_interface::vm_type vm) {
-         if(vm == wasm_interface::vm_type::wavm)
-            runtime_interface = std::make_unique<webassembly::wavm::wavm_runtime>();
+      /// the wasm of a contract after the SNAX injections, ready to be instantiated by a runtime
+      struct prepared_code {
+         std::vector<U8>       bytes;
+         std::vector<uint8_t>  initial_memory;
+      };
+
+      /// a background compilation; a compiled module is handed over to instantiation_cache, a failed one leaves the task done
+      struct compile_task {
+         bool                                                 done = false;
+         bool                                                 pinned = false;
+         std::unique_ptr<wasm_instantiated_module_interface>  module;
+      };
+
+      wasm_interface_impl(wasm_interface::vm_type vm, const fc::path& code_cache_dir, uint64_t code_cache_size, uint16_t compile_threads,
+                          uint64_t instantiation_cache_size)
+      : instantiation_cache(instantiation_cache_size) {
+         if(vm == wasm_interface::vm_type::wavm) {
+            runtime_interface = std::make_unique<webassembly::wavm::wavm_runtime>(code_cache_dir, code_cache_size);
+            if(compile_threads > 0) {
+               interpreter = std::make_unique<webassembly::wabt_runtime::wabt_runtime>();
+               compile_pool.emplace(compile_threads);
+            }
+         }
          else if(vm == wasm_interface::vm_type::wabt)
             runtime_interface = std::make_unique<webassembly::wabt_runtime::wabt_runtime>();
          else
             SNAX_THROW(wasm_exception, "wasm_interface_impl fall through");
+         executing_runtime = runtime_interface.get();
       }
 
-      std::vector<uint8_t> parse_initial_memory(const Module& module) {
+      ~wasm_interface_impl() {
+         if(compile_pool) {
+            compile_pool->stop();
+            compile_pool->join();
+         }
+      }
+
+      static std::vector<uint8_t> parse_initial_memory(const Module& module) {
          std::vector<uint8_t> mem_image;
 
          for(const DataSegment& data_segment : module.dataSegments) {
@@ -50,47 +85,185 @@ namespace snax { namespace chain {
          return mem_image;
       }
 
-      std::unique_ptr<wasm_instantiated_module_interface>& get_instantiated_module( const digest_type& code_id,
-                                                                                    const shared_string& code,
-                                                                                    transaction_context& trx_context )
-      {
-         auto it = instantiation_cache.find(code_id);
-         if(it == instantiation_cache.end()) {
-            auto timer_pause = fc::make_scoped_exit([&](){
-               trx_context.resume_billing_timer();
-            });
-            trx_context.pause_billing_timer();
-            IR::Module module;
-            try {
-               Serialization::MemoryInputStream stream((const U8*)code.data(), code.size());
-               WASM::serialize(stream, module);
-               module.userSections.clear();
-            } catch(const Serialization::FatalSerializationException& e) {
-               SNAX_ASSERT(false, wasm_serialization_error, e.message.c_str());
-            } catch(const IR::ValidationException& e) {
-               SNAX_ASSERT(false, wasm_serialization_error, e.message.c_str());
-            }
+      static prepared_code prepare_code(const char* code, size_t code_size) {
+         IR::Module module;
+         try {
+            Serialization::MemoryInputStream stream((const U8*)code, code_size);
+            WASM::serialize(stream, module);
+            module.userSections.clear();
+         } catch(const Serialization::FatalSerializationException& e) {
+            SNAX_ASSERT(false, wasm_serialization_error, e.message.c_str());
+         } catch(const IR::ValidationException& e) {
+            SNAX_ASSERT(false, wasm_serialization_error, e.message.c_str());
+         }
 
+         {
+            // the injections keep their state in statics
+            static std::mutex injection_mutex;
+            std::lock_guard<std::mutex> lock(injection_mutex);
             wasm_injections::wasm_binary_injection injector(module);
             injector.inject();
+         }
+
+         prepared_code prepared;
+         try {
+            Serialization::ArrayOutputStream outstream;
+            WASM::serialize(outstream, module);
+            prepared.bytes = outstream.getBytes();
+         } catch(const Serialization::FatalSerializationException& e) {
+            SNAX_ASSERT(false, wasm_serialization_error, e.message.c_str());
+         } catch(const IR::ValidationException& e) {
+            SNAX_ASSERT(false, wasm_serialization_error, e.message.c_str());
+         }
+         prepared.initial_memory = parse_initial_memory(module);
+         return prepared;
+      }
 
-            std::vector<U8> bytes;
+      /**
+       * Queue the compilation of a contract on the compile pool, unless it is already compiled or being compiled.
+       * Must be called with compile_mutex held.
+       */
+      void queue_compile(const digest_type& code_id, const char* code, size_t code_size, bool pinned) {
+         if(instantiation_cache.contains(code_id) || compile_tasks.count(code_id))
+            return;
+         compile_tasks[code_id].pinned = pinned;
+         ++compile_stats.queue_depth;
+
+         boost::asio::post(*compile_pool, [this, code_id, code = std::vector<char>(code, code + code_size)]() {
+            const auto start = fc::time_point::now();
+            std::unique_ptr<wasm_instantiated_module_interface> module;
             try {
-               Serialization::ArrayOutputStream outstream;
-               WASM::serialize(outstream, module);
-               bytes = outstream.getBytes();
-            } catch(const Serialization::FatalSerializationException& e) {
-               SNAX_ASSERT(false, wasm_serialization_error, e.message.c_str());
-            } catch(const IR::ValidationException& e) {
-               SNAX_ASSERT(false, wasm_serialization_error, e.message.c_str());
+               auto prepared = prepare_code(code.data(), code.size());
+               module = runtime_interface->instantiate_module((const char*)prepared.bytes.data(), prepared.bytes.size(), std::move(prepared.initial_memory));
+            } catch(const fc::exception& e) {
+               wlog("background compilation of ${id} failed: ${e}", ("id", code_id)("e", e.to_detail_string()));
+            } catch(const std::exception& e) {
+               wlog("background compilation of ${id} failed: ${e}", ("id", code_id)("e", e.what()));
+            } catch(...) {
+               wlog("background compilation of ${id} failed", ("id", code_id));
+            }
+            const auto elapsed = fc::time_point::now() - start;
+
+            std::lock_guard<std::mutex> lock(compile_mutex);
+            auto& task = compile_tasks[code_id];
+            task.done = true;
+            task.module = std::move(module);
+            --compile_stats.queue_depth;
+            if(task.module) {
+               compiled_tasks.push_back(code_id);
+               ++compile_stats.compiled;
+               compile_stats.total_compile_time += elapsed;
+               compile_stats.max_compile_time = std::max(compile_stats.max_compile_time, elapsed);
+               dlog("compiled ${id} in ${t} us", ("id", code_id)("t", elapsed.count()));
+            } else {
+               ++compile_stats.failed;
+            }
+         });
+      }
+
+      void compile_async(const digest_type& code_id, const char* code, size_t code_size, bool pinned) {
+         if(!compile_pool)
+            return;
+         std::lock_guard<std::mutex> lock(compile_mutex);
+         queue_compile(code_id, code, code_size, pinned);
+      }
+
+      /**
+       * Hands the modules compiled in the background over to instantiation_cache, whose budget then bounds them, whether
+       * or not their contracts are applied again. Called before an action is applied, when no module is executing.
+       */
+      void adopt_compiled_modules() {
+         std::vector<std::pair<digest_type, compile_task>> compiled;
+         {
+            std::lock_guard<std::mutex> lock(compile_mutex);
+            for(const auto& code_id : compiled_tasks) {
+               auto task = compile_tasks.find(code_id);
+               compiled.emplace_back(code_id, std::move(task->second));
+               compile_tasks.erase(task);
             }
-            it = instantiation_cache.emplace(code_id, runtime_interface->instantiate_module((const char*)bytes.data(), bytes.size(), parse_initial_memory(module))).first;
+            compiled_tasks.clear();
+         }
+
+         // switch over to the compiled module between two actions, never while one is executing
+         for(auto& c : compiled) {
+            interpreted_cache.erase(c.first);
+            instantiation_cache.insert(c.first, std::move(c.second.module), c.second.pinned);
          }
-         return it->second;
+      }
+
+      /// contracts of privileged accounts, i.e. the system contracts, stay instantiated
+      static bool is_pinned(const apply_context& context) {
+         return context.db.get<account_object,by_name>(context.receiver).privileged;
+      }
+
+      wasm_instantiated_module_interface& get_instantiated_module( const digest_type& code_id,
+                                                                   const shared_string& code,
+                                                                   apply_context& context )
+      {
+         executing_runtime = runtime_interface.get();
+         if(compile_pool)
+            adopt_compiled_modules();
+         if(auto module = instantiation_cache.get(code_id))
+            return *module;
+
+         auto& trx_context = context.trx_context;
+         if(compile_pool) {
+            std::unique_lock<std::mutex> lock(compile_mutex);
+            auto task = compile_tasks.find(code_id);
+            if(task == compile_tasks.end()) {
+               queue_compile(code_id, code.data(), code.size(), is_pinned(context));
+            } else if(task->second.done) {
+               // the compilation failed, it is not remembered: compile on this thread below so that the error is reported
+               // to the transaction, the contract is queued again if that fails as well
+               compile_tasks.erase(task);
+               lock.unlock();
+               interpreted_cache.erase(code_id);
+            }
+
+            if(lock.owns_lock()) {
+               ++compile_stats.interpreted_applies;
+               lock.unlock();
+
+               executing_runtime = interpreter.get();
+               auto interpreted = interpreted_cache.find(code_id);
+               if(interpreted == interpreted_cache.end()) {
+                  auto timer_pause = fc::make_scoped_exit([&](){
+                     trx_context.resume_billing_timer();
+                  });
+                  trx_context.pause_billing_timer();
+                  auto prepared = prepare_code(code.data(), code.size());
+                  interpreted = interpreted_cache.emplace(code_id, interpreter->instantiate_module((const char*)prepared.bytes.data(), prepared.bytes.size(), std::move(prepared.initial_memory))).first;
+               }
+               return *interpreted->second;
+            }
+         }
+
+         auto timer_pause = fc::make_scoped_exit([&](){
+            trx_context.resume_billing_timer();
+         });
+         trx_context.pause_billing_timer();
+         auto prepared = prepare_code(code.data(), code.size());
+         return instantiation_cache.insert(code_id, runtime_interface->instantiate_module((const char*)prepared.bytes.data(), prepared.bytes.size(), std::move(prepared.initial_memory)), is_pinned(context));
+      }
+
+      wasm_interface::compile_stats get_compile_stats() {
+         std::lock_guard<std::mutex> lock(compile_mutex);
+         return compile_stats;
       }
 
       std::unique_ptr<wasm_runtime_interface> runtime_interface;
-      map<digest_type, std::unique_ptr<wasm_instantiated_module_interface>> instantiation_cache;
+      wasm_instantiation_cache                instantiation_cache;
+
+      /// when contracts are compiled in the background, they are executed by the interpreter until their compilation finished
+      std::unique_ptr<wasm_runtime_interface> interpreter;
+      map<digest_type, std::unique_ptr<wasm_instantiated_module_interface>> interpreted_cache;
+      wasm_runtime_interface*                 executing_runtime = nullptr;
+
+      std::mutex                              compile_mutex;
+      map<digest_type, compile_task>          compile_tasks;
+      std::vector<digest_type>                compiled_tasks;  ///< done and compiled, not yet in instantiation_cache
+      wasm_interface::compile_stats           compile_stats;
+      optional<boost::asio::thread_pool>      compile_pool;
    };
 
 #define _REGISTER_INTRINSIC_EXPLICIT(CLS, MOD, METHOD, WASM_SIG, NAME, SIG)\
@@ -10,6 +10,9 @@ class wasm_instantiated_module_interface {
    public:
       virtual void apply(apply_context& context) = 0;
 
+      //approximate number of bytes of memory the instantiated module keeps resident
+      virtual size_t resident_size() const = 0;
+
       virtual ~wasm_instantiated_module_interface();
 };
 
@@ -16,9 +16,12 @@ using namespace Runtime;
 using namespace fc;
 using namespace snax::chain::webassembly::common;
 
+class wavm_code_cache;
+
 class wavm_runtime : public snax::chain::wasm_runtime_interface {
    public:
-      wavm_runtime();
+      /// @param code_cache_size maximum size of the on-disk cache of compiled contracts in code_cache_dir, 0 disables it
+      wavm_runtime( const fc::path& code_cache_dir = fc::path(), uint64_t code_cache_size = 0 );
       ~wavm_runtime();
       std::unique_ptr<wasm_instantiated_module_interface> instantiate_module(const char* code_bytes, size_t code_size, std::vector<uint8_t> initial_memory) override;
 
@@ -31,6 +34,7 @@ class wavm_runtime : public snax::chain::wasm_runtime_interface {
 
    private:
       std::shared_ptr<runtime_guard> _runtime_guard;
+      std::unique_ptr<wavm_code_cache> _code_cache;
 };
 
 //This is a temporary hack for the single threaded implementation
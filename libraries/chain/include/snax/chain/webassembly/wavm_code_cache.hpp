@@ -0,0 +1,47 @@
+#pragma once
+
+#include <snax/chain/types.hpp>
+
+#include <list>
+
+namespace snax { namespace chain { namespace webassembly { namespace wavm {
+
+/**
+ * On-disk cache of the relocatable object code WAVM compiles contracts to, so that restarts and replays map the
+ * machine code of previously compiled contracts back in instead of compiling them again through LLVM.
+ *
+ * Entries are keyed by the hash of the (injected) wasm they were compiled from. Each entry records the version of the
+ * code generator that produced it and a checksum of its object code; entries failing either check are discarded.
+ * The total size of the cache is bounded by evicting the least recently used entries.
+ */
+class wavm_code_cache {
+   public:
+      wavm_code_cache( const fc::path& dir, uint64_t max_size, const string& code_generator_version );
+
+      /// @return the object code cached for the wasm, or an empty vector
+      std::vector<uint8_t> get( const digest_type& wasm_id );
+      void                 put( const digest_type& wasm_id, const std::vector<uint8_t>& object_code );
+
+      uint64_t size()const { return _size; }
+      uint64_t max_size()const { return _max_size; }
+
+   private:
+      struct entry {
+         uint64_t                              size = 0;
+         std::list<digest_type>::iterator      lru_position; ///< position in _lru
+      };
+
+      fc::path entry_path( const digest_type& wasm_id )const;
+      void     add( const digest_type& wasm_id, uint64_t size );
+      void     remove( const digest_type& wasm_id );
+      void     evict( uint64_t needed );
+
+      fc::path                     _dir;
+      uint64_t                     _max_size;
+      string                       _code_generator_version;
+      map<digest_type, entry>      _entries;
+      std::list<digest_type>       _lru; ///< most recently used entry first
+      uint64_t                     _size = 0;
+};
+
+} } } } // snax::chain::webassembly::wavm
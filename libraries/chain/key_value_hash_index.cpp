@@ -0,0 +1,73 @@
+/**
+ *  @file
+ *  @copyright defined in snax/LICENSE.txt
+ */
+#include <snax/chain/key_value_hash_index.hpp>
+
+namespace snax { namespace chain {
+
+key_value_hash_index::key_value_hash_index( const chainbase::database& db )
+:_db(db)
+{
+}
+
+void key_value_hash_index::build() {
+   _rows.clear();
+   _journal.clear();
+
+   const auto& idx = _db.get_index<key_value_index, by_scope_primary>();
+   _rows.reserve( idx.size() );
+   for( const auto& obj : idx ) {
+      _rows.emplace( row_key{obj.t_id, obj.primary_key}, &obj );
+   }
+}
+
+const key_value_object* key_value_hash_index::find( table_id t_id, uint64_t primary_key ) {
+   sync();
+   auto itr = _rows.find( row_key{t_id, primary_key} );
+   return itr != _rows.end() ? itr->second : nullptr;
+}
+
+void key_value_hash_index::add( const key_value_object& obj ) {
+   sync();
+   row_key k{obj.t_id, obj.primary_key};
+   _rows[k] = &obj;
+   journal( k );
+}
+
+void key_value_hash_index::remove( const key_value_object& obj ) {
+   sync();
+   row_key k{obj.t_id, obj.primary_key};
+   _rows.erase( k );
+   journal( k );
+}
+
+void key_value_hash_index::journal( const row_key& k ) {
+   _journal.emplace_back( _db.revision(), k );
+}
+
+void key_value_hash_index::sync() {
+   const int64_t revision = _db.revision();
+   if( _journal.empty() || _journal.back().first <= revision ) return;
+
+   // the changes made past the revision were either undone or squashed into it, the ordered index tells which
+   auto itr = _journal.end();
+   while( itr != _journal.begin() && std::prev( itr )->first > revision ) --itr;
+   for( ; itr != _journal.end(); ++itr ) {
+      const row_key& k = itr->second;
+      const auto* obj = _db.find<key_value_object, by_scope_primary>( boost::make_tuple( k.t_id, k.primary_key ) );
+      if( obj ) {
+         _rows[k] = obj;
+      } else {
+         _rows.erase( k );
+      }
+      itr->first = revision;
+   }
+}
+
+void key_value_hash_index::commit( int64_t revision ) {
+   sync();
+   while( !_journal.empty() && _journal.front().first <= revision ) _journal.pop_front();
+}
+
+} } /// snax::chain
@@ -0,0 +1,50 @@
+/**
+ *  @file
+ *  @copyright defined in snax/LICENSE.txt
+ */
+#include <snax/chain/recovered_keys_cache.hpp>
+
+namespace snax { namespace chain {
+
+recovered_keys_cache::recovered_keys_cache( uint32_t max_entries )
+:_max_entries(max_entries)
+{
+}
+
+optional<flat_set<public_key_type>> recovered_keys_cache::find( const transaction_id_type& signed_id, const chain_id_type& chain_id ) {
+   std::lock_guard<std::mutex> g( _mutex );
+   auto& idx = _entries.get<by_signed_id>();
+   auto itr = idx.find( boost::make_tuple( signed_id, chain_id ) );
+   if( itr == idx.end() ) {
+      ++_misses;
+      return optional<flat_set<public_key_type>>();
+   }
+   ++_hits;
+   _entries.relocate( _entries.end(), _entries.project<0>( itr ) );
+   return itr->keys;
+}
+
+void recovered_keys_cache::add( const transaction_id_type& signed_id, const chain_id_type& chain_id, const flat_set<public_key_type>& keys ) {
+   if( _max_entries == 0 ) return;
+
+   std::lock_guard<std::mutex> g( _mutex );
+   // another thread may have recovered the same transaction meanwhile, which leaves its entry in place
+   if( !_entries.push_back( entry{ signed_id, chain_id, keys } ).second ) return;
+   while( _entries.size() > _max_entries ) {
+      _entries.pop_front();
+      ++_evictions;
+   }
+}
+
+recovered_keys_cache::stats recovered_keys_cache::get_stats()const {
+   std::lock_guard<std::mutex> g( _mutex );
+   stats s;
+   s.hits        = _hits;
+   s.misses      = _misses;
+   s.evictions   = _evictions;
+   s.entries     = _entries.size();
+   s.max_entries = _max_entries;
+   return s;
+}
+
+} } /// snax::chain
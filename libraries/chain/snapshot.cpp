@@ -1,9 +1,24 @@
 #include <snax/chain/snapshot.hpp>
 #include <snax/chain/exceptions.hpp>
 #include <fc/scoped_exit.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/crypto/city.hpp>
+
+#include <map>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+
+#include <boost/asio/post.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
 
 namespace snax { namespace chain {
 
+namespace bio = boost::iostreams;
+
 variant_snapshot_writer::variant_snapshot_writer(fc::mutable_variant_object& snapshot)
 : snapshot(snapshot)
 {
@@ -336,6 +351,532 @@ void istream_snapshot_reader::clear_section() {
    cur_row = 0;
 }
 
+namespace detail {
+   static uint32_t resolve_threads( uint32_t threads ) {
+      return threads ? threads : std::max( 1u, std::thread::hardware_concurrency() );
+   }
+
+   /// state shared by a parallel_snapshot_writer and the part writers of its write_concurrently calls
+   struct parallel_snapshot_output {
+      parallel_snapshot_output( std::ostream& snapshot, uint32_t threads, bool compress )
+      :snapshot(snapshot)
+      ,header_pos(snapshot.tellp())
+      ,threads(resolve_threads(threads))
+      ,compress(compress)
+      ,max_buffered(this->threads * 2)
+      ,pool(this->threads)
+      {}
+
+      ~parallel_snapshot_output() {
+         pool.stop();
+         pool.join();
+      }
+
+      /// reserves the place of a section in the directory
+      void start_section( const parallel_snapshot_writer::section_key& key, const std::string& name ) {
+         std::lock_guard<std::mutex> g( mtx );
+         SNAX_ASSERT( sections.count( key ) == 0, snapshot_exception, "Section ${n} is written twice", ("n", name) );
+         sections[key].name = name;
+      }
+
+      /// compresses and checksums the row sizes and rows of a chunk on the pool, then appends it to the snapshot
+      void write_chunk( const parallel_snapshot_writer::section_key& key, std::vector<char>&& row_sizes, std::vector<char>&& rows,
+                        uint32_t row_count ) {
+         std::unique_lock<std::mutex> lock( mtx );
+         // bound the chunks held in memory, the pool never waits here so it always drains them
+         cv.wait( lock, [this]() { return in_flight < max_buffered || error; } );
+         if( error ) std::rethrow_exception( error );
+         auto& chunks = sections[key].chunks;
+         const auto index = chunks.size();
+         chunks.emplace_back();
+         ++in_flight;
+         ++chunks_total;
+         lock.unlock();
+
+         auto sizes = std::make_shared<std::vector<char>>( std::move( row_sizes ) );
+         auto packed = std::make_shared<std::vector<char>>( std::move( rows ) );
+         boost::asio::post( pool, [this, key, index, sizes, packed, row_count]() {
+            try {
+               auto data = std::make_shared<std::vector<char>>();
+               data->reserve( sizes->size() + packed->size() );
+               data->insert( data->end(), sizes->begin(), sizes->end() );
+               data->insert( data->end(), packed->begin(), packed->end() );
+
+               snapshot_chunk_info info;
+               info.size = data->size();
+               info.index_size = sizes->size();
+               info.rows = row_count;
+               info.checksum = fc::sha256::hash( data->data(), data->size() );
+
+               std::vector<char> stored;
+               if( compress ) {
+                  bio::filtering_ostream comp;
+                  comp.push( bio::zlib_compressor( bio::zlib::best_speed ) );
+                  comp.push( bio::back_inserter( stored ) );
+                  bio::write( comp, data->data(), data->size() );
+                  bio::close( comp );
+               }
+               const bool compressed = compress && stored.size() < data->size();
+               const auto& out = compressed ? stored : *data;
+               info.compression = compressed ? 1 : 0;
+               info.stored_size = out.size();
+
+               std::lock_guard<std::mutex> g( mtx );
+               info.offset = snapshot.tellp() - header_pos;
+               snapshot.write( out.data(), out.size() );
+               if( !snapshot.good() ) {
+                  if( !error )
+                     error = std::make_exception_ptr( snapshot_exception( FC_LOG_MESSAGE( error, "Unable to write to the snapshot" ) ) );
+               } else {
+                  sections[key].chunks[index] = info;
+                  ++chunks_written;
+                  bytes_written += out.size();
+               }
+               --in_flight;
+            } catch( ... ) {
+               std::lock_guard<std::mutex> g( mtx );
+               if( !error ) error = std::current_exception();
+               --in_flight;
+            }
+            cv.notify_all();
+         });
+      }
+
+      /// waits for the chunks on the pool to be written, rethrowing the first error writing them
+      void wait() {
+         std::unique_lock<std::mutex> lock( mtx );
+         cv.wait( lock, [this]() { return in_flight == 0; } );
+         if( error ) std::rethrow_exception( error );
+      }
+
+      std::ostream&                   snapshot;
+      std::streampos                  header_pos;
+      uint32_t                        threads;
+      bool                            compress;
+      std::mutex                      mtx; ///< guards the stream and everything below
+      std::condition_variable         cv;
+      uint32_t                        max_buffered;
+      uint32_t                        in_flight = 0;
+      uint64_t                        chunks_total = 0;
+      uint64_t                        chunks_written = 0;
+      uint64_t                        bytes_written = 0;
+      std::exception_ptr              error;
+      uint32_t                        next_batch = 0;
+      std::map<parallel_snapshot_writer::section_key, snapshot_section_info> sections;
+      boost::asio::thread_pool        pool;
+   };
+}
+
+parallel_snapshot_writer::parallel_snapshot_writer(std::ostream& snapshot, uint32_t threads, bool compress)
+:output(std::make_shared<detail::parallel_snapshot_output>(snapshot, threads, compress))
+{
+   // write magic number
+   auto totem = magic_number;
+   snapshot.write((char*)&totem, sizeof(totem));
+
+   // write version
+   auto version = current_snapshot_version;
+   snapshot.write((char*)&version, sizeof(version));
+}
+
+parallel_snapshot_writer::parallel_snapshot_writer(const std::shared_ptr<detail::parallel_snapshot_output>& output, uint32_t batch, uint32_t part)
+:output(output)
+,part(std::make_pair(batch, part))
+{
+}
+
+void parallel_snapshot_writer::write_start_section( const std::string& section_name ) {
+   SNAX_ASSERT(!in_section, snapshot_exception, "Attempting to write a new section without closing the previous section");
+   if( part ) {
+      cur_section = section_key( part->first, part->second, next_section++ );
+   } else {
+      std::lock_guard<std::mutex> g( output->mtx );
+      cur_section = section_key( output->next_batch++, 0, 0 );
+   }
+   output->start_section( cur_section, section_name );
+   in_section = true;
+   chunk.reserve( chunk_size + chunk_size / 4 );
+}
+
+void parallel_snapshot_writer::write_row( const detail::abstract_snapshot_row_writer& row_writer ) {
+   const auto restore = chunk.size();
+   try {
+      row_writer.write(chunk);
+   } catch (...) {
+      chunk.resize(restore);
+      throw;
+   }
+
+   // the size of each row lets rows be read back without knowing their types
+   const fc::unsigned_int row_size( chunk.size() - restore );
+   const auto pos = chunk_row_sizes.size();
+   chunk_row_sizes.resize( pos + fc::raw::pack_size( row_size ) );
+   fc::datastream<char*> ds( chunk_row_sizes.data() + pos, chunk_row_sizes.size() - pos );
+   fc::raw::pack( ds, row_size );
+
+   ++chunk_rows;
+   if( chunk.size() >= chunk_size )
+      write_chunk();
+}
+
+void parallel_snapshot_writer::write_end_section( ) {
+   if( chunk_rows )
+      write_chunk();
+   in_section = false;
+}
+
+void parallel_snapshot_writer::write_chunk() {
+   output->write_chunk( cur_section, std::move(chunk_row_sizes), std::move(chunk), chunk_rows );
+   chunk_row_sizes = std::vector<char>();
+   chunk = std::vector<char>();
+   chunk.reserve( chunk_size + chunk_size / 4 );
+   chunk_rows = 0;
+}
+
+void parallel_snapshot_writer::write_concurrently( const std::vector<std::function<void(snapshot_writer&)>>& writes ) {
+   if( part ) {
+      // a part writer already runs concurrently with the others
+      snapshot_writer::write_concurrently( writes );
+      return;
+   }
+   SNAX_ASSERT(!in_section, snapshot_exception, "Attempting to write concurrently inside a section");
+
+   uint32_t batch = 0;
+   {
+      std::lock_guard<std::mutex> g( output->mtx );
+      batch = output->next_batch++;
+   }
+
+   std::atomic<size_t> next_write{0};
+   std::mutex error_mtx;
+   std::exception_ptr error;
+   auto run = [&]() {
+      for( size_t i = next_write++; i < writes.size(); i = next_write++ ) {
+         try {
+            parallel_snapshot_writer part_writer( output, batch, i );
+            writes[i]( part_writer );
+            SNAX_ASSERT(!part_writer.in_section, snapshot_exception, "Section left open by a concurrent write");
+         } catch( ... ) {
+            std::lock_guard<std::mutex> g( error_mtx );
+            if( !error ) error = std::current_exception();
+            next_write = writes.size();
+         }
+      }
+   };
+
+   // the part writers wait on the pool compressing their chunks so they need threads of their own
+   std::vector<std::thread> workers;
+   const auto worker_count = std::min<size_t>( output->threads, writes.size() );
+   for( size_t i = 1; i < worker_count; ++i )
+      workers.emplace_back( run );
+   run();
+   for( auto& w : workers )
+      w.join();
+
+   if( error ) std::rethrow_exception( error );
+}
+
+uint32_t parallel_snapshot_writer::concurrency() const {
+   return part ? 1 : output->threads;
+}
+
+void parallel_snapshot_writer::set_max_buffered_chunks( uint32_t max_chunks ) {
+   std::lock_guard<std::mutex> g( output->mtx );
+   output->max_buffered = std::max( 1u, max_chunks );
+   output->cv.notify_all();
+}
+
+parallel_snapshot_writer::progress_info parallel_snapshot_writer::progress() const {
+   std::lock_guard<std::mutex> g( output->mtx );
+   progress_info p;
+   p.chunks_written = output->chunks_written;
+   p.chunks_total = output->chunks_total;
+   p.bytes_written = output->bytes_written;
+   return p;
+}
+
+void parallel_snapshot_writer::finalize() {
+   SNAX_ASSERT(!part, snapshot_exception, "Only the writer a snapshot was started with can finalize it");
+   output->wait();
+
+   std::vector<detail::snapshot_section_info> directory;
+   std::lock_guard<std::mutex> g( output->mtx );
+   directory.reserve( output->sections.size() );
+   for( auto& s : output->sections )
+      directory.emplace_back( std::move( s.second ) );
+   output->sections.clear();
+
+   auto& snapshot = output->snapshot;
+   uint64_t directory_offset = snapshot.tellp() - output->header_pos;
+   const auto packed = fc::raw::pack( directory );
+   snapshot.write( packed.data(), packed.size() );
+
+   // the directory is found through its offset at the very end of the snapshot
+   snapshot.write((char*)&directory_offset, sizeof(directory_offset));
+   SNAX_ASSERT( snapshot.good(), snapshot_exception, "Unable to write to the snapshot" );
+}
+
+parallel_snapshot_reader::parallel_snapshot_reader(std::istream& snapshot, uint32_t threads)
+:snapshot(snapshot)
+,header_pos(snapshot.tellg())
+,threads(detail::resolve_threads(threads))
+,pool(this->threads)
+{
+}
+
+parallel_snapshot_reader::~parallel_snapshot_reader() {
+   clear_section();
+   pool.join();
+}
+
+bool parallel_snapshot_reader::is_parallel_snapshot( std::istream& snapshot ) {
+   auto restore_pos = fc::make_scoped_exit([&snapshot,pos=snapshot.tellg()](){
+      snapshot.clear();
+      snapshot.seekg(pos);
+   });
+
+   auto totem = parallel_snapshot_writer::magic_number;
+   decltype(totem) actual_totem = 0;
+   snapshot.read((char*)&actual_totem, sizeof(actual_totem));
+   return snapshot.good() && actual_totem == totem;
+}
+
+const std::vector<detail::snapshot_section_info>& parallel_snapshot_reader::directory() const {
+   std::lock_guard<std::mutex> g( snapshot_mtx );
+   if( sections ) return *sections;
+
+   auto restore_pos = fc::make_scoped_exit([this,pos=snapshot.tellg(),ex=snapshot.exceptions()](){
+      snapshot.seekg(pos);
+      snapshot.exceptions(ex);
+   });
+   snapshot.exceptions(std::istream::failbit|std::istream::eofbit);
+
+   try {
+      const std::streamoff header_size = sizeof(parallel_snapshot_writer::magic_number) + sizeof(current_snapshot_version);
+      snapshot.seekg(0, std::ios::end);
+      const std::streamoff size = snapshot.tellg() - header_pos;
+      SNAX_ASSERT(size >= header_size + std::streamoff(sizeof(uint64_t)), snapshot_exception, "Binary snapshot is truncated");
+
+      uint64_t directory_offset = 0;
+      snapshot.seekg(header_pos + size - std::streamoff(sizeof(directory_offset)));
+      snapshot.read((char*)&directory_offset, sizeof(directory_offset));
+      SNAX_ASSERT(directory_offset >= uint64_t(header_size) && directory_offset <= uint64_t(size) - sizeof(directory_offset),
+                  snapshot_exception, "Binary snapshot has a corrupt directory offset ${o}", ("o", directory_offset));
+
+      std::vector<char> packed( size - sizeof(directory_offset) - directory_offset );
+      snapshot.seekg(header_pos + std::streamoff(directory_offset));
+      snapshot.read(packed.data(), packed.size());
+
+      std::vector<detail::snapshot_section_info> directory;
+      fc::datastream<const char*> ds( packed.data(), packed.size() );
+      fc::raw::unpack( ds, directory );
+
+      for( const auto& s : directory ) {
+         for( const auto& c : s.chunks ) {
+            SNAX_ASSERT(c.offset >= uint64_t(header_size) && c.offset + c.stored_size <= directory_offset, snapshot_exception,
+                        "Binary snapshot section ${n} has a chunk outside of the snapshot", ("n", s.name));
+         }
+      }
+      sections = std::move( directory );
+   } catch( const std::ios_base::failure& e ) {
+      snapshot_exception fce(FC_LOG_MESSAGE( warn, "Binary snapshot directory threw IO exception (${what})",("what",e.what())));
+      throw fce;
+   }
+   return *sections;
+}
+
+void parallel_snapshot_reader::validate() const {
+   // make sure to restore the read pos
+   auto restore_pos = fc::make_scoped_exit([this,pos=snapshot.tellg(),ex=snapshot.exceptions()](){
+      snapshot.seekg(pos);
+      snapshot.exceptions(ex);
+   });
+
+   snapshot.exceptions(std::istream::failbit|std::istream::eofbit);
+
+   try {
+      // validate totem
+      auto expected_totem = parallel_snapshot_writer::magic_number;
+      decltype(expected_totem) actual_totem;
+      snapshot.read((char*)&actual_totem, sizeof(actual_totem));
+      SNAX_ASSERT(actual_totem == expected_totem, snapshot_exception,
+                 "Binary snapshot has unexpected magic number!");
+
+      // validate version
+      auto expected_version = current_snapshot_version;
+      decltype(expected_version) actual_version;
+      snapshot.read((char*)&actual_version, sizeof(actual_version));
+      SNAX_ASSERT(actual_version == expected_version, snapshot_exception,
+                 "Binary snapshot is an unsuppored version.  Expected : ${expected}, Got: ${actual}",
+                 ("expected", expected_version)("actual", actual_version));
+   } catch( const std::exception& e ) {
+      snapshot_exception fce(FC_LOG_MESSAGE( warn, "Binary snapshot validation threw IO exception (${what})",("what",e.what())));
+      throw fce;
+   }
+
+   directory();
+}
+
+bool parallel_snapshot_reader::has_section( const string& section_name ) {
+   for( const auto& s : directory() ) {
+      if( s.name == section_name )
+         return true;
+   }
+   return false;
+}
+
+void parallel_snapshot_reader::set_section( const string& section_name ) {
+   clear_section();
+
+   // sections written concurrently under the same name are read back as one
+   bool found = false;
+   for( const auto& s : directory() ) {
+      if( s.name != section_name ) continue;
+      found = true;
+      for( const auto& c : s.chunks ) {
+         chunks.push_back( &c );
+         rows_left += c.rows;
+      }
+   }
+   SNAX_ASSERT(found, snapshot_exception, "Binary snapshot has no section named ${n}", ("n", section_name));
+
+   read_ahead();
+}
+
+void parallel_snapshot_reader::read_ahead() {
+   while( read_chunks.size() < threads * 2 && next_chunk < chunks.size() ) {
+      auto task = std::make_shared<std::packaged_task<std::vector<char>()>>( [this, chunk = chunks[next_chunk]]() {
+         return read_chunk( *chunk );
+      });
+      boost::asio::post( pool, [task]() { (*task)(); } );
+      read_chunks.emplace_back( task->get_future() );
+      ++next_chunk;
+   }
+}
+
+std::vector<char> parallel_snapshot_reader::read_chunk( const detail::snapshot_chunk_info& chunk ) const {
+   std::vector<char> stored( chunk.stored_size );
+   {
+      std::lock_guard<std::mutex> g( snapshot_mtx );
+      snapshot.clear();
+      snapshot.seekg( header_pos + std::streamoff(chunk.offset) );
+      snapshot.read( stored.data(), stored.size() );
+      SNAX_ASSERT( snapshot.good(), snapshot_exception, "Unable to read a chunk of the snapshot at ${o}", ("o", chunk.offset) );
+   }
+
+   std::vector<char> data;
+   switch( chunk.compression ) {
+      case 0:
+         data = std::move( stored );
+         break;
+      case 1:
+         try {
+            bio::filtering_ostream decomp;
+            decomp.push( bio::zlib_decompressor() );
+            decomp.push( bio::back_inserter( data ) );
+            bio::write( decomp, stored.data(), stored.size() );
+            bio::close( decomp );
+         } catch( ... ) {
+            SNAX_THROW( snapshot_exception, "Unable to decompress a chunk of the snapshot at ${o}", ("o", chunk.offset) );
+         }
+         break;
+      default:
+         SNAX_THROW( snapshot_exception, "Unknown compression ${c} of a chunk of the snapshot", ("c", (uint32_t)chunk.compression) );
+   }
+
+   SNAX_ASSERT( data.size() == chunk.size && fc::sha256::hash( data.data(), data.size() ) == chunk.checksum, snapshot_exception,
+                "Chunk of the snapshot at ${o} is corrupt", ("o", chunk.offset) );
+   return data;
+}
+
+uint32_t parallel_snapshot_reader::next_row_size() {
+   SNAX_ASSERT( rows_left > 0, snapshot_exception, "Attempting to read past the end of a section" );
+   if( chunk_rows_left == 0 ) {
+      cur_data = read_chunks.front().get();
+      read_chunks.pop_front();
+      const auto& chunk = *chunks[cur_chunk++];
+      cur_index_pos = 0;
+      cur_pos = chunk.index_size;
+      chunk_rows_left = chunk.rows;
+      SNAX_ASSERT( cur_pos <= cur_data.size(), snapshot_exception, "Chunk of the snapshot at ${o} is corrupt", ("o", chunk.offset) );
+      read_ahead();
+   }
+
+   fc::datastream<const char*> ds( cur_data.data() + cur_index_pos, cur_pos - cur_index_pos );
+   fc::unsigned_int row_size;
+   fc::raw::unpack( ds, row_size );
+   cur_index_pos = cur_pos - ds.remaining();
+   SNAX_ASSERT( row_size.value <= cur_data.size() - cur_pos, snapshot_exception, "Row of the snapshot overruns its chunk" );
+   return row_size.value;
+}
+
+bool parallel_snapshot_reader::finish_row() {
+   --chunk_rows_left;
+   SNAX_ASSERT( chunk_rows_left > 0 || cur_pos == cur_data.size(), snapshot_exception,
+                "Chunk of the snapshot does not end with its last row" );
+   return --rows_left > 0;
+}
+
+bool parallel_snapshot_reader::read_row( detail::abstract_snapshot_row_reader& row_reader ) {
+   const auto row_size = next_row_size();
+   fc::datastream<const char*> ds( cur_data.data() + cur_pos, row_size );
+   row_reader.provide( ds );
+   SNAX_ASSERT( ds.remaining() == 0, snapshot_exception, "Row of type ${t} does not match the size it was written with",
+                ("t", row_reader.row_type_name()) );
+   cur_pos += row_size;
+   return finish_row();
+}
+
+bool parallel_snapshot_reader::read_packed_row( std::vector<char>& row ) {
+   const auto row_size = next_row_size();
+   row.assign( cur_data.data() + cur_pos, cur_data.data() + cur_pos + row_size );
+   cur_pos += row_size;
+   return finish_row();
+}
+
+std::vector<std::string> parallel_snapshot_reader::section_names() {
+   std::vector<std::string> names;
+   for( const auto& s : directory() ) {
+      if( std::find( names.begin(), names.end(), s.name ) == names.end() )
+         names.push_back( s.name );
+   }
+   return names;
+}
+
+fc::sha256 parallel_snapshot_reader::digest() {
+   fc::sha256::encoder enc;
+   for( const auto& s : directory() ) {
+      for( const auto& c : s.chunks )
+         fc::raw::pack( enc, c.checksum );
+   }
+   return enc.result();
+}
+
+bool parallel_snapshot_reader::empty ( ) {
+   return rows_left == 0;
+}
+
+void parallel_snapshot_reader::clear_section() {
+   // the chunks read ahead refer to this reader until they are done
+   for( auto& f : read_chunks )
+      f.wait();
+   read_chunks.clear();
+   chunks.clear();
+   next_chunk = 0;
+   cur_chunk = 0;
+   cur_data.clear();
+   cur_index_pos = 0;
+   cur_pos = 0;
+   chunk_rows_left = 0;
+   rows_left = 0;
+}
+
+snapshot_reader_ptr make_binary_snapshot_reader( std::istream& snapshot ) {
+   if( parallel_snapshot_reader::is_parallel_snapshot( snapshot ) )
+      return std::make_shared<parallel_snapshot_reader>( snapshot );
+   return std::make_shared<istream_snapshot_reader>( snapshot );
+}
+
 integrity_hash_snapshot_writer::integrity_hash_snapshot_writer(fc::sha256::encoder& enc)
 :enc(enc)
 {
@@ -358,4 +899,241 @@ void integrity_hash_snapshot_writer::finalize() {
    // no-op for structural details
 }
 
-}}
\ No newline at end of file
+const std::string delta_snapshot_writer::header_section_name = "snapshot_delta";
+
+delta_snapshot_writer::delta_snapshot_writer(const std::shared_ptr<packed_snapshot_reader>& base, std::ostream& delta, uint32_t threads)
+:base(base)
+,delta(delta, threads)
+{
+   detail::snapshot_delta_header header;
+   header.base_digest = base->digest();
+   this->delta.write_start_section(header_section_name);
+   this->delta.write_row(detail::make_row_writer(header));
+   this->delta.write_end_section();
+}
+
+void delta_snapshot_writer::write_start_section( const std::string& section_name ) {
+   base_rows.clear();
+   base_index.clear();
+   base_ahead.clear();
+   base_pos = 0;
+   run = detail::snapshot_delta_run();
+   literals.clear();
+
+   if( base->has_section(section_name) ) {
+      base->set_section(section_name);
+      bool more = !base->empty();
+      while( more ) {
+         more = base->read_packed_row(row);
+         base_rows.push_back( fc::city_hash64(row.data(), row.size()) );
+      }
+      base->clear_section();
+      // read again alongside the rows written, to compare the bytes of the rows their hashes match
+      base->set_section(section_name);
+
+      base_index.reserve( base_rows.size() );
+      for( uint32_t i = 0; i < base_rows.size(); ++i )
+         base_index.emplace_back( base_rows[i], i );
+      std::sort( base_index.begin(), base_index.end() );
+   }
+
+   delta.write_start_section(section_name);
+}
+
+void delta_snapshot_writer::write_row( const detail::abstract_snapshot_row_writer& row_writer ) {
+   row.clear();
+   row_writer.write(row);
+   const auto hash = fc::city_hash64(row.data(), row.size());
+
+   // the next row of the base is the likely match, otherwise the first one after it with the same bytes
+   auto match = base_rows.size();
+   if( base_pos < base_rows.size() && base_rows[base_pos] == hash ) {
+      match = base_pos;
+   } else {
+      auto itr = std::lower_bound( base_index.begin(), base_index.end(), std::make_pair(hash, base_pos) );
+      if( itr != base_index.end() && itr->first == hash )
+         match = itr->second;
+   }
+   // row bytes are user controlled and the hash is not collision resistant, so a match is only taken on equal bytes
+   if( match != base_rows.size() && !base_row_equals( match ) )
+      match = base_rows.size();
+
+   if( match == base_rows.size() ) {
+      literals.push_back(row);
+      return;
+   }
+
+   const uint32_t skip = match - base_pos;
+   if( !literals.empty() || (skip > 0 && run.copy.value > 0) )
+      flush_run();
+   if( run.copy.value == 0 )
+      run.skip = skip;
+   ++run.copy.value;
+   base_ahead.erase( base_ahead.begin(), base_ahead.begin() + (match + 1 - base_pos) );
+   base_pos = match + 1;
+}
+
+bool delta_snapshot_writer::base_row_equals( uint32_t pos ) {
+   // rows only ever match at or after base_pos, so the base section is read forward once; rows read past base_pos
+   // are kept until a later match moves base_pos beyond them
+   while( base_pos + base_ahead.size() <= pos ) {
+      base_ahead.emplace_back();
+      base->read_packed_row( base_ahead.back() );
+   }
+   return base_ahead[pos - base_pos] == row;
+}
+
+void delta_snapshot_writer::flush_run() {
+   if( run.copy.value == 0 && literals.empty() )
+      return;
+
+   run.literals = literals.size();
+   delta.write_row(detail::make_row_writer(run));
+   for( const auto& l : literals )
+      delta.write_row(detail::packed_row_writer(l));
+
+   run = detail::snapshot_delta_run();
+   literals.clear();
+}
+
+void delta_snapshot_writer::write_end_section( ) {
+   flush_run();
+   delta.write_end_section();
+   base->clear_section();
+   base_ahead.clear();
+
+   base_rows = std::vector<uint64_t>();
+   base_index = std::vector<std::pair<uint64_t, uint32_t>>();
+}
+
+void delta_snapshot_writer::finalize() {
+   delta.finalize();
+}
+
+delta_snapshot_reader::delta_snapshot_reader(const std::shared_ptr<packed_snapshot_reader>& base, const std::shared_ptr<parallel_snapshot_reader>& delta)
+:base(base)
+,delta(delta)
+{
+}
+
+bool delta_snapshot_reader::is_delta_snapshot( parallel_snapshot_reader& snapshot ) {
+   return snapshot.has_section(delta_snapshot_writer::header_section_name);
+}
+
+void delta_snapshot_reader::validate() const {
+   base->validate();
+   delta->validate();
+
+   SNAX_ASSERT(is_delta_snapshot(*delta), snapshot_validation_exception, "Snapshot is not a delta");
+
+   detail::snapshot_delta_header header;
+   delta->read_section(delta_snapshot_writer::header_section_name, [&header]( auto& section ) {
+      section.read_row(header);
+   });
+   SNAX_ASSERT(header.version == 1, snapshot_validation_exception,
+               "Delta snapshot is an unsupported version.  Expected : 1, Got: ${actual}", ("actual", header.version));
+   SNAX_ASSERT(header.base_digest == base->digest(), snapshot_validation_exception,
+               "Delta snapshot was written against another base snapshot");
+}
+
+bool delta_snapshot_reader::has_section( const string& section_name ) {
+   return section_name != delta_snapshot_writer::header_section_name && delta->has_section(section_name);
+}
+
+void delta_snapshot_reader::set_section( const string& section_name ) {
+   clear_section();
+   SNAX_ASSERT(section_name != delta_snapshot_writer::header_section_name, snapshot_exception,
+               "Delta snapshot has no section named ${n}", ("n", section_name));
+
+   delta->set_section(section_name);
+   delta_more = !delta->empty();
+   if( base->has_section(section_name) ) {
+      base->set_section(section_name);
+      base_more = !base->empty();
+   }
+}
+
+bool delta_snapshot_reader::read_packed_row( std::vector<char>& out ) {
+   if( run.copy.value == 0 && run.literals.value == 0 ) {
+      SNAX_ASSERT(delta_more, snapshot_exception, "Attempting to read past the end of a section");
+      delta_more = delta->read_packed_row(row);
+      fc::datastream<const char*> ds( row.data(), row.size() );
+      fc::raw::unpack( ds, run );
+
+      for( uint32_t i = 0; i < run.skip.value; ++i ) {
+         SNAX_ASSERT(base_more, snapshot_exception, "Delta snapshot skips past the end of its base section");
+         base_more = base->read_packed_row(row);
+      }
+   }
+
+   if( run.copy.value > 0 ) {
+      SNAX_ASSERT(base_more, snapshot_exception, "Delta snapshot copies past the end of its base section");
+      base_more = base->read_packed_row(out);
+      --run.copy.value;
+   } else {
+      SNAX_ASSERT(delta_more, snapshot_exception, "Delta snapshot is missing rows of a run");
+      delta_more = delta->read_packed_row(out);
+      --run.literals.value;
+   }
+
+   return run.copy.value > 0 || run.literals.value > 0 || delta_more;
+}
+
+bool delta_snapshot_reader::read_row( detail::abstract_snapshot_row_reader& row_reader ) {
+   const bool more = read_packed_row(row);
+   fc::datastream<const char*> ds( row.data(), row.size() );
+   row_reader.provide( ds );
+   SNAX_ASSERT( ds.remaining() == 0, snapshot_exception, "Row of type ${t} does not match the size it was written with",
+                ("t", row_reader.row_type_name()) );
+   return more;
+}
+
+bool delta_snapshot_reader::empty ( ) {
+   return !delta_more && run.copy.value == 0 && run.literals.value == 0;
+}
+
+void delta_snapshot_reader::clear_section() {
+   base->clear_section();
+   delta->clear_section();
+   base_more = false;
+   delta_more = false;
+   run = detail::snapshot_delta_run();
+}
+
+std::vector<std::string> delta_snapshot_reader::section_names() {
+   auto names = delta->section_names();
+   names.erase( std::remove( names.begin(), names.end(), delta_snapshot_writer::header_section_name ), names.end() );
+   return names;
+}
+
+fc::sha256 delta_snapshot_reader::digest() {
+   fc::sha256::encoder enc;
+   fc::raw::pack( enc, base->digest() );
+   fc::raw::pack( enc, delta->digest() );
+   return enc.result();
+}
+
+void copy_snapshot( packed_snapshot_reader& from, snapshot_writer& to ) {
+   std::vector<char> row;
+   for( const auto& name : from.section_names() ) {
+      from.set_section(name);
+      to.write_start_section(name);
+      bool more = !from.empty();
+      while( more ) {
+         more = from.read_packed_row(row);
+         to.write_row(detail::packed_row_writer(row));
+      }
+      to.write_end_section();
+      from.clear_section();
+   }
+}
+
+fc::sha256 calculate_integrity_hash( packed_snapshot_reader& snapshot ) {
+   fc::sha256::encoder enc;
+   integrity_hash_snapshot_writer writer(enc);
+   copy_snapshot(snapshot, writer);
+   writer.finalize();
+   return enc.result();
+}
+
+}}
@@ -168,6 +168,9 @@ void apply_snax_setcode(apply_context& context) {
 
    });
 
+   if( code_size > 0 )
+      context.control.get_wasm_interface().compile_async( code_id, act.code, account.privileged );
+
    const auto& account_sequence = db.get<account_sequence_object, by_name>(act.account);
    db.modify( account_sequence, [&]( auto& aso ) {
       aso.code_sequence += 1;
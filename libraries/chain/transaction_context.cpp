@@ -159,6 +159,7 @@ namespace bacc = boost::accumulators;
    ,pseudo_start(s)
    {
       if (!c.skip_db_sessions()) {
+         if( auto* rows = c.row_hash_index() ) rows->sync();
          undo_session = c.mutable_db().start_undo_session(true);
       }
       trace->id = id;
@@ -410,6 +411,7 @@ namespace bacc = boost::accumulators;
 
    void transaction_context::undo() {
       if (undo_session) undo_session->undo();
+      table_reads.clear();
    }
 
    void transaction_context::check_net_usage()const {
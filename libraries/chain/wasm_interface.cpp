@@ -28,7 +28,9 @@ namespace snax { namespace chain {
    using namespace webassembly;
    using namespace webassembly::common;
 
-   wasm_interface::wasm_interface(vm_type vm) : my( new wasm_interface_impl(vm) ) {}
+   wasm_interface::wasm_interface(vm_type vm, const fc::path& code_cache_dir, uint64_t code_cache_size, uint16_t compile_threads,
+                                  uint64_t instantiation_cache_size)
+   : my( new wasm_interface_impl(vm, code_cache_dir, code_cache_size, compile_threads, instantiation_cache_size) ) {}
 
    wasm_interface::~wasm_interface() {}
 
@@ -54,12 +56,24 @@ namespace snax { namespace chain {
       //Hard: Kick off instantiation in a separate thread at this location
 	 }
 
+   void wasm_interface::compile_async( const digest_type& code_id, const bytes& code, bool pinned ) {
+      my->compile_async(code_id, code.data(), code.size(), pinned);
+   }
+
+   wasm_interface::compile_stats wasm_interface::get_compile_stats()const {
+      return my->get_compile_stats();
+   }
+
+   wasm_interface::cache_stats wasm_interface::get_cache_stats()const {
+      return my->instantiation_cache.stats();
+   }
+
    void wasm_interface::apply( const digest_type& code_id, const shared_string& code, apply_context& context ) {
-      my->get_instantiated_module(code_id, code, context.trx_context)->apply(context);
+      my->get_instantiated_module(code_id, code, context).apply(context);
    }
 
    void wasm_interface::exit() {
-      my->runtime_interface->immediately_exit_currently_running_module();
+      my->executing_runtime->immediately_exit_currently_running_module();
    }
 
    wasm_instantiated_module_interface::~wasm_instantiated_module_interface() {}
@@ -1253,6 +1267,13 @@ class database_api : public context_aware_api {
       int db_end_i64( uint64_t code, uint64_t scope, uint64_t table ) {
          return context.db_end_i64( code, scope, table );
       }
+      int db_get_many_i64( uint64_t code, uint64_t scope, uint64_t table, array_ptr<const uint64_t> ids, size_t count, array_ptr<int> iterators, size_t iterators_count, array_ptr<char> buffer, size_t buffer_size ) {
+         SNAX_ASSERT( iterators_count == count, invalid_table_batch, "the batch needs one iterator per primary key" );
+         return context.db_get_many_i64( code, scope, table, ids, iterators, count, buffer, buffer_size );
+      }
+      void db_update_many_i64( array_ptr<const int> iterators, size_t count, uint64_t payer, array_ptr<const char> buffer, size_t buffer_size ) {
+         context.db_update_many_i64( iterators, count, payer, buffer, buffer_size );
+      }
 
       DB_API_METHOD_WRAPPERS_SIMPLE_SECONDARY(idx64,  uint64_t)
       DB_API_METHOD_WRAPPERS_SIMPLE_SECONDARY(idx128, uint128_t)
@@ -1735,6 +1756,8 @@ REGISTER_INTRINSICS( database_api,
    (db_lowerbound_i64,   int(int64_t,int64_t,int64_t,int64_t))
    (db_upperbound_i64,   int(int64_t,int64_t,int64_t,int64_t))
    (db_end_i64,          int(int64_t,int64_t,int64_t))
+   (db_get_many_i64,     int(int64_t,int64_t,int64_t,int,int,int,int,int,int))
+   (db_update_many_i64,  void(int,int,int64_t,int,int))
 
    DB_SECONDARY_INDEX_METHODS_SIMPLE(idx64)
    DB_SECONDARY_INDEX_METHODS_SIMPLE(idx128)
@@ -18,8 +18,8 @@ namespace wasm_constraints = snax::chain::wasm_constraints;
 
 class wabt_instantiated_module : public wasm_instantiated_module_interface {
    public:
-      wabt_instantiated_module(std::unique_ptr<interp::Environment> e, std::vector<uint8_t> initial_mem, interp::DefinedModule* mod) :
-         _env(move(e)), _instatiated_module(mod), _initial_memory(initial_mem),
+      wabt_instantiated_module(std::unique_ptr<interp::Environment> e, std::vector<uint8_t> initial_mem, interp::DefinedModule* mod, size_t code_size) :
+         _env(move(e)), _instatiated_module(mod), _initial_memory(initial_mem), _code_size(code_size),
          _executor(_env.get(), nullptr, Thread::Options(64*1024,
                                                         wasm_constraints::maximum_call_depth+2))
       {
@@ -61,10 +61,16 @@ class wabt_instantiated_module : public wasm_instantiated_module_interface {
          SNAX_ASSERT( res.result == interp::Result::Ok, wasm_execution_error, "wabt execution failure (${s})", ("s", ResultToString(res.result)) );
       }
 
+      size_t resident_size() const override {
+         //the interpreter's instruction stream is about as large as the wasm it was read from
+         return _code_size + _initial_memory.size() + (_env->GetMemoryCount() ? _env->GetMemory(0)->data.size() : 0);
+      }
+
    private:
       std::unique_ptr<interp::Environment>              _env;
       DefinedModule*                                    _instatiated_module;  //this is owned by the Environment
       std::vector<uint8_t>                              _initial_memory;
+      size_t                                            _code_size;
       TypedValues                                       _params{3, TypedValue(Type::I64)};
       std::vector<std::pair<Global*, TypedValue>>       _initial_globals;
       Limits                                            _initial_memory_configuration;
@@ -93,7 +99,7 @@ std::unique_ptr<wasm_instantiated_module_interface> wabt_runtime::instantiate_mo
    wabt::Result res = ReadBinaryInterp(env.get(), code_bytes, code_size, read_binary_options, &errors, &instantiated_module);
    SNAX_ASSERT( Succeeded(res), wasm_execution_error, "Error building wabt interp: ${e}", ("e", wabt::FormatErrorsToString(errors, Location::Type::Binary)) );
    
-   return std::make_unique<wabt_instantiated_module>(std::move(env), initial_memory, instantiated_module);
+   return std::make_unique<wabt_instantiated_module>(std::move(env), initial_memory, instantiated_module, code_size);
 }
 
 void wabt_runtime::immediately_exit_currently_running_module() {
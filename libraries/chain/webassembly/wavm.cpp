@@ -1,4 +1,5 @@
 #include <snax/chain/webassembly/wavm.hpp>
+#include <snax/chain/webassembly/wavm_code_cache.hpp>
 #include <snax/chain/wasm_snax_constraints.hpp>
 #include <snax/chain/wasm_snax_injection.hpp>
 #include <snax/chain/apply_context.hpp>
@@ -13,6 +14,7 @@
 #include "Runtime/Intrinsics.h"
 
 #include <mutex>
+#include <set>
 
 using namespace IR;
 using namespace Runtime;
@@ -21,13 +23,39 @@ namespace snax { namespace chain { namespace webassembly { namespace wavm {
 
 running_instance_context the_running_instance_context;
 
+// WAVM keeps its objects in global lists; modules may be instantiated by the background compile threads
+static std::mutex                __instantiate_lock;
+// module instances still referenced by a wavm_instantiated_module, all the other WAVM objects are garbage
+static std::set<ModuleInstance*> __live_instances;
+static bool                      __has_garbage = false;
+
+//modules with at least this much initial memory have it reset copy-on-write; each of them holds a file descriptor
+static constexpr size_t          __copy_on_write_initial_memory_size = 64*1024;
+
 class wavm_instantiated_module : public wasm_instantiated_module_interface {
    public:
-      wavm_instantiated_module(ModuleInstance* instance, std::unique_ptr<Module> module, std::vector<uint8_t> initial_mem) :
+      wavm_instantiated_module(ModuleInstance* instance, std::unique_ptr<Module> module, std::vector<uint8_t> initial_mem, size_t code_size) :
          _initial_memory(initial_mem),
          _instance(instance),
-         _module(std::move(module))
-      {}
+         _module(std::move(module)),
+         _resident_size(code_size + _initial_memory.size() + getModuleInstanceCodeSize(instance))
+      {
+         if(_module->memories.defs.size() && _initial_memory.size() >= __copy_on_write_initial_memory_size)
+            _memory_image = createMemoryImage(_module->memories.defs[0].type, _initial_memory.data(), _initial_memory.size());
+      }
+
+      ~wavm_instantiated_module() {
+         //the instance is freed by the next garbage collection, see wavm_runtime::instantiate_module
+         std::lock_guard<std::mutex> l(__instantiate_lock);
+         __live_instances.erase(_instance);
+         __has_garbage = true;
+         if(_memory_image)
+            destroyMemoryImage(_memory_image);
+      }
+
+      size_t resident_size() const override {
+         return _resident_size;
+      }
 
       void apply(apply_context& context) override {
          vector<Value> args = {Value(uint64_t(context.receiver)),
@@ -49,7 +77,11 @@ class wavm_instantiated_module : public wasm_instantiated_module_interface {
             //The memory instance is reused across all wavm_instantiated_modules, but for wasm instances
             // that didn't declare "memory", getDefaultMemory() won't see it
             MemoryInstance* default_mem = getDefaultMemory(_instance);
-            if(default_mem) {
+            if(default_mem && _memory_image) {
+               //maps the module's initial memory copy-on-write; when the previous action ran this module too, only
+               // the pages it wrote are reverted
+               resetMemory(default_mem, _module->memories.defs[0].type, _memory_image);
+            } else if(default_mem) {
                //reset memory resizes the sandbox'ed memory to the module's init memory size and then
                // (effectively) memzeros it all
                resetMemory(default_mem, _module->memories.defs[0].type);
@@ -76,9 +108,12 @@ class wavm_instantiated_module : public wasm_instantiated_module_interface {
 
       std::vector<uint8_t>     _initial_memory;
       //naked pointer because ModuleInstance is opaque
-      //_instance is deleted via WAVM's object garbage collection when wavm_rutime is deleted
+      //_instance is deleted via WAVM's object garbage collection once it is no longer live, or when wavm_runtime is deleted
       ModuleInstance*          _instance;
       std::unique_ptr<Module>  _module;
+      size_t                   _resident_size;
+      //null for small initial memories, or when the platform can't map memory copy-on-write
+      MemoryImage*             _memory_image = nullptr;
 };
 
 
@@ -95,20 +130,36 @@ wavm_runtime::runtime_guard::~runtime_guard() {
 static weak_ptr<wavm_runtime::runtime_guard> __runtime_guard_ptr;
 static std::mutex __runtime_guard_lock;
 
-wavm_runtime::wavm_runtime() {
-   std::lock_guard<std::mutex> l(__runtime_guard_lock);
-   if (__runtime_guard_ptr.use_count() == 0) {
-      _runtime_guard = std::make_shared<runtime_guard>();
-      __runtime_guard_ptr = _runtime_guard;
-   } else {
-      _runtime_guard = __runtime_guard_ptr.lock();
+wavm_runtime::wavm_runtime( const fc::path& code_cache_dir, uint64_t code_cache_size ) {
+   {
+      std::lock_guard<std::mutex> l(__runtime_guard_lock);
+      if (__runtime_guard_ptr.use_count() == 0) {
+         _runtime_guard = std::make_shared<runtime_guard>();
+         __runtime_guard_ptr = _runtime_guard;
+      } else {
+         _runtime_guard = __runtime_guard_ptr.lock();
+      }
    }
+
+   if( code_cache_size > 0 )
+      _code_cache = std::make_unique<wavm_code_cache>( code_cache_dir, code_cache_size, getObjectCodeVersion() );
 }
 
 wavm_runtime::~wavm_runtime() {
 }
 
 std::unique_ptr<wasm_instantiated_module_interface> wavm_runtime::instantiate_module(const char* code_bytes, size_t code_size, std::vector<uint8_t> initial_memory) {
+   std::lock_guard<std::mutex> l(__instantiate_lock);
+
+   //free the machine code and other objects of the modules evicted from the instantiation cache
+   if(__has_garbage) {
+      std::vector<ObjectInstance*> roots;
+      for(ModuleInstance* live : __live_instances)
+         roots.push_back(asObject(live));
+      Runtime::freeUnreferencedObjects(std::move(roots));
+      __has_garbage = false;
+   }
+
    std::unique_ptr<Module> module = std::make_unique<Module>();
    try {
       Serialization::MemoryInputStream stream((const U8*)code_bytes, code_size);
@@ -121,10 +172,21 @@ std::unique_ptr<wasm_instantiated_module_interface> wavm_runtime::instantiate_mo
 
    snax::chain::webassembly::common::root_resolver resolver;
    LinkResult link_result = linkModule(*module, resolver);
-   ModuleInstance *instance = instantiateModule(*module, std::move(link_result.resolvedImports));
+   ModuleInstance *instance = nullptr;
+   if( _code_cache ) {
+      const auto wasm_id = digest_type::hash( code_bytes, code_size );
+      std::vector<U8> object_code = _code_cache->get( wasm_id );
+      bool compiled = false;
+      instance = instantiateModule(*module, std::move(link_result.resolvedImports), object_code, compiled);
+      if( instance && compiled )
+         _code_cache->put( wasm_id, object_code );
+   } else {
+      instance = instantiateModule(*module, std::move(link_result.resolvedImports));
+   }
    SNAX_ASSERT(instance != nullptr, wasm_exception, "Fail to Instantiate WAVM Module");
+   __live_instances.insert(instance);
 
-   return std::make_unique<wavm_instantiated_module>(instance, std::move(module), initial_memory);
+   return std::make_unique<wavm_instantiated_module>(instance, std::move(module), initial_memory, code_size);
 }
 
 void wavm_runtime::immediately_exit_currently_running_module() {
@@ -0,0 +1,169 @@
+#include <snax/chain/webassembly/wavm_code_cache.hpp>
+#include <snax/chain/exceptions.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/log/logger.hpp>
+
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <fstream>
+
+namespace snax { namespace chain { namespace webassembly { namespace wavm {
+
+namespace bfs = boost::filesystem;
+
+namespace {
+   const uint32_t    code_cache_magic = 0x43564e53; // "SNVC"
+   const char* const code_cache_extension = ".wavm";
+
+   struct code_cache_entry_header {
+      uint32_t      magic = code_cache_magic;
+      string        code_generator_version;
+      digest_type   wasm_id;
+      uint64_t      object_code_size = 0;
+      digest_type   checksum;
+   };
+}
+
+} } } } // snax::chain::webassembly::wavm
+
+FC_REFLECT( snax::chain::webassembly::wavm::code_cache_entry_header, (magic)(code_generator_version)(wasm_id)(object_code_size)(checksum) )
+
+namespace snax { namespace chain { namespace webassembly { namespace wavm {
+
+wavm_code_cache::wavm_code_cache( const fc::path& dir, uint64_t max_size, const string& code_generator_version )
+:_dir(dir)
+,_max_size(max_size)
+,_code_generator_version(code_generator_version)
+{
+   if( !fc::exists( _dir ) )
+      fc::create_directories( _dir );
+
+   // order the existing entries by their modification time, which is refreshed every time an entry is used
+   vector<pair<std::time_t, pair<digest_type, uint64_t>>> existing;
+   for( bfs::directory_iterator itr( _dir.generic_string() ), end; itr != end; ++itr ) {
+      const bfs::path& p = itr->path();
+      if( !bfs::is_regular_file( p ) ) continue;
+      if( p.extension() != code_cache_extension ) {
+         // left over by an interrupted put
+         if( p.extension() == ".tmp" ) bfs::remove( p );
+         continue;
+      }
+      try {
+         digest_type wasm_id( p.stem().string() );
+         existing.emplace_back( bfs::last_write_time( p ), make_pair( wasm_id, bfs::file_size( p ) ) );
+      } catch( const fc::exception& ) {
+         wlog( "ignoring unexpected file ${f} in code cache", ("f", p.string()) );
+      }
+   }
+   std::sort( existing.begin(), existing.end(), []( const auto& a, const auto& b ) { return a.first < b.first; } );
+
+   for( const auto& e : existing )
+      add( e.second.first, e.second.second );
+   evict( 0 );
+
+   ilog( "WAVM code cache in ${d}: ${n} compiled contracts, ${s} bytes",
+         ("d", _dir.generic_string())("n", _entries.size())("s", _size) );
+}
+
+fc::path wavm_code_cache::entry_path( const digest_type& wasm_id )const {
+   return _dir / (wasm_id.str() + code_cache_extension);
+}
+
+std::vector<uint8_t> wavm_code_cache::get( const digest_type& wasm_id ) {
+   std::vector<uint8_t> object_code;
+
+   auto itr = _entries.find( wasm_id );
+   if( itr == _entries.end() ) return object_code;
+
+   try {
+      const auto p = entry_path( wasm_id );
+      std::ifstream file( p.generic_string(), std::ios::in | std::ios::binary );
+      SNAX_ASSERT( file, wasm_exception, "unable to open cached code ${p}", ("p", p.generic_string()) );
+      vector<char> data( (std::istreambuf_iterator<char>( file )), std::istreambuf_iterator<char>() );
+
+      fc::datastream<const char*> ds( data.data(), data.size() );
+      code_cache_entry_header header;
+      fc::raw::unpack( ds, header );
+
+      if( header.magic == code_cache_magic && header.code_generator_version == _code_generator_version &&
+          header.wasm_id == wasm_id && header.object_code_size == (uint64_t)ds.remaining() &&
+          digest_type::hash( data.data() + ds.tellp(), ds.remaining() ) == header.checksum ) {
+         object_code.assign( data.data() + ds.tellp(), data.data() + data.size() );
+         _lru.splice( _lru.begin(), _lru, itr->second.lru_position );
+         bfs::last_write_time( p.generic_string(), std::time( nullptr ) );
+         return object_code;
+      }
+      wlog( "discarding invalid or outdated cached code for ${id}", ("id", wasm_id) );
+   } catch( const fc::exception& e ) {
+      wlog( "discarding unreadable cached code for ${id}: ${e}", ("id", wasm_id)("e", e.to_detail_string()) );
+   } catch( const std::exception& e ) {
+      wlog( "discarding unreadable cached code for ${id}: ${e}", ("id", wasm_id)("e", e.what()) );
+   }
+
+   remove( wasm_id );
+   object_code.clear();
+   return object_code;
+}
+
+void wavm_code_cache::put( const digest_type& wasm_id, const std::vector<uint8_t>& object_code ) {
+   code_cache_entry_header header;
+   header.code_generator_version = _code_generator_version;
+   header.wasm_id = wasm_id;
+   header.object_code_size = object_code.size();
+   header.checksum = digest_type::hash( (const char*)object_code.data(), object_code.size() );
+
+   const auto packed_header = fc::raw::pack( header );
+   const uint64_t entry_size = packed_header.size() + object_code.size();
+   if( entry_size > _max_size ) return;
+
+   remove( wasm_id );
+   evict( entry_size );
+
+   try {
+      // write to a temporary file first so that an interrupted write never leaves a truncated entry behind
+      const auto p = entry_path( wasm_id );
+      const auto tmp_path = _dir / (wasm_id.str() + ".tmp");
+      {
+         std::ofstream file( tmp_path.generic_string(), std::ios::out | std::ios::binary | std::ios::trunc );
+         file.write( packed_header.data(), packed_header.size() );
+         file.write( (const char*)object_code.data(), object_code.size() );
+         file.close();
+         SNAX_ASSERT( file, wasm_exception, "unable to write cached code ${p}", ("p", tmp_path.generic_string()) );
+      }
+      fc::rename( tmp_path, p );
+
+      add( wasm_id, entry_size );
+   } catch( const fc::exception& e ) {
+      wlog( "unable to cache compiled code for ${id}: ${e}", ("id", wasm_id)("e", e.to_detail_string()) );
+   } catch( const std::exception& e ) {
+      wlog( "unable to cache compiled code for ${id}: ${e}", ("id", wasm_id)("e", e.what()) );
+   }
+}
+
+void wavm_code_cache::add( const digest_type& wasm_id, uint64_t size ) {
+   _lru.push_front( wasm_id );
+   _entries[wasm_id] = entry{ size, _lru.begin() };
+   _size += size;
+}
+
+void wavm_code_cache::remove( const digest_type& wasm_id ) {
+   auto itr = _entries.find( wasm_id );
+   if( itr == _entries.end() ) return;
+
+   _size -= itr->second.size;
+   _lru.erase( itr->second.lru_position );
+   _entries.erase( itr );
+
+   boost::system::error_code ec;
+   bfs::remove( entry_path( wasm_id ).generic_string(), ec );
+}
+
+void wavm_code_cache::evict( uint64_t needed ) {
+   while( !_lru.empty() && _size + needed > _max_size ) {
+      const digest_type wasm_id = _lru.back();
+      dlog( "evicting cached code for ${id}", ("id", wasm_id) );
+      remove( wasm_id );
+   }
+}
+
+} } } } // snax::chain::webassembly::wavm
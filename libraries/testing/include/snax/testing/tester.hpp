@@ -348,6 +348,8 @@ namespace snax { namespace testing {
          vcfg.reversible_cache_size = 1024*1024*8;
          vcfg.reversible_guard_size = 0;
          vcfg.contracts_console = false;
+         vcfg.wasm_compile_threads = 0;
+         vcfg.code_cache_size = 0;
 
          vcfg.genesis.initial_timestamp = fc::time_point::from_iso_string("2020-01-01T00:00:00.000");
          vcfg.genesis.initial_key = get_public_key( config::system_account_name, "active" );
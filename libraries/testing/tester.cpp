@@ -92,6 +92,9 @@ namespace snax { namespace testing {
       cfg.reversible_guard_size = 0;
       cfg.contracts_console = true;
       cfg.read_mode = read_mode;
+      // contracts are compiled where they are first applied, so that tests do not depend on when a compilation finishes
+      cfg.wasm_compile_threads = 0;
+      cfg.code_cache_size = 0;
 
       cfg.genesis.initial_timestamp = fc::time_point::from_iso_string("2020-01-01T00:00:00.000");
       cfg.genesis.initial_key = get_public_key( config::system_account_name, "active" );
@@ -94,6 +94,25 @@ namespace Platform
 	// baseVirtualAddress must be a multiple of the preferred page size.
 	PLATFORM_API void freeVirtualPages(U8* baseVirtualAddress,Uptr numPages);
 
+	// An immutable snapshot of memory contents that can be mapped copy-on-write into virtual pages.
+	struct MemorySnapshot;
+
+	// Creates a snapshot of numPages pages holding the numBytes bytes at data followed by zeros.
+	// Returns nullptr if the platform doesn't support snapshots.
+	PLATFORM_API MemorySnapshot* createMemorySnapshot(const U8* data,Uptr numBytes,Uptr numPages);
+	PLATFORM_API void destroyMemorySnapshot(MemorySnapshot* snapshot);
+	PLATFORM_API Uptr getMemorySnapshotNumPages(MemorySnapshot* snapshot);
+
+	// Maps the snapshot copy-on-write at the specified virtual pages, which must have been allocated by allocateVirtualPages.
+	// If the snapshot is already mapped there, only the pages written to since are reverted to the snapshot, so the cost
+	// scales with the number of pages written rather than with the size of the snapshot.
+	// baseVirtualAddress must be a multiple of the preferred page size.
+	PLATFORM_API bool mapMemorySnapshot(MemorySnapshot* snapshot,U8* baseVirtualAddress,bool isMapped);
+
+	// Replaces a snapshot mapped by mapMemorySnapshot with committed, zeroed pages.
+	// baseVirtualAddress must be a multiple of the preferred page size.
+	PLATFORM_API void unmapMemorySnapshot(U8* baseVirtualAddress,Uptr numPages);
+
 	//
 	// Call stack and exceptions
 	//
@@ -93,6 +93,12 @@ namespace Intrinsics
 	// Finds an intrinsic object by name and type.
 	RUNTIME_API Runtime::ObjectInstance* find(const std::string& name,const IR::ObjectType& type);
 
+	// Returns the name of an intrinsic object decorated with its type, which uniquely identifies it.
+	RUNTIME_API std::string getDecoratedName(const std::string& name,const IR::ObjectType& type);
+
+	// Finds an intrinsic function by its decorated name.
+	RUNTIME_API Runtime::FunctionInstance* findFunctionByDecoratedName(const std::string& decoratedName);
+
 	// Returns an array of all intrinsic runtime Objects; used as roots for garbage collection.
 	RUNTIME_API std::vector<Runtime::ObjectInstance*> getAllIntrinsicObjects();
 }
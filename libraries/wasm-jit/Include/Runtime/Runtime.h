@@ -168,6 +168,14 @@ namespace Runtime
 
 	// Validates that an offset range is wholly inside a Memory's virtual address range.
 	RUNTIME_API U8* getValidatedMemoryOffsetRange(MemoryInstance* memory,Uptr offset,Uptr numBytes);
+
+	// An image of the initial contents of a memory, which memories can be reset to copy-on-write.
+	struct MemoryImage;
+
+	// Creates an image of a memory of the given type's minimum size, holding numBytes of data followed by zeros.
+	// Returns null if the platform doesn't support copy-on-write memory images.
+	RUNTIME_API MemoryImage* createMemoryImage(const IR::MemoryType& type,const U8* data,Uptr numBytes);
+	RUNTIME_API void destroyMemoryImage(MemoryImage* image);
 	
 	// Validates an access to a single element of memory at the given offset, and returns a reference to it.
 	template<typename Value> Value& memoryRef(MemoryInstance* memory,U32 offset)
@@ -205,14 +213,28 @@ namespace Runtime
 	// Instantiates a module, bindings its imports to the specified objects. May throw InstantiationException.
 	RUNTIME_API ModuleInstance* instantiateModule(const IR::Module& module,ImportBindings&& imports);
 
+	// Instantiates a module like instantiateModule, but reuses the machine code in objectCode if it holds the object code
+	// the module was previously compiled to by a code generator of the same version (see getObjectCodeVersion).
+	// Otherwise, the module is compiled, objectCode is replaced by the object code it was compiled to and outCompiled is set.
+	RUNTIME_API ModuleInstance* instantiateModule(const IR::Module& module,ImportBindings&& imports,std::vector<U8>& objectCode,bool& outCompiled);
+
+	// Identifies the code generator; object code is only reusable by a runtime with the same version.
+	RUNTIME_API std::string getObjectCodeVersion();
+
 	// Gets the default table/memory for a ModuleInstance.
 	RUNTIME_API MemoryInstance* getDefaultMemory(ModuleInstance* moduleInstance);
 	RUNTIME_API uint64_t getDefaultMemorySize(ModuleInstance* moduleInstance);
 	RUNTIME_API TableInstance* getDefaultTable(ModuleInstance* moduleInstance);
 
+	// Gets the number of bytes of memory holding the machine code a ModuleInstance was compiled to.
+	RUNTIME_API Uptr getModuleInstanceCodeSize(ModuleInstance* moduleInstance);
+
 	RUNTIME_API void runInstanceStartFunc(ModuleInstance* moduleInstance);
 	RUNTIME_API void resetGlobalInstances(ModuleInstance* moduleInstance);
 	RUNTIME_API void resetMemory(MemoryInstance* memory, IR::MemoryType& newMemoryType);
+	// Resets a memory to the image created for newMemoryType. If the memory was last reset to the same image, only the pages
+	// written to since are copied again.
+	RUNTIME_API void resetMemory(MemoryInstance* memory, IR::MemoryType& newMemoryType, MemoryImage* image);
 
 	// Gets an object exported by a ModuleInstance by name.
 	RUNTIME_API ObjectInstance* getInstanceExport(ModuleInstance* moduleInstance,const std::string& name);
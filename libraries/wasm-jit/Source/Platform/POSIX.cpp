@@ -7,6 +7,9 @@
 #include <pthread.h>
 #include <unistd.h>
 #include <sys/mman.h>
+#include <sys/syscall.h>
+#include <stdio.h>
+#include <stdlib.h>
 
 #include <errno.h>
 #include <signal.h>
@@ -28,6 +31,9 @@
 #ifdef __linux__
 	#include <execinfo.h>
 	#include <dlfcn.h>
+	#ifndef MFD_CLOEXEC
+		#define MFD_CLOEXEC 0x0001U
+	#endif
 #endif
 #ifdef __FreeBSD__
 	#include <execinfo.h>
@@ -107,6 +113,79 @@ namespace Platform
 		if(munmap(baseVirtualAddress,numPages << getPageSizeLog2())) { Errors::fatal("munmap failed"); }
 	}
 
+	// The snapshot is held by an unlinked file, so the kernel shares its pages between all the mappings of it.
+	struct MemorySnapshot
+	{
+		int fd;
+		Uptr numPages;
+	};
+
+	static int createAnonymousFile()
+	{
+		#if defined(__linux__) && defined(SYS_memfd_create)
+			int fd = (int)syscall(SYS_memfd_create,"wavm-memory-snapshot",MFD_CLOEXEC);
+			if(fd >= 0) { return fd; }
+		#endif
+		std::string path = std::string(P_tmpdir) + "/wavm-memory-snapshot-XXXXXX";
+		int fd = mkstemp(&path[0]);
+		if(fd >= 0) { unlink(path.c_str()); }
+		return fd;
+	}
+
+	MemorySnapshot* createMemorySnapshot(const U8* data,Uptr numBytes,Uptr numPages)
+	{
+		const Uptr numSnapshotBytes = numPages << getPageSizeLog2();
+		errorUnless(numBytes <= numSnapshotBytes);
+
+		const int fd = createAnonymousFile();
+		if(fd < 0) { return nullptr; }
+
+		// The file is sparse: the pages past the data read as zeros without being stored.
+		bool succeeded = ftruncate(fd,numSnapshotBytes) == 0;
+		for(Uptr offset = 0;succeeded && offset < numBytes;)
+		{
+			const ssize_t numWritten = pwrite(fd,data + offset,numBytes - offset,offset);
+			if(numWritten < 0 && errno == EINTR) { continue; }
+			succeeded = numWritten > 0;
+			if(succeeded) { offset += numWritten; }
+		}
+		if(!succeeded)
+		{
+			close(fd);
+			return nullptr;
+		}
+		return new MemorySnapshot {fd,numPages};
+	}
+
+	void destroyMemorySnapshot(MemorySnapshot* snapshot)
+	{
+		// Mappings of the snapshot keep its file alive until they are unmapped.
+		close(snapshot->fd);
+		delete snapshot;
+	}
+
+	Uptr getMemorySnapshotNumPages(MemorySnapshot* snapshot) { return snapshot->numPages; }
+
+	bool mapMemorySnapshot(MemorySnapshot* snapshot,U8* baseVirtualAddress,bool isMapped)
+	{
+		errorUnless(isPageAligned(baseVirtualAddress));
+		const Uptr numBytes = snapshot->numPages << getPageSizeLog2();
+		if(!numBytes) { return true; }
+		#ifdef __linux__
+			// Discarding the private copies of a private file mapping's pages makes them read the file again.
+			if(isMapped) { return madvise(baseVirtualAddress,numBytes,MADV_DONTNEED) == 0; }
+		#endif
+		auto result = mmap(baseVirtualAddress,numBytes,PROT_READ | PROT_WRITE,MAP_PRIVATE | MAP_FIXED,snapshot->fd,0);
+		return result != MAP_FAILED;
+	}
+
+	void unmapMemorySnapshot(U8* baseVirtualAddress,Uptr numPages)
+	{
+		errorUnless(isPageAligned(baseVirtualAddress));
+		auto result = mmap(baseVirtualAddress,numPages << getPageSizeLog2(),PROT_READ | PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED,-1,0);
+		if(result == MAP_FAILED) { Errors::fatal("mmap failed"); }
+	}
+
 	bool describeInstructionPointer(Uptr ip,std::string& outDescription)
 	{
 		#if defined __linux__ || defined __FreeBSD__
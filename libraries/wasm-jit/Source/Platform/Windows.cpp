@@ -85,6 +85,12 @@ namespace Platform
 		if(baseVirtualAddress && !result) { Errors::fatal("VirtualFree(MEM_RELEASE) failed"); }
 	}
 
+	MemorySnapshot* createMemorySnapshot(const U8* data,Uptr numBytes,Uptr numPages) { return nullptr; }
+	void destroyMemorySnapshot(MemorySnapshot* snapshot) { Errors::unreachable(); }
+	Uptr getMemorySnapshotNumPages(MemorySnapshot* snapshot) { Errors::unreachable(); }
+	bool mapMemorySnapshot(MemorySnapshot* snapshot,U8* baseVirtualAddress,bool isMapped) { Errors::unreachable(); }
+	void unmapMemorySnapshot(U8* baseVirtualAddress,Uptr numPages) { Errors::unreachable(); }
+
 	// The interface to the DbgHelp DLL
 	struct DbgHelp
 	{
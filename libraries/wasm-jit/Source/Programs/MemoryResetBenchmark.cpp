@@ -0,0 +1,105 @@
+#include "Inline/BasicTypes.h"
+#include "Inline/Timing.h"
+#include "Platform/Platform.h"
+#include "CLI.h"
+#include "Runtime/Runtime.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <vector>
+
+using namespace IR;
+using namespace Runtime;
+
+// Compares resetting a memory by clearing it and copying its initial data back in, with resetting it to a copy-on-write
+// image of its initial data, for a varying number of pages written between two resets.
+
+static void writePages(MemoryInstance* memory,Uptr numPages,Uptr iteration)
+{
+	U8* baseAddress = getMemoryBaseAddress(memory);
+	const Uptr pageSize = Uptr(1) << Platform::getPageSizeLog2();
+	const Uptr memoryPages = (getMemoryNumPages(memory) << IR::numBytesPerPageLog2) / pageSize;
+	for(Uptr pageIndex = 0;pageIndex < numPages && pageIndex < memoryPages;++pageIndex)
+	{
+		// Spread the written pages over the memory.
+		baseAddress[(pageIndex * memoryPages / numPages) * pageSize] = U8(iteration);
+	}
+}
+
+int commandMain(int argc,char** argv)
+{
+	if(argc > 4)
+	{
+		std::cerr << "Usage: MemoryResetBenchmark [memory pages] [initial data KiB] [iterations]" << std::endl;
+		return EXIT_FAILURE;
+	}
+	const Uptr numMemoryPages = argc > 1 ? std::strtoull(argv[1],nullptr,10) : 33;
+	const Uptr numInitialBytes = (argc > 2 ? std::strtoull(argv[2],nullptr,10) : 1024) * 1024;
+	const Uptr numIterations = argc > 3 ? std::strtoull(argv[3],nullptr,10) : 10000;
+
+	MemoryType memoryType(false,SizeConstraints {numMemoryPages,numMemoryPages * 16});
+	if(numInitialBytes > (numMemoryPages << IR::numBytesPerPageLog2))
+	{
+		std::cerr << "The initial data doesn't fit in the memory" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::vector<U8> initialData(numInitialBytes);
+	for(Uptr index = 0;index < initialData.size();++index) { initialData[index] = U8(index * 7); }
+
+	MemoryInstance* memory = createMemory(memoryType);
+	if(!memory)
+	{
+		std::cerr << "Failed to create the memory" << std::endl;
+		return EXIT_FAILURE;
+	}
+	MemoryImage* image = createMemoryImage(memoryType,initialData.data(),initialData.size());
+	if(!image) { std::cerr << "Copy-on-write memory images aren't supported on this platform" << std::endl; }
+
+	std::cout << numMemoryPages << " wasm pages of memory, " << numInitialBytes / 1024 << " KiB of initial data, "
+		<< numIterations << " resets" << std::endl;
+	std::cout << std::setw(16) << "pages written" << std::setw(16) << "copy (us)" << std::setw(16) << "mapped (us)" << std::endl;
+
+	const Uptr totalPlatformPages = (numMemoryPages << IR::numBytesPerPageLog2) >> Platform::getPageSizeLog2();
+	for(Uptr numWrittenPages : {Uptr(0),Uptr(1),Uptr(4),Uptr(16),Uptr(64),Uptr(256),totalPlatformPages})
+	{
+		if(numWrittenPages > totalPlatformPages) { continue; }
+
+		Timing::Timer copyTimer;
+		for(Uptr iteration = 0;iteration < numIterations;++iteration)
+		{
+			resetMemory(memory,memoryType);
+			memcpy(getMemoryBaseAddress(memory),initialData.data(),initialData.size());
+			writePages(memory,numWrittenPages,iteration);
+		}
+		const F64 copyMicroseconds = F64(copyTimer.getMicroseconds()) / numIterations;
+
+		F64 mappedMicroseconds = 0;
+		if(image)
+		{
+			Timing::Timer mappedTimer;
+			for(Uptr iteration = 0;iteration < numIterations;++iteration)
+			{
+				resetMemory(memory,memoryType,image);
+				writePages(memory,numWrittenPages,iteration);
+			}
+			mappedMicroseconds = F64(mappedTimer.getMicroseconds()) / numIterations;
+
+			// Check that the reset restored the initial data.
+			resetMemory(memory,memoryType,image);
+			if(memcmp(getMemoryBaseAddress(memory),initialData.data(),initialData.size()))
+			{
+				std::cerr << "The copy-on-write reset didn't restore the initial data" << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+
+		std::cout << std::setw(16) << numWrittenPages
+			<< std::setw(16) << std::fixed << std::setprecision(2) << copyMicroseconds
+			<< std::setw(16) << mappedMicroseconds << std::endl;
+	}
+
+	if(image) { destroyMemoryImage(image); }
+	return EXIT_SUCCESS;
+}
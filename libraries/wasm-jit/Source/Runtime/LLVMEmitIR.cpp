@@ -37,6 +37,23 @@ namespace LLVMJIT
 		llvm::MDNode* likelyFalseBranchWeights;
 		llvm::MDNode* likelyTrueBranchWeights;
 
+		// Emits a reference to an object of the module instance through an external symbol resolved when the module's
+		// object code is loaded (see resolveInstanceSymbol).
+		llvm::GlobalVariable* getInstanceSymbol(const std::string& name)
+		{
+			auto global = llvmModule->getNamedGlobal(name);
+			if(!global) { global = new llvm::GlobalVariable(*llvmModule,llvmI8Type,true,llvm::GlobalVariable::ExternalLinkage,nullptr,name); }
+			return global;
+		}
+		llvm::Constant* emitInstancePointer(const std::string& name,llvm::Type* type)
+		{
+			return llvm::ConstantExpr::getPointerCast(getInstanceSymbol(name),type);
+		}
+		llvm::Constant* emitInstanceValue(const std::string& name,llvm::Type* type)
+		{
+			return llvm::ConstantExpr::getPtrToInt(getInstanceSymbol(name),type);
+		}
+
 		EmitModuleContext(const Module& inModule,ModuleInstance* inModuleInstance)
 		: module(inModule)
 		, moduleInstance(inModuleInstance)
@@ -306,7 +323,9 @@ namespace LLVMJIT
 			WAVM_ASSERT_THROW(intrinsicObject);
 			FunctionInstance* intrinsicFunction = asFunction(intrinsicObject);
 			WAVM_ASSERT_THROW(intrinsicFunction->type == intrinsicType);
-			auto intrinsicFunctionPointer = emitLiteralPointer(intrinsicFunction->nativeFunction,asLLVMType(intrinsicType)->getPointerTo());
+			auto intrinsicFunctionPointer = moduleContext.emitInstancePointer(
+				intrinsicSymbolPrefix + Intrinsics::getDecoratedName(intrinsicName,intrinsicType),
+				asLLVMType(intrinsicType)->getPointerTo());
 			return irBuilder.CreateCall(intrinsicFunctionPointer,llvm::ArrayRef<llvm::Value*>(args.begin(),args.end()));
 		}
 
@@ -687,7 +706,7 @@ namespace LLVMJIT
 			// Load the type for this table entry.
 			auto functionTypePointerPointer = irBuilder.CreateInBoundsGEP(moduleContext.defaultTablePointer,{functionIndexZExt,emitLiteral((U32)0)});
 			auto functionTypePointer = irBuilder.CreateLoad(functionTypePointerPointer);
-			auto llvmCalleeType = emitLiteralPointer(calleeType,llvmI8PtrType);
+			auto llvmCalleeType = moduleContext.emitInstancePointer(typeSymbolPrefix + std::to_string(imm.type.index),llvmI8PtrType);
 			
 			// If the function type doesn't match, trap.
 			emitConditionalTrapIntrinsic(
@@ -696,7 +715,7 @@ namespace LLVMJIT
 				FunctionType::get(ResultType::none,{ValueType::i32,ValueType::i64,ValueType::i64}),
 				{	tableElementIndex,
 					irBuilder.CreatePtrToInt(llvmCalleeType,llvmI64Type),
-					emitLiteral(reinterpret_cast<U64>(moduleContext.moduleInstance->defaultTable))	}
+					moduleContext.emitInstanceValue(defaultTableSymbolName,llvmI64Type)	}
 				);
 
 			// Call the function loaded from the table.
@@ -750,7 +769,7 @@ namespace LLVMJIT
 		void grow_memory(MemoryImm)
 		{
 			auto deltaNumPages = pop();
-			auto defaultMemoryObjectAsI64 = emitLiteral(reinterpret_cast<U64>(moduleContext.moduleInstance->defaultMemory));
+			auto defaultMemoryObjectAsI64 = moduleContext.emitInstanceValue(defaultMemorySymbolName,llvmI64Type);
 			auto previousNumPages = emitRuntimeIntrinsic(
 				"wavmIntrinsics.growMemory",
 				FunctionType::get(ResultType::i32,{ValueType::i32,ValueType::i64}),
@@ -759,7 +778,7 @@ namespace LLVMJIT
 		}
 		void current_memory(MemoryImm)
 		{
-			auto defaultMemoryObjectAsI64 = emitLiteral(reinterpret_cast<U64>(moduleContext.moduleInstance->defaultMemory));
+			auto defaultMemoryObjectAsI64 = moduleContext.emitInstanceValue(defaultMemorySymbolName,llvmI64Type);
 			auto currentNumPages = emitRuntimeIntrinsic(
 				"wavmIntrinsics.currentMemory",
 				FunctionType::get(ResultType::i32,{ValueType::i64}),
@@ -1234,7 +1253,7 @@ namespace LLVMJIT
 		{
 			auto numWaiters = pop();
 			auto address = pop();
-			auto defaultMemoryObjectAsI64 = emitLiteral(reinterpret_cast<U64>(moduleContext.moduleInstance->defaultMemory));
+			auto defaultMemoryObjectAsI64 = moduleContext.emitInstanceValue(defaultMemorySymbolName,llvmI64Type);
 			push(emitRuntimeIntrinsic(
 				"wavmIntrinsics.wake",
 				FunctionType::get(ResultType::i32,{ValueType::i32,ValueType::i32,ValueType::i64}),
@@ -1245,7 +1264,7 @@ namespace LLVMJIT
 			auto timeout = pop();
 			auto expectedValue = pop();
 			auto address = pop();
-			auto defaultMemoryObjectAsI64 = emitLiteral(reinterpret_cast<U64>(moduleContext.moduleInstance->defaultMemory));
+			auto defaultMemoryObjectAsI64 = moduleContext.emitInstanceValue(defaultMemorySymbolName,llvmI64Type);
 			push(emitRuntimeIntrinsic(
 				"wavmIntrinsics.wait",
 				FunctionType::get(ResultType::i32,{ValueType::i32,ValueType::i32,ValueType::f64,ValueType::i64}),
@@ -1256,7 +1275,7 @@ namespace LLVMJIT
 			auto timeout = pop();
 			auto expectedValue = pop();
 			auto address = pop();
-			auto defaultMemoryObjectAsI64 = emitLiteral(reinterpret_cast<U64>(moduleContext.moduleInstance->defaultMemory));
+			auto defaultMemoryObjectAsI64 = moduleContext.emitInstanceValue(defaultMemorySymbolName,llvmI64Type);
 			push(emitRuntimeIntrinsic(
 				"wavmIntrinsics.wait",
 				FunctionType::get(ResultType::i32,{ValueType::i32,ValueType::i64,ValueType::f64,ValueType::i64}),
@@ -1269,7 +1288,7 @@ namespace LLVMJIT
 			auto errorFunctionIndex = pop();
 			auto argument = pop();
 			auto functionIndex = pop();
-			auto defaultTableAsI64 = emitLiteral(reinterpret_cast<U64>(moduleContext.moduleInstance->defaultTable));
+			auto defaultTableAsI64 = moduleContext.emitInstanceValue(defaultTableSymbolName,llvmI64Type);
 			emitRuntimeIntrinsic(
 				"wavmIntrinsics.launchThread",
 				FunctionType::get(ResultType::none,{ValueType::i32,ValueType::i32,ValueType::i32,ValueType::i64}),
@@ -1580,9 +1599,8 @@ namespace LLVMJIT
 		// Create literals for the default memory base and mask.
 		if(moduleInstance->defaultMemory)
 		{
-			defaultMemoryBase = emitLiteralPointer(moduleInstance->defaultMemory->baseAddress,llvmI8PtrType);
-			const Uptr defaultMemoryEndOffsetValue = Uptr(moduleInstance->defaultMemory->endOffset);
-			defaultMemoryEndOffset = emitLiteral(defaultMemoryEndOffsetValue);
+			defaultMemoryBase = emitInstancePointer(defaultMemoryBaseSymbolName,llvmI8PtrType);
+			defaultMemoryEndOffset = emitInstanceValue(defaultMemoryEndOffsetSymbolName,sizeof(Uptr) == 8 ? llvmI64Type : llvmI32Type);
 		}
 		else { defaultMemoryBase = defaultMemoryEndOffset = nullptr; }
 
@@ -1593,8 +1611,8 @@ namespace LLVMJIT
 				llvmI8PtrType,
 				llvmI8PtrType
 				});
-			defaultTablePointer = emitLiteralPointer(moduleInstance->defaultTable->baseAddress,tableElementType->getPointerTo());
-			defaultTableMaxElementIndex = emitLiteral(((Uptr)moduleInstance->defaultTable->endOffset)/sizeof(TableInstance::FunctionElement));
+			defaultTablePointer = emitInstancePointer(defaultTableBaseSymbolName,tableElementType->getPointerTo());
+			defaultTableMaxElementIndex = emitInstanceValue(defaultTableMaxElementIndexSymbolName,sizeof(Uptr) == 8 ? llvmI64Type : llvmI32Type);
 		}
 		else
 		{
@@ -1605,12 +1623,15 @@ namespace LLVMJIT
 		for(Uptr functionIndex = 0;functionIndex < module.functions.imports.size();++functionIndex)
 		{
 			const FunctionInstance* functionInstance = moduleInstance->functions[functionIndex];
-			importedFunctionPointers.push_back(emitLiteralPointer(functionInstance->nativeFunction,asLLVMType(functionInstance->type)->getPointerTo()));
+			importedFunctionPointers.push_back(emitInstancePointer(importedFunctionSymbolPrefix + std::to_string(functionIndex),asLLVMType(functionInstance->type)->getPointerTo()));
 		}
 
 		// Create LLVM pointer constants for the module's globals.
-		for(auto global : moduleInstance->globals)
-		{ globalPointers.push_back(emitLiteralPointer(&global->value,asLLVMType(global->type.valueType)->getPointerTo())); }
+		for(Uptr globalIndex = 0;globalIndex < moduleInstance->globals.size();++globalIndex)
+		{
+			const GlobalInstance* global = moduleInstance->globals[globalIndex];
+			globalPointers.push_back(emitInstancePointer(globalSymbolPrefix + std::to_string(globalIndex),asLLVMType(global->type.valueType)->getPointerTo()));
+		}
 		
 		// Create the LLVM functions.
 		functionDefs.resize(module.functions.defs.size());
@@ -25,6 +25,12 @@
 #include "llvm-c/Disassembler.h"
 #endif
 
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+// Bump when a change to the code generator makes previously generated object code incompatible.
+#define OBJECT_CODE_FORMAT_VERSION 1
+
 namespace LLVMJIT
 {
 	llvm::LLVMContext context;
@@ -57,8 +63,24 @@ namespace LLVMJIT
 	std::map<Uptr,struct JITSymbol*> addressToSymbolMap;
 
 	// A map from function types to function indices in the invoke thunk unit.
+	Platform::Mutex* invokeThunkMapMutex = Platform::createMutex();
 	std::map<const FunctionType*,struct JITSymbol*> invokeThunkTypeToSymbolMap;
 
+	// Serializes code generation, which uses the global LLVM context, so modules may be compiled on a different
+	// thread than the one executing previously compiled code.
+	Platform::Mutex* compileMutex = Platform::createMutex();
+
+	const char* const defaultMemorySymbolName = "wavmDefaultMemory";
+	const char* const defaultMemoryBaseSymbolName = "wavmDefaultMemoryBase";
+	const char* const defaultMemoryEndOffsetSymbolName = "wavmDefaultMemoryEndOffset";
+	const char* const defaultTableSymbolName = "wavmDefaultTable";
+	const char* const defaultTableBaseSymbolName = "wavmDefaultTableBase";
+	const char* const defaultTableMaxElementIndexSymbolName = "wavmDefaultTableMaxElementIndex";
+	const char* const importedFunctionSymbolPrefix = "wavmImportedFunction";
+	const char* const globalSymbolPrefix = "wavmGlobal";
+	const char* const typeSymbolPrefix = "wavmType";
+	const char* const intrinsicSymbolPrefix = "wavmIntrinsic:";
+
 	// Information about a JIT symbol, used to map instruction pointers to descriptive names.
 	struct JITSymbol
 	{
@@ -169,6 +191,7 @@ namespace LLVMJIT
 		}
 
 		U8* getImageBaseAddress() const { return imageBaseAddress; }
+		Uptr getNumImageBytes() const { return numAllocatedImagePages << Platform::getPageSizeLog2(); }
 
 	private:
 		struct Section
@@ -238,10 +261,19 @@ namespace LLVMJIT
 			#endif
 		}
 
-		void compile(llvm::Module* llvmModule);
+		// Compiles the module, storing the object code it was compiled to in outObjectCode if it isn't null.
+		void compile(llvm::Module* llvmModule,std::vector<U8>* outObjectCode = nullptr);
+
+		// Loads previously compiled object code. Returns false without loading anything if it isn't valid object code
+		// or references symbols the unit can't resolve.
+		bool load(const std::vector<U8>& objectCode);
 
 		virtual void notifySymbolLoaded(const char* name,Uptr baseAddress,Uptr numBytes,std::map<U32,U32>&& offsetToOpIndexMap) = 0;
 
+		// The resolver for the external symbols referenced by the unit's object code.
+		virtual llvm::JITSymbolResolver& getSymbolResolver();
+		virtual bool canResolveSymbol(const std::string& name);
+
 	private:
 		
 		// Functor that receives notifications when an object produced by the JIT is loaded.
@@ -272,6 +304,7 @@ namespace LLVMJIT
 		CompileLayer::ModuleSetHandleT handle;
 		bool handleIsValid = false;
 		bool shouldLogMetrics;
+		std::vector<U8>* objectCodeCopy = nullptr;
 
 		struct LoadedObject
 		{
@@ -286,14 +319,42 @@ namespace LLVMJIT
 		#endif
 	};
 
+	// Used to override LLVM's default behavior of looking up unresolved symbols in DLL exports.
+	struct NullResolver : llvm::JITSymbolResolver
+	{
+		static NullResolver singleton;
+		virtual llvm::JITSymbol findSymbol(const std::string& name) override;
+		virtual llvm::JITSymbol findSymbolInLogicalDylib(const std::string& name) override;
+	};
+
 	// The JIT compilation unit for a WebAssembly module instance.
 	struct JITModule : JITUnit, JITModuleBase
 	{
+		// Resolves the symbols through which the module's code references the objects of its module instance.
+		struct InstanceResolver : llvm::JITSymbolResolver
+		{
+			JITModule* jitModule;
+			InstanceResolver(JITModule* inJITModule): jitModule(inJITModule) {}
+			virtual llvm::JITSymbol findSymbol(const std::string& name) override
+			{
+				Uptr value;
+				WAVM_ASSERT_THROW(jitModule->module);
+				if(resolveInstanceSymbol(*jitModule->module,jitModule->moduleInstance,name,value))
+				{ return llvm::JITSymbol(value,llvm::JITSymbolFlags::None); }
+				return NullResolver::singleton.findSymbol(name);
+			}
+			virtual llvm::JITSymbol findSymbolInLogicalDylib(const std::string& name) override { return llvm::JITSymbol(nullptr); }
+		};
+
 		ModuleInstance* moduleInstance;
 
+		// The module the instance was instantiated from; only set while the module's code is compiled or loaded.
+		const IR::Module* module = nullptr;
+		InstanceResolver instanceResolver;
+
 		std::vector<JITSymbol*> functionDefSymbols;
 
-		JITModule(ModuleInstance* inModuleInstance): moduleInstance(inModuleInstance) {}
+		JITModule(ModuleInstance* inModuleInstance): moduleInstance(inModuleInstance), instanceResolver(this) {}
 		~JITModule() override
 		{
 			// Delete the module's symbols, and remove them from the global address-to-symbol map.
@@ -324,6 +385,16 @@ namespace LLVMJIT
 				}
 			}
 		}
+
+		Uptr getNumImageBytes() const override { return memoryManager.getNumImageBytes(); }
+
+		llvm::JITSymbolResolver& getSymbolResolver() override { return instanceResolver; }
+		bool canResolveSymbol(const std::string& name) override
+		{
+			Uptr value;
+			WAVM_ASSERT_THROW(module);
+			return resolveInstanceSymbol(*module,moduleInstance,name,value) || JITUnit::canResolveSymbol(name);
+		}
 	};
 
 	// The JIT compilation unit for a single invoke thunk.
@@ -346,14 +417,6 @@ namespace LLVMJIT
 		}
 	};
 	
-	// Used to override LLVM's default behavior of looking up unresolved symbols in DLL exports.
-	struct NullResolver : llvm::JITSymbolResolver
-	{
-		static NullResolver singleton;
-		virtual llvm::JITSymbol findSymbol(const std::string& name) override;
-		virtual llvm::JITSymbol findSymbolInLogicalDylib(const std::string& name) override;
-	};
-	
 	static std::map<std::string,const char*> runtimeSymbolMap =
 	{
 		#ifdef _WIN32
@@ -394,6 +457,72 @@ namespace LLVMJIT
 	}
 	llvm::JITSymbol NullResolver::findSymbolInLogicalDylib(const std::string& name) { return llvm::JITSymbol(nullptr); }
 
+	llvm::JITSymbolResolver& JITUnit::getSymbolResolver() { return NullResolver::singleton; }
+	bool JITUnit::canResolveSymbol(const std::string& name) { return runtimeSymbolMap.count(name) != 0; }
+
+	static bool getSymbolIndex(const std::string& name,const char* prefix,Uptr& outIndex)
+	{
+		const Uptr numPrefixChars = strlen(prefix);
+		if(name.size() <= numPrefixChars || name.compare(0,numPrefixChars,prefix)) { return false; }
+		for(Uptr charIndex = numPrefixChars;charIndex < name.size();++charIndex)
+		{
+			if(!isdigit((unsigned char)name[charIndex])) { return false; }
+		}
+		outIndex = Uptr(std::strtoull(name.c_str() + numPrefixChars,nullptr,10));
+		return true;
+	}
+
+	bool resolveInstanceSymbol(const IR::Module& module,ModuleInstance* moduleInstance,const std::string& decoratedName,Uptr& outValue)
+	{
+		#if defined(_WIN32) && !defined(_WIN64)
+			if(decoratedName.empty() || decoratedName[0] != '_') { return false; }
+			const std::string name = decoratedName.substr(1);
+		#else
+			const std::string& name = decoratedName;
+		#endif
+
+		Uptr index;
+		if(name == defaultMemorySymbolName || name == defaultMemoryBaseSymbolName || name == defaultMemoryEndOffsetSymbolName)
+		{
+			if(!moduleInstance->defaultMemory) { return false; }
+			if(name == defaultMemorySymbolName) { outValue = reinterpret_cast<Uptr>(moduleInstance->defaultMemory); }
+			else if(name == defaultMemoryBaseSymbolName) { outValue = reinterpret_cast<Uptr>(moduleInstance->defaultMemory->baseAddress); }
+			else { outValue = Uptr(moduleInstance->defaultMemory->endOffset); }
+		}
+		else if(name == defaultTableSymbolName || name == defaultTableBaseSymbolName || name == defaultTableMaxElementIndexSymbolName)
+		{
+			if(!moduleInstance->defaultTable) { return false; }
+			if(name == defaultTableSymbolName) { outValue = reinterpret_cast<Uptr>(moduleInstance->defaultTable); }
+			else if(name == defaultTableBaseSymbolName) { outValue = reinterpret_cast<Uptr>(moduleInstance->defaultTable->baseAddress); }
+			else { outValue = Uptr(moduleInstance->defaultTable->endOffset) / sizeof(TableInstance::FunctionElement); }
+		}
+		else if(getSymbolIndex(name,importedFunctionSymbolPrefix,index))
+		{
+			if(index >= module.functions.imports.size() || index >= moduleInstance->functions.size()) { return false; }
+			outValue = reinterpret_cast<Uptr>(moduleInstance->functions[index]->nativeFunction);
+		}
+		else if(getSymbolIndex(name,globalSymbolPrefix,index))
+		{
+			if(index >= moduleInstance->globals.size()) { return false; }
+			outValue = reinterpret_cast<Uptr>(&moduleInstance->globals[index]->value);
+		}
+		else if(getSymbolIndex(name,typeSymbolPrefix,index))
+		{
+			if(index >= module.types.size()) { return false; }
+			outValue = reinterpret_cast<Uptr>(module.types[index]);
+		}
+		else if(!name.compare(0,strlen(intrinsicSymbolPrefix),intrinsicSymbolPrefix))
+		{
+			FunctionInstance* intrinsicFunction = Intrinsics::findFunctionByDecoratedName(name.substr(strlen(intrinsicSymbolPrefix)));
+			if(!intrinsicFunction) { return false; }
+			outValue = reinterpret_cast<Uptr>(intrinsicFunction->nativeFunction);
+		}
+		else { return false; }
+
+		// A null address can't be told apart from an unresolved symbol by the dynamic linker.
+		return outValue != 0;
+	}
+
 	void JITUnit::NotifyLoadedFunctor::operator()(
 		const llvm::orc::ObjectLinkingLayerBase::ObjSetHandleT& objectSetHandle,
 		const std::vector<std::unique_ptr<llvm::object::OwningBinary<llvm::object::ObjectFile>>>& objectSet,
@@ -401,6 +530,15 @@ namespace LLVMJIT
 		)
 	{
 		WAVM_ASSERT_THROW(objectSet.size() == loadedObjects.size());
+
+		// The dynamic linker relocates a copy of the object's sections, so the object itself is still relocatable.
+		if(jitUnit->objectCodeCopy)
+		{
+			WAVM_ASSERT_THROW(objectSet.size() == 1);
+			const llvm::StringRef objectData = objectSet[0]->getBinary()->getData();
+			jitUnit->objectCodeCopy->assign((const U8*)objectData.data(),(const U8*)objectData.data() + objectData.size());
+		}
+
 		for(Uptr objectIndex = 0;objectIndex < loadedObjects.size();++objectIndex)
 		{
 			llvm::object::ObjectFile* object = objectSet[objectIndex].get()->getBinary();
@@ -555,7 +693,7 @@ namespace LLVMJIT
 		Log::printf(Log::Category::debug,"Dumped LLVM module to: %s\n",augmentedFilename.c_str());
 	}
 
-	void JITUnit::compile(llvm::Module* llvmModule)
+	void JITUnit::compile(llvm::Module* llvmModule,std::vector<U8>* outObjectCode)
 	{
 		// Get a target machine object for this host, and set the module to use its data layout.
 		llvmModule->setDataLayout(targetMachine->createDataLayout());
@@ -598,9 +736,11 @@ namespace LLVMJIT
 		handle = compileLayer->addModuleSet(
 			std::vector<llvm::Module*>{llvmModule},
 			&memoryManager,
-			&NullResolver::singleton);
+			&getSymbolResolver());
 		handleIsValid = true;
+		objectCodeCopy = outObjectCode;
 		compileLayer->emitAndFinalize(handle);
+		objectCodeCopy = nullptr;
 
 		if(shouldLogMetrics)
 		{
@@ -610,17 +750,73 @@ namespace LLVMJIT
 		delete llvmModule;
 	}
 
-	void instantiateModule(const IR::Module& module,ModuleInstance* moduleInstance)
+	bool JITUnit::load(const std::vector<U8>& objectCode)
+	{
+		auto objectBuffer = llvm::MemoryBuffer::getMemBufferCopy(llvm::StringRef((const char*)objectCode.data(),objectCode.size()));
+		auto object = llvm::object::ObjectFile::createObjectFile(objectBuffer->getMemBufferRef());
+		if(!object)
+		{
+			llvm::consumeError(object.takeError());
+			return false;
+		}
+
+		// Check that every symbol the object code references can be resolved before handing it to the dynamic linker,
+		// which treats unresolved symbols as fatal errors.
+		for(auto symbol : (*object)->symbols())
+		{
+			const U32 flags = symbol.getFlags();
+			if(!(flags & llvm::object::SymbolRef::SF_Undefined) || (flags & llvm::object::SymbolRef::SF_FormatSpecific)) { continue; }
+			auto name = symbol.getName();
+			if(!name)
+			{
+				llvm::consumeError(name.takeError());
+				return false;
+			}
+			if(!canResolveSymbol(*name)) { return false; }
+		}
+
+		Timing::Timer loadTimer;
+		std::vector<std::unique_ptr<llvm::object::OwningBinary<llvm::object::ObjectFile>>> objectSet;
+		objectSet.push_back(llvm::make_unique<llvm::object::OwningBinary<llvm::object::ObjectFile>>(std::move(*object),std::move(objectBuffer)));
+		handle = objectLayer->addObjectSet(std::move(objectSet),&memoryManager,&getSymbolResolver());
+		handleIsValid = true;
+		objectLayer->emitAndFinalize(handle);
+
+		if(shouldLogMetrics)
+		{
+			Timing::logTimer("Loaded object code",loadTimer);
+		}
+		return true;
+	}
+
+	bool instantiateModule(const IR::Module& module,ModuleInstance* moduleInstance,std::vector<U8>* objectCode)
 	{
-		// Emit LLVM IR for the module.
-		auto llvmModule = emitModule(module,moduleInstance);
+		Platform::Lock compileLock(compileMutex);
 
 		// Construct the JIT compilation pipeline for this module.
 		auto jitModule = new JITModule(moduleInstance);
 		moduleInstance->jitModule = jitModule;
+		jitModule->module = &module;
 
-		// Compile the module.
-		jitModule->compile(llvmModule);
+		// Reuse the object code the module was previously compiled to if there is any.
+		bool compiled = false;
+		if(!objectCode || objectCode->empty() || !jitModule->load(*objectCode))
+		{
+			// Emit LLVM IR for the module, and compile it.
+			auto llvmModule = emitModule(module,moduleInstance);
+			jitModule->compile(llvmModule,objectCode);
+			compiled = true;
+		}
+
+		jitModule->module = nullptr;
+		return compiled;
+	}
+
+	std::string getObjectCodeVersion()
+	{
+		return "wavm-object-code-" + std::to_string(OBJECT_CODE_FORMAT_VERSION)
+			+ " llvm-" LLVM_VERSION_STRING
+			+ " " + targetMachine->getTargetTriple().str();
 	}
 
 	std::string getExternalFunctionName(ModuleInstance* moduleInstance,Uptr functionDefIndex)
@@ -687,8 +883,18 @@ namespace LLVMJIT
 	InvokeFunctionPointer getInvokeThunk(const FunctionType* functionType)
 	{
 		// Reuse cached invoke thunks for the same function type.
-		auto mapIt = invokeThunkTypeToSymbolMap.find(functionType);
-		if(mapIt != invokeThunkTypeToSymbolMap.end()) { return reinterpret_cast<InvokeFunctionPointer>(mapIt->second->baseAddress); }
+		{
+			Platform::Lock invokeThunkMapLock(invokeThunkMapMutex);
+			auto mapIt = invokeThunkTypeToSymbolMap.find(functionType);
+			if(mapIt != invokeThunkTypeToSymbolMap.end()) { return reinterpret_cast<InvokeFunctionPointer>(mapIt->second->baseAddress); }
+		}
+
+		Platform::Lock compileLock(compileMutex);
+		{
+			Platform::Lock invokeThunkMapLock(invokeThunkMapMutex);
+			auto mapIt = invokeThunkTypeToSymbolMap.find(functionType);
+			if(mapIt != invokeThunkTypeToSymbolMap.end()) { return reinterpret_cast<InvokeFunctionPointer>(mapIt->second->baseAddress); }
+		}
 
 		auto llvmModule = new llvm::Module("",context);
 		auto llvmFunctionType = llvm::FunctionType::get(
@@ -737,7 +943,10 @@ namespace LLVMJIT
 		jitUnit->compile(llvmModule);
 
 		WAVM_ASSERT_THROW(jitUnit->symbol);
-		invokeThunkTypeToSymbolMap[functionType] = jitUnit->symbol;
+		{
+			Platform::Lock invokeThunkMapLock(invokeThunkMapMutex);
+			invokeThunkTypeToSymbolMap[functionType] = jitUnit->symbol;
+		}
 
 		{
 			Platform::Lock addressToSymbolMapLock(addressToSymbolMapMutex);
@@ -125,6 +125,23 @@ namespace LLVMJIT
 	std::string getExternalFunctionName(ModuleInstance* moduleInstance,Uptr functionDefIndex);
 	bool getFunctionIndexFromExternalName(const char* externalName,Uptr& outFunctionDefIndex);
 
+	// The machine code of a module references the objects of its module instance through these external symbols instead
+	// of embedding their addresses, so that the object code doesn't depend on the instance it was compiled for and can be
+	// loaded into another instance of the same module. Prefixed symbols are suffixed with the index of the object.
+	extern const char* const defaultMemorySymbolName;
+	extern const char* const defaultMemoryBaseSymbolName;
+	extern const char* const defaultMemoryEndOffsetSymbolName;
+	extern const char* const defaultTableSymbolName;
+	extern const char* const defaultTableBaseSymbolName;
+	extern const char* const defaultTableMaxElementIndexSymbolName;
+	extern const char* const importedFunctionSymbolPrefix;
+	extern const char* const globalSymbolPrefix;
+	extern const char* const typeSymbolPrefix;
+	extern const char* const intrinsicSymbolPrefix;
+
+	// Resolves one of the above symbols to the address (or value) it refers to in a module instance.
+	bool resolveInstanceSymbol(const IR::Module& module,ModuleInstance* moduleInstance,const std::string& name,Uptr& outValue);
+
 	// Emits LLVM IR for a module.
 	llvm::Module* emitModule(const IR::Module& module,ModuleInstance* moduleInstance);
 }
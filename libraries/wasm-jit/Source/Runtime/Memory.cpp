@@ -88,7 +88,65 @@ namespace Runtime
 		return Uptr(memory->type.size.max);
 	}
 
+	// Replaces the image mapped at the start of a memory by zeroed pages.
+	static void unmapImage(MemoryInstance* memory)
+	{
+		if(memory->mappedImage)
+		{
+			Platform::unmapMemorySnapshot(memory->baseAddress,memory->mappedImage->numPages << getPlatformPagesPerWebAssemblyPageLog2());
+			memory->mappedImage = nullptr;
+		}
+	}
+
+	MemoryImage* createMemoryImage(const MemoryType& type,const U8* data,Uptr numBytes)
+	{
+		WAVM_ASSERT_THROW(type.size.min <= UINTPTR_MAX);
+		const Uptr numPages = Uptr(type.size.min);
+		if(numBytes > (numPages << IR::numBytesPerPageLog2)) { return nullptr; }
+
+		Platform::MemorySnapshot* snapshot = Platform::createMemorySnapshot(data,numBytes,numPages << getPlatformPagesPerWebAssemblyPageLog2());
+		if(!snapshot) { return nullptr; }
+		return new MemoryImage {snapshot,numPages};
+	}
+
+	void destroyMemoryImage(MemoryImage* image)
+	{
+		for(auto memory : memories)
+		{
+			if(memory->mappedImage == image) { unmapImage(memory); }
+		}
+		Platform::destroyMemorySnapshot(image->snapshot);
+		delete image;
+	}
+
+	void resetMemory(MemoryInstance* memory, MemoryType& newMemoryType, MemoryImage* image)
+	{
+		WAVM_ASSERT_THROW(image->numPages == newMemoryType.size.min);
+		const bool isMapped = memory->mappedImage == image;
+		if(!isMapped) { unmapImage(memory); }
+
+		// Decommit the pages the memory grew beyond the image.
+		if(memory->numPages > image->numPages)
+		{
+			Platform::decommitVirtualPages(
+				memory->baseAddress + (image->numPages << IR::numBytesPerPageLog2),
+				(memory->numPages - image->numPages) << getPlatformPagesPerWebAssemblyPageLog2()
+				);
+			memory->numPages = image->numPages;
+		}
+
+		if(!Platform::mapMemorySnapshot(image->snapshot,memory->baseAddress,isMapped))
+		{
+			memory->mappedImage = nullptr;
+			causeException(Exception::Cause::outOfMemory);
+		}
+		memory->mappedImage = image;
+		memory->type = newMemoryType;
+		memory->numPages = image->numPages;
+	}
+
 	void resetMemory(MemoryInstance* memory, MemoryType& newMemoryType) {
+		unmapImage(memory);
 		memory->type.size.min = 1;
 		if(shrinkMemory(memory, memory->numPages - 1) == -1)
 			causeException(Exception::Cause::outOfMemory);
@@ -30,7 +30,7 @@ namespace Runtime
 
 	MemoryInstance* MemoryInstance::theMemoryInstance = nullptr;
 
-	ModuleInstance* instantiateModule(const IR::Module& module,ImportBindings&& imports)
+	static ModuleInstance* instantiateModuleImpl(const IR::Module& module,ImportBindings&& imports,std::vector<U8>* objectCode,bool* outCompiled)
 	{
 		ModuleInstance* moduleInstance = new ModuleInstance(
 			std::move(imports.functions),
@@ -129,8 +129,9 @@ namespace Runtime
 			moduleInstance->functions.push_back(functionInstance);
 		}
 
-		// Generate machine code for the module.
-		LLVMJIT::instantiateModule(module,moduleInstance);
+		// Generate machine code for the module, or load it from the object code it was previously compiled to.
+		const bool compiled = LLVMJIT::instantiateModule(module,moduleInstance,objectCode);
+		if(outCompiled) { *outCompiled = compiled; }
 
 		// Set up the instance's exports.
 		for(const Export& exportIt : module.exports)
@@ -176,6 +177,16 @@ namespace Runtime
 		return moduleInstance;
 	}
 
+	ModuleInstance* instantiateModule(const IR::Module& module,ImportBindings&& imports)
+	{
+		return instantiateModuleImpl(module,std::move(imports),nullptr,nullptr);
+	}
+
+	ModuleInstance* instantiateModule(const IR::Module& module,ImportBindings&& imports,std::vector<U8>& objectCode,bool& outCompiled)
+	{
+		return instantiateModuleImpl(module,std::move(imports),&objectCode,&outCompiled);
+	}
+
 	ModuleInstance::~ModuleInstance()
 	{
 		delete jitModule;
@@ -184,6 +195,7 @@ namespace Runtime
 	MemoryInstance* getDefaultMemory(ModuleInstance* moduleInstance) { return moduleInstance->defaultMemory; }
 	uint64_t getDefaultMemorySize(ModuleInstance* moduleInstance) { return moduleInstance->defaultMemory->numPages << IR::numBytesPerPageLog2; }
 	TableInstance* getDefaultTable(ModuleInstance* moduleInstance) { return moduleInstance->defaultTable; }
+	Uptr getModuleInstanceCodeSize(ModuleInstance* moduleInstance) { return moduleInstance->jitModule ? moduleInstance->jitModule->getNumImageBytes() : 0; }
 
 	void runInstanceStartFunc(ModuleInstance* moduleInstance) {
 		if(moduleInstance->startFunctionIndex != UINTPTR_MAX)
@@ -13,6 +13,11 @@ namespace Runtime
 		LLVMJIT::init();
 		initWAVMIntrinsics();
 	}
+
+	std::string getObjectCodeVersion()
+	{
+		return LLVMJIT::getObjectCodeVersion();
+	}
 	
 	// Returns a vector of strings, each element describing a frame of the call stack.
 	// If the frame is a JITed function, use the JIT's information about the function
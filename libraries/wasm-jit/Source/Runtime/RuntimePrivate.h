@@ -17,10 +17,15 @@ namespace LLVMJIT
 	struct JITModuleBase
 	{
 		virtual ~JITModuleBase() {}
+		// The number of bytes of memory holding the module's machine code and data.
+		virtual Uptr getNumImageBytes() const = 0;
 	};
 
 	void init();
-	void instantiateModule(const IR::Module& module,Runtime::ModuleInstance* moduleInstance);
+	// Loads the module's machine code from objectCode if it is not null and holds reusable object code, otherwise
+	// compiles the module and stores the object code it was compiled to in objectCode. Returns whether it compiled.
+	bool instantiateModule(const IR::Module& module,Runtime::ModuleInstance* moduleInstance,std::vector<U8>* objectCode);
+	std::string getObjectCodeVersion();
 	bool describeInstructionPointer(Uptr ip,std::string& outDescription);
 	
 	typedef void (*InvokeFunctionPointer)(void*,U64*);
@@ -76,6 +81,13 @@ namespace Runtime
 		~TableInstance() override;
 	};
 
+	// A copy-on-write image of a memory's initial contents.
+	struct MemoryImage
+	{
+		Platform::MemorySnapshot* snapshot;
+		Uptr numPages;
+	};
+
 	// An instance of a WebAssembly Memory.
 	struct MemoryInstance : GCObject
 	{
@@ -88,7 +100,10 @@ namespace Runtime
 		U8* reservedBaseAddress;
 		Uptr reservedNumPlatformPages;
 
-		MemoryInstance(const MemoryType& inType): GCObject(ObjectKind::memory), type(inType), baseAddress(nullptr), numPages(0), endOffset(0), reservedBaseAddress(nullptr), reservedNumPlatformPages(0) {}
+		// The image mapped copy-on-write at the start of the memory, if any.
+		MemoryImage* mappedImage;
+
+		MemoryInstance(const MemoryType& inType): GCObject(ObjectKind::memory), type(inType), baseAddress(nullptr), numPages(0), endOffset(0), reservedBaseAddress(nullptr), reservedNumPlatformPages(0), mappedImage(nullptr) {}
 		~MemoryInstance() override;
 
       static MemoryInstance* theMemoryInstance;
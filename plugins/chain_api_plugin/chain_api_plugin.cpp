@@ -84,6 +84,8 @@ void chain_api_plugin::plugin_startup() {
 
    _http_plugin.add_api({
       CHAIN_RO_CALL(get_info, 200l),
+      CHAIN_RO_CALL(get_wasm_stats, 200),
+      CHAIN_RO_CALL(get_recovered_keys_stats, 200),
       CHAIN_RO_CALL(get_block, 200),
       CHAIN_RO_CALL(get_block_header_state, 200),
       CHAIN_RO_CALL(get_account, 200),
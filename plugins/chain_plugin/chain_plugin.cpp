@@ -26,6 +26,8 @@
 #include <fc/variant.hpp>
 #include <signal.h>
 #include <cstdlib>
+#include <fstream>
+#include <list>
 
 namespace snax {
 
@@ -165,6 +167,21 @@ public:
    fc::optional<vm_type>            wasm_runtime;
    fc::microseconds                 abi_serializer_max_time_ms;
    fc::optional<bfs::path>          snapshot_path;
+   vector<bfs::path>                snapshot_delta_paths;
+
+   /// opens the snapshot and the deltas applied onto it, the files stay open as long as the reader is used
+   snapshot_reader_ptr open_snapshot( std::list<std::ifstream>& files ) const {
+      files.emplace_back(snapshot_path->generic_string(), (std::ios::in | std::ios::binary));
+      auto reader = make_binary_snapshot_reader(files.back());
+      for( const auto& delta_path : snapshot_delta_paths ) {
+         auto base = std::dynamic_pointer_cast<packed_snapshot_reader>(reader);
+         SNAX_ASSERT( base, plugin_config_exception,
+                      "Cannot apply ${name}, deltas apply only onto snapshots in the parallel format", ("name", delta_path.generic_string()) );
+         files.emplace_back(delta_path.generic_string(), (std::ios::in | std::ios::binary));
+         reader = std::make_shared<delta_snapshot_reader>(base, std::make_shared<parallel_snapshot_reader>(files.back()));
+      }
+      return reader;
+   }
 
 
    // retained references to channels for easy publication
@@ -210,6 +227,23 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
    cfg.add_options()
          ("blocks-dir", bpo::value<bfs::path>()->default_value("blocks"),
           "the location of the blocks directory (absolute path or relative to application data dir)")
+         ("blocks-log-write-queue", bpo::value<uint32_t>()->default_value(config::default_blocks_log_write_queue_size),
+          "Number of irreversible blocks waiting to be written to the block log by its writer thread before block "
+          "application waits for it. 0 writes them on the main thread instead")
+         ("blocks-log-fsync-interval", bpo::value<uint32_t>()->default_value(config::default_blocks_log_fsync_interval),
+          "Number of blocks written to the block log between two syncs of it to disk. 0 leaves it to the operating system")
+         ("blocks-log-stride", bpo::value<uint32_t>()->default_value(config::default_blocks_log_stride),
+          "Split the block log into files of this many blocks, named blocks-<first>-<last>.log, once blocks.log holds them. "
+          "0 keeps all blocks in blocks.log")
+         ("blocks-log-retained-blocks", bpo::value<uint32_t>()->default_value(config::default_blocks_log_retained_blocks),
+          "Number of blocks behind the head kept in split block log files in the blocks directory. Older files are moved to "
+          "blocks-archive-dir, or deleted if it is empty. 0 keeps them all")
+         ("blocks-archive-dir", bpo::value<bfs::path>()->default_value(config::default_blocks_archive_dir_name),
+          "the location of the split block log files past blocks-log-retained-blocks (absolute path or relative to blocks dir). "
+          "An empty value deletes them instead")
+         ("blocks-log-compression", bpo::value<string>()->default_value("none"),
+          "Compression of the blocks written to a new block log, \"none\" or \"zlib\". A compressed block log uses "
+          "block log format version 3, which older versions cannot read")
          ("checkpoint", bpo::value<vector<string>>()->composing(), "Pairs of [BLOCK_NUM,BLOCK_ID] that should be enforced as checkpoints.")
          ("wasm-runtime", bpo::value<snax::chain::wasm_interface::vm_type>()->value_name("wavm/wabt"), "Override default WASM runtime")
          ("abi-serializer-max-time-ms", bpo::value<uint32_t>()->default_value(config::default_abi_serializer_max_time_ms),
@@ -218,8 +252,21 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
          ("chain-state-db-guard-size-mb", bpo::value<uint64_t>()->default_value(config::default_state_guard_size / (1024  * 1024)), "Safely shut down node when free space remaining in the chain state database drops below this size (in MiB).")
          ("reversible-blocks-db-size-mb", bpo::value<uint64_t>()->default_value(config::default_reversible_cache_size / (1024  * 1024)), "Maximum size (in MiB) of the reversible blocks database")
          ("reversible-blocks-db-guard-size-mb", bpo::value<uint64_t>()->default_value(config::default_reversible_guard_size / (1024  * 1024)), "Safely shut down node when free space remaining in the reverseible blocks database drops below this size (in MiB).")
+         ("wavm-code-cache-size-mb", bpo::value<uint64_t>()->default_value(config::default_code_cache_size / (1024  * 1024)),
+          "Maximum size (in MiB) of the on-disk cache of contracts compiled by the wavm runtime, 0 to disable it")
+         ("wasm-compile-threads", bpo::value<uint16_t>()->default_value(config::default_wasm_compile_threads),
+          "Number of threads compiling new contracts in the background for the wavm runtime; contracts are interpreted until "
+          "compiled. 0 compiles contracts on first use instead")
+         ("wasm-cache-size-mb", bpo::value<uint64_t>()->default_value(config::default_wasm_instantiation_cache_size / (1024  * 1024)),
+          "Maximum memory (in MiB) used by the contracts kept instantiated, the least recently used ones are evicted first. "
+          "The contracts of privileged accounts are never evicted")
          ("chain-threads", bpo::value<uint16_t>()->default_value(config::default_controller_thread_pool_size),
           "Number of worker threads in controller thread pool")
+         ("replay-prefetch-blocks", bpo::value<uint32_t>()->default_value(config::default_replay_prefetch_blocks),
+          "Number of blocks read, deserialized and prepared on the controller thread pool ahead of application during replay")
+         ("recovered-keys-cache-size", bpo::value<uint32_t>()->default_value(config::default_recovered_keys_cache_size),
+          "Number of transactions whose keys recovered from their signatures are kept, so that a transaction is not "
+          "recovered again when it is applied in a block or across forks. 0 disables the cache")
          ("contracts-console", bpo::bool_switch()->default_value(false),
           "print contract's output to console")
          ("actor-whitelist", boost::program_options::value<vector<string>>()->composing()->multitoken(),
@@ -250,6 +297,13 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
          ("disable-ram-billing-notify-checks", bpo::bool_switch()->default_value(false),
           "Disable the check which subjectively fails a transaction if a contract bills more RAM to another account within the context of a notification handler (i.e. when the receiver is not the code of the action).")
          ("trusted-producer", bpo::value<vector<string>>()->composing(), "Indicate a producer whose blocks headers signed by it will be fully validated, but transactions in those validated blocks will be trusted.")
+         ("contract-row-hash-index", bpo::bool_switch()->default_value(false),
+          "Keep an in-memory hash index of the contract table rows, built from the state database at startup, so that "
+          "contracts find rows by primary key in constant time. Uses memory for every row in the state database.")
+         ("fork-database-journal", bpo::bool_switch()->default_value(false),
+          "Journal the fork database as blocks are applied, so that after an unclean exit it is recovered from the journal "
+          "instead of from the reversible blocks. Recovery needs the state database to have survived the exit; a dirty state "
+          "database forces a replay, which discards the journal. Costs a journal write per block.")
          ;
 
 // TODO: rate limiting
@@ -288,6 +342,8 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
          ("export-reversible-blocks", bpo::value<bfs::path>(),
            "export reversible block database in portable format into specified file and then exit")
          ("snapshot", bpo::value<bfs::path>(), "File to read Snapshot State from")
+         ("snapshot-delta", bpo::value<vector<bfs::path>>()->composing(),
+          "File to read a delta snapshot from, applied onto --snapshot and the deltas given before it, in order")
          ;
 
 }
@@ -379,6 +435,37 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
             my->blocks_dir = bld;
       }
 
+      if( options.count( "blocks-log-write-queue" ))
+         my->chain_config->blocks_log_write_queue_size = options.at( "blocks-log-write-queue" ).as<uint32_t>();
+
+      if( options.count( "blocks-log-fsync-interval" ))
+         my->chain_config->blocks_log_fsync_interval = options.at( "blocks-log-fsync-interval" ).as<uint32_t>();
+
+      if( options.count( "blocks-log-stride" ))
+         my->chain_config->blocks_log_stride = options.at( "blocks-log-stride" ).as<uint32_t>();
+
+      if( options.count( "blocks-log-retained-blocks" ))
+         my->chain_config->blocks_log_retained_blocks = options.at( "blocks-log-retained-blocks" ).as<uint32_t>();
+
+      if( options.count( "blocks-archive-dir" )) {
+         auto ad = options.at( "blocks-archive-dir" ).as<bfs::path>();
+         if( ad.empty() || ad.is_absolute() )
+            my->chain_config->blocks_archive_dir = ad;
+         else
+            my->chain_config->blocks_archive_dir = my->blocks_dir / ad;
+      }
+
+      if( options.count( "blocks-log-compression" )) {
+         const auto compression = options.at( "blocks-log-compression" ).as<string>();
+         if( compression == "zlib" ) {
+            my->chain_config->blocks_log_compression = block_log_compression::zlib;
+         } else {
+            SNAX_ASSERT( compression == "none", plugin_config_exception,
+                         "Unknown blocks-log-compression ${c}, expected none or zlib", ("c", compression) );
+            my->chain_config->blocks_log_compression = block_log_compression::none;
+         }
+      }
+
       if( options.count("checkpoint") ) {
          auto cps = options.at("checkpoint").as<vector<string>>();
          my->loaded_checkpoints.reserve(cps.size());
@@ -405,6 +492,7 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
 
       my->chain_config->blocks_dir = my->blocks_dir;
       my->chain_config->state_dir = app().data_dir() / config::default_state_dir_name;
+      my->chain_config->code_cache_dir = app().data_dir() / config::default_code_cache_dir_name;
       my->chain_config->read_only = my->readonly;
 
       if( options.count( "chain-state-db-size-mb" ))
@@ -420,12 +508,30 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
       if( options.count( "reversible-blocks-db-guard-size-mb" ))
          my->chain_config->reversible_guard_size = options.at( "reversible-blocks-db-guard-size-mb" ).as<uint64_t>() * 1024 * 1024;
 
+      if( options.count( "wavm-code-cache-size-mb" ))
+         my->chain_config->code_cache_size = options.at( "wavm-code-cache-size-mb" ).as<uint64_t>() * 1024 * 1024;
+
+      if( options.count( "wasm-compile-threads" ))
+         my->chain_config->wasm_compile_threads = options.at( "wasm-compile-threads" ).as<uint16_t>();
+
+      if( options.count( "wasm-cache-size-mb" ))
+         my->chain_config->wasm_cache_size = options.at( "wasm-cache-size-mb" ).as<uint64_t>() * 1024 * 1024;
+
       if( options.count( "chain-threads" )) {
          my->chain_config->thread_pool_size = options.at( "chain-threads" ).as<uint16_t>();
          SNAX_ASSERT( my->chain_config->thread_pool_size > 0, plugin_config_exception,
                      "chain-threads ${num} must be greater than 0", ("num", my->chain_config->thread_pool_size) );
       }
 
+      if( options.count( "replay-prefetch-blocks" )) {
+         my->chain_config->replay_prefetch_blocks = options.at( "replay-prefetch-blocks" ).as<uint32_t>();
+         SNAX_ASSERT( my->chain_config->replay_prefetch_blocks > 0, plugin_config_exception,
+                     "replay-prefetch-blocks ${num} must be greater than 0", ("num", my->chain_config->replay_prefetch_blocks) );
+      }
+
+      if( options.count( "recovered-keys-cache-size" ))
+         my->chain_config->recovered_keys_cache_size = options.at( "recovered-keys-cache-size" ).as<uint32_t>();
+
       if( my->wasm_runtime )
          my->chain_config->wasm_runtime = *my->wasm_runtime;
 
@@ -433,6 +539,8 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
       my->chain_config->disable_replay_opts = options.at( "disable-replay-opts" ).as<bool>();
       my->chain_config->contracts_console = options.at( "contracts-console" ).as<bool>();
       my->chain_config->allow_ram_billing_in_notify = options.at( "disable-ram-billing-notify-checks" ).as<bool>();
+      my->chain_config->contract_row_hash_index = options.at( "contract-row-hash-index" ).as<bool>();
+      my->chain_config->fork_db_journal = options.at( "fork-database-journal" ).as<bool>();
 
       if( options.count( "extract-genesis-json" ) || options.at( "print-genesis-json" ).as<bool>()) {
          genesis_state gs;
@@ -546,14 +654,21 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
          SNAX_ASSERT( fc::exists(*my->snapshot_path), plugin_config_exception,
                      "Cannot load snapshot, ${name} does not exist", ("name", my->snapshot_path->generic_string()) );
 
+         if (options.count( "snapshot-delta" )) {
+            my->snapshot_delta_paths = options.at( "snapshot-delta" ).as<vector<bfs::path>>();
+            for( const auto& delta_path : my->snapshot_delta_paths ) {
+               SNAX_ASSERT( fc::exists(delta_path), plugin_config_exception,
+                           "Cannot load snapshot delta, ${name} does not exist", ("name", delta_path.generic_string()) );
+            }
+         }
+
          // recover genesis information from the snapshot
-         auto infile = std::ifstream(my->snapshot_path->generic_string(), (std::ios::in | std::ios::binary));
-         auto reader = std::make_shared<istream_snapshot_reader>(infile);
+         std::list<std::ifstream> files;
+         auto reader = my->open_snapshot(files);
          reader->validate();
          reader->read_section<genesis_state>([this]( auto &section ){
             section.read_row(my->chain_config->genesis);
          });
-         infile.close();
 
          SNAX_ASSERT( options.count( "genesis-json" ) == 0 &&  options.count( "genesis-timestamp" ) == 0,
                  plugin_config_exception,
@@ -706,10 +821,8 @@ void chain_plugin::plugin_startup()
    try {
       auto shutdown = [](){ return app().is_quiting(); };
       if (my->snapshot_path) {
-         auto infile = std::ifstream(my->snapshot_path->generic_string(), (std::ios::in | std::ios::binary));
-         auto reader = std::make_shared<istream_snapshot_reader>(infile);
-         my->chain->startup(shutdown, reader);
-         infile.close();
+         std::list<std::ifstream> files;
+         my->chain->startup(shutdown, my->open_snapshot(files));
       } else {
          my->chain->startup(shutdown);
       }
@@ -1035,6 +1148,17 @@ read_only::get_info_results read_only::get_info(const read_only::get_info_params
    };
 }
 
+read_only::get_wasm_stats_results read_only::get_wasm_stats(const read_only::get_wasm_stats_params&) const {
+   const auto& wasmif = db.get_wasm_interface();
+   return { wasmif.get_compile_stats(), wasmif.get_cache_stats() };
+}
+
+read_only::get_recovered_keys_stats_results read_only::get_recovered_keys_stats(const read_only::get_recovered_keys_stats_params&) const {
+   const auto s = db.get_recovered_keys_stats();
+   const uint64_t lookups = s.hits + s.misses;
+   return { s, lookups ? double(s.hits) / lookups : 0.0 };
+}
+
 uint64_t read_only::get_table_index_name(const read_only::get_table_rows_params& p, bool& primary) {
    using boost::algorithm::starts_with;
    // see multi_index packing of index name
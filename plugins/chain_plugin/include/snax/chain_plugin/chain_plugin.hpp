@@ -15,6 +15,7 @@
 #include <snax/chain/abi_serializer.hpp>
 #include <snax/chain/plugin_interface.hpp>
 #include <snax/chain/types.hpp>
+#include <snax/chain/wasm_interface.hpp>
 
 #include <boost/container/flat_set.hpp>
 #include <boost/multiprecision/cpp_int.hpp>
@@ -107,6 +108,22 @@ public:
    };
    get_info_results get_info(const get_info_params&) const;
 
+   using get_wasm_stats_params = empty;
+
+   struct get_wasm_stats_results {
+      chain::wasm_interface::compile_stats  compile;
+      chain::wasm_interface::cache_stats    cache;
+   };
+   get_wasm_stats_results get_wasm_stats(const get_wasm_stats_params&) const;
+
+   using get_recovered_keys_stats_params = empty;
+
+   struct get_recovered_keys_stats_results {
+      chain::recovered_keys_cache::stats  cache;
+      double                              hit_rate = 0; ///< hits out of all lookups since startup
+   };
+   get_recovered_keys_stats_results get_recovered_keys_stats(const get_recovered_keys_stats_params&) const;
+
    struct producer_info {
       name                       producer_name;
    };
@@ -705,6 +722,8 @@ FC_REFLECT( snax::chain_apis::permission, (perm_name)(parent)(required_auth) )
 FC_REFLECT(snax::chain_apis::empty, )
 FC_REFLECT(snax::chain_apis::read_only::get_info_results,
 (server_version)(chain_id)(head_block_num)(last_irreversible_block_num)(last_irreversible_block_id)(head_block_id)(head_block_time)(head_block_producer)(virtual_block_cpu_limit)(virtual_block_net_limit)(block_cpu_limit)(block_net_limit)(server_version_string) )
+FC_REFLECT(snax::chain_apis::read_only::get_wasm_stats_results, (compile)(cache) )
+FC_REFLECT(snax::chain_apis::read_only::get_recovered_keys_stats_results, (cache)(hit_rate) )
 FC_REFLECT(snax::chain_apis::read_only::get_block_params, (block_num_or_id))
 FC_REFLECT(snax::chain_apis::read_only::get_block_header_state_params, (block_num_or_id))
 
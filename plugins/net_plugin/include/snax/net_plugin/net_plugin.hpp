@@ -15,6 +15,11 @@ namespace snax {
       bool              connecting = false;
       bool              syncing    = false;
       handshake_message last_handshake;
+      bool              compressed = false; ///< messages sent to this peer are compressed
+      uint64_t          bytes_sent = 0;
+      uint64_t          bytes_received = 0;
+      uint64_t          compact_blocks_received = 0; ///< blocks rebuilt from compact_block_message sent by this peer
+      uint64_t          transactions_announced = 0;  ///< transaction ids this peer announced in notices
    };
 
    class net_plugin : public appbase::plugin<net_plugin>
@@ -44,4 +49,5 @@ namespace snax {
 
 }
 
-FC_REFLECT( snax::connection_status, (peer)(connecting)(syncing)(last_handshake) )
+FC_REFLECT( snax::connection_status, (peer)(connecting)(syncing)(last_handshake)(compressed)(bytes_sent)(bytes_received)
+            (compact_blocks_received)(transactions_announced) )
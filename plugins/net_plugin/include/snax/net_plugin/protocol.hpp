@@ -132,6 +132,27 @@ namespace snax {
       uint32_t end_block;
    };
 
+   /**
+    * A transaction receipt of a compact block. A packed transaction the receiving peer is expected to hold
+    * is referenced by its short id, the first 8 bytes of the transaction id.
+    */
+   struct compact_receipt : public transaction_receipt_header {
+      compact_receipt() = default;
+      explicit compact_receipt( const transaction_receipt_header& h ) : transaction_receipt_header(h) {}
+
+      fc::static_variant<uint64_t, transaction_id_type, packed_transaction> trx;
+   };
+
+   /**
+    * A block relayed to a peer that holds its transactions. The peer rebuilds the block from the transactions
+    * it knows and requests it in full when one is missing.
+    */
+   struct compact_block_message {
+      signed_block_header       header;
+      vector<compact_receipt>   transactions;
+      extensions_type           block_extensions;
+   };
+
    using net_message = static_variant<handshake_message,
                                       chain_size_message,
                                       go_away_message,
@@ -140,7 +161,8 @@ namespace snax {
                                       request_message,
                                       sync_request_message,
                                       signed_block,
-                                      packed_transaction>;
+                                      packed_transaction,
+                                      compact_block_message>;
 
 } // namespace snax
 
@@ -159,6 +181,8 @@ FC_REFLECT( snax::time_message, (org)(rec)(xmt)(dst) )
 FC_REFLECT( snax::notice_message, (known_trx)(known_blocks) )
 FC_REFLECT( snax::request_message, (req_trx)(req_blocks) )
 FC_REFLECT( snax::sync_request_message, (start_block)(end_block) )
+FC_REFLECT_DERIVED( snax::compact_receipt, (snax::chain::transaction_receipt_header), (trx) )
+FC_REFLECT( snax::compact_block_message, (header)(transactions)(block_extensions) )
 
 /**
  *
@@ -9,6 +9,7 @@
 #include <snax/chain/controller.hpp>
 #include <snax/chain/exceptions.hpp>
 #include <snax/chain/block.hpp>
+#include <snax/chain/merkle.hpp>
 #include <snax/chain/plugin_interface.hpp>
 #include <snax/producer_plugin/producer_plugin.hpp>
 #include <snax/chain/contract_types.hpp>
@@ -26,7 +27,22 @@
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/ip/host_name.hpp>
 #include <boost/asio/steady_timer.hpp>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/executor_work_guard.hpp>
 #include <boost/intrusive/set.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <limits>
+#include <map>
+#include <thread>
 
 using namespace snax::chain::plugin_interface::compat;
 
@@ -60,7 +76,16 @@ namespace snax {
 
    using socket_ptr = std::shared_ptr<tcp::socket>;
 
+   namespace bio = boost::iostreams;
+
+   /// how messages are compressed on connections to peers that support compressed frames
+   enum class wire_compression {
+      none,
+      zlib
+   };
+
    using net_message_ptr = shared_ptr<net_message>;
+   using send_buffer_ptr = shared_ptr<const vector<char>>; ///< a message framed for the wire, shared by every connection it is queued to
 
    struct node_transaction_state {
       transaction_id_type id;
@@ -68,7 +93,7 @@ namespace snax {
                                 /// Expires increased while the txn is
                                 /// "in flight" to anoher peer
       packed_transaction packed_txn;
-      vector<char>    serialized_txn; /// the received raw bundle
+      send_buffer_ptr serialized_txn; /// the framed transaction message
       uint32_t        block_num = 0; /// block transaction was included in
       uint32_t        true_block = 0; /// used to reset block_uum when request is 0
       uint16_t        requests = 0; /// the number of "in flight" requests for this txn
@@ -119,6 +144,14 @@ namespace snax {
 
    class net_plugin_impl {
    public:
+      /// socket I/O, message framing and unpacking run on these threads, each connection on its own strand;
+      /// everything else, including all calls into chain_plugin and producer_plugin, runs on the main thread.
+      /// declared first so that it outlives every socket and the acceptor
+      unique_ptr<boost::asio::io_context> net_ioc;
+      optional<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>> net_work;
+      vector<std::thread>              net_thread_pool;
+      uint32_t                         net_threads = 0;
+
       unique_ptr<tcp::acceptor>        acceptor;
       tcp::endpoint                    listen_endpoint;
       string                           p2p_address;
@@ -146,6 +179,24 @@ namespace snax {
       unique_ptr< sync_manager >       sync_master;
       unique_ptr< dispatch_manager >   dispatcher;
 
+      fc::time_point                   current_message_received; ///< when the message being handled was unpacked on its strand
+      struct block_latency_stats {
+         uint32_t         blocks = 0;
+         uint32_t         live_blocks = 0;
+         fc::microseconds accepted;    ///< unpacked on the strand until accepted by the chain
+         fc::microseconds propagation; ///< block timestamp until accepted by the chain, live blocks only
+      }                                block_latency;
+      void record_block_latency( const signed_block& b, fc::time_point received );
+
+      uint32_t                         sync_verify_window = 0;
+      struct sync_window_block {
+         connection_ptr   c;
+         signed_block_ptr block;
+         fc::time_point   received;
+      };
+      std::deque<sync_window_block>    sync_window; ///< blocks received during sync, verifying ahead of being applied
+      std::map<uint32_t, sync_window_block> sync_reorder; ///< blocks received during sync ahead of the next block in order
+
       unique_ptr<boost::asio::steady_timer> connector_check;
       unique_ptr<boost::asio::steady_timer> transaction_check;
       unique_ptr<boost::asio::steady_timer> keepalive_timer;
@@ -170,6 +221,9 @@ namespace snax {
       shared_ptr<tcp::resolver>     resolver;
 
       bool                          use_socket_read_watermark = false;
+      wire_compression              compression = wire_compression::none;
+      bool                          announce_transactions = false;
+      bool                          compact_blocks = false;
 
       channels::transaction_ack::channel_type::handle  incoming_transaction_ack_subscription;
 
@@ -177,13 +231,18 @@ namespace snax {
       void connect( connection_ptr c, tcp::resolver::iterator endpoint_itr );
       bool start_session( connection_ptr c );
       void start_listen_loop( );
-      void start_read_message( connection_ptr c);
+      void start_read_message( connection_ptr c, uint32_t session );
+      template<typename F>
+      void post_to_main( const connection_ptr& c, uint32_t session, F&& f );
 
       void   close( connection_ptr c );
       size_t count_open_sockets() const;
 
       template<typename VerifierFunc>
       void send_all( const net_message &msg, VerifierFunc verify );
+      /// queue send_buffer, packed once in pack_time, to every current connection accepted by verify
+      template<typename VerifierFunc>
+      void send_all( const send_buffer_ptr& send_buffer, fc::microseconds pack_time, VerifierFunc verify );
 
       void accepted_block_header(const block_state_ptr&);
       void accepted_block(const block_state_ptr&);
@@ -219,6 +278,11 @@ namespace snax {
       void handle_message( connection_ptr c, const sync_request_message &msg);
       void handle_message( connection_ptr c, const signed_block &msg);
       void handle_message( connection_ptr c, const packed_transaction &msg);
+      void handle_message( connection_ptr c, const compact_block_message &msg);
+
+      bool accept_block( connection_ptr c, const signed_block_ptr& sbp, fc::time_point received );
+      void apply_sync_window( size_t keep );
+      void apply_sync_blocks();
 
       void start_conn_timer(boost::asio::steady_timer::duration du, std::weak_ptr<connection> from_connection);
       void start_txn_timer( );
@@ -314,10 +378,22 @@ namespace snax {
    constexpr auto     def_txn_expire_wait = std::chrono::seconds(3);
    constexpr auto     def_resp_expected_wait = std::chrono::seconds(5);
    constexpr auto     def_sync_fetch_span = 100;
+   constexpr uint32_t def_sync_peers = 4;
+   constexpr auto     def_sync_stall_timeout = std::chrono::seconds(2); ///< for peers whose sync rate is not measured yet
+   constexpr auto     def_sync_min_stall_timeout = std::chrono::seconds(1); ///< above the time the main thread takes to apply a verify window
+   constexpr double   def_stalled_sync_rate = 1.0; ///< blocks per second assumed for a peer that stalled before being measured
+   constexpr uint32_t def_sync_verify_window = 32;
+   constexpr uint32_t def_net_threads = 2;
+   constexpr uint32_t def_block_latency_report = 1000; ///< blocks between block latency reports
+   const fc::microseconds def_live_block_age = fc::minutes(5); ///< older blocks are from sync and excluded from propagation latency
    constexpr uint32_t  def_max_just_send = 1500; // roughly 1 "mtu"
    constexpr bool     large_msg_notify = false;
 
    constexpr auto     message_header_size = 4;
+   constexpr uint32_t compressed_message_flag = 0x80000000; ///< set in the size header of a zlib compressed frame
+   constexpr uint32_t def_compression_threshold = 256; ///< smaller messages are always sent uncompressed
+   constexpr size_t   def_max_trx_announcement = 1000; ///< transaction ids per announcement notice
+   const fc::microseconds def_trx_request_wait = fc::seconds(5); ///< before a transaction announced by several peers is requested again
 
    /**
     *  For a while, network version was a 16 bit value equal to the second set of 16 bits
@@ -339,8 +415,10 @@ namespace snax {
     */
    constexpr uint16_t proto_base = 0;
    constexpr uint16_t proto_explicit_sync = 1;
+   constexpr uint16_t proto_compression = 2; // frames may be zlib compressed, flagged in their size header
+   constexpr uint16_t proto_compact_relay = 3; // compact_block_message, transactions announced by id in batched notices
 
-   constexpr uint16_t net_version = proto_explicit_sync;
+   constexpr uint16_t net_version = proto_compact_relay;
 
    /**
     *  Index by id
@@ -479,15 +557,16 @@ namespace snax {
          return ((!_sync_write_queue.empty() || !_write_queue.empty()) && _out_queue.empty());
       }
 
-      bool add_write_queue( const std::shared_ptr<vector<char>>& buff,
+      /// @param owner - keeps the bytes of buff alive until they are sent
+      bool add_write_queue( const std::shared_ptr<const void>& owner, boost::asio::const_buffer buff,
                             std::function<void( boost::system::error_code, std::size_t )> callback,
                             bool to_sync_queue ) {
          if( to_sync_queue ) {
-            _sync_write_queue.push_back( {buff, callback} );
+            _sync_write_queue.push_back( {owner, buff, callback} );
          } else {
-            _write_queue.push_back( {buff, callback} );
+            _write_queue.push_back( {owner, buff, callback} );
          }
-         _write_queue_size += buff->size();
+         _write_queue_size += boost::asio::buffer_size( buff );
          if( _write_queue_size > 2 * def_max_write_queue_size ) {
             return false;
          }
@@ -515,8 +594,8 @@ namespace snax {
                             deque<queued_write>& w_queue ) {
          while ( w_queue.size() > 0 ) {
             auto& m = w_queue.front();
-            bufs.push_back( boost::asio::buffer( *m.buff ));
-            _write_queue_size -= m.buff->size();
+            bufs.push_back( m.buff );
+            _write_queue_size -= boost::asio::buffer_size( m.buff );
             _out_queue.emplace_back( m );
             w_queue.pop_front();
          }
@@ -524,11 +603,12 @@ namespace snax {
 
    private:
       struct queued_write {
-         std::shared_ptr<vector<char>> buff;
+         std::shared_ptr<const void> owner;
+         boost::asio::const_buffer buff;
          std::function<void( boost::system::error_code, std::size_t )> callback;
       };
 
-      uint32_t _write_queue_size = 0;
+      std::atomic<uint32_t> _write_queue_size{0}; ///< also read by the connection's strand for flow control
       deque<queued_write> _write_queue;
       deque<queued_write> _sync_write_queue; // sync_write_queue will be sent first
       deque<queued_write> _out_queue;
@@ -548,6 +628,10 @@ namespace snax {
       transaction_state_index trx_state;
       optional<sync_state>    peer_requested;  // this peer is requesting info from us
       socket_ptr              socket;
+      boost::asio::strand<boost::asio::io_context::executor_type> strand; ///< serializes all use of socket and the read state below
+      bool                    socket_open = false; ///< main thread view of the socket, set by start_session, cleared by close
+      std::atomic<uint32_t>   session{0}; ///< incremented by close, work queued for an earlier session is dropped
+      boost::asio::ip::address accepted_address; ///< remote address of an accepted connection
 
       fc::message_buffer<1024*1024>    pending_message_buffer;
       fc::optional<std::size_t>        outstanding_read_bytes;
@@ -556,8 +640,20 @@ namespace snax {
 
       queued_buffer           buffer_queue;
 
-      uint32_t                reads_in_flight = 0;
-      uint32_t                trx_in_progress_size = 0;
+      /// a send waiting on a buffer compressed off the main thread, queued in order by complete_deferred_send
+      struct deferred_send {
+         send_buffer_ptr                             buffer; ///< null when compression did not pay
+         bool                                        ready = false;
+         std::function<void(const send_buffer_ptr&)> queue;
+      };
+      using deferred_send_ptr = std::shared_ptr<deferred_send>;
+      deque<deferred_send_ptr> deferred_sends; ///< main thread only, later sends wait behind these
+
+      std::atomic<uint32_t>   reads_in_flight{0}; ///< reads outstanding plus messages waiting for the main thread
+      std::atomic<uint32_t>   trx_in_progress_size{0};
+      std::atomic<uint64_t>   bytes_sent{0}; ///< bytes written to the socket, as framed on the wire
+      std::atomic<uint64_t>   bytes_received{0}; ///< bytes read from the socket, as framed on the wire
+      std::atomic<int64_t>    last_block_received{0}; ///< microseconds since the epoch when the strand last unpacked a block
       fc::sha256              node_id;
       handshake_message       last_handshake_recv;
       handshake_message       last_handshake_sent;
@@ -573,6 +669,9 @@ namespace snax {
       block_id_type          fork_head;
       uint32_t               fork_head_num = 0;
       optional<request_message> last_req;
+      double                 sync_rate = 0; ///< blocks per second over the sync ranges served by this peer, 0 until measured
+      uint64_t               compact_blocks_received = 0;
+      uint64_t               transactions_announced = 0;
 
       connection_status get_status()const {
          connection_status stat;
@@ -580,9 +679,34 @@ namespace snax {
          stat.connecting = connecting;
          stat.syncing = syncing;
          stat.last_handshake = last_handshake_recv;
+         stat.compressed = compress_sends();
+         stat.bytes_sent = bytes_sent;
+         stat.bytes_received = bytes_received;
+         stat.compact_blocks_received = compact_blocks_received;
+         stat.transactions_announced = transactions_announced;
          return stat;
       }
 
+      /// true when messages to this peer are sent compressed, which requires the peer to have advertised support
+      bool compress_sends() const {
+         return my_impl->compression != wire_compression::none && protocol_version >= proto_compression;
+      }
+
+      /// true when transactions are announced to this peer by id, for it to request the ones it is missing
+      bool announce_transactions() const {
+         return my_impl->announce_transactions && protocol_version >= proto_compact_relay;
+      }
+
+      /// true when blocks are relayed to this peer as compact_block_message when it holds their transactions
+      bool compact_blocks() const {
+         return my_impl->compact_blocks && protocol_version >= proto_compact_relay;
+      }
+
+      vector<transaction_id_type> pending_announcements; ///< transaction ids for the next announcement notice
+
+      /// record that the peer holds the transaction, it is then neither sent nor announced to the peer
+      void trx_known_by_peer( const transaction_id_type& id, time_point_sec expires );
+
       /** \name Peer Timestamps
        *  Time message handling
        *  @{
@@ -642,6 +766,17 @@ namespace snax {
       void stop_send();
 
       void enqueue( const net_message &msg, bool trigger_send = true, bool to_sync_queue = false );
+      /// queue a message created by create_send_buffer, sharing rather than copying its bytes
+      void enqueue_buffer( const send_buffer_ptr& send_buffer, bool trigger_send = true, bool to_sync_queue = false,
+                           go_away_reason close_after_send = no_reason );
+      void enqueue_packed_block( const packed_block_view& block, bool trigger_send, bool to_sync_queue );
+      /// queue the buffer now, unless sends waiting on compression have to go first
+      void write_buffer( const send_buffer_ptr& send_buffer, bool trigger_send = true, bool to_sync_queue = false,
+                         go_away_reason close_after_send = no_reason );
+      deferred_send_ptr defer_send( std::function<void(const send_buffer_ptr&)> queue );
+      void complete_deferred_send( const deferred_send_ptr& d, const send_buffer_ptr& buffer );
+      /// runs compress on the connection's strand and queue with its result on the main thread, in order with other sends
+      void compress_and_enqueue( std::function<send_buffer_ptr()> compress, std::function<void(const send_buffer_ptr&)> queue );
       void cancel_sync(go_away_reason);
       void flush_queues();
       bool enqueue_sync_block();
@@ -649,11 +784,18 @@ namespace snax {
 
       void cancel_wait();
       void sync_wait();
+      void sync_wait( boost::asio::steady_timer::duration timeout );
       void fetch_wait();
       void sync_timeout(boost::system::error_code ec);
       void fetch_timeout(boost::system::error_code ec);
 
-      void queue_write(std::shared_ptr<vector<char>> buff,
+      bool queue_write(const send_buffer_ptr& buff,
+                       bool trigger_send,
+                       std::function<void(boost::system::error_code, std::size_t)> callback,
+                       bool to_sync_queue = false);
+      /// @return false if the connection was closed because its write queue is full
+      bool queue_write(const std::shared_ptr<const void>& owner,
+                       boost::asio::const_buffer buff,
                        bool trigger_send,
                        std::function<void(boost::system::error_code, std::size_t)> callback,
                        bool to_sync_queue = false);
@@ -665,10 +807,14 @@ namespace snax {
        * message_length is the already determined length of the data
        * part of the message and impl in the net plugin implementation
        * that will handle the message.
+       * compressed is set when the frame is zlib compressed.
+       * Runs on the connection's strand: the message is unpacked there and
+       * posted to the main thread to be handled, unless the connection has
+       * been closed since session.
        * Returns true is successful. Returns false if an error was
-       * encountered unpacking or processing the message.
+       * encountered unpacking the message.
        */
-      bool process_next_message(net_plugin_impl& impl, uint32_t message_length);
+      bool process_next_message(net_plugin_impl& impl, uint32_t message_length, bool compressed, uint32_t session);
 
       bool add_peer_block(const peer_block_state& pbs);
 
@@ -718,30 +864,51 @@ namespace snax {
          in_sync
       };
 
+      /**
+       * A span of blocks requested from one peer during lib catchup. A range released by a stalled
+       * or closed peer keeps its place, without a peer, until it is assigned to another one.
+       */
+      struct sync_range {
+         uint32_t       end = 0;
+         uint32_t       next = 0;           ///< next block expected within the range
+         uint32_t       requested_from = 0; ///< first block of the current request, for the peer's rate
+         connection_ptr peer;
+         fc::time_point requested;
+      };
+
       uint32_t       sync_known_lib_num;
       uint32_t       sync_last_requested_num;
       uint32_t       sync_next_expected_num;
       uint32_t       sync_req_span;
-      connection_ptr source;
+      uint32_t       sync_max_peers;
+      std::map<uint32_t, sync_range> sync_ranges; ///< outstanding ranges by first block
       stages         state;
 
       chain_plugin* chain_plug = nullptr;
 
       constexpr auto stage_str(stages s );
+      std::map<uint32_t, sync_range>::iterator find_range(const connection_ptr& c);
+      bool release_range(const connection_ptr& c);
+      void reset_ranges();
 
    public:
-      explicit sync_manager(uint32_t span);
+      sync_manager(uint32_t span, uint32_t max_peers);
       void set_state(stages s);
       bool sync_required();
       void send_handshakes();
       bool is_active(connection_ptr conn);
       void reset_lib_num(connection_ptr conn);
-      void request_next_chunk(connection_ptr conn = connection_ptr() );
+      void request_next_chunk();
       void start_sync(connection_ptr c, uint32_t target);
       void reassign_fetch(connection_ptr c, go_away_reason reason);
       void verify_catchup(connection_ptr c, uint32_t num, block_id_type id);
       void rejected_block(connection_ptr c, uint32_t blk_num);
+      bool sync_block_received(connection_ptr c, uint32_t blk_num);
       void recv_block(connection_ptr c, const block_id_type &blk_id, uint32_t blk_num);
+      bool in_lib_catchup() const { return state == lib_catchup; }
+      uint32_t last_requested_num() const { return sync_last_requested_num; }
+      uint32_t next_expected_num() const { return sync_next_expected_num; }
+      boost::asio::steady_timer::duration stall_timeout(const connection& c) const;
       void recv_handshake(connection_ptr c, const handshake_message& msg);
       void recv_notice(connection_ptr c, const notice_message& msg);
    };
@@ -750,12 +917,15 @@ namespace snax {
    public:
       uint32_t just_send_it_max = 0;
 
-      vector<transaction_id_type> req_trx;
+      std::map<transaction_id_type, fc::time_point> req_trx; ///< transactions requested from a peer, by request time
+      bool announce_scheduled = false;
 
       std::multimap<block_id_type, connection_ptr> received_blocks;
       std::multimap<transaction_id_type, connection_ptr> received_transactions;
 
       void bcast_transaction (const packed_transaction& msg);
+      void announce_transaction (const connection_ptr& c, const transaction_id_type& id);
+      void flush_announcements ();
       void rejected_transaction (const transaction_id_type& msg);
       void bcast_block (const signed_block& msg);
       void rejected_block (const block_id_type &id);
@@ -769,11 +939,110 @@ namespace snax {
 
    //---------------------------------------------------------------------------
 
+   /// frame a message for the wire, a 32 bit payload size followed by the packed net_message
+   send_buffer_ptr create_send_buffer( const net_message& m ) {
+      const uint32_t payload_size = fc::raw::pack_size( m );
+      auto send_buffer = std::make_shared<vector<char>>( sizeof(payload_size) + payload_size );
+      fc::datastream<char*> ds( send_buffer->data(), send_buffer->size() );
+      ds.write( reinterpret_cast<const char*>(&payload_size), sizeof(payload_size) );
+      fc::raw::pack( ds, m );
+      return send_buffer;
+   }
+
+   /// the short id referencing a transaction in a compact block, the first 8 bytes of its id
+   uint64_t short_trx_id( const transaction_id_type& id ) {
+      return id._hash[0];
+   }
+
+   /// frame b as a compact_block_message referencing its packed transactions, with ids trx_ids, by short id
+   send_buffer_ptr create_compact_block_buffer( const signed_block& b, const vector<transaction_id_type>& trx_ids ) {
+      compact_block_message cb;
+      cb.header = b;
+      cb.block_extensions = b.block_extensions;
+      cb.transactions.reserve( b.transactions.size() );
+      auto id = trx_ids.begin();
+      for( const auto& r : b.transactions ) {
+         compact_receipt cr( r );
+         if( r.trx.contains<packed_transaction>() ) {
+            cr.trx = short_trx_id( *id++ );
+         } else {
+            cr.trx = r.trx.get<transaction_id_type>();
+         }
+         cb.transactions.emplace_back( std::move( cr ) );
+      }
+      return create_send_buffer( net_message( std::move( cb ) ) );
+   }
+
+   /// frame the concatenation of parts zlib compressed, nullptr if that would not be smaller than framing them as they are
+   send_buffer_ptr create_compressed_send_buffer( const vector<boost::asio::const_buffer>& parts ) {
+      const size_t payload_size = boost::asio::buffer_size( parts );
+      if( payload_size < def_compression_threshold )
+         return send_buffer_ptr();
+
+      auto send_buffer = std::make_shared<vector<char>>( message_header_size );
+      bio::filtering_ostream comp;
+      comp.push( bio::zlib_compressor( bio::zlib::best_speed ) );
+      comp.push( bio::back_inserter( *send_buffer ) );
+      for( const auto& part : parts ) {
+         bio::write( comp, boost::asio::buffer_cast<const char*>( part ), boost::asio::buffer_size( part ) );
+      }
+      bio::close( comp );
+
+      const uint32_t compressed_size = send_buffer->size() - message_header_size;
+      if( compressed_size >= payload_size )
+         return send_buffer_ptr();
+      const uint32_t header = compressed_size | compressed_message_flag;
+      memcpy( send_buffer->data(), &header, message_header_size );
+      return send_buffer;
+   }
+
+   /// the compressed form of a buffer created by create_send_buffer, nullptr when compression does not pay
+   send_buffer_ptr compress_send_buffer( const send_buffer_ptr& send_buffer ) {
+      try {
+         return create_compressed_send_buffer( { boost::asio::buffer( *send_buffer ) + message_header_size } );
+      } catch( ... ) {
+         elog( "Unable to compress message of ${s} bytes, sending it uncompressed", ("s", send_buffer->size()) );
+         return send_buffer_ptr();
+      }
+   }
+
+   /// a sink that refuses to grow past limit, bounding what a compressed frame may expand to
+   struct bounded_sink {
+      typedef char          char_type;
+      typedef bio::sink_tag category;
+
+      vector<char>& out;
+      size_t        limit;
+
+      std::streamsize write( const char* s, std::streamsize n ) {
+         SNAX_ASSERT( out.size() + static_cast<size_t>( n ) <= limit, plugin_exception, "decompressed message exceeds ${l} bytes", ("l", limit) );
+         out.insert( out.end(), s, s + n );
+         return n;
+      }
+   };
+
+   vector<char> zlib_decompress( const char* data, size_t size, size_t limit ) {
+      try {
+         vector<char> out;
+         bio::filtering_ostream decomp;
+         decomp.push( bio::zlib_decompressor() );
+         decomp.push( bounded_sink{ out, limit } );
+         bio::write( decomp, data, size );
+         bio::close( decomp );
+         return out;
+      } catch( fc::exception& er ) {
+         throw;
+      } catch( ... ) {
+         SNAX_THROW( plugin_exception, "Unable to decompress message" );
+      }
+   }
+
    connection::connection( string endpoint )
       : blk_state(),
         trx_state(),
         peer_requested(),
-        socket( std::make_shared<tcp::socket>( std::ref( app().get_io_service() ))),
+        socket( std::make_shared<tcp::socket>( std::ref( *my_impl->net_ioc ))),
+        strand( my_impl->net_ioc->get_executor() ),
         node_id(),
         last_handshake_recv(),
         last_handshake_sent(),
@@ -799,6 +1068,7 @@ namespace snax {
         trx_state(),
         peer_requested(),
         socket( s ),
+        strand( my_impl->net_ioc->get_executor() ),
         node_id(),
         last_handshake_recv(),
         last_handshake_sent(),
@@ -825,11 +1095,11 @@ namespace snax {
       auto *rnd = node_id.data();
       rnd[0] = 0;
       response_expected.reset(new boost::asio::steady_timer(app().get_io_service()));
-      read_delay_timer.reset(new boost::asio::steady_timer(app().get_io_service()));
+      read_delay_timer.reset(new boost::asio::steady_timer(*my_impl->net_ioc));
    }
 
    bool connection::connected() {
-      return (socket && socket->is_open() && !connecting);
+      return (socket_open && !connecting);
    }
 
    bool connection::current() {
@@ -840,6 +1110,16 @@ namespace snax {
       peer_requested.reset();
       blk_state.clear();
       trx_state.clear();
+      pending_announcements.clear();
+   }
+
+   void connection::trx_known_by_peer( const transaction_id_type& id, time_point_sec expires ) {
+      auto ts = trx_state.find( id );
+      if( ts == trx_state.end() ) {
+         trx_state.insert( transaction_state({id,true,true,0,expires,time_point()}) );
+      } else if( !ts->is_known_by_peer ) {
+         trx_state.modify( ts, set_is_known );
+      }
    }
 
    void connection::flush_queues() {
@@ -847,8 +1127,17 @@ namespace snax {
    }
 
    void connection::close() {
+      ++session;
+      socket_open = false;
+      deferred_sends.clear();
       if(socket) {
-         socket->close();
+         boost::asio::post( strand, [c = shared_from_this()]() {
+            boost::system::error_code ec;
+            c->socket->close( ec );
+            c->read_delay_timer->cancel();
+            c->pending_message_buffer.reset();
+            c->outstanding_read_bytes.reset();
+         });
       }
       else {
          wlog("no socket to close!");
@@ -866,13 +1155,11 @@ namespace snax {
       my_impl->sync_master->reset_lib_num(shared_from_this());
       fc_dlog(logger, "canceling wait on ${p}", ("p",peer_name()));
       cancel_wait();
-      if( read_delay_timer ) read_delay_timer->cancel();
-      pending_message_buffer.reset();
    }
 
    void connection::txn_send_pending(const vector<transaction_id_type> &ids) {
       for(auto tx = my_impl->local_txns.begin(); tx != my_impl->local_txns.end(); ++tx ){
-         if(tx->serialized_txn.size() && tx->block_num == 0) {
+         if(tx->serialized_txn && tx->block_num == 0) {
             bool found = false;
             for(auto known : ids) {
                if( known == tx->id) {
@@ -882,7 +1169,7 @@ namespace snax {
             }
             if(!found) {
                my_impl->local_txns.modify(tx,incr_in_flight);
-               queue_write(std::make_shared<vector<char>>(tx->serialized_txn),
+               queue_write(tx->serialized_txn,
                            true,
                            [tx_id=tx->id](boost::system::error_code ec, std::size_t ) {
                               auto& local_txns = my_impl->local_txns;
@@ -901,9 +1188,10 @@ namespace snax {
    void connection::txn_send(const vector<transaction_id_type> &ids) {
       for(auto t : ids) {
          auto tx = my_impl->local_txns.get<by_id>().find(t);
-         if( tx != my_impl->local_txns.end() && tx->serialized_txn.size()) {
+         if( tx != my_impl->local_txns.end() && tx->serialized_txn) {
+            trx_known_by_peer( t, tx->expires );
             my_impl->local_txns.modify( tx,incr_in_flight);
-            queue_write(std::make_shared<vector<char>>(tx->serialized_txn),
+            queue_write(tx->serialized_txn,
                         true,
                         [t](boost::system::error_code ec, std::size_t ) {
                            auto& local_txns = my_impl->local_txns;
@@ -1036,71 +1324,103 @@ namespace snax {
       enqueue(xpkt);
    }
 
-   void connection::queue_write(std::shared_ptr<vector<char>> buff,
+   bool connection::queue_write(const send_buffer_ptr& buff,
                                 bool trigger_send,
                                 std::function<void(boost::system::error_code, std::size_t)> callback,
                                 bool to_sync_queue) {
-      if( !buffer_queue.add_write_queue( buff, callback, to_sync_queue )) {
+      const auto b = boost::asio::buffer( *buff );
+      return queue_write( buff, b, trigger_send, callback, to_sync_queue );
+   }
+
+   bool connection::queue_write(const std::shared_ptr<const void>& owner,
+                                boost::asio::const_buffer buff,
+                                bool trigger_send,
+                                std::function<void(boost::system::error_code, std::size_t)> callback,
+                                bool to_sync_queue) {
+      if( !buffer_queue.add_write_queue( owner, buff, callback, to_sync_queue )) {
          fc_wlog( logger, "write_queue full ${s} bytes, giving up on connection ${p}",
                   ("s", buffer_queue.write_queue_size())("p", peer_name()) );
          my_impl->close( shared_from_this() );
-         return;
+         return false;
       }
       if( buffer_queue.is_out_queue_empty() && trigger_send) {
          do_queue_write();
       }
+      return true;
    }
 
    void connection::do_queue_write() {
       if( !buffer_queue.ready_to_send() )
          return;
       connection_wptr c(shared_from_this());
-      if(!socket->is_open()) {
+      if(!socket_open) {
          fc_elog(logger,"socket not open to ${p}",("p",peer_name()));
          my_impl->close(c.lock());
          return;
       }
+      // the out queue keeps the buffers alive and is not touched again until the write completes
       std::vector<boost::asio::const_buffer> bufs;
       buffer_queue.fill_out_buffer( bufs );
-      boost::asio::async_write(*socket, bufs, [c](boost::system::error_code ec, std::size_t w) {
-            try {
-               auto conn = c.lock();
-               if(!conn)
-                  return;
+      boost::asio::post( strand, [c, bufs = std::move(bufs), s = session.load()]() {
+         auto conn = c.lock();
+         if(!conn)
+            return;
+         auto on_write = [c, s](boost::system::error_code ec, std::size_t w) {
+            if( auto conn = c.lock() ) {
+               conn->bytes_sent += w;
+            }
+            app().get_io_service().post( [c, s, ec, w]() {
+               try {
+                  auto conn = c.lock();
+                  if(!conn)
+                     return;
 
-               conn->buffer_queue.out_callback( ec, w );
+                  conn->buffer_queue.out_callback( ec, w );
 
-               if(ec) {
-                  string pname = conn ? conn->peer_name() : "no connection name";
-                  if( ec.value() != boost::asio::error::eof) {
-                     elog("Error sending to peer ${p}: ${i}", ("p",pname)("i", ec.message()));
+                  if( s != conn->session ) {
+                     // closed while the write was in flight, the queue may already hold the next session's messages
+                     conn->buffer_queue.clear_out_queue();
+                     conn->do_queue_write();
+                     return;
                   }
-                  else {
-                     ilog("connection closure detected on write to ${p}",("p",pname));
+                  if(ec) {
+                     string pname = conn ? conn->peer_name() : "no connection name";
+                     if( ec.value() != boost::asio::error::eof) {
+                        elog("Error sending to peer ${p}: ${i}", ("p",pname)("i", ec.message()));
+                     }
+                     else {
+                        ilog("connection closure detected on write to ${p}",("p",pname));
+                     }
+                     my_impl->close(conn);
+                     return;
                   }
-                  my_impl->close(conn);
-                  return;
+                  conn->buffer_queue.clear_out_queue();
+                  conn->enqueue_sync_block();
+                  conn->do_queue_write();
                }
-               conn->buffer_queue.clear_out_queue();
-               conn->enqueue_sync_block();
-               conn->do_queue_write();
-            }
-            catch(const std::exception &ex) {
-               auto conn = c.lock();
-               string pname = conn ? conn->peer_name() : "no connection name";
-               elog("Exception in do_queue_write to ${p} ${s}", ("p",pname)("s",ex.what()));
-            }
-            catch(const fc::exception &ex) {
-               auto conn = c.lock();
-               string pname = conn ? conn->peer_name() : "no connection name";
-               elog("Exception in do_queue_write to ${p} ${s}", ("p",pname)("s",ex.to_string()));
-            }
-            catch(...) {
-               auto conn = c.lock();
-               string pname = conn ? conn->peer_name() : "no connection name";
-               elog("Exception in do_queue_write to ${p}", ("p",pname) );
-            }
-         });
+               catch(const std::exception &ex) {
+                  auto conn = c.lock();
+                  string pname = conn ? conn->peer_name() : "no connection name";
+                  elog("Exception in do_queue_write to ${p} ${s}", ("p",pname)("s",ex.what()));
+               }
+               catch(const fc::exception &ex) {
+                  auto conn = c.lock();
+                  string pname = conn ? conn->peer_name() : "no connection name";
+                  elog("Exception in do_queue_write to ${p} ${s}", ("p",pname)("s",ex.to_string()));
+               }
+               catch(...) {
+                  auto conn = c.lock();
+                  string pname = conn ? conn->peer_name() : "no connection name";
+                  elog("Exception in do_queue_write to ${p}", ("p",pname) );
+               }
+            });
+         };
+         if( s != conn->session ) {
+            on_write( boost::asio::error::operation_aborted, 0 );
+            return;
+         }
+         boost::asio::async_write( *conn->socket, bufs, boost::asio::bind_executor( conn->strand, on_write ));
+      });
    }
 
    void connection::cancel_sync(go_away_reason reason) {
@@ -1131,6 +1451,12 @@ namespace snax {
          peer_requested.reset();
       }
       try {
+         // irreversible blocks are sent as they are in the block log, without unpacking and packing them again
+         auto packed = cc.fetch_packed_block_by_number(num);
+         if(packed) {
+            enqueue_packed_block( packed, trigger_send, true );
+            return true;
+         }
          signed_block_ptr sb = cc.fetch_block_by_number(num);
          if(sb) {
             enqueue( *sb, trigger_send, true);
@@ -1148,17 +1474,62 @@ namespace snax {
          close_after_send = m.get<go_away_message>().reason;
       }
 
-      uint32_t payload_size = fc::raw::pack_size( m );
-      char * header = reinterpret_cast<char*>(&payload_size);
-      size_t header_size = sizeof(payload_size);
+      auto send_buffer = create_send_buffer( m );
+      if( compress_sends() && send_buffer->size() - message_header_size >= def_compression_threshold ) {
+         // queued from the completion handlers of earlier writes, so it has to trigger its own send
+         compress_and_enqueue( [send_buffer]() { return compress_send_buffer( send_buffer ); },
+                               [this, send_buffer, to_sync_queue, close_after_send]( const send_buffer_ptr& compressed ) {
+                                  write_buffer( compressed ? compressed : send_buffer, true, to_sync_queue, close_after_send );
+                               });
+         return;
+      }
+      enqueue_buffer( send_buffer, trigger_send, to_sync_queue, close_after_send );
+   }
 
-      size_t buffer_size = header_size + payload_size;
+   void connection::enqueue_buffer( const send_buffer_ptr& send_buffer, bool trigger_send, bool to_sync_queue,
+                                    go_away_reason close_after_send ) {
+      if( !deferred_sends.empty() ) {
+         complete_deferred_send( defer_send( [this, to_sync_queue, close_after_send]( const send_buffer_ptr& b ) {
+                                    write_buffer( b, true, to_sync_queue, close_after_send );
+                                 }), send_buffer );
+         return;
+      }
+      write_buffer( send_buffer, trigger_send, to_sync_queue, close_after_send );
+   }
 
-      auto send_buffer = std::make_shared<vector<char>>(buffer_size);
-      fc::datastream<char*> ds( send_buffer->data(), buffer_size);
-      ds.write( header, header_size );
-      fc::raw::pack( ds, m );
+   connection::deferred_send_ptr connection::defer_send( std::function<void(const send_buffer_ptr&)> queue ) {
+      auto d = std::make_shared<deferred_send>();
+      d->queue = std::move( queue );
+      deferred_sends.push_back( d );
+      return d;
+   }
+
+   void connection::complete_deferred_send( const deferred_send_ptr& d, const send_buffer_ptr& buffer ) {
+      // a send dropped by close is no longer in the deque
+      d->buffer = buffer;
+      d->ready = true;
+      while( !deferred_sends.empty() && deferred_sends.front()->ready ) {
+         auto front = std::move( deferred_sends.front() );
+         deferred_sends.pop_front();
+         front->queue( front->buffer );
+      }
+   }
+
+   void connection::compress_and_enqueue( std::function<send_buffer_ptr()> compress,
+                                          std::function<void(const send_buffer_ptr&)> queue ) {
+      auto d = defer_send( std::move( queue ) );
+      connection_wptr weak_this = shared_from_this();
+      boost::asio::post( strand, [weak_this, d, compress = std::move( compress )]() {
+         auto buffer = compress();
+         app().get_io_service().post( [weak_this, d, buffer]() {
+            if( auto conn = weak_this.lock() )
+               conn->complete_deferred_send( d, buffer );
+         });
+      });
+   }
 
+   void connection::write_buffer( const send_buffer_ptr& send_buffer, bool trigger_send, bool to_sync_queue,
+                                  go_away_reason close_after_send ) {
       connection_wptr weak_this = shared_from_this();
       queue_write(send_buffer,trigger_send,
                   [weak_this, close_after_send](boost::system::error_code ec, std::size_t ) {
@@ -1176,13 +1547,58 @@ namespace snax {
                   to_sync_queue);
    }
 
+   void connection::enqueue_packed_block( const packed_block_view& block, bool trigger_send, bool to_sync_queue ) {
+      // frame the block as the net_message holding a signed_block would be, ahead of the packed block itself
+      const fc::unsigned_int which = net_message::tag<signed_block>::value;
+      const uint32_t payload_size = fc::raw::pack_size( which ) + block.size;
+      auto header = std::make_shared<vector<char>>( sizeof(payload_size) + fc::raw::pack_size( which ) );
+      fc::datastream<char*> ds( header->data(), header->size() );
+      ds.write( reinterpret_cast<const char*>(&payload_size), sizeof(payload_size) );
+      fc::raw::pack( ds, which );
+
+      connection_wptr weak_this = shared_from_this();
+      auto callback = [weak_this](boost::system::error_code ec, std::size_t ) {
+         if( !weak_this.lock() ) {
+            fc_wlog(logger, "connection expired before enqueued net_message called callback!");
+         }
+      };
+      auto write = [this, header, block, callback, to_sync_queue]( const send_buffer_ptr& compressed, bool trigger ) {
+         if( compressed ) {
+            queue_write( compressed, trigger, callback, to_sync_queue );
+         } else if( queue_write( header, false, callback, to_sync_queue ) ) {
+            queue_write( block.owner, boost::asio::buffer( block.data, block.size ), trigger, callback, to_sync_queue );
+         }
+      };
+      if( compress_sends() ) {
+         compress_and_enqueue( [header, block]() {
+                                  try {
+                                     return create_compressed_send_buffer( { boost::asio::buffer( *header ) + sizeof(uint32_t),
+                                                                             boost::asio::buffer( block.data, block.size ) } );
+                                  } catch( ... ) {
+                                     elog( "Unable to compress block of ${s} bytes, sending it uncompressed", ("s", block.size) );
+                                     return send_buffer_ptr();
+                                  }
+                               },
+                               [write]( const send_buffer_ptr& compressed ) { write( compressed, true ); } );
+      } else if( !deferred_sends.empty() ) {
+         complete_deferred_send( defer_send( [write]( const send_buffer_ptr& ) { write( send_buffer_ptr(), true ); } ),
+                                 send_buffer_ptr() );
+      } else {
+         write( send_buffer_ptr(), trigger_send );
+      }
+   }
+
    void connection::cancel_wait() {
       if (response_expected)
          response_expected->cancel();
    }
 
    void connection::sync_wait( ) {
-      response_expected->expires_from_now( my_impl->resp_expected_period);
+      sync_wait( my_impl->sync_master->stall_timeout( *this ) );
+   }
+
+   void connection::sync_wait( boost::asio::steady_timer::duration timeout ) {
+      response_expected->expires_from_now( timeout );
       connection_wptr c(shared_from_this());
       response_expected->async_wait( [c]( boost::system::error_code ec){
             connection_ptr conn = c.lock();
@@ -1211,6 +1627,14 @@ namespace snax {
 
    void connection::sync_timeout( boost::system::error_code ec ) {
       if( !ec ) {
+         // the main thread may expire the timer while it applies a window of blocks, or run an expiry queued before
+         // the timer was re-armed, so the peer has stalled only if its strand has not unpacked a block for as long
+         const auto since_block = std::chrono::microseconds( fc::time_point::now().time_since_epoch().count() - last_block_received );
+         const auto timeout = my_impl->sync_master->stall_timeout( *this );
+         if( since_block < timeout ) {
+            sync_wait( timeout - since_block );
+            return;
+         }
          my_impl->sync_master->reassign_fetch (shared_from_this(),benign_other);
       }
       else if( ec == boost::asio::error::operation_aborted) {
@@ -1252,32 +1676,63 @@ namespace snax {
       sync_wait();
    }
 
-   bool connection::process_next_message(net_plugin_impl& impl, uint32_t message_length) {
+   bool connection::process_next_message(net_plugin_impl& impl, uint32_t message_length, bool compressed, uint32_t session) {
       try {
-         // If it is a signed_block, then save the raw message for the cache
-         // This must be done before we unpack the message.
-         // This code is copied from fc::io::unpack(..., unsigned_int)
-         auto index = pending_message_buffer.read_index();
-         uint64_t which = 0; char b = 0; uint8_t by = 0;
-         do {
-            pending_message_buffer.peek(&b, 1, index);
-            which |= uint32_t(uint8_t(b) & 0x7f) << by;
-            by += 7;
-         } while( uint8_t(b) & 0x80 && by < 32);
-
-         if (which == uint64_t(net_message::tag<signed_block>::value)) {
-            blk_buffer.resize(message_length);
+         auto msg = std::make_shared<net_message>();
+         if( compressed ) {
+            vector<char> frame( message_length );
             auto index = pending_message_buffer.read_index();
-            pending_message_buffer.peek(blk_buffer.data(), message_length, index);
+            pending_message_buffer.peek( frame.data(), message_length, index );
+            pending_message_buffer.advance_read_ptr( message_length );
+            auto payload = zlib_decompress( frame.data(), frame.size(), def_send_buffer_size*2 );
+            fc::datastream<const char*> ds( payload.data(), payload.size() );
+            fc::raw::unpack(ds, *msg);
+         } else {
+            // If it is a signed_block, then save the raw message for the cache
+            // This must be done before we unpack the message.
+            // This code is copied from fc::io::unpack(..., unsigned_int)
+            auto index = pending_message_buffer.read_index();
+            uint64_t which = 0; char b = 0; uint8_t by = 0;
+            do {
+               pending_message_buffer.peek(&b, 1, index);
+               which |= uint32_t(uint8_t(b) & 0x7f) << by;
+               by += 7;
+            } while( uint8_t(b) & 0x80 && by < 32);
+
+            if (which == uint64_t(net_message::tag<signed_block>::value)) {
+               blk_buffer.resize(message_length);
+               auto index = pending_message_buffer.read_index();
+               pending_message_buffer.peek(blk_buffer.data(), message_length, index);
+            }
+            auto ds = pending_message_buffer.create_datastream();
+            fc::raw::unpack(ds, *msg);
          }
-         auto ds = pending_message_buffer.create_datastream();
-         net_message msg;
-         fc::raw::unpack(ds, msg);
-         msgHandler m(impl, shared_from_this() );
-         msg.visit(m);
+         const auto received = fc::time_point::now();
+         if( msg->contains<signed_block>() ) {
+            last_block_received = received.time_since_epoch().count();
+         }
+         ++reads_in_flight;
+         connection_wptr weak_conn = shared_from_this();
+         app().get_io_service().post( [&impl, weak_conn, session, msg, received]() {
+            auto c = weak_conn.lock();
+            if( !c ) return;
+            --c->reads_in_flight;
+            if( session != c->session ) return;
+            try {
+               impl.current_message_received = received;
+               msgHandler m( impl, c );
+               msg->visit( m );
+            } catch( const fc::exception& e ) {
+               edump((e.to_detail_string() ));
+               impl.close( c );
+            } catch( const std::exception& e ) {
+               elog( "Exception handling message from ${p}: ${s}", ("p",c->peer_name())("s",e.what()) );
+               impl.close( c );
+            }
+         });
       } catch(  const fc::exception& e ) {
          edump((e.to_detail_string() ));
-         impl.close( shared_from_this() );
+         impl.post_to_main( shared_from_this(), session, [&impl]( const connection_ptr& c ) { impl.close( c ); } );
          return false;
       }
       return true;
@@ -1303,12 +1758,13 @@ namespace snax {
 
    //-----------------------------------------------------------
 
-    sync_manager::sync_manager( uint32_t req_span )
+    sync_manager::sync_manager( uint32_t req_span, uint32_t max_peers )
       :sync_known_lib_num( 0 )
       ,sync_last_requested_num( 0 )
       ,sync_next_expected_num( 1 )
       ,sync_req_span( req_span )
-      ,source()
+      ,sync_max_peers( max_peers )
+      ,sync_ranges()
       ,state(in_sync)
    {
       chain_plug = app( ).find_plugin<chain_plugin>( );
@@ -1343,19 +1799,50 @@ namespace snax {
    }
 
    void sync_manager::reset_lib_num(connection_ptr c) {
-      if(state == in_sync) {
-         source.reset();
-      }
       if( c->current() ) {
          if( c->last_handshake_recv.last_irreversible_block_num > sync_known_lib_num) {
             sync_known_lib_num =c->last_handshake_recv.last_irreversible_block_num;
          }
-      } else if( c == source ) {
-         sync_last_requested_num = 0;
+      } else if( release_range( c ) ) {
          request_next_chunk();
       }
    }
 
+   std::map<uint32_t, sync_manager::sync_range>::iterator sync_manager::find_range( const connection_ptr& c ) {
+      return std::find_if( sync_ranges.begin(), sync_ranges.end(),
+                           [&c]( const auto& r ) { return r.second.peer == c; } );
+   }
+
+   bool sync_manager::release_range( const connection_ptr& c ) {
+      auto r = find_range( c );
+      if( r == sync_ranges.end() ) {
+         return false;
+      }
+      fc_dlog(logger, "releasing range ${s} to ${e} from ${p}",
+              ("s",r->second.next)("e",r->second.end)("p",c->peer_name()));
+      r->second.peer.reset();
+      return true;
+   }
+
+   void sync_manager::reset_ranges() {
+      for( auto& r : sync_ranges ) {
+         if( r.second.peer ) {
+            r.second.peer->cancel_sync( benign_other );
+         }
+      }
+      sync_ranges.clear();
+   }
+
+   boost::asio::steady_timer::duration sync_manager::stall_timeout( const connection& c ) const {
+      if( c.sync_rate <= 0 ) {
+         return def_sync_stall_timeout;
+      }
+      // a peer has stalled once it falls well behind the rate it has been delivering blocks at
+      boost::asio::steady_timer::duration expected = std::chrono::microseconds( static_cast<int64_t>( 8 * 1000000 / c.sync_rate ) );
+      return std::min<boost::asio::steady_timer::duration>(
+            std::max<boost::asio::steady_timer::duration>( expected, def_sync_min_stall_timeout ), def_sync_stall_timeout );
+   }
+
    bool sync_manager::sync_required( ) {
       fc_dlog(logger, "last req = ${req}, last recv = ${recv} known = ${known} our head = ${head}",
               ("req",sync_last_requested_num)("recv",sync_next_expected_num)("known",sync_known_lib_num)("head",chain_plug->chain( ).fork_db_head_block_num( )));
@@ -1364,86 +1851,73 @@ namespace snax {
               chain_plug->chain( ).fork_db_head_block_num( ) < sync_last_requested_num );
    }
 
-   void sync_manager::request_next_chunk( connection_ptr conn ) {
-      uint32_t head_block = chain_plug->chain().fork_db_head_block_num();
-
-      if (head_block < sync_last_requested_num && source && source->current()) {
-         fc_ilog (logger, "ignoring request, head is ${h} last req = ${r} source is ${p}",
-                  ("h",head_block)("r",sync_last_requested_num)("p",source->peer_name()));
+   void sync_manager::request_next_chunk() {
+      if( state != lib_catchup ) {
          return;
       }
+      uint32_t head_block = chain_plug->chain().fork_db_head_block_num();
+      // blocks received ahead of the next one in order are held until it arrives, bound how far ahead ranges go
+      uint32_t lookahead = head_block + 2 * sync_req_span * sync_max_peers;
 
       /* ----------
-       * next chunk provider selection criteria
-       * a provider is supplied and able to be used, use it.
-       * otherwise select the next available from the list, round-robin style.
+       * range provider selection criteria
+       * every current peer not already serving a range is a candidate, fastest first. peers not measured
+       * yet go first so each gets to show its rate. a range released by a stalled or closed peer is assigned
+       * before a new one, the blocks after it cannot be applied until it is in.
        */
-
-      if (conn && conn->current() ) {
-         source = conn;
+      vector<connection_ptr> idle;
+      for( const auto& c : my_impl->connections ) {
+         if( c->current() && find_range( c ) == sync_ranges.end() ) {
+            idle.push_back( c );
+         }
       }
-      else {
-         if (my_impl->connections.size() == 1) {
-            if (!source) {
-               source = *my_impl->connections.begin();
-            }
+      auto score = []( const connection_ptr& c ) {
+         return c->sync_rate > 0 ? c->sync_rate : std::numeric_limits<double>::max();
+      };
+      std::stable_sort( idle.begin(), idle.end(), [&score]( const connection_ptr& a, const connection_ptr& b ) {
+         return score( a ) > score( b );
+      });
+      auto peer_has = []( const connection_ptr& c, uint32_t blk_num ) {
+         return std::max( c->last_handshake_recv.head_num, c->last_handshake_recv.last_irreversible_block_num ) >= blk_num;
+      };
+
+      size_t assigned = std::count_if( sync_ranges.begin(), sync_ranges.end(),
+                                       []( const auto& r ) { return r.second.peer != nullptr; } );
+      for( const auto& c : idle ) {
+         if( assigned >= sync_max_peers ) {
+            break;
          }
-         else {
-            // init to a linear array search
-            auto cptr = my_impl->connections.begin();
-            auto cend = my_impl->connections.end();
-            // do we remember the previous source?
-            if (source) {
-               //try to find it in the list
-               cptr = my_impl->connections.find(source);
-               cend = cptr;
-               if (cptr == my_impl->connections.end()) {
-                  //not there - must have been closed! cend is now connections.end, so just flatten the ring.
-                  source.reset();
-                  cptr = my_impl->connections.begin();
-               } else {
-                  //was found - advance the start to the next. cend is the old source.
-                  if (++cptr == my_impl->connections.end() && cend != my_impl->connections.end() ) {
-                     cptr = my_impl->connections.begin();
-                  }
-               }
+         auto r = std::find_if( sync_ranges.begin(), sync_ranges.end(),
+                                [&]( const auto& r ) { return !r.second.peer && peer_has( c, r.second.end ); } );
+         if( r == sync_ranges.end() ) {
+            uint32_t start = sync_last_requested_num ? sync_last_requested_num + 1 : sync_next_expected_num;
+            uint32_t end = std::min( start + sync_req_span - 1, sync_known_lib_num );
+            if( start > end || start > lookahead || !peer_has( c, end ) ) {
+               continue;
             }
-
-            //scan the list of peers looking for another able to provide sync blocks.
-            auto cstart_it = cptr;
-            do {
-               //select the first one which is current and break out.
-               if((*cptr)->current()) {
-                  source = *cptr;
-                  break;
-               }
-               if(++cptr == my_impl->connections.end())
-                     cptr = my_impl->connections.begin();
-            } while(cptr != cstart_it);
-            // no need to check the result, either source advanced or the whole list was checked and the old source is reused.
+            sync_range range;
+            range.end = end;
+            range.next = start;
+            r = sync_ranges.emplace( start, range ).first;
+            sync_last_requested_num = end;
          }
-      }
-
-      // verify there is an available source
-      if (!source || !source->current() ) {
+         r->second.peer = c;
+         r->second.requested = fc::time_point::now();
+         r->second.requested_from = r->second.next;
+         ++assigned;
+         fc_ilog(logger, "requesting range ${s} to ${e}, from ${n}",
+                 ("n",c->peer_name())("s",r->second.next)("e",r->second.end));
+         c->request_sync_blocks( r->second.next, r->second.end );
+      }
+
+      // verify there is an available source for the blocks still to come
+      uint32_t start = sync_last_requested_num ? sync_last_requested_num + 1 : sync_next_expected_num;
+      if( assigned == 0 && ( !sync_ranges.empty() || ( start <= sync_known_lib_num && start <= lookahead ) ) ) {
          elog("Unable to continue syncing at this time");
          sync_known_lib_num = chain_plug->chain().last_irreversible_block_num();
          sync_last_requested_num = 0;
+         reset_ranges();
          set_state(in_sync); // probably not, but we can't do anything else
-         return;
-      }
-
-      if( sync_last_requested_num != sync_known_lib_num ) {
-         uint32_t start = sync_next_expected_num;
-         uint32_t end = start + sync_req_span - 1;
-         if( end > sync_known_lib_num )
-            end = sync_known_lib_num;
-         if( end > 0 && end >= start ) {
-            fc_ilog(logger, "requesting range ${s} to ${e}, from ${n}",
-                    ("n",source->peer_name())("s",start)("e",end));
-            source->request_sync_blocks(start, end);
-            sync_last_requested_num = end;
-         }
       }
    }
 
@@ -1472,21 +1946,24 @@ namespace snax {
       if (state == in_sync) {
          set_state(lib_catchup);
          sync_next_expected_num = chain_plug->chain().last_irreversible_block_num() + 1;
+         sync_last_requested_num = 0;
+         reset_ranges();
       }
 
       fc_ilog(logger, "Catching up with chain, our last req is ${cc}, theirs is ${t} peer ${p}",
               ( "cc",sync_last_requested_num)("t",target)("p",c->peer_name()));
 
-      request_next_chunk(c);
+      request_next_chunk();
    }
 
    void sync_manager::reassign_fetch(connection_ptr c, go_away_reason reason) {
       fc_ilog(logger, "reassign_fetch, our last req is ${cc}, next expected is ${ne} peer ${p}",
               ( "cc",sync_last_requested_num)("ne",sync_next_expected_num)("p",c->peer_name()));
 
-      if (c == source) {
+      if( release_range( c ) ) {
          c->cancel_sync (reason);
-         sync_last_requested_num = 0;
+         // a stalled peer is asked again only after the peers delivering at a better rate
+         c->sync_rate = c->sync_rate > 0 ? c->sync_rate / 2 : def_stalled_sync_rate;
          request_next_chunk();
       }
    }
@@ -1616,26 +2093,50 @@ namespace snax {
       if (state != in_sync ) {
          fc_ilog (logger, "block ${bn} not accepted from ${p}",("bn",blk_num)("p",c->peer_name()));
          sync_last_requested_num = 0;
-         source.reset();
+         reset_ranges();
          my_impl->close(c);
          set_state(in_sync);
          send_handshakes();
       }
    }
+
+   bool sync_manager::sync_block_received (connection_ptr c, uint32_t blk_num) {
+      auto r = find_range( c );
+      if( r == sync_ranges.end() || blk_num != r->second.next ) {
+         // left over from a range that was cancelled or reassigned
+         fc_dlog(logger, "ignoring sync block ${bn} from ${p}",("bn",blk_num)("p",c->peer_name()));
+         if( r != sync_ranges.end() ) {
+            c->sync_wait();
+         }
+         return false;
+      }
+      if( ++r->second.next <= r->second.end ) {
+         c->sync_wait();
+         return true;
+      }
+
+      // timed by when the strand unpacked the block, the main thread may have been busy applying blocks since
+      fc::microseconds elapsed = my_impl->current_message_received - r->second.requested;
+      double rate = ( r->second.end - r->second.requested_from + 1 ) * 1000000.0 / std::max<int64_t>( elapsed.count(), 1 );
+      c->sync_rate = c->sync_rate > 0 ? 0.7 * c->sync_rate + 0.3 * rate : rate;
+      fc_dlog(logger, "range ${s} to ${e} received from ${p}, sync rate ${r} blocks/sec",
+              ("s",r->second.requested_from)("e",r->second.end)("p",c->peer_name())("r",c->sync_rate));
+      sync_ranges.erase( r );
+      request_next_chunk();
+      return true;
+   }
+
    void sync_manager::recv_block (connection_ptr c, const block_id_type &blk_id, uint32_t blk_num) {
       fc_dlog(logger," got block ${bn} from ${p}",("bn",blk_num)("p",c->peer_name()));
       if (state == lib_catchup) {
-         if (blk_num != sync_next_expected_num) {
-            fc_ilog (logger, "expected block ${ne} but got ${bn}",("ne",sync_next_expected_num)("bn",blk_num));
-            my_impl->close(c);
-            return;
+         // blocks are applied in order, a known block also means all the blocks before it are known
+         if( blk_num >= sync_next_expected_num ) {
+            sync_next_expected_num = blk_num + 1;
          }
-         sync_next_expected_num = blk_num + 1;
       }
       if (state == head_catchup) {
          fc_dlog (logger, "sync_manager in head_catchup state");
          set_state(in_sync);
-         source.reset();
 
          block_id_type null_id;
          for (auto cp : my_impl->connections) {
@@ -1657,12 +2158,9 @@ namespace snax {
             set_state(in_sync);
             send_handshakes();
          }
-         else if (blk_num == sync_last_requested_num) {
-            request_next_chunk();
-         }
          else {
-            fc_dlog(logger,"calling sync_wait on connection ${p}",("p",c->peer_name()));
-            c->sync_wait();
+            // applying blocks makes room for ranges held back by the lookahead
+            request_next_chunk();
          }
       }
    }
@@ -1677,9 +2175,11 @@ namespace snax {
       }
       received_blocks.erase(range.first, range.second);
 
-      net_message msg(bsum);
-      uint32_t packsiz = fc::raw::pack_size(msg);
-      uint32_t msgsiz = packsiz + sizeof(packsiz);
+      // packed once, the size on the wire is taken from the same buffer sent to every peer
+      auto start = fc::time_point::now();
+      auto send_buffer = create_send_buffer( net_message(bsum) );
+      auto pack_time = fc::time_point::now() - start;
+      uint32_t msgsiz = send_buffer->size();
       notice_message pending_notify;
       block_id_type bid = bsum.id();
       uint32_t bnum = bsum.block_num();
@@ -1704,13 +2204,41 @@ namespace snax {
       }
       else {
          pbstate.is_known = true;
-         for (auto cp : my_impl->connections) {
-            if (skips.find(cp) != skips.end() || !cp->current()) {
-               continue;
+         // peers holding every transaction of the block get it compact, the others in full
+         send_buffer_ptr compact;
+         vector<transaction_id_type> trx_ids;
+         start = fc::time_point::now();
+         if( my_impl->compact_blocks ) {
+            for( const auto& r : bsum.transactions ) {
+               if( r.trx.contains<packed_transaction>() ) {
+                  trx_ids.emplace_back( r.trx.get<packed_transaction>().id() );
+               }
+            }
+            if( !trx_ids.empty() ) {
+               compact = create_compact_block_buffer( bsum, trx_ids );
             }
-            cp->add_peer_block(pbstate);
-            cp->enqueue( bsum );
          }
+         auto send_compact = [&compact, &trx_ids]( const connection_ptr& c ) {
+            return compact && c->compact_blocks() &&
+                   std::all_of( trx_ids.begin(), trx_ids.end(), [&c]( const transaction_id_type& id ) {
+                      auto ts = c->trx_state.find( id );
+                      return ts != c->trx_state.end() && ts->is_known_by_peer;
+                   });
+         };
+         if( compact ) {
+            my_impl->send_all( compact, fc::time_point::now() - start, [&skips, pbstate, &send_compact](connection_ptr c) -> bool {
+               if( skips.find(c) != skips.end() || !send_compact( c ) )
+                  return false;
+               c->add_peer_block(pbstate);
+               return true;
+               });
+         }
+         my_impl->send_all( send_buffer, pack_time, [&skips, pbstate, &send_compact](connection_ptr c) -> bool {
+            if( skips.find(c) != skips.end() || send_compact( c ) )
+               return false;
+            c->add_peer_block(pbstate);
+            return true;
+            });
       }
    }
 
@@ -1757,39 +2285,29 @@ namespace snax {
       }
       received_transactions.erase(range.first, range.second);
 
-      for (auto ref = req_trx.begin(); ref != req_trx.end(); ++ref) {
-         if (*ref == id) {
-            req_trx.erase(ref);
-            break;
-         }
-      }
+      req_trx.erase(id);
 
       if( my_impl->local_txns.get<by_id>().find( id ) != my_impl->local_txns.end( ) ) { //found
          fc_dlog(logger, "found trxid in local_trxs" );
          return;
       }
-      uint32_t packsiz = 0;
-      uint32_t bufsiz = 0;
-
       time_point_sec trx_expiration = trx.expiration();
 
-      net_message msg(trx);
-      packsiz = fc::raw::pack_size(msg);
-      bufsiz = packsiz + sizeof(packsiz);
-      vector<char> buff(bufsiz);
-      fc::datastream<char*> ds( buff.data(), bufsiz);
-      ds.write( reinterpret_cast<char*>(&packsiz), sizeof(packsiz) );
-      fc::raw::pack( ds, msg );
+      // packed once, the same buffer is kept for later requests and sent to every peer
+      auto start = fc::time_point::now();
+      auto send_buffer = create_send_buffer( net_message(trx) );
+      auto pack_time = fc::time_point::now() - start;
+      uint32_t bufsiz = send_buffer->size();
       node_transaction_state nts = {id,
                                     trx_expiration,
                                     trx,
-                                    std::move(buff),
+                                    send_buffer,
                                     0, 0, 0};
       my_impl->local_txns.insert(std::move(nts));
 
       if( !large_msg_notify || bufsiz <= just_send_it_max) {
-         my_impl->send_all( trx, [id, &skips, trx_expiration](connection_ptr c) -> bool {
-               if( skips.find(c) != skips.end() || c->syncing ) {
+         my_impl->send_all( send_buffer, pack_time, [id, &skips, trx_expiration](connection_ptr c) -> bool {
+               if( skips.find(c) != skips.end() || c->syncing || c->announce_transactions() ) {
                   return false;
                }
                const auto& bs = c->trx_state.find(id);
@@ -1826,6 +2344,51 @@ namespace snax {
             });
       }
 
+      for( const auto& c : my_impl->connections ) {
+         if( !c->current() || !c->announce_transactions() || skips.find(c) != skips.end() ) {
+            continue;
+         }
+         const auto& bs = c->trx_state.find(id);
+         if( bs == c->trx_state.end() ) {
+            c->trx_state.insert(transaction_state({id,false,true,0,trx_expiration,time_point() }));
+            announce_transaction( c, id );
+         } else {
+            update_txn_expiry ute(trx_expiration);
+            c->trx_state.modify(bs, ute);
+         }
+      }
+   }
+
+   void dispatch_manager::announce_transaction (const connection_ptr& c, const transaction_id_type& id) {
+      // ids are batched with every other transaction broadcast before the main thread gets to the flush
+      c->pending_announcements.push_back( id );
+      if( c->pending_announcements.size() >= def_max_trx_announcement ) {
+         flush_announcements();
+      } else if( !announce_scheduled ) {
+         announce_scheduled = true;
+         app().get_io_service().post( []() {
+            my_impl->dispatcher->flush_announcements();
+         });
+      }
+   }
+
+   void dispatch_manager::flush_announcements () {
+      announce_scheduled = false;
+      for( const auto& c : my_impl->connections ) {
+         if( c->pending_announcements.empty() ) {
+            continue;
+         }
+         notice_message note;
+         note.known_trx.mode = normal;
+         note.known_trx.pending = c->pending_announcements.size();
+         note.known_trx.ids = std::move( c->pending_announcements );
+         note.known_blocks.mode = none;
+         c->pending_announcements.clear();
+         if( c->current() ) {
+            fc_dlog(logger, "announcing ${n} transactions to ${p}", ("n",note.known_trx.ids.size())("p",c->peer_name()));
+            c->enqueue( note );
+         }
+      }
    }
 
    void dispatch_manager::recv_transaction (connection_ptr c, const transaction_id_type& id) {
@@ -1846,6 +2409,7 @@ namespace snax {
       fc_dlog(logger,"not sending rejected transaction ${tid}",("tid",id));
       auto range = received_transactions.equal_range(id);
       received_transactions.erase(range.first, range.second);
+      req_trx.erase(id);
    }
 
    void dispatch_manager::recv_notice (connection_ptr c, const notice_message& msg, bool generated) {
@@ -1857,6 +2421,7 @@ namespace snax {
       if (msg.known_trx.mode == normal) {
          req.req_trx.mode = normal;
          req.req_trx.pending = 0;
+         auto now = fc::time_point::now();
          for( const auto& t : msg.known_trx.ids ) {
             const auto &tx = my_impl->local_txns.get<by_id>( ).find( t );
 
@@ -1866,14 +2431,19 @@ namespace snax {
                //At this point the details of the txn are not known, just its id. This
                //effectively gives 120 seconds to learn of the details of the txn which
                //will update the expiry in bcast_transaction
-               c->trx_state.insert( (transaction_state){t,true,true,0,time_point_sec(time_point::now()) + 120,
-                        time_point()} );
+               c->trx_known_by_peer( t, time_point_sec(time_point::now()) + 120 );
 
+               // announced by several peers, the transaction is requested from the first
+               auto requested = req_trx.find( t );
+               if( requested != req_trx.end() && requested->second + def_trx_request_wait > now ) {
+                  continue;
+               }
                req.req_trx.ids.push_back( t );
-               req_trx.push_back( t );
+               req_trx[t] = now;
             }
             else {
                fc_dlog(logger,"big msg manager found txn id in table, ${id}",("id", t));
+               c->trx_known_by_peer( t, tx->expires );
             }
          }
          send_req = !req.req_trx.ids.empty();
@@ -2021,53 +2591,67 @@ namespace snax {
       ++endpoint_itr;
       c->connecting = true;
       connection_wptr weak_conn = c;
-      c->socket->async_connect( current_endpoint, [weak_conn, endpoint_itr, this] ( const boost::system::error_code& err ) {
-            auto c = weak_conn.lock();
-            if (!c) return;
-            if( !err && c->socket->is_open() ) {
-               if (start_session( c )) {
-                  c->send_handshake ();
-               }
-            } else {
-               if( endpoint_itr != tcp::resolver::iterator() ) {
-                  close(c);
-                  connect( c, endpoint_itr );
-               }
-               else {
-                  elog( "connection failed to ${peer}: ${error}",
-                        ( "peer", c->peer_name())("error",err.message()));
-                  c->connecting = false;
-                  my_impl->close(c);
-               }
-            }
-         } );
+      uint32_t session = c->session;
+      boost::asio::post( c->strand, [weak_conn, current_endpoint, endpoint_itr, session, this]() {
+         auto c = weak_conn.lock();
+         if (!c) return;
+         c->socket->async_connect( current_endpoint, boost::asio::bind_executor( c->strand,
+            [weak_conn, endpoint_itr, session, this] ( const boost::system::error_code& err ) {
+               auto c = weak_conn.lock();
+               if (!c) return;
+               bool open = c->socket->is_open();
+               post_to_main( c, session, [endpoint_itr, err, open, this]( const connection_ptr& c ) {
+                  if( !err && open ) {
+                     if (start_session( c )) {
+                        c->send_handshake ();
+                     }
+                  } else {
+                     if( endpoint_itr != tcp::resolver::iterator() ) {
+                        close(c);
+                        connect( c, endpoint_itr );
+                     }
+                     else {
+                        elog( "connection failed to ${peer}: ${error}",
+                              ( "peer", c->peer_name())("error",err.message()));
+                        c->connecting = false;
+                        my_impl->close(c);
+                     }
+                  }
+               } );
+            } ) );
+      } );
    }
 
    bool net_plugin_impl::start_session( connection_ptr con ) {
-      boost::asio::ip::tcp::no_delay nodelay( true );
-      boost::system::error_code ec;
-      con->socket->set_option( nodelay, ec );
-      if (ec) {
-         elog( "connection failed to ${peer}: ${error}",
-               ( "peer", con->peer_name())("error",ec.message()));
-         con->connecting = false;
-         close(con);
-         return false;
-      }
-      else {
-         start_read_message( con );
-         ++started_sessions;
-         return true;
-         // for now, we can just use the application main loop.
-         //     con->readloop_complete  = bf::async( [=](){ read_loop( con ); } );
-         //     con->writeloop_complete = bf::async( [=](){ write_loop con ); } );
-      }
+      con->socket_open = true;
+      connection_wptr weak_conn = con;
+      uint32_t session = con->session;
+      boost::asio::post( con->strand, [weak_conn, session, this]() {
+         auto con = weak_conn.lock();
+         if (!con) return;
+         boost::asio::ip::tcp::no_delay nodelay( true );
+         boost::system::error_code ec;
+         con->socket->set_option( nodelay, ec );
+         if (ec) {
+            post_to_main( con, session, [ec, this]( const connection_ptr& con ) {
+               elog( "connection failed to ${peer}: ${error}",
+                     ( "peer", con->peer_name())("error",ec.message()));
+               con->connecting = false;
+               close(con);
+            } );
+            return;
+         }
+         start_read_message( con, session );
+      } );
+      ++started_sessions;
+      return true;
    }
 
 
    void net_plugin_impl::start_listen_loop( ) {
-      auto socket = std::make_shared<tcp::socket>( std::ref( app().get_io_service() ) );
+      auto socket = std::make_shared<tcp::socket>( std::ref( *net_ioc ) );
       acceptor->async_accept( *socket, [socket,this]( boost::system::error_code ec ) {
+         app().get_io_service().post( [socket,ec,this]() mutable {
             if( !ec ) {
                uint32_t visitors = 0;
                uint32_t from_addr = 0;
@@ -2077,11 +2661,10 @@ namespace snax {
                }
                else {
                   for (auto &conn : connections) {
-                     if(conn->socket->is_open()) {
+                     if(conn->socket_open) {
                         if (conn->peer_addr.empty()) {
                            visitors++;
-                           boost::system::error_code ec;
-                           if (paddr == conn->socket->remote_endpoint(ec).address()) {
+                           if (paddr == conn->accepted_address) {
                               from_addr++;
                            }
                         }
@@ -2094,6 +2677,7 @@ namespace snax {
                   if( from_addr < max_nodes_per_host && (max_client_count == 0 || num_clients < max_client_count )) {
                      ++num_clients;
                      connection_ptr c = std::make_shared<connection>( socket );
+                     c->accepted_address = paddr;
                      connections.insert( c );
                      start_session( c );
 
@@ -2125,14 +2709,28 @@ namespace snax {
                      return;
                }
             }
-            start_listen_loop();
+            if( !done )
+               start_listen_loop();
          });
+      });
    }
 
-   void net_plugin_impl::start_read_message( connection_ptr conn ) {
+   template<typename F>
+   void net_plugin_impl::post_to_main( const connection_ptr& c, uint32_t session, F&& f ) {
+      connection_wptr weak_conn = c;
+      app().get_io_service().post( [weak_conn, session, f = std::forward<F>(f)]() {
+         auto c = weak_conn.lock();
+         if( c && session == c->session ) {
+            f( c );
+         }
+      });
+   }
+
+   // runs on the connection's strand, anything touching state outside of the read state is posted to the main thread
+   void net_plugin_impl::start_read_message( connection_ptr conn, uint32_t session ) {
 
       try {
-         if(!conn->socket) {
+         if(!conn->socket || session != conn->session) {
             return;
          }
          connection_wptr weak_conn = conn;
@@ -2154,46 +2752,57 @@ namespace snax {
             }
          };
 
-         if( conn->buffer_queue.write_queue_size() > def_max_write_queue_size ||
-             conn->reads_in_flight > def_max_reads_in_flight   ||
-             conn->trx_in_progress_size > def_max_trx_in_progress_size )
+         uint32_t write_queue_size = conn->buffer_queue.write_queue_size();
+         uint32_t reads_in_flight = conn->reads_in_flight;
+         uint32_t trx_in_progress_size = conn->trx_in_progress_size;
+         if( write_queue_size > def_max_write_queue_size ||
+             reads_in_flight > def_max_reads_in_flight   ||
+             trx_in_progress_size > def_max_trx_in_progress_size )
          {
             // too much queued up, reschedule
-            if( conn->buffer_queue.write_queue_size() > def_max_write_queue_size ) {
-               peer_wlog( conn, "write_queue full ${s} bytes", ("s", conn->buffer_queue.write_queue_size()) );
-            } else if( conn->reads_in_flight > def_max_reads_in_flight ) {
-               peer_wlog( conn, "max reads in flight ${s}", ("s", conn->reads_in_flight) );
-            } else {
-               peer_wlog( conn, "max trx in progress ${s} bytes", ("s", conn->trx_in_progress_size) );
-            }
-            if( conn->buffer_queue.write_queue_size() > 2*def_max_write_queue_size ||
-                conn->reads_in_flight > 2*def_max_reads_in_flight   ||
-                conn->trx_in_progress_size > 2*def_max_trx_in_progress_size )
-            {
-               fc_wlog( logger, "queues over full, giving up on connection ${p}", ("p", conn->peer_name()) );
-               my_impl->close( conn );
-               return;
-            }
-            if( !conn->read_delay_timer ) return;
-            conn->read_delay_timer->expires_from_now( def_read_delay_for_full_write_queue );
-            conn->read_delay_timer->async_wait([this, weak_conn]( boost::system::error_code ) {
-               auto conn = weak_conn.lock();
-               if( !conn ) return;
-               start_read_message( conn );
+            bool give_up = write_queue_size > 2*def_max_write_queue_size ||
+                           reads_in_flight > 2*def_max_reads_in_flight   ||
+                           trx_in_progress_size > 2*def_max_trx_in_progress_size;
+            post_to_main( conn, session, [write_queue_size, reads_in_flight, trx_in_progress_size, give_up, this]( const connection_ptr& conn ) {
+               if( write_queue_size > def_max_write_queue_size ) {
+                  peer_wlog( conn, "write_queue full ${s} bytes", ("s", write_queue_size) );
+               } else if( reads_in_flight > def_max_reads_in_flight ) {
+                  peer_wlog( conn, "max reads in flight ${s}", ("s", reads_in_flight) );
+               } else {
+                  peer_wlog( conn, "max trx in progress ${s} bytes", ("s", trx_in_progress_size) );
+               }
+               if( give_up ) {
+                  fc_wlog( logger, "queues over full, giving up on connection ${p}", ("p", conn->peer_name()) );
+                  close( conn );
+               }
             } );
+            if( give_up ) return;
+            conn->read_delay_timer->expires_from_now( def_read_delay_for_full_write_queue );
+            conn->read_delay_timer->async_wait( boost::asio::bind_executor( conn->strand,
+               [this, weak_conn, session]( boost::system::error_code ) {
+                  auto conn = weak_conn.lock();
+                  if( !conn ) return;
+                  start_read_message( conn, session );
+               } ) );
             return;
          }
 
          ++conn->reads_in_flight;
          boost::asio::async_read(*conn->socket,
             conn->pending_message_buffer.get_buffer_sequence_for_boost_async_read(), completion_handler,
-            [this,weak_conn]( boost::system::error_code ec, std::size_t bytes_transferred ) {
+            boost::asio::bind_executor( conn->strand,
+            [this,weak_conn,session]( boost::system::error_code ec, std::size_t bytes_transferred ) {
                auto conn = weak_conn.lock();
                if (!conn) {
                   return;
                }
 
                --conn->reads_in_flight;
+               conn->bytes_received += bytes_transferred;
+               if( session != conn->session ) {
+                  // closed since the read was started, the read state belongs to the next session
+                  return;
+               }
                conn->outstanding_read_bytes.reset();
 
                try {
@@ -2214,10 +2823,12 @@ namespace snax {
                            uint32_t message_length;
                            auto index = conn->pending_message_buffer.read_index();
                            conn->pending_message_buffer.peek(&message_length, sizeof(message_length), index);
+                           const bool compressed = message_length & compressed_message_flag;
+                           message_length &= ~compressed_message_flag;
                            if(message_length > def_send_buffer_size*2 || message_length == 0) {
                               boost::system::error_code ec;
                               elog("incoming message length unexpected (${i}), from ${p}", ("i", message_length)("p",boost::lexical_cast<std::string>(conn->socket->remote_endpoint(ec))));
-                              close(conn);
+                              post_to_main( conn, session, [this]( const connection_ptr& conn ) { close( conn ); } );
                               return;
                            }
 
@@ -2225,7 +2836,7 @@ namespace snax {
 
                            if (bytes_in_buffer >= total_message_bytes) {
                               conn->pending_message_buffer.advance_read_ptr(message_header_size);
-                              if (!conn->process_next_message(*this, message_length)) {
+                              if (!conn->process_next_message(*this, message_length, compressed, session)) {
                                  return;
                               }
                            } else {
@@ -2240,37 +2851,43 @@ namespace snax {
                            }
                         }
                      }
-                     start_read_message(conn);
+                     start_read_message(conn, session);
                   } else {
-                     auto pname = conn->peer_name();
-                     if (ec.value() != boost::asio::error::eof) {
-                        elog( "Error reading message from ${p}: ${m}",("p",pname)( "m", ec.message() ) );
-                     } else {
-                        ilog( "Peer ${p} closed connection",("p",pname) );
-                     }
-                     close( conn );
+                     post_to_main( conn, session, [ec, this]( const connection_ptr& conn ) {
+                        auto pname = conn->peer_name();
+                        if (ec.value() != boost::asio::error::eof) {
+                           elog( "Error reading message from ${p}: ${m}",("p",pname)( "m", ec.message() ) );
+                        } else {
+                           ilog( "Peer ${p} closed connection",("p",pname) );
+                        }
+                        close( conn );
+                     } );
                   }
                }
                catch(const std::exception &ex) {
-                  string pname = conn ? conn->peer_name() : "no connection name";
-                  elog("Exception in handling read data from ${p} ${s}",("p",pname)("s",ex.what()));
-                  close( conn );
+                  post_to_main( conn, session, [what = string( ex.what() ), this]( const connection_ptr& conn ) {
+                     elog("Exception in handling read data from ${p} ${s}",("p",conn->peer_name())("s",what));
+                     close( conn );
+                  } );
                }
                catch(const fc::exception &ex) {
-                  string pname = conn ? conn->peer_name() : "no connection name";
-                  elog("Exception in handling read data ${s}", ("p",pname)("s",ex.to_string()));
-                  close( conn );
+                  post_to_main( conn, session, [what = ex.to_string(), this]( const connection_ptr& conn ) {
+                     elog("Exception in handling read data ${s}", ("p",conn->peer_name())("s",what));
+                     close( conn );
+                  } );
                }
                catch (...) {
-                  string pname = conn ? conn->peer_name() : "no connection name";
-                  elog( "Undefined exception hanlding the read data from connection ${p}",( "p",pname));
-                  close( conn );
+                  post_to_main( conn, session, [this]( const connection_ptr& conn ) {
+                     elog( "Undefined exception hanlding the read data from connection ${p}",( "p",conn->peer_name()));
+                     close( conn );
+                  } );
                }
-            } );
+            } ) );
       } catch (...) {
-         string pname = conn ? conn->peer_name() : "no connection name";
-         elog( "Undefined exception handling reading ${p}",("p",pname) );
-         close( conn );
+         post_to_main( conn, session, [this]( const connection_ptr& conn ) {
+            elog( "Undefined exception handling reading ${p}",("p",conn->peer_name()) );
+            close( conn );
+         } );
       }
    }
 
@@ -2278,7 +2895,7 @@ namespace snax {
    {
       size_t count = 0;
       for( auto &c : connections) {
-         if(c->socket->is_open())
+         if(c->socket_open)
             ++count;
       }
       return count;
@@ -2287,11 +2904,47 @@ namespace snax {
 
    template<typename VerifierFunc>
    void net_plugin_impl::send_all( const net_message &msg, VerifierFunc verify) {
+      auto start = fc::time_point::now();
+      auto send_buffer = create_send_buffer( msg );
+      send_all( send_buffer, fc::time_point::now() - start, verify );
+   }
+
+   template<typename VerifierFunc>
+   void net_plugin_impl::send_all( const send_buffer_ptr& send_buffer, fc::microseconds pack_time, VerifierFunc verify) {
+      const bool compressible = send_buffer->size() - message_header_size >= def_compression_threshold;
+      vector<std::pair<connection_wptr, connection::deferred_send_ptr>> compressing;
+      uint32_t peers = 0;
       for( auto &c : connections) {
          if( c->current() && verify( c)) {
-            c->enqueue( msg );
+            if( compressible && c->compress_sends() ) {
+               auto conn = c.get();
+               compressing.emplace_back( c, c->defer_send( [conn, send_buffer]( const send_buffer_ptr& compressed ) {
+                  conn->write_buffer( compressed ? compressed : send_buffer );
+               }));
+            } else {
+               c->enqueue_buffer( send_buffer );
+            }
+            ++peers;
          }
       }
+      fc_dlog( logger, "broadcast ${b} bytes to ${n} peers, packed once in ${t}us",
+               ("b", send_buffer->size())("n", peers)("t", pack_time.count()) );
+      if( compressing.empty() ) return;
+
+      // compressed once on the net threads for all the peers taking compressed frames
+      boost::asio::post( *net_ioc, [compressing = std::move( compressing ), send_buffer]() {
+         auto start = fc::time_point::now();
+         auto compressed = compress_send_buffer( send_buffer );
+         fc_dlog( logger, "compressed broadcast of ${b} bytes to ${c} bytes for ${n} peers in ${t}us",
+                  ("b", send_buffer->size())("c", compressed ? compressed->size() : send_buffer->size())
+                  ("n", compressing.size())("t", (fc::time_point::now() - start).count()) );
+         app().get_io_service().post( [compressing, compressed]() {
+            for( const auto& c : compressing ) {
+               if( auto conn = c.first.lock() )
+                  conn->complete_deferred_send( c.second, compressed );
+            }
+         });
+      });
    }
 
    bool net_plugin_impl::is_valid( const handshake_message &msg) {
@@ -2511,6 +3164,7 @@ namespace snax {
          break;
       }
       case normal: {
+         c->transactions_announced += msg.known_trx.ids.size();
          dispatcher->recv_notice (c, msg, false);
       }
       }
@@ -2610,6 +3264,7 @@ namespace snax {
       }
       transaction_id_type tid = msg.id();
       c->cancel_wait();
+      c->trx_known_by_peer(tid, msg.expiration());
       if(local_txns.get<by_id>().find(tid) != local_txns.end()) {
          fc_dlog(logger, "got a duplicate transaction - dropping");
          return;
@@ -2635,31 +3290,161 @@ namespace snax {
       });
    }
 
+   void net_plugin_impl::handle_message( connection_ptr c, const compact_block_message &msg) {
+      peer_ilog(c, "received compact_block_message");
+      signed_block b( msg.header );
+      block_id_type blk_id = b.id();
+      bool known = false;
+      try {
+         known = chain_plug->chain().fetch_block_by_id(blk_id) != nullptr;
+      } catch( ...) {
+         elog("Caught an unknown exception trying to recall blockID");
+      }
+      if( known ) {
+         handle_message( c, b );
+         return;
+      }
+
+      // rebuild the block from the transactions we hold
+      b.block_extensions = msg.block_extensions;
+      b.transactions.reserve( msg.transactions.size() );
+      const auto& by_id_idx = local_txns.get<by_id>();
+      bool complete = true;
+      for( const auto& cr : msg.transactions ) {
+         transaction_receipt r;
+         static_cast<transaction_receipt_header&>( r ) = cr;
+         if( cr.trx.contains<uint64_t>() ) {
+            uint64_t short_id = cr.trx.get<uint64_t>();
+            transaction_id_type lower;
+            lower._hash[0] = short_id;
+            auto ltx = by_id_idx.lower_bound( lower );
+            if( ltx == by_id_idx.end() || short_trx_id( ltx->id ) != short_id ) {
+               complete = false;
+               break;
+            }
+            r.trx = ltx->packed_txn;
+         } else if( cr.trx.contains<transaction_id_type>() ) {
+            r.trx = cr.trx.get<transaction_id_type>();
+         } else {
+            r.trx = cr.trx.get<packed_transaction>();
+         }
+         b.transactions.emplace_back( std::move( r ) );
+      }
+      if( complete ) {
+         // two transactions sharing a short id rebuild a block that does not match its header
+         vector<digest_type> digests;
+         digests.reserve( b.transactions.size() );
+         for( const auto& r : b.transactions ) {
+            digests.emplace_back( r.digest() );
+         }
+         complete = merkle( std::move( digests ) ) == b.transaction_mroot;
+      }
+      if( !complete ) {
+         peer_dlog(c, "missing transactions of compact block #${n}, requesting it in full", ("n",b.block_num()));
+         request_message req;
+         req.req_trx.mode = none;
+         req.req_blocks.mode = normal;
+         req.req_blocks.ids.push_back( blk_id );
+         c->add_peer_block({blk_id, b.block_num(), true, true, fc::time_point::now()});
+         c->enqueue( req );
+         c->fetch_wait();
+         c->last_req = std::move( req );
+         return;
+      }
+      ++c->compact_blocks_received;
+      handle_message( c, b );
+   }
+
    void net_plugin_impl::handle_message( connection_ptr c, const signed_block &msg) {
       controller &cc = chain_plug->chain();
       block_id_type blk_id = msg.id();
       uint32_t blk_num = msg.block_num();
       fc_dlog(logger, "canceling wait on ${p}", ("p",c->peer_name()));
       c->cancel_wait();
+      // during lib catchup ranges are striped across peers, their blocks arrive out of order
+      bool catching_up = sync_master->in_lib_catchup();
 
+      bool known = false;
       try {
-         if( cc.fetch_block_by_id(blk_id)) {
-            sync_master->recv_block(c, blk_id, blk_num);
-            return;
-         }
+         known = cc.fetch_block_by_id(blk_id) != nullptr;
       } catch( ...) {
          // should this even be caught?
          elog("Caught an unknown exception trying to recall blockID");
       }
+      if( known ) {
+         if( catching_up ) {
+            sync_master->sync_block_received(c, blk_num);
+         }
+         sync_master->recv_block(c, blk_id, blk_num);
+         if( catching_up ) {
+            // blocks of a later range may be waiting on the known ones
+            apply_sync_blocks();
+         }
+         return;
+      }
 
       dispatcher->recv_block(c, blk_id, blk_num);
       fc::microseconds age( fc::time_point::now() - msg.timestamp);
       peer_ilog(c, "received signed_block : #${n} block age in secs = ${age}",
               ("n",blk_num)("age",age.to_seconds()));
 
+      signed_block_ptr sbp = std::make_shared<signed_block>(msg);
+      if( catching_up ) {
+         if( sync_master->sync_block_received( c, blk_num ) ) {
+            sync_reorder[blk_num] = { c, sbp, current_message_received };
+            apply_sync_blocks();
+         }
+         return;
+      }
+
+      sync_reorder.clear();
+      apply_sync_window( 0 );
+      accept_block( c, sbp, current_message_received );
+   }
+
+   void net_plugin_impl::apply_sync_blocks() {
+      controller& cc = chain_plug->chain();
+      uint32_t next = sync_window.empty() ? sync_master->next_expected_num() : sync_window.back().block->block_num() + 1;
+      // left over from a range that was received again after being reassigned
+      sync_reorder.erase( sync_reorder.begin(), sync_reorder.lower_bound( next ) );
+      for( auto itr = sync_reorder.begin(); itr != sync_reorder.end() && itr->first == next; ++next ) {
+         if( sync_verify_window > 1 ) {
+            // verify signatures of the blocks in the window in parallel while they wait to be applied
+            try {
+               cc.prepare_block( itr->second.block );
+            } catch( const fc::exception& ex ) {
+               peer_elog(itr->second.c, "unable to prepare signed_block : ${m}", ("m",ex.what()));
+            }
+         }
+         sync_window.push_back( std::move( itr->second ) );
+         itr = sync_reorder.erase( itr );
+      }
+      // keep the window full while requested blocks are still on their way
+      bool drain = sync_verify_window <= 1 || sync_window.empty() ||
+                   sync_window.back().block->block_num() >= sync_master->last_requested_num();
+      apply_sync_window( drain ? 0 : sync_verify_window - 1 );
+   }
+
+   void net_plugin_impl::apply_sync_window( size_t keep ) {
+      while( sync_window.size() > keep ) {
+         auto next = sync_window.front();
+         sync_window.pop_front();
+         if( !accept_block( next.c, next.block, next.received ) ) {
+            // the blocks after a rejected one cannot link, sync restarts from our head
+            sync_window.clear();
+            sync_reorder.clear();
+            chain_plug->chain().clear_prepared_blocks();
+         }
+      }
+   }
+
+   bool net_plugin_impl::accept_block( connection_ptr c, const signed_block_ptr& sbp, fc::time_point received ) {
+      const signed_block& msg = *sbp;
+      block_id_type blk_id = msg.id();
+      uint32_t blk_num = msg.block_num();
+
       go_away_reason reason = fatal_other;
       try {
-         signed_block_ptr sbp = std::make_shared<signed_block>(msg);
          chain_plug->accept_block(sbp); //, sync_master->is_active(c));
          reason = no_reason;
       } catch( const unlinkable_block_exception &ex) {
@@ -2683,6 +3468,7 @@ namespace snax {
 
       update_block_num ubn(blk_num);
       if( reason == no_reason ) {
+         record_block_latency( msg, received );
          for (const auto &recpt : msg.transactions) {
             auto id = (recpt.trx.which() == 0) ? recpt.trx.get<transaction_id_type>() : recpt.trx.get<packed_transaction>().id();
             auto ltx = local_txns.get<by_id>().find(id);
@@ -2695,10 +3481,30 @@ namespace snax {
             }
          }
          sync_master->recv_block(c, blk_id, blk_num);
+         return true;
       }
       else {
          sync_master->rejected_block(c, blk_num);
          dispatcher->rejected_block( blk_id );
+         return false;
+      }
+   }
+
+   void net_plugin_impl::record_block_latency( const signed_block& b, fc::time_point received ) {
+      auto now = fc::time_point::now();
+      auto& stats = block_latency;
+      ++stats.blocks;
+      stats.accepted += now - received;
+      fc::microseconds age = now - b.timestamp;
+      if( age < def_live_block_age ) {
+         ++stats.live_blocks;
+         stats.propagation += age;
+      }
+      if( stats.blocks >= def_block_latency_report ) {
+         fc_ilog( logger, "block latency over ${n} blocks: received to accepted ${a}us, ${l} live blocks produced to accepted ${p}us",
+                  ("n", stats.blocks)("a", stats.accepted.count() / stats.blocks)
+                  ("l", stats.live_blocks)("p", stats.live_blocks ? stats.propagation.count() / stats.live_blocks : 0) );
+         stats = block_latency_stats();
       }
    }
 
@@ -2736,7 +3542,7 @@ namespace snax {
                wlog ("Peer keepalive ticked sooner than expected: ${m}", ("m", ec.message()));
             }
             for (auto &c : connections ) {
-               if (c->socket->is_open()) {
+               if (c->socket_open) {
                   c->send_time();
                }
             }
@@ -2762,6 +3568,10 @@ namespace snax {
       uint32_t bn = cc.last_irreversible_block_num();
       stale.erase( stale.lower_bound(1), stale.upper_bound(bn) );
       dispatcher->expire_blocks( bn );
+      auto request_expired = fc::time_point::now() - def_trx_request_wait;
+      for( auto r = dispatcher->req_trx.begin(); r != dispatcher->req_trx.end(); ) {
+         r = r->second < request_expired ? dispatcher->req_trx.erase( r ) : std::next( r );
+      }
       for ( auto &c : connections ) {
          auto &stale_txn = c->trx_state.get<by_block_num>();
          stale_txn.erase( stale_txn.lower_bound(1), stale_txn.upper_bound(bn) );
@@ -2783,7 +3593,7 @@ namespace snax {
             start_conn_timer(std::chrono::milliseconds(1), *it); // avoid exhausting
             return;
          }
-         if( !(*it)->socket->is_open() && !(*it)->connecting) {
+         if( !(*it)->socket_open && !(*it)->connecting) {
             if( (*it)->peer_addr.length() > 0) {
                connect(*it);
             }
@@ -2798,7 +3608,7 @@ namespace snax {
    }
 
    void net_plugin_impl::close( connection_ptr c ) {
-      if( c->peer_addr.empty( ) && c->socket->is_open() ) {
+      if( c->peer_addr.empty( ) && c->socket_open ) {
          if (num_clients == 0) {
             fc_wlog( logger, "num_clients already at 0");
          }
@@ -3000,8 +3810,14 @@ namespace snax {
          ( "network-version-match", bpo::value<bool>()->default_value(false),
            "True to require exact match of peer network version.")
          ( "sync-fetch-span", bpo::value<uint32_t>()->default_value(def_sync_fetch_span), "number of blocks to retrieve in a chunk from any individual peer during synchronization")
+         ( "sync-peers", bpo::value<uint32_t>()->default_value(def_sync_peers), "maximum number of peers blocks are requested from at once during synchronization, each serving its own range of sync-fetch-span blocks")
+         ( "sync-verify-window", bpo::value<uint32_t>()->default_value(def_sync_verify_window), "number of blocks received during synchronization whose signatures are verified in parallel ahead of being applied in order, 0 or 1 to verify each block as it is applied")
          ( "max-implicit-request", bpo::value<uint32_t>()->default_value(def_max_just_send), "maximum sizes of transaction or block messages that are sent without first sending a notice")
          ( "use-socket-read-watermark", bpo::value<bool>()->default_value(false), "Enable expirimental socket read watermark optimization")
+         ( "net-threads", bpo::value<uint32_t>()->default_value(def_net_threads), "number of threads doing socket I/O and message unpacking for all connections")
+         ( "p2p-compression", bpo::value<string>()->default_value("none"), "Compression of messages sent to peers that support it, \"zlib\" or \"none\". Compressed messages are always accepted.")
+         ( "p2p-announce-transactions", bpo::value<bool>()->default_value(false), "Announce transactions by id, in batched notices, to peers that support it and let them request the ones they are missing, instead of sending every transaction in full.")
+         ( "p2p-compact-blocks", bpo::value<bool>()->default_value(false), "Relay blocks to peers that support it with the transactions they hold referenced by short id. A peer missing one of them requests the block in full.")
          ( "peer-log-format", bpo::value<string>()->default_value( "[\"${_name}\" ${_ip}:${_port}]" ),
            "The string used to format peers when logging messages about them.  Variables are escaped with ${<variable name>}.\n"
            "Available Variables:\n"
@@ -3027,7 +3843,11 @@ namespace snax {
 
          my->network_version_match = options.at( "network-version-match" ).as<bool>();
 
-         my->sync_master.reset( new sync_manager( options.at( "sync-fetch-span" ).as<uint32_t>()));
+         const auto sync_peers = options.at( "sync-peers" ).as<uint32_t>();
+         SNAX_ASSERT( sync_peers > 0, plugin_config_exception,
+                      "sync-peers ${num} must be greater than 0", ("num", sync_peers) );
+         my->sync_master.reset( new sync_manager( options.at( "sync-fetch-span" ).as<uint32_t>(), sync_peers ));
+         my->sync_verify_window = options.at( "sync-verify-window" ).as<uint32_t>();
          my->dispatcher.reset( new dispatch_manager );
 
          my->connector_period = std::chrono::seconds( options.at( "connection-cleanup-period" ).as<int>());
@@ -3042,6 +3862,18 @@ namespace snax {
 
          my->use_socket_read_watermark = options.at( "use-socket-read-watermark" ).as<bool>();
 
+         my->net_threads = options.at( "net-threads" ).as<uint32_t>();
+         SNAX_ASSERT( my->net_threads > 0, plugin_config_exception,
+                      "net-threads ${num} must be greater than 0", ("num", my->net_threads) );
+         my->net_ioc.reset( new boost::asio::io_context( my->net_threads ));
+
+         const auto compression = options.at( "p2p-compression" ).as<string>();
+         SNAX_ASSERT( compression == "none" || compression == "zlib", plugin_config_exception,
+                      "Unknown p2p-compression ${c}, expected none or zlib", ("c", compression) );
+         my->compression = compression == "zlib" ? wire_compression::zlib : wire_compression::none;
+         my->announce_transactions = options.at( "p2p-announce-transactions" ).as<bool>();
+         my->compact_blocks = options.at( "p2p-compact-blocks" ).as<bool>();
+
          my->resolver = std::make_shared<tcp::resolver>( std::ref( app().get_io_service()));
          if( options.count( "p2p-listen-endpoint" )) {
             my->p2p_address = options.at( "p2p-listen-endpoint" ).as<string>();
@@ -3053,7 +3885,7 @@ namespace snax {
 
             my->listen_endpoint = *my->resolver->resolve( query );
 
-            my->acceptor.reset( new tcp::acceptor( app().get_io_service()));
+            my->acceptor.reset( new tcp::acceptor( *my->net_ioc ));
          }
          if( options.count( "p2p-server-address" )) {
             my->p2p_address = options.at( "p2p-server-address" ).as<string>();
@@ -3126,6 +3958,12 @@ namespace snax {
    }
 
    void net_plugin::plugin_startup() {
+      my->net_work.emplace( boost::asio::make_work_guard( *my->net_ioc ));
+      my->net_thread_pool.reserve( my->net_threads );
+      for( uint32_t i = 0; i < my->net_threads; ++i ) {
+         my->net_thread_pool.emplace_back( [ioc = my->net_ioc.get()]{ ioc->run(); } );
+      }
+
       if( my->acceptor ) {
          my->acceptor->open(my->listen_endpoint.protocol());
          my->acceptor->set_option(tcp::acceptor::reuse_address(true));
@@ -3171,6 +4009,15 @@ namespace snax {
       try {
          ilog( "shutdown.." );
          my->done = true;
+         if( my->net_ioc ) {
+            ilog( "stop ${n} net threads",( "n",my->net_thread_pool.size()) );
+            my->net_work.reset();
+            my->net_ioc->stop();
+            for( auto& t : my->net_thread_pool ) {
+               t.join();
+            }
+            my->net_thread_pool.clear();
+         }
          if( my->acceptor ) {
             ilog( "close acceptor" );
             my->acceptor->close();
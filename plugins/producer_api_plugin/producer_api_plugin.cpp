@@ -90,6 +90,10 @@ void producer_api_plugin::plugin_startup() {
             INVOKE_R_V(producer, get_integrity_hash), 201),
        CALL(producer, producer, create_snapshot,
             INVOKE_R_V(producer, create_snapshot), 201),
+       CALL(producer, producer, get_snapshot_progress,
+            INVOKE_R_V(producer, get_snapshot_progress), 201),
+       CALL(producer, producer, create_delta_snapshot,
+            INVOKE_R_R(producer, create_delta_snapshot, producer_plugin::delta_snapshot_params), 201),
    });
 }
 
@@ -51,6 +51,22 @@ public:
       std::string          snapshot_name;
    };
 
+   struct delta_snapshot_params {
+      std::string              base_snapshot; ///< in the parallel format, relative to the snapshots directory
+      std::vector<std::string> base_deltas;   ///< applied onto base_snapshot in order
+   };
+
+   struct snapshot_progress {
+      chain::block_id_type    head_block_id;
+      std::string             snapshot_name;
+      bool                    done = false;
+      uint64_t                chunks_written = 0;
+      uint64_t                chunks_total = 0;
+      uint64_t                bytes_written = 0;
+      int64_t                 elapsed_ms = 0;
+      fc::optional<std::string> error;
+   };
+
    producer_plugin();
    virtual ~producer_plugin();
 
@@ -81,6 +97,8 @@ public:
 
    integrity_hash_information get_integrity_hash() const;
    snapshot_information create_snapshot() const;
+   snapshot_progress get_snapshot_progress() const;
+   snapshot_information create_delta_snapshot(const delta_snapshot_params& params) const;
 
    signal<void(const chain::producer_confirmation&)> confirmed_block;
 private:
@@ -94,4 +112,6 @@ FC_REFLECT(snax::producer_plugin::greylist_params, (accounts));
 FC_REFLECT(snax::producer_plugin::whitelist_blacklist, (actor_whitelist)(actor_blacklist)(contract_whitelist)(contract_blacklist)(action_blacklist)(key_blacklist) )
 FC_REFLECT(snax::producer_plugin::integrity_hash_information, (head_block_id)(integrity_hash))
 FC_REFLECT(snax::producer_plugin::snapshot_information, (head_block_id)(snapshot_name))
+FC_REFLECT(snax::producer_plugin::delta_snapshot_params, (base_snapshot)(base_deltas))
+FC_REFLECT(snax::producer_plugin::snapshot_progress, (head_block_id)(snapshot_name)(done)(chunks_written)(chunks_total)(bytes_written)(elapsed_ms)(error))
 
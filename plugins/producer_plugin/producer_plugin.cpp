@@ -19,6 +19,10 @@
 
 #include <iostream>
 #include <algorithm>
+#include <atomic>
+#include <thread>
+#include <fstream>
+#include <list>
 #include <boost/algorithm/string.hpp>
 #include <boost/range/adaptor/map.hpp>
 #include <boost/function_output_iterator.hpp>
@@ -179,6 +183,30 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
       // path to write the snapshots to
       bfs::path _snapshots_dir;
 
+      // write snapshots as parallel_snapshot_writer does on this many threads, instead of as ostream_snapshot_writer does
+      bool      _parallel_snapshots = true;
+      uint32_t  _snapshot_threads = 0;
+      bool      _background_snapshots = true;
+      uint32_t  _background_snapshot_buffer_mb = 1024;
+
+      // a snapshot whose rows were captured at a block boundary and are compressed and written on a thread of its own
+      struct background_snapshot {
+         chain::block_id_type                       head_block_id;
+         std::string                                snapshot_name;
+         std::string                                temp_name;
+         std::ofstream                              out;
+         std::shared_ptr<parallel_snapshot_writer>  writer;
+         std::thread                                thread;
+         fc::time_point                             start;
+         fc::time_point                             end;   ///< set before done
+         std::atomic<bool>                          done{false};
+         std::string                                error; ///< set before done
+      };
+      std::unique_ptr<background_snapshot> _background_snapshot;
+
+      void start_background_snapshot( const chain::block_id_type& head_id, const std::string& snapshot_path );
+      void join_background_snapshot();
+
 
       void on_block( const block_state_ptr& bsp ) {
          if( bsp->header.timestamp <= _last_signed_block_time ) return;
@@ -536,6 +564,18 @@ void producer_plugin::set_program_options(
           "ratio between incoming transations and deferred transactions when both are exhausted")
          ("snapshots-dir", bpo::value<bfs::path>()->default_value("snapshots"),
           "the location of the snapshots directory (absolute path or relative to application data dir)")
+         ("snapshot-format", bpo::value<string>()->default_value("parallel"),
+          "format of the snapshots written, \"parallel\" for sections compressed and written on several threads or \"binary\" for the single threaded format older nodes read")
+         ("snapshot-threads", bpo::value<uint32_t>()->default_value(0),
+          "number of threads writing a snapshot in the parallel format, 0 for one per core")
+         ("snapshot-in-background", bpo::value<bool>()->default_value(true),
+          "capture the state for a snapshot in the parallel format in memory and write it to disk in the background, "
+          "applying blocks meanwhile. Capturing runs on the main thread and no block is applied until it is done. "
+          "create_snapshot returns once the state is captured and get_snapshot_progress reports the rest")
+         ("snapshot-background-buffer-mb", bpo::value<uint32_t>()->default_value(1024),
+          "megabytes of captured state a snapshot written in the background may hold in memory before capturing it waits for "
+          "the state captured so far to be written. A state larger than this is largely written to disk before capturing "
+          "is done, holding up block application for that long")
          ;
    config_file_options.add(producer_options);
 }
@@ -681,6 +721,14 @@ void producer_plugin::plugin_initialize(const boost::program_options::variables_
                   "No such directory '${dir}'", ("dir", my->_snapshots_dir.generic_string()) );
    }
 
+   const auto snapshot_format = options.at( "snapshot-format" ).as<string>();
+   SNAX_ASSERT( snapshot_format == "parallel" || snapshot_format == "binary", plugin_config_exception,
+               "Unknown snapshot-format ${f}, expected parallel or binary", ("f", snapshot_format) );
+   my->_parallel_snapshots = snapshot_format == "parallel";
+   my->_snapshot_threads = options.at( "snapshot-threads" ).as<uint32_t>();
+   my->_background_snapshots = options.at( "snapshot-in-background" ).as<bool>();
+   my->_background_snapshot_buffer_mb = options.at( "snapshot-background-buffer-mb" ).as<uint32_t>();
+
    my->_incoming_block_subscription = app().get_channel<incoming::channels::block>().subscribe([this](const signed_block_ptr& block){
       try {
          my->on_incoming_block(block);
@@ -769,6 +817,9 @@ void producer_plugin::plugin_shutdown() {
 
    my->_accepted_block_connection.reset();
    my->_irreversible_block_connection.reset();
+
+   // let a snapshot being written finish rather than leave it behind half written
+   my->join_background_snapshot();
 }
 
 void producer_plugin::pause() {
@@ -925,9 +976,71 @@ producer_plugin::snapshot_information producer_plugin::create_snapshot() const {
    SNAX_ASSERT( !fc::is_regular_file(snapshot_path), snapshot_exists_exception,
                "snapshot named ${name} already exists", ("name", snapshot_path));
 
+   if (my->_parallel_snapshots && my->_background_snapshots) {
+      my->start_background_snapshot(head_id, snapshot_path);
+      return {head_id, snapshot_path};
+   }
 
    auto snap_out = std::ofstream(snapshot_path, (std::ios::out | std::ios::binary));
-   auto writer = std::make_shared<ostream_snapshot_writer>(snap_out);
+   if (my->_parallel_snapshots) {
+      auto writer = std::make_shared<parallel_snapshot_writer>(snap_out, my->_snapshot_threads);
+      chain.write_snapshot(writer);
+      writer->finalize();
+   } else {
+      auto writer = std::make_shared<ostream_snapshot_writer>(snap_out);
+      chain.write_snapshot(writer);
+      writer->finalize();
+   }
+   snap_out.flush();
+   snap_out.close();
+
+   return {head_id, snapshot_path};
+}
+
+producer_plugin::snapshot_information producer_plugin::create_delta_snapshot(const delta_snapshot_params& params) const {
+   chain::controller& chain = app().get_plugin<chain_plugin>().chain();
+
+   auto resolve = [this]( const std::string& name ) {
+      bfs::path p( name );
+      if (p.is_relative()) {
+         p = my->_snapshots_dir / p;
+      }
+      SNAX_ASSERT( fc::is_regular_file(p), snapshot_exception, "snapshot ${name} does not exist", ("name", p.generic_string()) );
+      return p.generic_string();
+   };
+
+   // open the base and the deltas already applied onto it before touching the pending block
+   std::list<std::ifstream> files;
+   files.emplace_back(resolve(params.base_snapshot), (std::ios::in | std::ios::binary));
+   auto base_reader = std::make_shared<parallel_snapshot_reader>(files.back(), my->_snapshot_threads);
+   std::shared_ptr<packed_snapshot_reader> base = base_reader;
+   SNAX_ASSERT( !delta_snapshot_reader::is_delta_snapshot(*base_reader), snapshot_exception,
+               "base_snapshot ${name} is a delta, give the full snapshot it was written against", ("name", params.base_snapshot) );
+   for (const auto& delta_name : params.base_deltas) {
+      files.emplace_back(resolve(delta_name), (std::ios::in | std::ios::binary));
+      base = std::make_shared<delta_snapshot_reader>(base, std::make_shared<parallel_snapshot_reader>(files.back(), my->_snapshot_threads));
+   }
+   base->validate();
+
+   auto reschedule = fc::make_scoped_exit([this](){
+      my->schedule_production_loop();
+   });
+
+   if (chain.pending_block_state()) {
+      // abort the pending block
+      chain.abort_block();
+   } else {
+      reschedule.cancel();
+   }
+
+   auto head_id = chain.head_block_id();
+   std::string snapshot_path = (my->_snapshots_dir / fc::format_string("snapshot-${id}.delta", fc::mutable_variant_object()("id", head_id))).generic_string();
+
+   SNAX_ASSERT( !fc::is_regular_file(snapshot_path), snapshot_exists_exception,
+               "snapshot named ${name} already exists", ("name", snapshot_path));
+
+   auto snap_out = std::ofstream(snapshot_path, (std::ios::out | std::ios::binary));
+   auto writer = std::make_shared<delta_snapshot_writer>(base, snap_out, my->_snapshot_threads);
    chain.write_snapshot(writer);
    writer->finalize();
    snap_out.flush();
@@ -936,6 +1049,98 @@ producer_plugin::snapshot_information producer_plugin::create_snapshot() const {
    return {head_id, snapshot_path};
 }
 
+producer_plugin::snapshot_progress producer_plugin::get_snapshot_progress() const {
+   snapshot_progress result;
+   const auto& snapshot = my->_background_snapshot;
+   if (!snapshot) {
+      return result;
+   }
+
+   const auto progress = snapshot->writer->progress();
+   result.head_block_id = snapshot->head_block_id;
+   result.snapshot_name = snapshot->snapshot_name;
+   result.done = snapshot->done;
+   result.chunks_written = progress.chunks_written;
+   result.chunks_total = progress.chunks_total;
+   result.bytes_written = progress.bytes_written;
+   result.elapsed_ms = ((result.done ? snapshot->end : fc::time_point::now()) - snapshot->start).count() / 1000;
+   if (result.done && !snapshot->error.empty()) {
+      result.error = snapshot->error;
+   }
+   return result;
+}
+
+void producer_plugin_impl::start_background_snapshot( const chain::block_id_type& head_id, const std::string& snapshot_path ) {
+   chain::controller& chain = app().get_plugin<chain_plugin>().chain();
+
+   if (_background_snapshot) {
+      SNAX_ASSERT( _background_snapshot->done, snapshot_in_progress_exception,
+                  "snapshot ${name} is still being written", ("name", _background_snapshot->snapshot_name));
+      join_background_snapshot();
+   }
+
+   auto snapshot = std::make_unique<background_snapshot>();
+   snapshot->head_block_id = head_id;
+   snapshot->snapshot_name = snapshot_path;
+   snapshot->temp_name = snapshot_path + ".tmp";
+   snapshot->start = fc::time_point::now();
+   snapshot->out.open(snapshot->temp_name, (std::ios::out | std::ios::binary));
+   auto remove_temp = fc::make_scoped_exit([&snapshot](){
+      snapshot->writer.reset();
+      snapshot->out.close();
+      boost::system::error_code ec;
+      bfs::remove(snapshot->temp_name, ec);
+   });
+
+   // the rows are read from the state on this thread, which applies no block until they are all captured; they are
+   // compressed and written on the writer's threads, and once the chunks waiting to be written reach the buffer,
+   // capturing waits for them to be written, so only the last buffer's worth is written after this returns
+   const uint32_t max_chunks = uint64_t(_background_snapshot_buffer_mb) * 1024 * 1024 / parallel_snapshot_writer::chunk_size;
+   snapshot->writer = std::make_shared<parallel_snapshot_writer>(snapshot->out, _snapshot_threads);
+   snapshot->writer->set_max_buffered_chunks(max_chunks);
+   chain.write_snapshot(snapshot->writer);
+   remove_temp.cancel();
+
+   const auto captured = snapshot->writer->progress();
+   ilog("captured the state at block ${id} for snapshot ${name} in ${ms} ms without applying blocks, writing the rest of it in the background",
+        ("id", head_id)("name", snapshot_path)("ms", (fc::time_point::now() - snapshot->start).count() / 1000));
+   if (captured.chunks_total > max_chunks) {
+      wlog("the state for snapshot ${name} is larger than snapshot-background-buffer-mb, capturing it waited for ${n} of its ${total} chunks to be written",
+           ("name", snapshot_path)("n", captured.chunks_written)("total", captured.chunks_total));
+   }
+
+   snapshot->thread = std::thread([s = snapshot.get()]() {
+      try {
+         s->writer->finalize();
+         s->out.flush();
+         s->out.close();
+         SNAX_ASSERT( !s->out.fail(), snapshot_exception, "Unable to write snapshot ${name}", ("name", s->temp_name) );
+         bfs::rename(s->temp_name, s->snapshot_name);
+         ilog("snapshot ${name} written in ${ms} ms", ("name", s->snapshot_name)("ms", (fc::time_point::now() - s->start).count() / 1000));
+      } catch( const fc::exception& e ) {
+         s->error = e.to_detail_string();
+      } catch( const std::exception& e ) {
+         s->error = e.what();
+      } catch( ... ) {
+         s->error = "unknown exception";
+      }
+      if (!s->error.empty()) {
+         elog("failed to write snapshot ${name}: ${e}", ("name", s->snapshot_name)("e", s->error));
+         boost::system::error_code ec;
+         bfs::remove(s->temp_name, ec);
+      }
+      s->end = fc::time_point::now();
+      s->done = true;
+   });
+   _background_snapshot = std::move(snapshot);
+}
+
+void producer_plugin_impl::join_background_snapshot() {
+   if (_background_snapshot && _background_snapshot->thread.joinable()) {
+      _background_snapshot->thread.join();
+   }
+}
+
 optional<fc::time_point> producer_plugin_impl::calculate_next_block_time(const account_name& producer_name, const block_timestamp_type& current_block_time) const {
    chain::controller& chain = app().get_plugin<chain_plugin>().chain();
    const auto& hbs = chain.head_block_state();
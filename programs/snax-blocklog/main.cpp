@@ -27,6 +27,8 @@ struct blocklog {
    {}
 
    void read_log();
+   void relog();
+   void make_index();
    void set_program_options(options_description& cli);
    void initialize(const variables_map& options);
 
@@ -36,8 +38,76 @@ struct blocklog {
    uint32_t                         last_block;
    bool                             no_pretty_print;
    bool                             as_json_array;
+   uint32_t                         split_stride = 0;
+   bool                             merge = false;
+   optional<block_log_compression>  compression;
+   bool                             make_index_only = false;
+   uint32_t                         index_threads = 0;
 };
 
+/// whether p is one of the files of a block log, blocks.log or blocks-<first>-<last>.log and their indexes
+static bool is_block_log_file( const bfs::path& p ) {
+   const auto name = p.stem().generic_string();
+   const auto extension = p.extension().generic_string();
+   if( extension != ".log" && extension != ".index" ) return false;
+   unsigned first = 0, last = 0;
+   char rest = 0;
+   return name == "blocks" || sscanf( name.c_str(), "blocks-%u-%u%c", &first, &last, &rest ) == 2;
+}
+
+/// writes the block log again, split into files of split_stride blocks or merged into a single blocks.log, and compressed
+void blocklog::relog() {
+   block_log source(blocks_dir);
+   const auto head = source.read_head();
+   SNAX_ASSERT( head, block_log_exception, "No blocks found in block log" );
+   const uint32_t first_num = source.first_block_num();
+   const auto gs = block_log::extract_genesis_state( blocks_dir );
+
+   const auto relog_dir = blocks_dir / "relog";
+   SNAX_ASSERT( !bfs::exists( relog_dir ), block_log_exception, "${d} is left over from an earlier run, remove it first",
+                ("d", relog_dir.generic_string()) );
+   ilog( "writing blocks ${first} through ${last} to ${d}", ("first", first_num)("last", head->block_num())("d", relog_dir.generic_string()) );
+   {
+      block_log_config config;
+      config.stride = merge ? 0 : split_stride;
+      config.compression = compression ? *compression : block_log_compression::none;
+      block_log target( relog_dir, config );
+      target.reset( gs, source.read_block_by_num( first_num ), first_num );
+      for( uint32_t n = first_num + 1; n <= head->block_num(); ++n ) {
+         auto b = source.read_block_by_num( n );
+         SNAX_ASSERT( b, block_log_exception, "Block ${n} is missing from the block log", ("n", n) );
+         target.append( b );
+         if( n % 100000 == 0 )
+            ilog( "written block ${n}", ("n", n) );
+      }
+   }
+
+   for( bfs::directory_iterator itr( blocks_dir ), end; itr != end; ++itr ) {
+      if( is_block_log_file( itr->path() ) )
+         bfs::remove( itr->path() );
+   }
+   for( bfs::directory_iterator itr( relog_dir ), end; itr != end; ++itr ) {
+      bfs::rename( itr->path(), blocks_dir / itr->path().filename() );
+   }
+   bfs::remove_all( relog_dir );
+   ilog( "block log in ${d} rewritten", ("d", blocks_dir.generic_string()) );
+}
+
+/// rebuilds blocks.index, resuming from the entries it already has, and reports the progress
+void blocklog::make_index() {
+   const auto start = fc::time_point::now();
+   auto last_report = start;
+   block_log::construct_index( blocks_dir / "blocks.log", blocks_dir / "blocks.index", index_threads,
+                               [&]( uint64_t scanned, uint64_t total ) {
+      const auto now = fc::time_point::now();
+      if( scanned < total && now - last_report < fc::seconds(5) ) return;
+      last_report = now;
+      ilog( "scanned ${s} of ${t} MiB of the block log (${p}%)",
+            ("s", scanned >> 20)("t", total >> 20)("p", total ? scanned * 100 / total : 100) );
+   });
+   ilog( "blocks.index written in ${s} seconds", ("s", (fc::time_point::now() - start).count() / 1000000) );
+}
+
 void blocklog::read_log() {
    block_log block_logger(blocks_dir);
    const auto end = block_logger.read_head();
@@ -145,6 +215,17 @@ void blocklog::set_program_options(options_description& cli)
           "Do not pretty print the output.  Useful if piping to jq to improve performance.")
          ("as-json-array", bpo::bool_switch(&as_json_array)->default_value(false),
           "Print out json blocks wrapped in json array (otherwise the output is free-standing json objects).")
+         ("split", bpo::value<uint32_t>(&split_stride)->default_value(0),
+          "Rewrite the block log split into files of this many blocks, blocks-<first>-<last>.log, instead of printing it.")
+         ("merge", bpo::bool_switch(&merge)->default_value(false),
+          "Rewrite a split block log into a single blocks.log, instead of printing it.")
+         ("compression", bpo::value<std::string>(),
+          "Rewrite the block log with its blocks compressed, \"zlib\", or uncompressed, \"none\", instead of printing it. "
+          "The block log is also merged unless --split is given.")
+         ("make-index", bpo::bool_switch(&make_index_only)->default_value(false),
+          "Rebuild blocks.index from blocks.log, keeping the entries of an existing index that still match, instead of printing the log.")
+         ("index-threads", bpo::value<uint32_t>(&index_threads)->default_value(0),
+          "Number of threads scanning blocks.log for --make-index, 0 for one per core.")
          ("help", "Print this help message and exit.")
          ;
 
@@ -152,6 +233,12 @@ void blocklog::set_program_options(options_description& cli)
 
 void blocklog::initialize(const variables_map& options) {
    try {
+      if (options.count( "compression" )) {
+         const auto c = options.at( "compression" ).as<std::string>();
+         SNAX_ASSERT( c == "none" || c == "zlib", block_log_exception, "Unknown compression ${c}, expected none or zlib", ("c", c) );
+         compression = c == "zlib" ? block_log_compression::zlib : block_log_compression::none;
+      }
+
       auto bld = options.at( "blocks-dir" ).as<bfs::path>();
       if( bld.is_relative())
          blocks_dir = bfs::current_path() / bld;
@@ -185,7 +272,12 @@ int main(int argc, char** argv)
         return 0;
       }
       blog.initialize(vmap);
-      blog.read_log();
+      if (blog.make_index_only)
+         blog.make_index();
+      else if (blog.split_stride || blog.merge || blog.compression)
+         blog.relog();
+      else
+         blog.read_log();
    } catch( const fc::exception& e ) {
       elog( "${e}", ("e", e.to_detail_string()));
       return -1;
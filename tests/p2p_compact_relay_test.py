@@ -0,0 +1,130 @@
+#!/usr/bin/env python3
+
+from testUtils import Utils
+from Cluster import Cluster
+from WalletMgr import WalletMgr
+from TestHelper import TestHelper
+
+import random
+
+###############################################################
+# p2p_compact_relay_test
+#  Stands up a producing and two non-producing nodes twice, once relaying full transactions and blocks and once
+#  announcing transactions by id and relaying compact blocks. Each time funds are spread between accounts through
+#  every node and the transfers and block logs are verified. The relay run has to rebuild blocks from compact
+#  blocks and receive fewer bytes on the wire for the same transfers. E.g.
+#  p2p_compact_relay_test.py -v --clean-run --dump-error-detail
+###############################################################
+
+Print=Utils.Print
+errorExit=Utils.errorExit
+
+args=TestHelper.parse_args({"--seed","--dump-error-details","-v","--leave-running","--clean-run","--keep-logs"})
+debug=args.v
+seed=args.seed
+dontKill=args.leave_running
+dumpErrorDetails=args.dump_error_details
+killAll=args.clean_run
+keepLogs=args.keep_logs
+
+Utils.Debug=debug
+killWallet=not dontKill
+killSnaxInstances=not dontKill
+testSuccessful=False
+
+pnodes=1
+totalNodes=3
+
+def peerTotals(cluster):
+    """bytes received, compact blocks rebuilt and transactions announced summed over the peers of every node"""
+    totals={"bytes_received": 0, "compact_blocks_received": 0, "transactions_announced": 0}
+    for nodeId in range(totalNodes):
+        node=cluster.getNode(nodeId)
+        peers=node.processClisnaxCmd("net peers", "net peers", silentErrors=False, exitOnError=True)
+        for peer in peers:
+            for key in totals:
+                totals[key]+=int(peer[key])
+    return totals
+
+def spreadFunds(cluster, walletMgr, relay):
+    mode="announcing transactions and relaying compact blocks" if relay else "relaying transactions and blocks in full"
+    Print("Stand up cluster %s" % (mode))
+    cluster.killall(allInstances=killAll)
+    cluster.cleanup()
+    extraArgs=" --plugin snax::net_api_plugin --p2p-announce-transactions %s --p2p-compact-blocks %s" % (str(relay).lower(), str(relay).lower())
+    if cluster.launch(pnodes=pnodes, totalNodes=totalNodes, topo="mesh", delay=1, extraSnaxnodeArgs=extraArgs) is False:
+        errorExit("Failed to stand up snax cluster.")
+
+    Print("Wait for Cluster stabilization")
+    if not cluster.waitOnClusterBlockNumSync(3):
+        errorExit("Cluster never stabilized")
+
+    walletName="MyWallet-%d" % (random.randrange(10000))
+    Print("Creating wallet %s." % walletName)
+    walletAccounts=[cluster.defproduceraAccount,cluster.defproducerbAccount,cluster.snaxAccount]
+    wallet=walletMgr.create(walletName, walletAccounts)
+    if wallet is None:
+        errorExit("Failed to create wallet %s" % (walletName))
+
+    Print("Populate wallet with %d accounts." % (totalNodes))
+    if not cluster.populateWallet(totalNodes, wallet):
+        errorExit("Wallet initialization failed.")
+
+    Print("Create accounts.")
+    if not cluster.createAccounts(cluster.snaxAccount):
+        errorExit("Accounts creation failed.")
+    if not cluster.waitOnClusterSync():
+        errorExit("Cluster never synchronized")
+
+    Print("Spread funds through every node and validate")
+    before=peerTotals(cluster)
+    if not cluster.spreadFundsAndValidate(10):
+        errorExit("Failed to spread and validate funds.")
+    if not cluster.waitOnClusterSync():
+        errorExit("Cluster never synchronized")
+    after=peerTotals(cluster)
+    spread={key: after[key] - before[key] for key in after}
+    Print("%s: %s" % (mode, spread))
+
+    if relay:
+        if spread["compact_blocks_received"] == 0:
+            errorExit("No block was rebuilt from a compact block")
+        if spread["transactions_announced"] == 0:
+            errorExit("No transaction was announced by id")
+    elif spread["compact_blocks_received"] != 0 or spread["transactions_announced"] != 0:
+        errorExit("Compact relay was used although it is disabled")
+
+    if not dontKill:
+        cluster.killall(allInstances=killAll)
+    else:
+        Print("NOTE: Skip killing nodes, block log verification will be limited")
+
+    cluster.compareBlockLogs()
+    return spread["bytes_received"]
+
+random.seed(seed) # Use a fixed seed for repeatability.
+cluster=Cluster(walletd=True)
+walletMgr=WalletMgr(True)
+
+try:
+    cluster.setWalletMgr(walletMgr)
+    full=spreadFunds(cluster, walletMgr, False)
+    cluster.killall(allInstances=killAll)
+    cluster.cleanup()
+    walletMgr.killall(allInstances=killAll)
+    WalletMgr.cleanup()
+
+    cluster=Cluster(walletd=True)
+    walletMgr=WalletMgr(True)
+    cluster.setWalletMgr(walletMgr)
+    relayed=spreadFunds(cluster, walletMgr, True)
+
+    Print("bytes received spreading funds: full %d, compact relay %d (%.1f%%)" % (full, relayed, 100.0 * relayed / full))
+    if relayed >= full:
+        errorExit("Compact relay did not reduce the bytes on the wire")
+
+    testSuccessful=True
+finally:
+    TestHelper.shutdown(cluster, walletMgr, testSuccessful, killSnaxInstances, killWallet, keepLogs, killAll, dumpErrorDetails)
+
+exit(0)
@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+
+from testUtils import Utils
+from Cluster import Cluster
+from TestHelper import TestHelper
+from WalletMgr import WalletMgr
+
+###############################################################
+# p2p_compression_test
+#  Stands up a producing and a non-producing node twice, once sending p2p messages uncompressed and once zlib
+#  compressed, and compares the bytes on the wire the non-producing node receives per block while the chain is
+#  bootstrapped. E.g.
+#  p2p_compression_test.py -v --clean-run --dump-error-detail
+###############################################################
+
+Print=Utils.Print
+errorExit=Utils.errorExit
+
+args = TestHelper.parse_args({"--dump-error-details","-v","--leave-running","--clean-run"})
+debug=args.v
+dontKill=args.leave_running
+dumpErrorDetails=args.dump_error_details
+killAll=args.clean_run
+
+Utils.Debug=debug
+
+killSnaxInstances=not dontKill
+testSuccessful=False
+
+def bytesPerBlock(cluster, compression):
+    Print("Stand up cluster with p2p-compression %s" % (compression))
+    cluster.killall(allInstances=killAll)
+    cluster.cleanup()
+    extraArgs=" --plugin snax::net_api_plugin --p2p-compression %s" % (compression)
+    if cluster.launch(pnodes=1, totalNodes=2, prodCount=1, topo="mesh", delay=1, extraSnaxnodeArgs=extraArgs) is False:
+        errorExit("Failed to stand up snax cluster.")
+
+    Print("Wait for Cluster stabilization")
+    if not cluster.waitOnClusterBlockNumSync(3):
+        errorExit("Cluster never stabilized")
+    if not cluster.waitOnClusterSync():
+        errorExit("Cluster never synchronized")
+
+    node=cluster.getNode(1)
+    peers=node.processClisnaxCmd("net peers", "net peers", silentErrors=False, exitOnError=True)
+    headBlockNum=node.getHeadBlockNum()
+    received=sum(int(peer["bytes_received"]) for peer in peers)
+    for peer in peers:
+        if peer["compressed"] != (compression != "none"):
+            errorExit("Connection to %s compressed %s with p2p-compression %s" % (peer["peer"], peer["compressed"], compression))
+    Print("p2p-compression %s: %d bytes received for %d blocks" % (compression, received, headBlockNum))
+    return received / headBlockNum
+
+cluster=Cluster(walletd=True)
+try:
+    Print("BEGIN")
+    uncompressed=bytesPerBlock(cluster, "none")
+    cluster.killall(allInstances=killAll)
+    cluster.cleanup()
+    cluster.walletMgr.killall(allInstances=killAll)
+    WalletMgr.cleanup()
+
+    cluster=Cluster(walletd=True)
+    compressed=bytesPerBlock(cluster, "zlib")
+    Print("bytes received per block: uncompressed %.1f, zlib %.1f (%.1f%%)" % (uncompressed, compressed, 100.0 * compressed / uncompressed))
+    if compressed >= uncompressed:
+        errorExit("Compressed messages did not reduce the bytes on the wire")
+
+    testSuccessful=True
+finally:
+    TestHelper.shutdown(cluster, cluster.walletMgr, testSuccessful, killSnaxInstances, True, False, killAll, dumpErrorDetails)
+
+exit(0)
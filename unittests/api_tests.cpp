@@ -1301,6 +1301,13 @@ BOOST_FIXTURE_TEST_CASE(db_tests, TESTER) { try {
    CALL_TEST_FUNCTION( *this, "test_db", "primary_i64_general", {});
    CALL_TEST_FUNCTION( *this, "test_db", "primary_i64_lowerbound", {});
    CALL_TEST_FUNCTION( *this, "test_db", "primary_i64_upperbound", {});
+   CALL_TEST_FUNCTION( *this, "test_db", "primary_i64_many", {});
+   CALL_TEST_FUNCTION_AND_CHECK_EXCEPTION( *this, "test_db", "primary_i64_many_invalid", {},
+                                           invalid_table_batch, "more values than rows in the batch");
+   CALL_TEST_FUNCTION_AND_CHECK_EXCEPTION( *this, "test_db", "primary_i64_many_count_mismatch", {},
+                                           invalid_table_batch, "the batch needs one iterator per primary key");
+   CALL_TEST_FUNCTION( *this, "test_db", "primary_i64_bench_setup", {});
+   CALL_TEST_FUNCTION( *this, "test_db", "primary_i64_bench_many", {});
    CALL_TEST_FUNCTION( *this, "test_db", "idx64_general", {});
    CALL_TEST_FUNCTION( *this, "test_db", "idx64_lowerbound", {});
    CALL_TEST_FUNCTION( *this, "test_db", "idx64_upperbound", {});
@@ -0,0 +1,59 @@
+/**
+ *  @file
+ *  @copyright defined in snax/LICENSE.txt
+ */
+
+#include <snax/testing/tester.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <test_api_db/test_api_db.wast.hpp>
+
+#define DISABLE_SNAXLIB_SERIALIZE
+#include <test_api/test_api_common.hpp>
+
+using namespace snax::chain;
+using namespace snax::testing;
+
+BOOST_AUTO_TEST_SUITE(api_benchmarks)
+
+   // Compares finding, reading and updating rows one at a time from a contract with the batched intrinsics, which must
+   // take less time for the same rows. The results are logged:
+   //    unit_test_benchmarks -t api_benchmarks/db_batch_benchmark -- --verbose
+   BOOST_AUTO_TEST_CASE(db_batch_benchmark) {
+      try {
+         tester test;
+         test.produce_blocks(2);
+         test.create_account( N(testapi) );
+         test.produce_blocks(10);
+         test.set_code( N(testapi), test_api_db_wast );
+         test.produce_blocks(1);
+
+         auto call = [&]( const char* method ) {
+            signed_transaction trx;
+            trx.actions.emplace_back( vector<permission_level>{{N(testapi), config::active_name}},
+                                      N(testapi), WASM_TEST_ACTION("test_db", method), bytes() );
+            test.set_transaction_headers( trx );
+            trx.sign( test.get_private_key( N(testapi), "active" ), test.control->get_chain_id() );
+            auto trace = test.push_transaction( trx );
+            BOOST_REQUIRE_EQUAL( transaction_receipt::executed, trace->receipt->status );
+            test.produce_block();
+            return trace->action_traces.front().elapsed;
+         };
+
+         call( "primary_i64_bench_setup" );
+
+         const int rounds = 10;
+         fc::microseconds per_row, many;
+         for( int i = 0; i < rounds; ++i ) {
+            per_row += call( "primary_i64_bench_per_row" );
+            many    += call( "primary_i64_bench_many" );
+         }
+         ilog( "500 rows row by row: ${per_row} us, batched: ${many} us",
+               ("per_row", per_row.count() / rounds)("many", many.count() / rounds) );
+         // the rounds alternate, so that both paths see the same state of the chain and of the machine
+         BOOST_CHECK_LT( many.count(), per_row.count() );
+      } FC_LOG_AND_RETHROW()
+   }
+
+BOOST_AUTO_TEST_SUITE_END()
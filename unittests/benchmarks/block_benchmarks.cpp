@@ -0,0 +1,71 @@
+/**
+ *  @file
+ *  @copyright defined in snax/LICENSE.txt
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <snax/testing/tester.hpp>
+#include <snax/chain/block_log.hpp>
+
+using namespace snax;
+using namespace testing;
+using namespace chain;
+
+BOOST_AUTO_TEST_SUITE(block_benchmarks)
+
+// Compares the disk usage and read latency of compressed and uncompressed block logs, and checks that compression
+// saves space while reading a block still costs the same wherever it is in the log. The results are logged:
+//    unit_test_benchmarks -t block_benchmarks/block_log_compression_benchmark -- --verbose
+BOOST_AUTO_TEST_CASE(block_log_compression_benchmark) try {
+   tester chain;
+   for( uint32_t i = 0; i < 200; ++i ) {
+      std::string name = "bench";
+      for( uint32_t j = i; j; j /= 26 ) name += char( 'a' + j % 26 );
+      chain.create_account( account_name( name ) );
+      chain.produce_block();
+   }
+   const uint32_t last_block_num = chain.control->last_irreversible_block_num();
+
+   fc::temp_directory tempdir;
+   std::map<block_log_compression, uint64_t> log_size;
+   for( auto compression : { block_log_compression::none, block_log_compression::zlib } ) {
+      const auto dir = tempdir.path() / std::to_string( (uint32_t)compression );
+      block_log_config config;
+      config.compression = compression;
+      block_log log( dir, config );
+      log.reset( chain.get_config().genesis, chain.control->fetch_block_by_number( 1 ) );
+      for( uint32_t n = 2; n <= last_block_num; ++n )
+         log.append( chain.control->fetch_block_by_number( n ) );
+
+      const uint32_t reads = 10000;
+      const auto start = fc::time_point::now();
+      for( uint32_t i = 0; i < reads; ++i )
+         BOOST_REQUIRE( log.read_packed_block_by_num( 1 + i % last_block_num ) );
+      const auto elapsed = fc::time_point::now() - start;
+      log_size[compression] = fc::file_size( dir / "blocks.log" );
+      ilog( "compression ${c}: ${size} bytes for ${n} blocks, ${ns} ns per read",
+            ("c", (uint32_t)compression)("size", log_size[compression])("n", last_block_num)
+            ("ns", elapsed.count() * 1000 / reads) );
+
+      // the fastest of a few runs reading ten consecutive blocks over and over
+      auto read_ns = [&]( uint32_t first ) {
+         int64_t best = std::numeric_limits<int64_t>::max();
+         for( int run = 0; run < 3; ++run ) {
+            const auto start = fc::time_point::now();
+            for( uint32_t i = 0; i < reads; ++i )
+               BOOST_REQUIRE( log.read_packed_block_by_num( first + i % 10 ) );
+            best = std::min( best, ( fc::time_point::now() - start ).count() );
+         }
+         return best * 1000 / reads;
+      };
+      // blocks are found through the index and decompressed one at a time, a log scanned or decompressed from the
+      // start would make the last blocks many times slower to read than the early ones
+      const auto early_ns = read_ns( last_block_num / 10 ), late_ns = read_ns( last_block_num - 9 );
+      ilog( "compression ${c}: ${early} ns per early block, ${late} ns per late block",
+            ("c", (uint32_t)compression)("early", early_ns)("late", late_ns) );
+      BOOST_CHECK_LT( late_ns, 4 * early_ns );
+   }
+   BOOST_CHECK_LT( log_size[block_log_compression::zlib], log_size[block_log_compression::none] );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,127 @@
+/**
+ *  @file
+ *  @copyright defined in snax/LICENSE.txt
+ */
+
+#include <snax/testing/tester.hpp>
+#include <snax/chain/apply_context.hpp>
+#include <snax/chain/transaction_context.hpp>
+#include <snax/chain/key_value_hash_index.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+#include <random>
+
+using namespace snax::chain;
+using namespace snax::testing;
+
+BOOST_AUTO_TEST_SUITE(database_benchmarks)
+
+   // Times the contract table intrinsics of apply_context against a table of many rows, and checks that the hash index
+   // of the rows finds them faster than the ordered index. The results are logged:
+   //    unit_test_benchmarks -t database_benchmarks/db_intrinsics_benchmark -- --verbose
+   BOOST_AUTO_TEST_CASE(db_intrinsics_benchmark) {
+      try {
+         tester test;
+         test.create_account( N(bench) );
+         test.produce_block();
+
+         const uint32_t num_rows    = 10000;
+         const uint32_t num_lookups = 100000;
+         const uint64_t scope = N(bench), table = N(accounts);
+
+         signed_transaction trx;
+         test.set_transaction_headers( trx );
+         transaction_context trx_context( *test.control, trx, trx.id() );
+         trx_context.init_for_implicit_trx();
+
+         action act;
+         act.account = N(bench);
+         act.name    = N(bench);
+         apply_context context( *test.control, trx_context, act );
+
+         auto time = [&]( const char* what, uint32_t count, auto&& op ) {
+            const auto start = fc::time_point::now();
+            for( uint32_t i = 0; i < count; ++i ) op( i );
+            const auto ns = ( fc::time_point::now() - start ).count() * 1000 / count;
+            ilog( "${what}: ${ns} ns/op", ("what", what)("ns", ns) );
+            return ns;
+         };
+
+         std::mt19937_64 rng( 42 );
+         vector<uint64_t> keys( num_lookups );
+         for( auto& k : keys ) k = rng() % num_rows;
+
+         const char value[64] = {};
+         time( "db_store_i64", num_rows, [&]( uint32_t i ) {
+            context.db_store_i64( scope, table, N(bench), i, value, sizeof(value) );
+         });
+
+         const auto& db = test.control->db();
+         const auto& tab = db.get<table_id_object, by_code_scope_table>( boost::make_tuple( N(bench), scope, table ) );
+         key_value_hash_index rows( db );
+         rows.build();
+         BOOST_TEST( rows.size() == num_rows );
+
+         // the fastest of a few runs of each is compared, so that a stray context switch does not decide it
+         int64_t ordered_ns = std::numeric_limits<int64_t>::max(), hashed_ns = ordered_ns;
+         for( int run = 0; run < 3; ++run ) {
+            uint32_t found = 0;
+            ordered_ns = std::min( ordered_ns, time( "ordered index find", num_lookups, [&]( uint32_t i ) {
+               found += db.find<key_value_object, by_scope_primary>( boost::make_tuple( tab.id, keys[i] ) ) != nullptr;
+            }));
+            hashed_ns = std::min( hashed_ns, time( "hash index find", num_lookups, [&]( uint32_t i ) {
+               found += rows.find( tab.id, keys[i] ) != nullptr;
+            }));
+            BOOST_TEST( found == 2 * num_lookups );
+         }
+         BOOST_CHECK_LT( hashed_ns, ordered_ns );
+
+         // the transaction read cache is warm for the rows the transaction stored, so start over with it cold
+         trx_context.table_reads.clear();
+         time( "db_find_i64 (cold)", num_rows, [&]( uint32_t i ) {
+            BOOST_TEST( context.db_find_i64( N(bench), scope, table, i ) >= 0 );
+         });
+         time( "db_find_i64", num_lookups, [&]( uint32_t i ) {
+            context.db_find_i64( N(bench), scope, table, keys[i] );
+         });
+         time( "db_find_i64 (missing row)", num_lookups, [&]( uint32_t i ) {
+            BOOST_TEST( context.db_find_i64( N(bench), scope, table, num_rows + keys[i] ) < -1 );
+         });
+
+         char buffer[sizeof(value)];
+         time( "db_find_i64 + db_get_i64", num_lookups, [&]( uint32_t i ) {
+            context.db_get_i64( context.db_find_i64( N(bench), scope, table, keys[i] ), buffer, sizeof(buffer) );
+         });
+         time( "db_find_i64 + db_update_i64", num_lookups, [&]( uint32_t i ) {
+            context.db_update_i64( context.db_find_i64( N(bench), scope, table, keys[i] ), N(bench), value, sizeof(value) );
+         });
+
+         const uint32_t batch_size = 100;
+         vector<uint64_t> batch_keys( batch_size );
+         vector<int> batch_iterators( batch_size );
+         vector<char> batch_rows( batch_size * (sizeof(uint32_t) + sizeof(value)) );
+         time( "db_get_many_i64 + db_update_many_i64 (100 rows)", num_lookups / batch_size, [&]( uint32_t i ) {
+            std::copy_n( keys.begin() + i * batch_size, batch_size, batch_keys.begin() );
+            BOOST_TEST( context.db_get_many_i64( N(bench), scope, table, batch_keys.data(), batch_iterators.data(), batch_size,
+                                                 batch_rows.data(), batch_rows.size() ) == (int)batch_rows.size() );
+            context.db_update_many_i64( batch_iterators.data(), batch_size, N(bench), batch_rows.data(), batch_rows.size() );
+         });
+
+         uint64_t primary = 0;
+         int itr = context.db_lowerbound_i64( N(bench), scope, table, 0 );
+         time( "db_next_i64", num_rows - 1, [&]( uint32_t i ) {
+            itr = context.db_next_i64( itr, primary );
+         });
+         BOOST_TEST( primary == num_rows - 1 );
+
+         time( "db_find_i64 + db_remove_i64", num_rows, [&]( uint32_t i ) {
+            context.db_remove_i64( context.db_find_i64( N(bench), scope, table, i ) );
+         });
+         BOOST_TEST( context.db_find_i64( N(bench), scope, table, 0 ) == -1 );
+
+         trx_context.undo();
+      } FC_LOG_AND_RETHROW()
+   }
+
+BOOST_AUTO_TEST_SUITE_END()
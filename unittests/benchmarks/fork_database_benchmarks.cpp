@@ -0,0 +1,117 @@
+/**
+ *  @file
+ *  @copyright defined in snax/LICENSE.txt
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <snax/testing/tester.hpp>
+#include <snax/chain/fork_database.hpp>
+
+using namespace snax::chain;
+
+BOOST_AUTO_TEST_SUITE(fork_database_benchmarks)
+
+/// unsigned block state building on @p prev, @p salt distinguishes competing blocks at the same height
+static block_state_ptr make_synthetic_block( const block_state_ptr& prev, uint16_t salt ) {
+   auto bsp = std::make_shared<block_state>();
+   bsp->header.previous  = prev->id;
+   bsp->header.timestamp = prev->header.timestamp.next();
+   bsp->header.confirmed = salt;
+   bsp->id               = bsp->header.id();
+   bsp->block_num        = bsp->header.block_num();
+   bsp->block            = std::make_shared<signed_block>( bsp->header );
+   return bsp;
+}
+
+/// the branches as fetch_branch_from found them before the flat index: by looking each previous block up by id
+static pair<branch_type, branch_type> fetch_branch_by_id( const fork_database& fork_db, const block_id_type& first,
+                                                         const block_id_type& second ) {
+   pair<branch_type, branch_type> result;
+   auto first_branch  = fork_db.get_block( first );
+   auto second_branch = fork_db.get_block( second );
+   while( first_branch->block_num > second_branch->block_num ) {
+      result.first.push_back( first_branch );
+      first_branch = fork_db.get_block( first_branch->header.previous );
+   }
+   while( second_branch->block_num > first_branch->block_num ) {
+      result.second.push_back( second_branch );
+      second_branch = fork_db.get_block( second_branch->header.previous );
+   }
+   while( first_branch->header.previous != second_branch->header.previous ) {
+      result.first.push_back( first_branch );
+      result.second.push_back( second_branch );
+      first_branch  = fork_db.get_block( first_branch->header.previous );
+      second_branch = fork_db.get_block( second_branch->header.previous );
+   }
+   result.first.push_back( first_branch );
+   result.second.push_back( second_branch );
+   return result;
+}
+
+// Times switches between deep competing forks the way controller::maybe_switch_forks does, and checks that the flat
+// index finds the branches faster than walking them by id as the fork database used to. The results are logged:
+//    unit_test_benchmarks -t fork_database_benchmarks/fork_db_deep_fork_switch -- --verbose
+BOOST_AUTO_TEST_CASE( fork_db_deep_fork_switch ) try {
+   fc::temp_directory dir;
+   fork_database fork_db( dir.path() );
+
+   auto root = std::make_shared<block_state>();
+   root->id        = root->header.id();
+   root->block_num = root->header.block_num();
+   root->block     = std::make_shared<signed_block>( root->header );
+   fork_db.set( root );
+
+   const uint32_t depth = 500, forks = 8;
+   vector<branch_type> branches( forks );
+   for( uint16_t f = 0; f < forks; ++f ) {
+      auto prev = root;
+      for( uint32_t i = 0; i < depth; ++i ) {
+         prev = fork_db.add( make_synthetic_block( prev, f + 2 ), false );
+         branches[f].push_back( prev );
+         if( f == 0 ) fork_db.mark_in_current_chain( prev, true );
+      }
+   }
+
+   const uint32_t switches = 200;
+   uint32_t current = 0;
+   const auto start = fc::time_point::now();
+   for( uint32_t i = 1; i <= switches; ++i ) {
+      const uint32_t next = i % forks;
+      auto result = fork_db.fetch_branch_from( branches[next].back()->id, branches[current].back()->id );
+      for( const auto& b : result.second )
+         fork_db.mark_in_current_chain( b, false );
+      for( auto ritr = result.first.rbegin(); ritr != result.first.rend(); ++ritr )
+         fork_db.mark_in_current_chain( *ritr, true );
+      current = next;
+   }
+   const auto elapsed = fc::time_point::now() - start;
+   ilog( "${n} switches between ${f} forks of depth ${d}: ${us} us per switch",
+         ("n", switches)("f", forks)("d", depth)("us", elapsed.count() / switches) );
+
+   // the fastest of a few runs of each, so that a stray context switch does not decide the comparison
+   auto time_branches = [&]( auto&& fetch ) {
+      int64_t best = std::numeric_limits<int64_t>::max();
+      for( int run = 0; run < 3; ++run ) {
+         size_t blocks = 0;
+         const auto start = fc::time_point::now();
+         for( uint32_t i = 1; i <= switches; ++i ) {
+            auto result = fetch( branches[i % forks].back()->id, branches[(i - 1) % forks].back()->id );
+            blocks += result.first.size() + result.second.size();
+         }
+         best = std::min( best, ( fc::time_point::now() - start ).count() );
+         BOOST_REQUIRE_EQUAL( blocks, 2 * depth * switches );
+      }
+      return best * 1000 / switches;
+   };
+   const auto indexed_ns = time_branches( [&]( const block_id_type& a, const block_id_type& b ) {
+      return fork_db.fetch_branch_from( a, b );
+   });
+   const auto by_id_ns = time_branches( [&]( const block_id_type& a, const block_id_type& b ) {
+      return fetch_branch_by_id( fork_db, a, b );
+   });
+   ilog( "fetch_branch_from: ${indexed} ns, walking the branches by id: ${by_id} ns",
+         ("indexed", indexed_ns)("by_id", by_id_ns) );
+   BOOST_CHECK_LT( indexed_ns, by_id_ns );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -5,6 +5,7 @@
 
 #include <boost/test/unit_test.hpp>
 #include <snax/testing/tester.hpp>
+#include <snax/chain/block_log.hpp>
 
 using namespace snax;
 using namespace testing;
@@ -163,4 +164,317 @@ BOOST_AUTO_TEST_CASE(untrusted_producer_test)
    }) ;
 }
 
+BOOST_AUTO_TEST_CASE(replay_pipeline_test) try {
+   tester chain;
+   chain.create_accounts( {N(alice), N(bob), N(carol)} );
+   chain.produce_blocks( 10 );
+   chain.create_account( N(dave) );
+   chain.produce_blocks( 20 );
+   chain.control->abort_block();
+
+   // replay a copy of the block log into a fresh state with the given pipeline configuration
+   int ordinal = 0;
+   auto replay = [&]( uint32_t prefetch_blocks, bool force_all_checks ) {
+      controller::config cfg = chain.get_config();
+      ++ordinal;
+      cfg.blocks_dir = cfg.blocks_dir.parent_path() / std::string("replay_").append(std::to_string(ordinal)).append("_blocks");
+      cfg.state_dir  = cfg.state_dir.parent_path() / std::string("replay_").append(std::to_string(ordinal)).append("_state");
+      cfg.replay_prefetch_blocks = prefetch_blocks;
+      cfg.force_all_checks = force_all_checks;
+      fc::create_directories( cfg.blocks_dir );
+      fc::copy( chain.get_config().blocks_dir / "blocks.log", cfg.blocks_dir / "blocks.log" );
+      return std::make_unique<tester>( cfg );
+   };
+
+   auto serial = replay( 1, false );
+   auto pipelined = replay( 8, false );
+   auto checked = replay( 8, true );
+
+   const auto replayed_head = serial->control->head_block_num();
+   BOOST_REQUIRE_GT( replayed_head, 1u );
+   BOOST_REQUIRE_EQUAL( serial->control->head_block_id().str(), chain.control->get_block_id_for_num( replayed_head ).str() );
+
+   for( auto* t : { pipelined.get(), checked.get() } ) {
+      BOOST_REQUIRE_EQUAL( t->control->head_block_id().str(), serial->control->head_block_id().str() );
+      BOOST_REQUIRE_EQUAL( t->control->calculate_integrity_hash().str(), serial->control->calculate_integrity_hash().str() );
+   }
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_CASE(recovered_keys_cache_test) try {
+   const auto key_a = tester::get_public_key( N(a), "active" );
+   const auto key_b = tester::get_public_key( N(b), "active" );
+   const auto chain_id = chain_id_type( fc::sha256::hash( "chain" ) );
+   const auto other_chain_id = chain_id_type( fc::sha256::hash( "other chain" ) );
+   auto signed_id = []( uint32_t n ) { return transaction_id_type::hash( n ); };
+
+   recovered_keys_cache cache( 2 );
+   BOOST_TEST( !cache.find( signed_id(1), chain_id ) );
+   cache.add( signed_id(1), chain_id, {key_a} );
+   cache.add( signed_id(2), chain_id, {key_a, key_b} );
+   BOOST_REQUIRE( cache.find( signed_id(1), chain_id ) );
+   BOOST_TEST( cache.find( signed_id(2), chain_id )->size() == 2u );
+   BOOST_TEST( !cache.find( signed_id(1), other_chain_id ) );
+
+   // 2 was used last, so 1 makes room for 3
+   cache.add( signed_id(3), chain_id, {key_b} );
+   BOOST_TEST( !cache.find( signed_id(1), chain_id ) );
+   BOOST_TEST( *cache.find( signed_id(3), chain_id ) == flat_set<public_key_type>{key_b} );
+
+   const auto stats = cache.get_stats();
+   BOOST_TEST( stats.hits == 3u );
+   BOOST_TEST( stats.misses == 3u );
+   BOOST_TEST( stats.evictions == 1u );
+   BOOST_TEST( stats.entries == 2u );
+   BOOST_TEST( stats.max_entries == 2u );
+} FC_LOG_AND_RETHROW()
+
+// A transaction pushed to a node and then received in a block of another producer is recovered only once
+BOOST_AUTO_TEST_CASE(recovered_keys_reused_by_block_test) try {
+   tester main, other;
+   main.produce_block();
+   other.push_block( main.control->fetch_block_by_number( 1 + other.control->head_block_num() ) );
+
+   main.create_account( N(alice) );
+   auto b = main.produce_block();
+   auto ptrx = b->transactions.back().trx.get<packed_transaction>();
+
+   other.push_transaction( ptrx );
+   const auto before = other.control->get_recovered_keys_stats();
+   BOOST_TEST( before.entries >= 1u );
+
+   other.push_block( b );
+   const auto after = other.control->get_recovered_keys_stats();
+   BOOST_TEST( after.hits == before.hits + 1 );
+   BOOST_TEST( after.misses == before.misses );
+   BOOST_REQUIRE_EQUAL( other.control->head_block_id().str(), b->id().str() );
+} FC_LOG_AND_RETHROW()
+
+// Blocks appended to a block log written by its writer thread are readable right away, and end up in the files
+BOOST_AUTO_TEST_CASE(block_log_async_append_test) try {
+   tester chain;
+   chain.produce_blocks( 30 );
+   const uint32_t last_block_num = chain.control->last_irreversible_block_num();
+   BOOST_REQUIRE_GT( last_block_num, 10u );
+
+   fc::temp_directory tempdir;
+   auto check_log = [&]( const block_log& log ) {
+      BOOST_REQUIRE( log.head() );
+      BOOST_REQUIRE_EQUAL( log.head()->block_num(), last_block_num );
+      BOOST_REQUIRE_EQUAL( log.read_head()->id().str(), log.head()->id().str() );
+      for( uint32_t n = 1; n <= last_block_num; ++n ) {
+         auto b = chain.control->fetch_block_by_number( n );
+         BOOST_REQUIRE_EQUAL( log.read_block_by_num( n )->id().str(), b->id().str() );
+         BOOST_REQUIRE( log.read_serialized_block_by_num( n ) == fc::raw::pack( *b ) );
+         auto view = log.read_packed_block_by_num( n );
+         BOOST_REQUIRE( vector<char>( view.data, view.data + view.size ) == fc::raw::pack( *b ) );
+         BOOST_REQUIRE_EQUAL( log.read_block( log.get_block_pos( n ) ).first->id().str(), b->id().str() );
+      }
+      BOOST_REQUIRE( !log.read_block_by_num( last_block_num + 1 ) );
+   };
+
+   for( uint32_t queue_size : { 0u, 1u, 8u } ) {
+      const auto dir = tempdir.path() / std::to_string( queue_size );
+      {
+         block_log_config config;
+         config.write_queue_size = queue_size;
+         config.fsync_interval = 3;
+         block_log log( dir, config );
+         log.reset( chain.get_config().genesis, chain.control->fetch_block_by_number( 1 ) );
+         for( uint32_t n = 2; n <= last_block_num; ++n ) {
+            log.append( chain.control->fetch_block_by_number( n ) );
+            BOOST_REQUIRE_EQUAL( log.read_block_by_num( n )->block_num(), n );
+            BOOST_REQUIRE_EQUAL( log.read_block_by_num( n / 2 )->block_num(), n / 2 );
+            // at most queue_size appended blocks are not written yet
+            BOOST_REQUIRE_LE( log.last_written_block_num(), n );
+            BOOST_REQUIRE_GE( log.last_written_block_num() + queue_size, n );
+         }
+         check_log( log );
+         log.flush();
+         BOOST_REQUIRE_EQUAL( log.last_written_block_num(), last_block_num );
+      }
+
+      // the blocks left in the queue are written when the log is closed, and the index is consistent with them
+      block_log reopened( dir );
+      check_log( reopened );
+
+      // views of the mapped log outlive appends that grow the mapping and resets that replace the files
+      auto view = reopened.read_packed_block_by_num( last_block_num );
+      BOOST_REQUIRE( view );
+      reopened.reset( chain.get_config().genesis, chain.control->fetch_block_by_number( 1 ) );
+      BOOST_REQUIRE( !reopened.read_packed_block_by_num( last_block_num ) );
+      BOOST_REQUIRE( vector<char>( view.data, view.data + view.size ) == fc::raw::pack( *chain.control->fetch_block_by_number( last_block_num ) ) );
+   }
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_CASE(block_log_segments_test) try {
+   tester chain;
+   chain.produce_blocks( 30 );
+   const uint32_t last_block_num = chain.control->last_irreversible_block_num();
+   BOOST_REQUIRE_GT( last_block_num, 16u );
+
+   fc::temp_directory tempdir;
+   const auto dir = tempdir.path() / "blocks";
+   block_log_config config;
+   config.write_queue_size = 8;
+   config.stride = 5;
+   config.retained_blocks = 8;
+   config.archive_dir = tempdir.path() / "archive";
+
+   auto check_log = [&]( const block_log& log, uint32_t first_block_num ) {
+      BOOST_REQUIRE_EQUAL( log.first_block_num(), first_block_num );
+      BOOST_REQUIRE_EQUAL( log.read_head()->block_num(), last_block_num );
+      for( uint32_t n = 1; n <= last_block_num; ++n ) {
+         auto b = chain.control->fetch_block_by_number( n );
+         if( n < first_block_num ) {
+            BOOST_REQUIRE( !log.read_block_by_num( n ) );
+            continue;
+         }
+         BOOST_REQUIRE_EQUAL( log.read_block_by_num( n )->id().str(), b->id().str() );
+         auto view = log.read_packed_block_by_num( n );
+         BOOST_REQUIRE( vector<char>( view.data, view.data + view.size ) == fc::raw::pack( *b ) );
+      }
+      BOOST_REQUIRE( !log.read_block_by_num( last_block_num + 1 ) );
+   };
+
+   {
+      block_log log( dir, config );
+      log.reset( chain.get_config().genesis, chain.control->fetch_block_by_number( 1 ) );
+      for( uint32_t n = 2; n <= last_block_num; ++n ) {
+         log.append( chain.control->fetch_block_by_number( n ) );
+         BOOST_REQUIRE_EQUAL( log.read_block_by_num( n / 2 )->block_num(), n / 2 );
+      }
+      check_log( log, 1 );
+   }
+
+   // the log is rolled once a block follows a multiple of the stride, and the segments more than
+   // retained_blocks behind the last roll are moved to the archive
+   const uint32_t last_rolled = (last_block_num - 1) / 5 * 5;
+   auto segment = [&]( const fc::path& d, uint32_t last ) {
+      return d / ("blocks-" + std::to_string( last - 4 ) + "-" + std::to_string( last ) + ".log");
+   };
+   BOOST_REQUIRE( fc::exists( segment( dir, last_rolled ) ) );
+   BOOST_REQUIRE( fc::exists( segment( dir, last_rolled - 5 ) ) );
+   BOOST_REQUIRE( !fc::exists( segment( dir, last_rolled - 10 ) ) );
+   BOOST_REQUIRE( fc::exists( segment( config.archive_dir, last_rolled - 10 ) ) );
+   BOOST_REQUIRE( fc::exists( segment( config.archive_dir, 5 ) ) );
+
+   block_log reopened( dir, config );
+   check_log( reopened, 1 );
+
+   // without the archive, the log starts with the oldest segment in the blocks directory
+   block_log unarchived( dir );
+   check_log( unarchived, last_rolled - 9 );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_CASE(block_log_compression_test) try {
+   tester chain;
+   chain.create_accounts( {N(alice), N(bob)} );
+   chain.produce_blocks( 20 );
+   const uint32_t last_block_num = chain.control->last_irreversible_block_num();
+   BOOST_REQUIRE_GT( last_block_num, 10u );
+
+   fc::temp_directory tempdir;
+   auto check_log = [&]( const block_log& log ) {
+      BOOST_REQUIRE_EQUAL( log.read_head()->block_num(), last_block_num );
+      for( uint32_t n = 1; n <= last_block_num; ++n ) {
+         auto b = chain.control->fetch_block_by_number( n );
+         BOOST_REQUIRE_EQUAL( log.read_block_by_num( n )->id().str(), b->id().str() );
+         BOOST_REQUIRE( log.read_serialized_block_by_num( n ) == fc::raw::pack( *b ) );
+      }
+   };
+
+   for( auto compression : { block_log_compression::none, block_log_compression::zlib } ) {
+      for( uint32_t stride : { 0u, 4u } ) {
+         const auto dir = tempdir.path() / (std::to_string( (uint32_t)compression ) + "-" + std::to_string( stride ));
+         block_log_config config;
+         config.stride = stride;
+         config.compression = compression;
+         {
+            block_log log( dir, config );
+            log.reset( chain.get_config().genesis, chain.control->fetch_block_by_number( 1 ) );
+            for( uint32_t n = 2; n <= last_block_num; ++n )
+               log.append( chain.control->fetch_block_by_number( n ) );
+            check_log( log );
+            if( stride == 0 ) {
+               // positions refer to the entries, and read_block returns the position of the next one
+               const auto pos = log.get_block_pos( 2 );
+               BOOST_REQUIRE_EQUAL( log.read_block( pos ).second, log.get_block_pos( 3 ) );
+            }
+         }
+
+         // the version is read back from the files, and the index rebuilt from the entries
+         fc::remove_all( dir / "blocks.index" );
+         block_log reopened( dir, config );
+         check_log( reopened );
+      }
+
+      // repair copies the entries as they are
+      const auto dir = tempdir.path() / (std::to_string( (uint32_t)compression ) + "-0");
+      block_log::repair_log( dir );
+      block_log repaired( dir );
+      check_log( repaired );
+   }
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_CASE(block_log_construct_index_test) try {
+   tester chain;
+   chain.produce_blocks( 30 );
+   const uint32_t last_block_num = chain.control->last_irreversible_block_num();
+
+   fc::temp_directory tempdir;
+   const auto block_file = tempdir.path() / "blocks.log";
+   const auto index_file = tempdir.path() / "blocks.index";
+   {
+      block_log log( tempdir.path() );
+      log.reset( chain.get_config().genesis, chain.control->fetch_block_by_number( 1 ) );
+      for( uint32_t n = 2; n <= last_block_num; ++n )
+         log.append( chain.control->fetch_block_by_number( n ) );
+   }
+   auto read_index = [&]() {
+      std::ifstream f( index_file.generic_string(), std::ios::binary );
+      return vector<char>( std::istreambuf_iterator<char>( f ), std::istreambuf_iterator<char>() );
+   };
+   const auto expected = read_index();
+   BOOST_REQUIRE_EQUAL( expected.size(), last_block_num * sizeof(uint64_t) );
+
+   // the ranges scanned by the threads are smaller than a block here, so most walks start from guesses
+   for( uint32_t threads : { 1u, 4u, 64u } ) {
+      fc::remove_all( index_file );
+      uint64_t reported = 0;
+      block_log::construct_index( block_file, index_file, threads, [&]( uint64_t scanned, uint64_t total ) {
+         reported = scanned;
+         BOOST_REQUIRE_LE( scanned, total );
+      });
+      BOOST_REQUIRE( read_index() == expected );
+      BOOST_REQUIRE_GT( reported, 0u );
+   }
+
+   // an interrupted rebuild resumes from the entries already written, also when the last one is partly written
+   bfs::resize_file( index_file.generic_string(), expected.size() / 2 + 3 );
+   block_log::construct_index( block_file, index_file, 4 );
+   BOOST_REQUIRE( read_index() == expected );
+
+   // entries past the end of the log are dropped
+   {
+      std::ofstream f( index_file.generic_string(), std::ios::binary | std::ios::app );
+      const uint64_t past_end = fc::file_size( block_file ) + 100;
+      f.write( (const char*)&past_end, sizeof(past_end) );
+   }
+   block_log::construct_index( block_file, index_file, 4 );
+   BOOST_REQUIRE( read_index() == expected );
+
+   // an index whose last entry is not the block it stands for is rebuilt from the first block
+   {
+      std::fstream f( index_file.generic_string(), std::ios::binary | std::ios::in | std::ios::out );
+      f.seekp( expected.size() - sizeof(uint64_t) );
+      f.write( expected.data() + sizeof(uint64_t), sizeof(uint64_t) );
+   }
+   block_log::construct_index( block_file, index_file, 4 );
+   BOOST_REQUIRE( read_index() == expected );
+
+   block_log reopened( tempdir.path() );
+   BOOST_REQUIRE_EQUAL( reopened.read_block_by_num( last_block_num )->id().str(),
+                        chain.control->fetch_block_by_number( last_block_num )->id().str() );
+} FC_LOG_AND_RETHROW()
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -5,6 +5,9 @@
 
 #include <snax/testing/tester.hpp>
 #include <snax/chain/global_property_object.hpp>
+#include <snax/chain/apply_context.hpp>
+#include <snax/chain/transaction_context.hpp>
+#include <snax/chain/key_value_hash_index.hpp>
 #include <fc/crypto/digest.hpp>
 
 #include <boost/test/unit_test.hpp>
@@ -50,6 +53,206 @@ BOOST_AUTO_TEST_SUITE(database_tests)
       } FC_LOG_AND_RETHROW()
    }
 
+   // Rows found through the transaction's read cache must match the database, also once rows are removed or undone
+   BOOST_AUTO_TEST_CASE(table_read_cache_test) {
+      try {
+         tester test;
+         test.create_account( N(alice) );
+         test.produce_block();
+
+         const uint64_t scope = N(alice), table = N(accounts);
+
+         signed_transaction trx;
+         test.set_transaction_headers( trx );
+         transaction_context trx_context( *test.control, trx, trx.id() );
+         trx_context.init_for_implicit_trx();
+
+         action act;
+         act.account = N(alice);
+         act.name    = N(test);
+         apply_context context( *test.control, trx_context, act );
+
+         const char value[8] = {};
+         for( uint64_t pk = 0; pk < 100; pk += 2 )
+            context.db_store_i64( scope, table, N(alice), pk, value, sizeof(value) );
+
+         const auto& db = test.control->db();
+         const auto& tab = db.get<table_id_object, by_code_scope_table>( boost::make_tuple( N(alice), scope, table ) );
+         auto found = [&]( uint64_t pk ) {
+            const bool in_db = db.find<key_value_object, by_scope_primary>( boost::make_tuple( tab.id, pk ) ) != nullptr;
+            BOOST_TEST( (context.db_find_i64( N(alice), scope, table, pk ) >= 0) == in_db );
+            return in_db;
+         };
+
+         for( uint64_t pk = 0; pk < 100; ++pk )
+            BOOST_TEST( found( pk ) == (pk % 2 == 0) );
+
+         context.db_remove_i64( context.db_find_i64( N(alice), scope, table, 10 ) );
+         BOOST_TEST( !found( 10 ) );
+         BOOST_TEST( found( 12 ) );
+
+         trx_context.undo();
+         BOOST_TEST( context.db_find_i64( N(alice), scope, table, 12 ) == -1 );
+      } FC_LOG_AND_RETHROW()
+   }
+
+   // The row hash index must match the ordered index across nested undo sessions, squashes and a revision reached again
+   BOOST_AUTO_TEST_CASE(key_value_hash_index_test) {
+      try {
+         tester test;
+         snax::chain::database& db = const_cast<snax::chain::database&>( test.control->db() );
+
+         key_value_hash_index index( db );
+         index.build();
+
+         const auto& tab = db.create<table_id_object>( []( auto& t ) {
+            t.code  = N(alice);
+            t.scope = N(alice);
+            t.table = N(accounts);
+            t.payer = N(alice);
+         });
+         auto store = [&]( uint64_t pk ) {
+            index.add( db.create<key_value_object>( [&]( auto& o ) {
+               o.t_id        = tab.id;
+               o.primary_key = pk;
+               o.payer       = N(alice);
+            }));
+         };
+         auto erase = [&]( uint64_t pk ) {
+            const auto& obj = db.get<key_value_object, by_scope_primary>( boost::make_tuple( tab.id, pk ) );
+            index.remove( obj );
+            db.remove( obj );
+         };
+         auto check = [&]() {
+            for( uint64_t pk = 0; pk < 24; ++pk ) {
+               BOOST_TEST( index.find( tab.id, pk ) == db.find<key_value_object, by_scope_primary>( boost::make_tuple( tab.id, pk ) ) );
+            }
+            BOOST_TEST( index.size() == db.get_index<key_value_index>().size() );
+         };
+
+         for( uint64_t pk = 0; pk < 20; pk += 2 ) store( pk );
+         check();
+
+         {
+            index.sync();
+            auto outer = db.start_undo_session( true );
+            store( 1 );
+            erase( 2 );
+            check();
+            {
+               index.sync();
+               auto inner = db.start_undo_session( true );
+               store( 3 );
+               erase( 4 );
+               erase( 1 );
+               check();
+               inner.undo();
+            }
+            check();
+            {
+               index.sync();
+               auto inner = db.start_undo_session( true );
+               store( 5 );
+               erase( 6 );
+               inner.squash();
+            }
+            check();
+            {
+               // undone when it goes out of scope
+               index.sync();
+               auto inner = db.start_undo_session( true );
+               store( 7 );
+               erase( 8 );
+            }
+            check();
+            outer.undo();
+         }
+         check();
+
+         // a new session at the revision of an undone one
+         {
+            index.sync();
+            auto session = db.start_undo_session( true );
+            store( 21 );
+            erase( 10 );
+            session.undo();
+         }
+         {
+            index.sync();
+            auto session = db.start_undo_session( true );
+            store( 23 );
+            check();
+            index.commit( db.revision() - 1 );
+            session.undo();
+         }
+         check();
+      } FC_LOG_AND_RETHROW()
+   }
+
+   // With the row hash index enabled, contracts must find the rows the state database holds across undone transactions and blocks
+   BOOST_AUTO_TEST_CASE(contract_row_hash_index_test) {
+      try {
+         tester test;
+         controller::config cfg = test.get_config();
+         test.close();
+         cfg.contract_row_hash_index = true;
+         test.init( cfg );
+         test.create_account( N(alice) );
+         test.produce_block();
+
+         const uint64_t scope = N(alice), table = N(accounts);
+         const char value[8] = {};
+         auto run = [&]( bool keep, auto&& f ) {
+            signed_transaction trx;
+            test.set_transaction_headers( trx );
+            transaction_context trx_context( *test.control, trx, trx.id() );
+            trx_context.init_for_implicit_trx();
+
+            action act;
+            act.account = N(alice);
+            act.name    = N(test);
+            apply_context context( *test.control, trx_context, act );
+            f( context );
+            if( keep ) trx_context.squash();
+            else trx_context.undo();
+         };
+         auto check = [&]( apply_context& context ) {
+            const auto& db = test.control->db();
+            const auto* tab = db.find<table_id_object, by_code_scope_table>( boost::make_tuple( N(alice), scope, table ) );
+            BOOST_REQUIRE( tab );
+            for( uint64_t pk = 0; pk < 12; ++pk ) {
+               const bool in_db = db.find<key_value_object, by_scope_primary>( boost::make_tuple( tab->id, pk ) ) != nullptr;
+               BOOST_TEST( (context.db_find_i64( N(alice), scope, table, pk ) >= 0) == in_db );
+            }
+         };
+
+         run( true, [&]( apply_context& context ) {
+            for( uint64_t pk = 0; pk < 10; pk += 2 )
+               context.db_store_i64( scope, table, N(alice), pk, value, sizeof(value) );
+         });
+         test.produce_block();
+
+         run( false, [&]( apply_context& context ) {
+            context.db_store_i64( scope, table, N(alice), 1, value, sizeof(value) );
+            context.db_remove_i64( context.db_find_i64( N(alice), scope, table, 2 ) );
+            check( context );
+         });
+         run( true, [&]( apply_context& context ) {
+            check( context );
+            context.db_store_i64( scope, table, N(alice), 3, value, sizeof(value) );
+            context.db_remove_i64( context.db_find_i64( N(alice), scope, table, 4 ) );
+         });
+         test.control->abort_block();
+         test.produce_block();
+
+         run( false, [&]( apply_context& context ) {
+            check( context );
+            BOOST_TEST( context.db_find_i64( N(alice), scope, table, 3 ) < -1 );
+            BOOST_TEST( context.db_find_i64( N(alice), scope, table, 4 ) >= 0 );
+         });
+      } FC_LOG_AND_RETHROW()
+   }
+
    // Test the block fetching methods on database, fetch_bock_by_id, and fetch_block_by_number
    BOOST_AUTO_TEST_CASE(get_blocks) {
       try {
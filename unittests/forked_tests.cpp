@@ -10,6 +10,8 @@
 
 #include <fc/variant_object.hpp>
 
+#include <fstream>
+
 using namespace snax::chain;
 using namespace snax::testing;
 
@@ -28,6 +30,18 @@ void push_blocks( tester& from, tester& to ) {
    }
 }
 
+/// unsigned block state building on @p prev, @p salt distinguishes competing blocks at the same height
+block_state_ptr make_synthetic_block( const block_state_ptr& prev, uint16_t salt ) {
+   auto bsp = std::make_shared<block_state>();
+   bsp->header.previous  = prev->id;
+   bsp->header.timestamp = prev->header.timestamp.next();
+   bsp->header.confirmed = salt;
+   bsp->id               = bsp->header.id();
+   bsp->block_num        = bsp->header.block_num();
+   bsp->block            = std::make_shared<signed_block>( bsp->header );
+   return bsp;
+}
+
 BOOST_AUTO_TEST_SUITE(forked_tests)
 
 BOOST_AUTO_TEST_CASE( irrblock ) try {
@@ -374,4 +388,203 @@ BOOST_AUTO_TEST_CASE( read_modes ) try {
 
 } FC_LOG_AND_RETHROW()
 
+BOOST_AUTO_TEST_CASE( fork_db_journal_recovery ) try {
+   tester c;
+   auto cfg = c.get_config();
+   c.close();
+   cfg.fork_db_journal = true;
+   c.init( cfg );
+   c.produce_block();
+   auto r = c.create_accounts( {N(dan),N(sam),N(pam)} );
+   c.produce_block();
+   auto res = c.set_producers( {N(dan),N(sam),N(pam)} );
+   c.produce_blocks(200);
+
+   const auto journal = c.get_config().state_dir / config::forkdb_journal_filename;
+   BOOST_REQUIRE( fc::exists( journal ) );
+
+   // copy the journal of the running chain, as an unclean exit would leave it behind
+   fc::temp_directory crashed;
+   const auto recovered_journal = crashed.path() / config::forkdb_journal_filename;
+   fc::copy( journal, recovered_journal );
+
+   auto check_recovered = [&]() {
+      fork_database recovered( crashed.path(), true );
+      BOOST_REQUIRE( recovered.head() );
+      BOOST_REQUIRE_EQUAL( string(c.control->fork_db_head_block_id()), string(recovered.head()->id) );
+      for( auto n = c.control->last_irreversible_block_num() + 1; n <= c.control->head_block_num(); ++n ) {
+         auto expected = c.control->fork_db().get_block_in_current_chain_by_num( n );
+         auto actual   = recovered.get_block_in_current_chain_by_num( n );
+         BOOST_REQUIRE( expected && actual );
+         BOOST_REQUIRE_EQUAL( string(expected->id), string(actual->id) );
+         BOOST_REQUIRE_EQUAL( expected->validated, actual->validated );
+         BOOST_REQUIRE_EQUAL( expected->bft_irreversible_blocknum, actual->bft_irreversible_blocknum );
+         // the journal does not keep blocks, they are fetched again
+         BOOST_REQUIRE( !actual->block );
+      }
+      recovered.recover_blocks( [&]( const block_state& s ) { return c.control->fetch_block_by_id( s.id ); } );
+      for( auto n = c.control->last_irreversible_block_num() + 1; n <= c.control->head_block_num(); ++n ) {
+         auto actual = recovered.get_block_in_current_chain_by_num( n );
+         BOOST_REQUIRE( actual->block );
+         BOOST_REQUIRE_EQUAL( string(actual->block->id()), string(actual->id) );
+      }
+      // a clean close leaves forkdb.dat and no journal
+      recovered.close();
+      BOOST_REQUIRE( !fc::exists( recovered_journal ) );
+      fc::remove( crashed.path() / config::forkdb_filename );
+   };
+   check_recovered();
+
+   // a torn record at the end of the journal is discarded
+   fc::copy( journal, recovered_journal );
+   {
+      std::ofstream out( recovered_journal.generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::app );
+      const uint32_t size = 1024;
+      out.write( reinterpret_cast<const char*>(&size), sizeof(size) );
+      out.write( "torn", 4 );
+   }
+   check_recovered();
+
+   // block states whose blocks are gone are dropped
+   fc::copy( journal, recovered_journal );
+   {
+      fork_database recovered( crashed.path(), true );
+      const auto head_num = c.control->head_block_num();
+      recovered.recover_blocks( [&]( const block_state& s ) {
+         return s.block_num < head_num ? c.control->fetch_block_by_id( s.id ) : signed_block_ptr();
+      });
+      BOOST_REQUIRE_EQUAL( recovered.head()->block_num, head_num - 1 );
+      BOOST_REQUIRE( !recovered.get_block( c.control->head_block_id() ) );
+      recovered.close();
+      fc::remove( crashed.path() / config::forkdb_filename );
+   }
+
+   c.close();
+   BOOST_REQUIRE( !fc::exists( journal ) );
+   BOOST_REQUIRE( fc::exists( c.get_config().state_dir / config::forkdb_filename ) );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_CASE( fork_db_journal_behind_reversible_blocks ) try {
+   tester c;
+   auto cfg = c.get_config();
+   c.close();
+   cfg.fork_db_journal = true;
+   c.init( cfg );
+   c.produce_blocks(10);
+
+   // the journal as it was one block before the last block written to the reversible block database
+   const auto journal = cfg.state_dir / config::forkdb_journal_filename;
+   fc::temp_directory saved;
+   fc::copy( journal, saved.path() / config::forkdb_journal_filename );
+   c.produce_block();
+   const auto head_id = c.control->head_block_id();
+
+   c.close();
+   fc::remove( cfg.state_dir / config::forkdb_filename );
+   fc::copy( saved.path() / config::forkdb_journal_filename, journal );
+
+   c.open( nullptr );
+   BOOST_REQUIRE_EQUAL( string(head_id), string(c.control->head_block_id()) );
+   BOOST_REQUIRE( c.control->fork_db().get_block( head_id )->in_current_chain );
+   c.produce_block();
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_CASE( fork_db_fork_switch ) try {
+   fc::temp_directory dir;
+   fork_database fork_db( dir.path() );
+
+   auto root = std::make_shared<block_state>();
+   root->id        = root->header.id();
+   root->block_num = root->header.block_num();
+   root->block     = std::make_shared<signed_block>( root->header );
+   fork_db.set( root );
+
+   // competing branches of the same depth built on the root, branch 0 is the current chain
+   const uint32_t depth = 50, forks = 4;
+   vector<branch_type> branches( forks );
+   for( uint16_t f = 0; f < forks; ++f ) {
+      auto prev = root;
+      for( uint32_t i = 0; i < depth; ++i ) {
+         prev = fork_db.add( make_synthetic_block( prev, f + 2 ), false );
+         branches[f].push_back( prev );
+         if( f == 0 ) fork_db.mark_in_current_chain( prev, true );
+      }
+   }
+   BOOST_REQUIRE_EQUAL( string(branches[0].back()->id), string(fork_db.head()->id) );
+
+   // switch between all branches the way controller::maybe_switch_forks does
+   const uint32_t switches = 3 * forks;
+   uint32_t current = 0;
+   for( uint32_t i = 1; i <= switches; ++i ) {
+      const uint32_t next = i % forks;
+      auto result = fork_db.fetch_branch_from( branches[next].back()->id, branches[current].back()->id );
+      BOOST_REQUIRE_EQUAL( depth, result.first.size() );
+      BOOST_REQUIRE_EQUAL( depth, result.second.size() );
+      BOOST_REQUIRE_EQUAL( string(root->id), string(result.first.back()->header.previous) );
+
+      for( const auto& b : result.second )
+         fork_db.mark_in_current_chain( b, false );
+      for( auto ritr = result.first.rbegin(); ritr != result.first.rend(); ++ritr )
+         fork_db.mark_in_current_chain( *ritr, true );
+      current = next;
+   }
+
+   for( uint32_t i = 0; i < depth; ++i ) {
+      auto b = fork_db.get_block_in_current_chain_by_num( i + 2 );
+      BOOST_REQUIRE( b );
+      BOOST_REQUIRE_EQUAL( string(branches[current][i]->id), string(b->id) );
+   }
+
+   // removing the first block of a fork removes the whole fork
+   const uint32_t removed = (current + 1) % forks;
+   fork_db.set_validity( branches[removed].front(), false );
+   for( const auto& b : branches[removed] )
+      BOOST_REQUIRE( !fork_db.get_block( b->id ) );
+   BOOST_REQUIRE( fork_db.get_block( branches[current].back()->id ) );
+   BOOST_CHECK_THROW( fork_db.fetch_branch_from( branches[removed].back()->id, branches[current].back()->id ),
+                      fork_db_block_not_found );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_CASE( prepared_block_window ) try {
+   tester c;
+   c.produce_block();
+   auto r = c.create_accounts( {N(dan),N(sam),N(pam)} );
+   c.produce_block();
+   auto res = c.set_producers( {N(dan),N(sam),N(pam)} );
+   c.produce_blocks(60);
+
+   // verify a window of blocks ahead, then push them in order as net_plugin does during sync
+   tester other;
+   const uint32_t window_size = 16;
+   while( other.control->fork_db_head_block_num() < c.control->fork_db_head_block_num() ) {
+      vector<signed_block_ptr> window;
+      for( auto n = other.control->fork_db_head_block_num() + 1;
+           n <= c.control->fork_db_head_block_num() && window.size() < window_size; ++n ) {
+         window.push_back( c.control->fetch_block_by_number( n ) );
+         other.control->prepare_block( window.back() );
+      }
+      for( const auto& b : window )
+         other.push_block( b );
+   }
+   BOOST_REQUIRE_EQUAL( string(c.control->head_block_id()), string(other.control->head_block_id()) );
+
+   // a block with a bad producer signature is rejected when pushed, the blocks built on it do not verify either
+   c.produce_blocks(4);
+   vector<signed_block_ptr> window;
+   for( auto n = other.control->head_block_num() + 1; n <= c.control->head_block_num(); ++n ) {
+      window.push_back( std::make_shared<signed_block>( *c.control->fetch_block_by_number( n ) ) );
+   }
+   window[1]->producer_signature = get_private_key( N(bad), "active" ).sign( window[1]->digest() );
+   for( const auto& b : window )
+      other.control->prepare_block( b );
+
+   other.push_block( window[0] );
+   BOOST_REQUIRE_THROW( other.push_block( window[1] ), fc::exception );
+   other.control->clear_prepared_blocks();
+
+   for( auto n = other.control->head_block_num() + 1; n <= c.control->head_block_num(); ++n )
+      other.push_block( c.control->fetch_block_by_number( n ) );
+   BOOST_REQUIRE_EQUAL( string(c.control->head_block_id()), string(other.control->head_block_id()) );
+} FC_LOG_AND_RETHROW()
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -13,6 +13,7 @@
 #include <snapshot_test/snapshot_test.abi.hpp>
 
 #include <sstream>
+#include <thread>
 
 using namespace snax;
 using namespace testing;
@@ -149,9 +150,55 @@ struct buffered_snapshot_suite {
 
 };
 
+struct parallel_snapshot_suite {
+   using writer_t = parallel_snapshot_writer;
+   using reader_t = parallel_snapshot_reader;
+   using write_storage_t = std::ostringstream;
+   using snapshot_t = std::string;
+   using read_storage_t = std::istringstream;
+
+   // more threads than the test machine may have cores, to have sections written concurrently
+   static const uint32_t threads = 4;
+
+   struct writer : public writer_t {
+      writer( const std::shared_ptr<write_storage_t>& storage )
+      :writer_t(*storage, threads)
+      ,storage(storage)
+      {
+
+      }
+
+      std::shared_ptr<write_storage_t> storage;
+   };
+
+   struct reader : public reader_t {
+      explicit reader(const std::shared_ptr<read_storage_t>& storage)
+      :reader_t(*storage, threads)
+      ,storage(storage)
+      {}
+
+      std::shared_ptr<read_storage_t> storage;
+   };
+
+
+   static auto get_writer() {
+      return std::make_shared<writer>(std::make_shared<write_storage_t>());
+   }
+
+   static auto finalize(const std::shared_ptr<writer>& w) {
+      w->finalize();
+      return w->storage->str();
+   }
+
+   static auto get_reader( const snapshot_t& buffer) {
+      return std::make_shared<reader>(std::make_shared<read_storage_t>(buffer));
+   }
+
+};
+
 BOOST_AUTO_TEST_SUITE(snapshot_tests)
 
-using snapshot_suites = boost::mpl::list<variant_snapshot_suite, buffered_snapshot_suite>;
+using snapshot_suites = boost::mpl::list<variant_snapshot_suite, buffered_snapshot_suite, parallel_snapshot_suite>;
 
 BOOST_AUTO_TEST_CASE_TEMPLATE(test_exhaustive_snapshot, SNAPSHOT_SUITE, snapshot_suites)
 {
@@ -254,4 +301,145 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(test_replay_over_snapshot, SNAPSHOT_SUITE, snapsho
    BOOST_REQUIRE_EQUAL(expected_post_integrity_hash.str(), snap_chain.control->calculate_integrity_hash().str());
 }
 
+BOOST_AUTO_TEST_CASE(test_parallel_snapshot_checksums)
+{
+   tester chain;
+
+   chain.create_account(N(snapshot));
+   chain.produce_blocks(1);
+   chain.set_code(N(snapshot), snapshot_test_wast);
+   chain.set_abi(N(snapshot), snapshot_test_abi);
+   chain.produce_blocks(1);
+   chain.control->abort_block();
+
+   auto writer = parallel_snapshot_suite::get_writer();
+   chain.control->write_snapshot(writer);
+   auto snapshot = parallel_snapshot_suite::finalize(writer);
+
+   // both binary formats are told apart by their magic number
+   {
+      std::istringstream parallel_in(snapshot);
+      BOOST_REQUIRE(parallel_snapshot_reader::is_parallel_snapshot(parallel_in));
+      BOOST_REQUIRE(std::dynamic_pointer_cast<parallel_snapshot_reader>(make_binary_snapshot_reader(parallel_in)));
+
+      auto binary_writer = buffered_snapshot_suite::get_writer();
+      chain.control->write_snapshot(binary_writer);
+      std::istringstream binary_in(buffered_snapshot_suite::finalize(binary_writer));
+      BOOST_REQUIRE(!parallel_snapshot_reader::is_parallel_snapshot(binary_in));
+      BOOST_REQUIRE(std::dynamic_pointer_cast<istream_snapshot_reader>(make_binary_snapshot_reader(binary_in)));
+   }
+
+   // the first chunk written follows the header, whichever section it belongs to
+   const size_t header_size = sizeof(parallel_snapshot_writer::magic_number) + sizeof(current_snapshot_version);
+   snapshot[header_size] ^= 0x5a;
+   BOOST_REQUIRE_THROW(snapshotted_tester(chain.get_config(), parallel_snapshot_suite::get_reader(snapshot), 1), snapshot_exception);
+}
+
+BOOST_AUTO_TEST_CASE(test_parallel_snapshot_background_write)
+{
+   tester chain;
+
+   chain.create_account(N(snapshot));
+   chain.produce_blocks(1);
+   chain.set_code(N(snapshot), snapshot_test_wast);
+   chain.set_abi(N(snapshot), snapshot_test_abi);
+   chain.produce_blocks(1);
+   chain.control->abort_block();
+   auto expected_integrity_hash = chain.control->calculate_integrity_hash();
+
+   // capture the rows without waiting for them to be written, then with a buffer of a single chunk, smaller than the state
+   uint32_t ordinal = 1;
+   for (uint32_t max_chunks : {std::numeric_limits<uint32_t>::max(), 1u}) {
+      auto writer = parallel_snapshot_suite::get_writer();
+      writer->set_max_buffered_chunks(max_chunks);
+      chain.control->write_snapshot(writer);
+      const auto head_num = chain.control->head_block_num();
+      // every section is cut into chunks of its own, so the state spans more than the single chunk buffer
+      BOOST_REQUIRE_GT(writer->progress().chunks_total, 1u);
+
+      // keep producing blocks while the snapshot is written on another thread
+      std::string snapshot;
+      std::thread background([&]() { snapshot = parallel_snapshot_suite::finalize(writer); });
+      for (int itr = 0; itr < 4; itr++) {
+         chain.push_action(N(snapshot), N(increment), N(snapshot), mutable_variant_object()
+            ( "value", 1 )
+         );
+         chain.produce_block();
+      }
+      background.join();
+      BOOST_REQUIRE_EQUAL(chain.control->head_block_num(), head_num + 4);
+
+      const auto progress = writer->progress();
+      BOOST_REQUIRE_EQUAL(progress.chunks_written, progress.chunks_total);
+      BOOST_REQUIRE_GT(progress.bytes_written, 0u);
+
+      snapshotted_tester snap_chain(chain.get_config(), parallel_snapshot_suite::get_reader(snapshot), ordinal++);
+      BOOST_REQUIRE_EQUAL(expected_integrity_hash.str(), snap_chain.control->calculate_integrity_hash().str());
+
+      chain.control->abort_block();
+      expected_integrity_hash = chain.control->calculate_integrity_hash();
+   }
+}
+
+BOOST_AUTO_TEST_CASE(test_delta_snapshot_chain)
+{
+   tester chain;
+
+   chain.create_account(N(snapshot));
+   chain.produce_blocks(1);
+   chain.set_code(N(snapshot), snapshot_test_wast);
+   chain.set_abi(N(snapshot), snapshot_test_abi);
+   chain.produce_blocks(1);
+   chain.control->abort_block();
+
+   auto increment = [&]( int blocks ) {
+      for (int itr = 0; itr < blocks; itr++) {
+         chain.push_action(N(snapshot), N(increment), N(snapshot), mutable_variant_object()
+            ( "value", 1 )
+         );
+         chain.produce_block();
+      }
+      chain.control->abort_block();
+   };
+
+   auto writer = parallel_snapshot_suite::get_writer();
+   chain.control->write_snapshot(writer);
+   const auto full = parallel_snapshot_suite::finalize(writer);
+
+   // each delta is written against the full snapshot and the deltas before it
+   std::vector<std::string> deltas;
+   auto base_reader = [&]( size_t delta_count ) {
+      std::shared_ptr<packed_snapshot_reader> reader = parallel_snapshot_suite::get_reader(full);
+      for (size_t i = 0; i < delta_count; i++) {
+         reader = std::make_shared<delta_snapshot_reader>(reader, parallel_snapshot_suite::get_reader(deltas[i]));
+      }
+      return reader;
+   };
+
+   for (int generation = 0; generation < 3; generation++) {
+      increment(3);
+
+      std::ostringstream out;
+      auto delta_writer = std::make_shared<delta_snapshot_writer>(base_reader(deltas.size()), out, parallel_snapshot_suite::threads);
+      chain.control->write_snapshot(delta_writer);
+      delta_writer->finalize();
+      deltas.emplace_back(out.str());
+      BOOST_REQUIRE_LT(deltas.back().size(), full.size());
+
+      // the state rebuilt from the chain of deltas hashes to the state of the chain
+      auto rebuilt = base_reader(deltas.size());
+      rebuilt->validate();
+      BOOST_REQUIRE_EQUAL(chain.control->calculate_integrity_hash().str(), calculate_integrity_hash(*rebuilt).str());
+   }
+
+   // and a chain can start from it
+   snapshotted_tester snap_chain(chain.get_config(), base_reader(deltas.size()), 1);
+   BOOST_REQUIRE_EQUAL(chain.control->calculate_integrity_hash().str(), snap_chain.control->calculate_integrity_hash().str());
+
+   // a delta does not apply onto another base
+   auto wrong_base = std::make_shared<delta_snapshot_reader>(parallel_snapshot_suite::get_reader(full),
+                                                             parallel_snapshot_suite::get_reader(deltas.back()));
+   BOOST_REQUIRE_THROW(wrong_base->validate(), snapshot_validation_exception);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -7,6 +7,8 @@
 #include <snax/chain/resource_limits.hpp>
 #include <snax/chain/exceptions.hpp>
 #include <snax/chain/wast_to_wasm.hpp>
+#include <snax/chain/webassembly/wavm_code_cache.hpp>
+#include <snax/chain/wasm_instantiation_cache.hpp>
 #include <asserter/asserter.wast.hpp>
 #include <asserter/asserter.abi.hpp>
 
@@ -27,6 +29,9 @@
 #include "test_softfloat_wasts.hpp"
 
 #include <array>
+#include <chrono>
+#include <fstream>
+#include <thread>
 #include <utility>
 
 #include "incbin.h"
@@ -1935,4 +1940,239 @@ BOOST_FIXTURE_TEST_CASE(weighted_net_usage_tests, tester ) try {
 } FC_LOG_AND_RETHROW()
 #endif
 
+BOOST_AUTO_TEST_CASE( wavm_code_cache_test ) try {
+   using snax::chain::webassembly::wavm::wavm_code_cache;
+   fc::temp_directory tempdir;
+
+   const auto id_a = digest_type::hash( string("a") );
+   const auto id_b = digest_type::hash( string("b") );
+   const std::vector<uint8_t> code_a( 1000, 0xaa );
+   const std::vector<uint8_t> code_b( 1000, 0xbb );
+
+   {
+      wavm_code_cache cache( tempdir.path(), 1024*1024, "v1" );
+      BOOST_REQUIRE( cache.get( id_a ).empty() );
+      cache.put( id_a, code_a );
+      cache.put( id_b, code_b );
+      BOOST_REQUIRE( cache.get( id_a ) == code_a );
+      BOOST_REQUIRE( cache.get( id_b ) == code_b );
+   }
+
+   // entries survive a restart but not a change of code generator
+   {
+      wavm_code_cache cache( tempdir.path(), 1024*1024, "v1" );
+      BOOST_REQUIRE( cache.get( id_a ) == code_a );
+   }
+   {
+      wavm_code_cache cache( tempdir.path(), 1024*1024, "v2" );
+      BOOST_REQUIRE( cache.get( id_a ).empty() );
+      BOOST_REQUIRE( cache.get( id_b ).empty() );
+      BOOST_REQUIRE_EQUAL( cache.size(), 0u );
+   }
+
+   // the least recently used entry is evicted when the cache is full
+   {
+      wavm_code_cache cache( tempdir.path(), 2500, "v1" );
+      cache.put( id_a, code_a );
+      cache.put( id_b, code_b );
+      BOOST_REQUIRE( cache.get( id_a ) == code_a );
+      const auto id_c = digest_type::hash( string("c") );
+      cache.put( id_c, code_a );
+      BOOST_REQUIRE( cache.get( id_b ).empty() );
+      BOOST_REQUIRE( cache.get( id_a ) == code_a );
+      BOOST_REQUIRE( cache.get( id_c ) == code_a );
+      BOOST_REQUIRE( cache.size() <= cache.max_size() );
+   }
+
+   // corrupted entries are discarded
+   {
+      const auto p = tempdir.path() / (id_a.str() + ".wavm");
+      std::fstream file( p.generic_string(), std::ios::in | std::ios::out | std::ios::binary );
+      file.seekp( -1, std::ios::end );
+      file.put( 0 );
+      file.close();
+
+      wavm_code_cache cache( tempdir.path(), 2500, "v1" );
+      BOOST_REQUIRE( cache.get( id_a ).empty() );
+      BOOST_REQUIRE( !fc::exists( p ) );
+   }
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_CASE( wasm_instantiation_cache_pinned_over_budget ) try {
+   struct sized_module : wasm_instantiated_module_interface {
+      explicit sized_module( size_t s ) : size(s) {}
+      void apply( apply_context& ) override {}
+      size_t resident_size() const override { return size; }
+      size_t size;
+   };
+   auto module = []( size_t size ) { return std::make_unique<sized_module>( size ); };
+   auto id = []( const char* s ) { return fc::sha256::hash( std::string(s) ); };
+
+   wasm_instantiation_cache cache( 100 );
+
+   // a pinned module over budget with nothing evictable
+   cache.insert( id("pinned_a"), module(150), true );
+   BOOST_REQUIRE_EQUAL( cache.stats().entries, 1u );
+   BOOST_REQUIRE_EQUAL( cache.stats().resident_bytes, 150u );
+
+   // an unpinned module is only evicted once everything else was, and pinned modules never are
+   cache.insert( id("unpinned_a"), module(10), false );
+   BOOST_REQUIRE( cache.contains( id("unpinned_a") ) );
+
+   // another pinned module evicts every unpinned one and still stays over budget
+   cache.insert( id("pinned_b"), module(20), true );
+   BOOST_REQUIRE( !cache.contains( id("unpinned_a") ) );
+   BOOST_REQUIRE( cache.contains( id("pinned_a") ) );
+   BOOST_REQUIRE( cache.contains( id("pinned_b") ) );
+   BOOST_REQUIRE_EQUAL( cache.stats().entries, 2u );
+   BOOST_REQUIRE_EQUAL( cache.stats().pinned_entries, 2u );
+   BOOST_REQUIRE_EQUAL( cache.stats().evictions, 1u );
+   BOOST_REQUIRE_EQUAL( cache.stats().resident_bytes, 170u );
+
+   BOOST_REQUIRE( cache.get( id("pinned_b") ) != nullptr );
+   BOOST_REQUIRE( cache.get( id("unpinned_a") ) == nullptr );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_CASE( wasm_instantiation_cache_test ) try {
+   const char* first_wast = R"=====(
+(module
+ (export "apply" (func $apply))
+ (memory $0 1)
+ (data (i32.const 8) "first")
+ (func $apply (param $0 i64) (param $1 i64) (param $2 i64))
+)
+)=====";
+   const char* second_wast = R"=====(
+(module
+ (export "apply" (func $apply))
+ (memory $0 1)
+ (data (i32.const 8) "second")
+ (func $apply (param $0 i64) (param $1 i64) (param $2 i64))
+)
+)=====";
+
+   tester chain;
+   controller::config cfg = chain.get_config();
+   chain.close();
+   // evict every contract that is not pinned as soon as another one is instantiated
+   cfg.wasm_cache_size = 1;
+   chain.init( cfg );
+
+   chain.create_accounts( {N(first), N(second)} );
+   chain.set_code( N(first), first_wast );
+   chain.set_code( N(second), second_wast );
+   chain.produce_block();
+
+   auto call = [&]( account_name account ) {
+      signed_transaction trx;
+      trx.actions.emplace_back( vector<permission_level>{{account, config::active_name}}, account, N(go), bytes() );
+      chain.set_transaction_headers( trx );
+      trx.sign( chain.get_private_key( account, "active" ), chain.control->get_chain_id() );
+      chain.push_transaction( trx );
+      chain.produce_block();
+   };
+
+   const auto& wasmif = chain.control->get_wasm_interface();
+   const auto before = wasmif.get_cache_stats();
+   call( N(first) );
+   call( N(second) );
+   call( N(first) );
+   const auto after = wasmif.get_cache_stats();
+
+   BOOST_REQUIRE_GE( after.misses - before.misses, 3u );
+   BOOST_REQUIRE_GE( after.evictions - before.evictions, 2u );
+   // the system contract applied by onblock is pinned, and is hit once per block
+   BOOST_REQUIRE_GE( after.pinned_entries, 1u );
+   BOOST_REQUIRE_GE( after.hits - before.hits, 3u );
+   BOOST_REQUIRE_EQUAL( after.entries - after.pinned_entries, 1u );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_CASE( wasm_background_compile ) try {
+   // fails the "fail" action and accepts any other
+   const std::string fail_action = std::to_string( N(fail) );
+   const std::string wast = R"=====(
+(module
+ (import "env" "snax_assert" (func $snax_assert (param i32 i32)))
+ (export "apply" (func $apply))
+ (memory $0 1)
+ (data (i32.const 8) "failed")
+ (func $apply (param $0 i64) (param $1 i64) (param $2 i64)
+  (if (i64.eq (get_local $2) (i64.const )=====" + fail_action + R"=====())
+   (call $snax_assert (i32.const 0) (i32.const 8))
+  )
+ )
+)
+)=====";
+
+   tester chain;
+   controller::config cfg = chain.get_config();
+   chain.close();
+   cfg.wasm_runtime = wasm_interface::vm_type::wavm;
+   cfg.wasm_compile_threads = 1;
+   chain.init( cfg );
+
+   chain.create_accounts( {N(contract)} );
+   chain.produce_block();
+
+   auto action = [&]( action_name name ) {
+      return snax::chain::action( vector<permission_level>{{N(contract), config::active_name}}, N(contract), name, bytes() );
+   };
+   auto push = [&]( vector<snax::chain::action> actions ) {
+      signed_transaction trx;
+      trx.actions = std::move( actions );
+      chain.set_transaction_headers( trx );
+      trx.sign( chain.get_private_key( N(contract), "active" ), chain.control->get_chain_id() );
+      chain.push_transaction( trx );
+   };
+
+   // the contract is applied right after setcode queued its compilation, so the interpreter runs it
+   const auto wasm = wast_to_wasm( wast );
+   push( { snax::chain::action( vector<permission_level>{{N(contract), config::active_name}},
+                                setcode{ N(contract), 0, 0, bytes( wasm.begin(), wasm.end() ) } ),
+           action( N(go) ) } );
+   BOOST_REQUIRE_THROW( push( { action( N(fail) ) } ), snax_assert_message_exception );
+   chain.produce_block();
+
+   const auto& wasmif = chain.control->get_wasm_interface();
+   auto stats = wasmif.get_compile_stats();
+   BOOST_REQUIRE_GE( stats.interpreted_applies, 1u );
+
+   const auto deadline = fc::time_point::now() + fc::seconds( 60 );
+   while( stats.queue_depth && fc::time_point::now() < deadline ) {
+      std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+      stats = wasmif.get_compile_stats();
+   }
+   BOOST_REQUIRE_EQUAL( stats.queue_depth, 0u );
+   BOOST_REQUIRE_GE( stats.compiled, 1u );
+   BOOST_REQUIRE_EQUAL( stats.failed, 0u );
+
+   // the compiled module takes over and behaves as the interpreter did
+   push( { action( N(go) ) } );
+   BOOST_REQUIRE_THROW( push( { action( N(fail) ) } ), snax_assert_message_exception );
+   chain.produce_block();
+   const auto after = wasmif.get_compile_stats();
+   BOOST_REQUIRE_EQUAL( after.interpreted_applies, stats.interpreted_applies );
+   BOOST_REQUIRE_EQUAL( after.compiled, stats.compiled );
+
+   // a compiled module joins the instantiation cache, under its budget, when any contract is applied next
+   std::string other_wast = wast;
+   other_wast.replace( other_wast.find( "failed" ), 6, "denied" );
+   chain.create_accounts( {N(other)} );
+   chain.set_code( N(other), other_wast.c_str() );
+   chain.produce_block();
+   stats = wasmif.get_compile_stats();
+   const auto other_deadline = fc::time_point::now() + fc::seconds( 60 );
+   while( stats.queue_depth && fc::time_point::now() < other_deadline ) {
+      std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+      stats = wasmif.get_compile_stats();
+   }
+   BOOST_REQUIRE_EQUAL( stats.queue_depth, 0u );
+   BOOST_REQUIRE_EQUAL( stats.compiled, after.compiled + 1 );
+
+   const auto entries = wasmif.get_cache_stats().entries;
+   push( { action( N(go) ) } );
+   BOOST_REQUIRE_EQUAL( wasmif.get_cache_stats().entries, entries + 1 );
+   BOOST_REQUIRE_EQUAL( wasmif.get_compile_stats().interpreted_applies, stats.interpreted_applies );
+} FC_LOG_AND_RETHROW()
+
 BOOST_AUTO_TEST_SUITE_END()